@@ -16,8 +16,31 @@ DECLARE_bool(debug);
 DECLARE_bool(always_disasm);
 
 DECLARE_bool(validate_hir);
+DECLARE_bool(trace_context_promotion);
+DECLARE_bool(trace_register_allocation);
+
+DECLARE_bool(runtime_tiered);
+DECLARE_int32(runtime_tier_up_threshold);
+
+DECLARE_bool(ivm_superinstructions);
 
 DECLARE_uint64(break_on_instruction);
 DECLARE_uint64(break_on_memory);
 
+DECLARE_bool(x64_enable_avx2);
+DECLARE_bool(x64_enable_fma);
+DECLARE_bool(x64_enable_bmi2);
+DECLARE_bool(x64_enable_movbe);
+DECLARE_bool(x64_enable_f16c);
+
+DECLARE_string(x64_code_cache_path);
+DECLARE_int32(x64_code_cache_limit_mb);
+
+DECLARE_bool(ppc_inline_save_restore);
+DECLARE_int32(ppc_inline_max_instrs);
+
+DECLARE_bool(x64_indirect_call_stats);
+DECLARE_bool(ppc_global_lock_stats);
+DECLARE_string(translation_profile_path);
+
 #endif  // ALLOY_ALLOY_PRIVATE_H_
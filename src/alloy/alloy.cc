@@ -27,8 +27,72 @@ DEFINE_bool(
 DEFINE_bool(validate_hir, false,
             "Perform validation checks on the HIR during compilation.");
 
+DEFINE_bool(trace_context_promotion, false,
+            "Log context loads seen and promoted across blocks for each "
+            "translated function.");
+DEFINE_bool(trace_register_allocation, false,
+            "Log instruction counts before/after register allocation and "
+            "spill/coalescing stats for each translated function.");
+
+// Tiered execution:
+DEFINE_bool(runtime_tiered, false,
+            "Run new functions on the interpreter first and only translate "
+            "them to x64 once they have been entered enough times.");
+DEFINE_int32(runtime_tier_up_threshold, 1000,
+             "Entries of an interpreted function before it is retranslated "
+             "with the full pipeline (--runtime_tiered).");
+
+// Interpreter:
+DEFINE_bool(ivm_superinstructions, true,
+            "Fuse common intcode sequences into single intcodes.");
+
 // Breakpoints:
 DEFINE_uint64(break_on_instruction, 0,
               "int3 before the given guest address is executed.");
 DEFINE_uint64(break_on_memory, 0,
               "int3 on read/write to the given memory address.");
+
+// Code generation:
+// Each only allows the instructions; they're still used only if the host has
+// them. Turning them off forces the fallback sequences, for testing.
+DEFINE_bool(x64_enable_avx2, true,
+            "Use AVX2 sequences (vpermd, vpbroadcast, variable vector "
+            "shifts) when the host supports them.");
+DEFINE_bool(x64_enable_fma, true,
+            "Use FMA3 for fused multiply-add/subtract when the host supports "
+            "it.");
+DEFINE_bool(x64_enable_bmi2, true,
+            "Use BMI2 shifts/rotates (shlx/shrx/sarx/rorx) when the host "
+            "supports them.");
+DEFINE_bool(x64_enable_movbe, true,
+            "Fuse byte swapped loads/stores into movbe when the host "
+            "supports it.");
+DEFINE_bool(x64_enable_f16c, true,
+            "Use F16C for half float pack/unpack when the host supports it.");
+
+// Code cache:
+DEFINE_string(x64_code_cache_path, "",
+              "File to persist translated x64 code in and reuse on later "
+              "runs. Empty to disable.");
+DEFINE_int32(x64_code_cache_limit_mb, 0,
+             "Soft limit on the size of translated x64 code. Least recently "
+             "used functions are evicted past it. 0 for no limit.");
+
+// Inlining:
+DEFINE_bool(ppc_inline_save_restore, true,
+            "Inline calls to the __savegprlr/__restgprlr-style helpers into "
+            "their callers.");
+DEFINE_int32(ppc_inline_max_instrs, 16,
+             "Inline leaf functions up to this many instructions into their "
+             "callers. 0 to disable.");
+
+// Profiling:
+DEFINE_string(translation_profile_path, "",
+              "Write per-function translation timings (phases, compiler "
+              "passes, HIR/code sizes) as CSV to the given file at exit.");
+DEFINE_bool(x64_indirect_call_stats, false,
+            "Count inline cache/dispatch table hits per indirect call site and "
+            "dump them on shutdown.");
+DEFINE_bool(ppc_global_lock_stats, false,
+            "Take the mtmsr global lock out of line and log hold/wait times "
+            "and contention per call site on shutdown.");
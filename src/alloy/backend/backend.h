@@ -16,6 +16,8 @@
 
 namespace alloy {
 namespace runtime {
+class Function;
+class FunctionInfo;
 class Runtime;
 }  // namespace runtime
 }  // namespace alloy
@@ -38,8 +40,30 @@ class Backend {
   virtual void* AllocThreadData();
   virtual void FreeThreadData(void* thread_data);
 
+  // Brackets host code resolving and calling guest functions on a thread.
+  // Functions resolved in between stay valid until the matching LeaveGuest.
+  // Brackets may nest.
+  virtual void EnterGuest(void* thread_data, const void* stack_top) {}
+  virtual void LeaveGuest(void* thread_data) {}
+
   virtual std::unique_ptr<Assembler> CreateAssembler() = 0;
 
+  // Produces the function from a previous run's translation, if the backend
+  // keeps one and it is still valid. Returns 0 on success.
+  virtual int LoadCachedFunction(runtime::FunctionInfo* symbol_info,
+                                 runtime::Function** out_function) {
+    return 1;
+  }
+
+  // Makes a function translated for the first tier of --runtime_tiered
+  // callable from this backend's code, taking ownership of it. The wrapper
+  // is expected to count entries and have the runtime promote it once it's
+  // hot. Returns 0 on success.
+  virtual int WrapTier0Function(runtime::Function* tier0_function,
+                                runtime::Function** out_function) {
+    return 1;
+  }
+
  protected:
   runtime::Runtime* runtime_;
   MachineInfo machine_info_;
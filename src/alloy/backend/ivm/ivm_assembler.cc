@@ -9,6 +9,8 @@
 
 #include <alloy/backend/ivm/ivm_assembler.h>
 
+#include <alloy/alloy-private.h>
+
 #include <alloy/reset_scope.h>
 #include <alloy/backend/backend.h>
 #include <alloy/backend/ivm/ivm_intcode.h>
@@ -114,6 +116,9 @@ int IVMAssembler::Assemble(FunctionInfo* symbol_info, HIRBuilder* builder,
   }
 
   fn->Setup(ctx);
+  if (FLAGS_ivm_superinstructions) {
+    fn->FuseIntCodes();
+  }
 
   *out_function = fn;
   return 0;
@@ -27,7 +27,8 @@ IVMFunction::IVMFunction(FunctionInfo* symbol_info)
       intcode_count_(0),
       intcodes_(nullptr),
       source_map_count_(0),
-      source_map_(nullptr) {}
+      source_map_(nullptr),
+      breakpoint_count_(0) {}
 
 IVMFunction::~IVMFunction() {
   free(intcodes_);
@@ -43,6 +44,10 @@ void IVMFunction::Setup(TranslationContext& ctx) {
   source_map_ = (SourceMapEntry*)ctx.source_map_arena->CloneContents();
 }
 
+uint32_t IVMFunction::FuseIntCodes() {
+  return ivm::FuseIntCodes(intcodes_, intcode_count_);
+}
+
 IntCode* IVMFunction::GetIntCodeAtSourceOffset(uint64_t offset) {
   for (size_t n = 0; n < source_map_count_; n++) {
     auto entry = &source_map_[n];
@@ -68,6 +73,7 @@ int IVMFunction::AddBreakpointImpl(Breakpoint* breakpoint) {
 
   // Increment breakpoint counter.
   ++i->debug_flags;
+  ++breakpoint_count_;
 
   return 0;
 }
@@ -80,6 +86,7 @@ int IVMFunction::RemoveBreakpointImpl(Breakpoint* breakpoint) {
 
   // Decrement breakpoint counter.
   --i->debug_flags;
+  --breakpoint_count_;
   i->src2_reg = i->src3_reg = 0;
 
   // If there were other breakpoints, see what they were.
@@ -95,7 +102,8 @@ int IVMFunction::RemoveBreakpointImpl(Breakpoint* breakpoint) {
   return 0;
 }
 
-void IVMFunction::OnBreakpointHit(ThreadState* thread_state, IntCode* i) {
+void IVMFunction::OnBreakpointHit(ThreadState* thread_state,
+                                  const IntCode* i) {
   uint64_t breakpoint_ptr = i->src2_reg | (uint64_t(i->src3_reg) << 32);
   Breakpoint* breakpoint = (Breakpoint*)breakpoint_ptr;
 
@@ -105,11 +113,12 @@ void IVMFunction::OnBreakpointHit(ThreadState* thread_state, IntCode* i) {
   debugger->OnBreakpointHit(thread_state, breakpoint);
 }
 
-#undef TRACE_SOURCE_OFFSET
-
 int IVMFunction::CallImpl(ThreadState* thread_state, uint64_t return_address) {
   // Setup register file on stack.
-  auto stack = (IVMStack*)thread_state->backend_data();
+  // Running as the first tier under another backend, if it has its own data.
+  auto stack = (IVMStack*)(thread_state->tier0_backend_data()
+                               ? thread_state->tier0_backend_data()
+                               : thread_state->backend_data());
   auto register_file = (Register*)stack->Alloc(register_count_);
   auto local_stack = (uint8_t*)alloca(stack_size_);
 
@@ -120,50 +129,28 @@ int IVMFunction::CallImpl(ThreadState* thread_state, uint64_t return_address) {
   ics.locals = local_stack;
   ics.context = (uint8_t*)thread_state->raw_context();
   ics.membase = memory->membase();
-  ics.page_table = ics.membase + memory->page_table();
   ics.did_carry = 0;
   ics.did_saturate = 0;
   ics.thread_state = thread_state;
   ics.return_address = return_address;
   ics.call_return_address = 0;
+  ics.intcodes = intcodes_;
 
 // TODO(benvanik): DID_CARRY -- need HIR to set a OPCODE_FLAG_SET_CARRY
 //                 or something so the fns can set an ics flag.
 
-#ifdef TRACE_SOURCE_OFFSET
-  size_t source_index = 0;
-#endif
-
-  uint32_t ia = 0;
-  while (true) {
-#ifdef TRACE_SOURCE_OFFSET
-    uint64_t source_offset = -1;
-    if (source_index < this->source_map_count_ &&
-        this->source_map_[source_index].intcode_index <= ia) {
-      while (source_index + 1 < this->source_map_count_ &&
-             this->source_map_[source_index + 1].intcode_index <= ia) {
-        source_index++;
-      }
-      source_offset = this->source_map_[source_index].source_offset;
+  const IntCode* i = intcodes_;
+  if (!breakpoint_count_) {
+    while (i) {
+      i = i->intcode_fn(ics, i);
     }
-#endif
-
-    IntCode* i = &intcodes_[ia];
-
-    if (i->debug_flags) {
-      OnBreakpointHit(thread_state, i);
-    }
-
-    uint32_t new_ia = i->intcode_fn(ics, i);
-    if (new_ia == IA_NEXT) {
-      ia++;
-    } else if (new_ia == IA_RETURN) {
-      break;
-    } else {
-      ia = new_ia;
-#ifdef TRACE_SOURCE_OFFSET
-      source_index = 0;
-#endif
+  } else {
+    // Breakpoints added after this point are only seen by later calls.
+    while (i) {
+      if (i->debug_flags) {
+        OnBreakpointHit(thread_state, i);
+      }
+      i = i->intcode_fn(ics, i);
     }
   }
 
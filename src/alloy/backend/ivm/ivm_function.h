@@ -10,6 +10,8 @@
 #ifndef ALLOY_BACKEND_IVM_IVM_FUNCTION_H_
 #define ALLOY_BACKEND_IVM_IVM_FUNCTION_H_
 
+#include <atomic>
+
 #include <alloy/backend/ivm/ivm_intcode.h>
 #include <alloy/runtime/function.h>
 #include <alloy/runtime/symbol_info.h>
@@ -24,6 +26,9 @@ class IVMFunction : public runtime::Function {
   virtual ~IVMFunction();
 
   void Setup(TranslationContext& ctx);
+  // Replaces common sequences with superinstructions. Returns the number
+  // fused.
+  uint32_t FuseIntCodes();
 
  protected:
   virtual int AddBreakpointImpl(runtime::Breakpoint* breakpoint);
@@ -33,7 +38,7 @@ class IVMFunction : public runtime::Function {
 
  private:
   IntCode* GetIntCodeAtSourceOffset(uint64_t offset);
-  void OnBreakpointHit(runtime::ThreadState* thread_state, IntCode* i);
+  void OnBreakpointHit(runtime::ThreadState* thread_state, const IntCode* i);
 
  private:
   size_t register_count_;
@@ -42,6 +47,8 @@ class IVMFunction : public runtime::Function {
   IntCode* intcodes_;
   size_t source_map_count_;
   SourceMapEntry* source_map_;
+  // Intcodes with breakpoints. Only checked for while nonzero.
+  std::atomic<uint32_t> breakpoint_count_;
 };
 
 }  // namespace ivm
@@ -51,10 +51,10 @@ using alloy::runtime::FunctionInfo;
 //  if (ics.thread_state->thread_id() == 1) printf
 //#define DFLUSH() fflush(stdout)
 
-uint32_t IntCode_INT_LOAD_CONSTANT(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_INT_LOAD_CONSTANT(IntCodeState& ics, const IntCode* i) {
   // TODO(benvanik): optimize on type to avoid 16b copy per load.
   ics.rf[i->dest_reg].v128 = i->constant.v128;
-  return IA_NEXT;
+  return i + 1;
 }
 
 uint32_t AllocConstant(TranslationContext& ctx, uint64_t value,
@@ -142,8 +142,8 @@ uint32_t AllocOpRegister(TranslationContext& ctx, OpcodeSignatureType sig_type,
   return 0;
 }
 
-uint32_t IntCode_INVALID(IntCodeState& ics, const IntCode* i);
-uint32_t IntCode_INVALID_TYPE(IntCodeState& ics, const IntCode* i);
+const IntCode* IntCode_INVALID(IntCodeState& ics, const IntCode* i);
+const IntCode* IntCode_INVALID_TYPE(IntCodeState& ics, const IntCode* i);
 int DispatchToC(TranslationContext& ctx, Instr* i, IntCodeFn fn) {
   assert_true(fn != IntCode_INVALID);
   assert_true(fn != IntCode_INVALID_TYPE);
@@ -179,24 +179,24 @@ int DispatchToC(TranslationContext& ctx, Instr* i, IntCodeFn fn) {
   return 0;
 }
 
-uint32_t IntCode_INVALID(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_INVALID(IntCodeState& ics, const IntCode* i) {
   assert_always();
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_INVALID_TYPE(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_INVALID_TYPE(IntCodeState& ics, const IntCode* i) {
   assert_always();
-  return IA_NEXT;
+  return i + 1;
 }
 int TranslateInvalid(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_INVALID);
 }
 
-uint32_t IntCode_COMMENT(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMMENT(IntCodeState& ics, const IntCode* i) {
   char* value = (char*)(i->src1_reg | ((uint64_t)i->src2_reg << 32));
   (void)(value);
   IPRINT("XE[t] :%d: %s\n", ics.thread_state->thread_id(), value);
   IFLUSH();
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_COMMENT(TranslationContext& ctx, Instr* i) {
   ctx.intcode_count++;
@@ -212,13 +212,15 @@ int Translate_COMMENT(TranslationContext& ctx, Instr* i) {
   return 0;
 }
 
-uint32_t IntCode_NOP(IntCodeState& ics, const IntCode* i) { return IA_NEXT; }
+const IntCode* IntCode_NOP(IntCodeState& ics, const IntCode* i) {
+  return i + 1;
+}
 int Translate_NOP(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_NOP);
 }
 
-uint32_t IntCode_SOURCE_OFFSET(IntCodeState& ics, const IntCode* i) {
-  return IA_NEXT;
+const IntCode* IntCode_SOURCE_OFFSET(IntCodeState& ics, const IntCode* i) {
+  return i + 1;
 }
 int Translate_SOURCE_OFFSET(TranslationContext& ctx, Instr* i) {
   int result = DispatchToC(ctx, i, IntCode_SOURCE_OFFSET);
@@ -233,7 +235,7 @@ int Translate_SOURCE_OFFSET(TranslationContext& ctx, Instr* i) {
 }
 
 // TODO(benvanik): dispatch of register forms.
-uint32_t IntCode_TRACE_SOURCE(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRACE_SOURCE(IntCodeState& ics, const IntCode* i) {
   uint64_t trace_base = ics.thread_state->memory()->trace_base();
   if (trace_base) {
     auto ev = xdb::protocol::InstrEvent::Append(trace_base);
@@ -241,56 +243,62 @@ uint32_t IntCode_TRACE_SOURCE(IntCodeState& ics, const IntCode* i) {
     ev->thread_id = ics.thread_state->thread_id();
     ev->address = ics.rf[i->src1_reg].i32;
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_TRACE_SOURCE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_TRACE_SOURCE);
 }
 
-uint32_t IntCode_DEBUG_BREAK(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DEBUG_BREAK(IntCodeState& ics, const IntCode* i) {
   DFLUSH();
   __debugbreak();
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_DEBUG_BREAK(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_DEBUG_BREAK);
 }
 
-uint32_t IntCode_DEBUG_BREAK_TRUE_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DEBUG_BREAK_TRUE_I8(IntCodeState& ics,
+                                           const IntCode* i) {
   if (ics.rf[i->src1_reg].u8) {
     return IntCode_DEBUG_BREAK(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DEBUG_BREAK_TRUE_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DEBUG_BREAK_TRUE_I16(IntCodeState& ics,
+                                            const IntCode* i) {
   if (ics.rf[i->src1_reg].u16) {
     return IntCode_DEBUG_BREAK(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DEBUG_BREAK_TRUE_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DEBUG_BREAK_TRUE_I32(IntCodeState& ics,
+                                            const IntCode* i) {
   if (ics.rf[i->src1_reg].u32) {
     return IntCode_DEBUG_BREAK(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DEBUG_BREAK_TRUE_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DEBUG_BREAK_TRUE_I64(IntCodeState& ics,
+                                            const IntCode* i) {
   if (ics.rf[i->src1_reg].u64) {
     return IntCode_DEBUG_BREAK(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DEBUG_BREAK_TRUE_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DEBUG_BREAK_TRUE_F32(IntCodeState& ics,
+                                            const IntCode* i) {
   if (ics.rf[i->src1_reg].f32) {
     return IntCode_DEBUG_BREAK(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DEBUG_BREAK_TRUE_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DEBUG_BREAK_TRUE_F64(IntCodeState& ics,
+                                            const IntCode* i) {
   if (ics.rf[i->src1_reg].f64) {
     return IntCode_DEBUG_BREAK(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_DEBUG_BREAK_TRUE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -302,58 +310,58 @@ int Translate_DEBUG_BREAK_TRUE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_TRAP(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRAP(IntCodeState& ics, const IntCode* i) {
   // TODO(benvanik): post software interrupt to debugger.
   switch (i->flags) {
     case 20:
       // 0x0FE00014 is a 'debug print' where r3 = buffer r4 = length
-      return IA_NEXT;
+      return i + 1;
     case 22:
       // Always trap?
       break;
   }
   __debugbreak();
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_TRAP(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_TRAP);
 }
 
-uint32_t IntCode_TRAP_TRUE_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRAP_TRUE_I8(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u8) {
     return IntCode_TRAP(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_TRAP_TRUE_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRAP_TRUE_I16(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u16) {
     return IntCode_TRAP(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_TRAP_TRUE_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRAP_TRUE_I32(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u32) {
     return IntCode_TRAP(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_TRAP_TRUE_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRAP_TRUE_I64(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u64) {
     return IntCode_TRAP(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_TRAP_TRUE_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRAP_TRUE_F32(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].f32) {
     return IntCode_TRAP(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_TRAP_TRUE_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRAP_TRUE_F64(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].f64) {
     return IntCode_TRAP(ics, i);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_TRAP_TRUE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -364,7 +372,8 @@ int Translate_TRAP_TRUE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_CALL_XX(IntCodeState& ics, const IntCode* i, uint32_t reg) {
+const IntCode* IntCode_CALL_XX(IntCodeState& ics, const IntCode* i,
+                               uint32_t reg) {
   FunctionInfo* symbol_info = (FunctionInfo*)ics.rf[reg].u64;
   Function* fn = symbol_info->function();
   if (!fn) {
@@ -378,50 +387,50 @@ uint32_t IntCode_CALL_XX(IntCodeState& ics, const IntCode* i, uint32_t reg) {
   if (i->flags & CALL_TAIL) {
     return IA_RETURN;
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL(IntCodeState& ics, const IntCode* i) {
   return IntCode_CALL_XX(ics, i, i->src1_reg);
 }
 int Translate_CALL(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_CALL);
 }
 
-uint32_t IntCode_CALL_TRUE_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_TRUE_I8(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u8) {
     return IntCode_CALL_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL_TRUE_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_TRUE_I16(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u16) {
     return IntCode_CALL_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL_TRUE_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_TRUE_I32(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u32) {
     return IntCode_CALL_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL_TRUE_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_TRUE_I64(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u64) {
     return IntCode_CALL_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL_TRUE_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_TRUE_F32(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].f32) {
     return IntCode_CALL_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL_TRUE_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_TRUE_F64(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].f64) {
     return IntCode_CALL_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_CALL_TRUE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -432,8 +441,8 @@ int Translate_CALL_TRUE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_CALL_INDIRECT_XX(IntCodeState& ics, const IntCode* i,
-                                  uint32_t reg) {
+const IntCode* IntCode_CALL_INDIRECT_XX(IntCodeState& ics, const IntCode* i,
+                                        uint32_t reg) {
   uint64_t target = ics.rf[reg].u32;
 
   // Check if return address - if so, return.
@@ -454,50 +463,56 @@ uint32_t IntCode_CALL_INDIRECT_XX(IntCodeState& ics, const IntCode* i,
   if (i->flags & CALL_TAIL) {
     return IA_RETURN;
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL_INDIRECT(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_INDIRECT(IntCodeState& ics, const IntCode* i) {
   return IntCode_CALL_INDIRECT_XX(ics, i, i->src1_reg);
 }
 int Translate_CALL_INDIRECT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_CALL_INDIRECT);
 }
 
-uint32_t IntCode_CALL_INDIRECT_TRUE_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_INDIRECT_TRUE_I8(IntCodeState& ics,
+                                             const IntCode* i) {
   if (ics.rf[i->src1_reg].u8) {
     return IntCode_CALL_INDIRECT_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL_INDIRECT_TRUE_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_INDIRECT_TRUE_I16(IntCodeState& ics,
+                                              const IntCode* i) {
   if (ics.rf[i->src1_reg].u16) {
     return IntCode_CALL_INDIRECT_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL_INDIRECT_TRUE_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_INDIRECT_TRUE_I32(IntCodeState& ics,
+                                              const IntCode* i) {
   if (ics.rf[i->src1_reg].u32) {
     return IntCode_CALL_INDIRECT_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL_INDIRECT_TRUE_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_INDIRECT_TRUE_I64(IntCodeState& ics,
+                                              const IntCode* i) {
   if (ics.rf[i->src1_reg].u64) {
     return IntCode_CALL_INDIRECT_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL_INDIRECT_TRUE_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_INDIRECT_TRUE_F32(IntCodeState& ics,
+                                              const IntCode* i) {
   if (ics.rf[i->src1_reg].f32) {
     return IntCode_CALL_INDIRECT_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CALL_INDIRECT_TRUE_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_INDIRECT_TRUE_F64(IntCodeState& ics,
+                                              const IntCode* i) {
   if (ics.rf[i->src1_reg].f64) {
     return IntCode_CALL_INDIRECT_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_CALL_INDIRECT_TRUE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -509,55 +524,55 @@ int Translate_CALL_INDIRECT_TRUE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_CALL_EXTERN(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CALL_EXTERN(IntCodeState& ics, const IntCode* i) {
   return IntCode_CALL_XX(ics, i, i->src1_reg);
 }
 int Translate_CALL_EXTERN(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_CALL_EXTERN);
 }
 
-uint32_t IntCode_RETURN(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_RETURN(IntCodeState& ics, const IntCode* i) {
   return IA_RETURN;
 }
 int Translate_RETURN(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_RETURN);
 }
 
-uint32_t IntCode_RETURN_TRUE_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_RETURN_TRUE_I8(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u8) {
     return IA_RETURN;
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_RETURN_TRUE_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_RETURN_TRUE_I16(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u16) {
     return IA_RETURN;
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_RETURN_TRUE_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_RETURN_TRUE_I32(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u32) {
     return IA_RETURN;
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_RETURN_TRUE_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_RETURN_TRUE_I64(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u64) {
     return IA_RETURN;
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_RETURN_TRUE_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_RETURN_TRUE_F32(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].f32) {
     return IA_RETURN;
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_RETURN_TRUE_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_RETURN_TRUE_F64(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].f64) {
     return IA_RETURN;
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_RETURN_TRUE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -568,59 +583,60 @@ int Translate_RETURN_TRUE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_SET_RETURN_ADDRESS(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SET_RETURN_ADDRESS(IntCodeState& ics, const IntCode* i) {
   ics.call_return_address = ics.rf[i->src1_reg].u32;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_SET_RETURN_ADDRESS(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_SET_RETURN_ADDRESS);
 }
 
-uint32_t IntCode_BRANCH_XX(IntCodeState& ics, const IntCode* i, uint32_t reg) {
-  return ics.rf[reg].u32;
+const IntCode* IntCode_BRANCH_XX(IntCodeState& ics, const IntCode* i,
+                                 uint32_t reg) {
+  return ics.intcodes + ics.rf[reg].u32;
 }
-uint32_t IntCode_BRANCH(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH(IntCodeState& ics, const IntCode* i) {
   return IntCode_BRANCH_XX(ics, i, i->src1_reg);
 }
 int Translate_BRANCH(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_BRANCH);
 }
 
-uint32_t IntCode_BRANCH_TRUE_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_TRUE_I8(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u8) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BRANCH_TRUE_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_TRUE_I16(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u16) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BRANCH_TRUE_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_TRUE_I32(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u32) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BRANCH_TRUE_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_TRUE_I64(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].u64) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BRANCH_TRUE_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_TRUE_F32(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].f32) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BRANCH_TRUE_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_TRUE_F64(IntCodeState& ics, const IntCode* i) {
   if (ics.rf[i->src1_reg].f64) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_BRANCH_TRUE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -631,41 +647,41 @@ int Translate_BRANCH_TRUE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_BRANCH_FALSE_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_FALSE_I8(IntCodeState& ics, const IntCode* i) {
   if (!ics.rf[i->src1_reg].u8) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BRANCH_FALSE_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_FALSE_I16(IntCodeState& ics, const IntCode* i) {
   if (!ics.rf[i->src1_reg].u16) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BRANCH_FALSE_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_FALSE_I32(IntCodeState& ics, const IntCode* i) {
   if (!ics.rf[i->src1_reg].u32) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BRANCH_FALSE_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_FALSE_I64(IntCodeState& ics, const IntCode* i) {
   if (!ics.rf[i->src1_reg].u64) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BRANCH_FALSE_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_FALSE_F32(IntCodeState& ics, const IntCode* i) {
   if (!ics.rf[i->src1_reg].f32) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BRANCH_FALSE_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BRANCH_FALSE_F64(IntCodeState& ics, const IntCode* i) {
   if (!ics.rf[i->src1_reg].f64) {
     return IntCode_BRANCH_XX(ics, i, i->src2_reg);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_BRANCH_FALSE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -677,33 +693,33 @@ int Translate_BRANCH_FALSE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_ASSIGN_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ASSIGN_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ASSIGN_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ASSIGN_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ics.rf[i->src1_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ASSIGN_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ASSIGN_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ics.rf[i->src1_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ASSIGN_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ASSIGN_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ics.rf[i->src1_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ASSIGN_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ASSIGN_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = ics.rf[i->src1_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ASSIGN_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ASSIGN_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = ics.rf[i->src1_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ASSIGN_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ASSIGN_V128(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].v128 = ics.rf[i->src1_reg].v128;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_ASSIGN(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -714,37 +730,43 @@ int Translate_ASSIGN(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_CAST(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CAST(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].v128 = ics.rf[i->src1_reg].v128;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_CAST(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_CAST);
 }
 
-uint32_t IntCode_ZERO_EXTEND_I8_TO_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ZERO_EXTEND_I8_TO_I16(IntCodeState& ics,
+                                             const IntCode* i) {
   ics.rf[i->dest_reg].i16 = (uint8_t)ics.rf[i->src1_reg].u8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ZERO_EXTEND_I8_TO_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ZERO_EXTEND_I8_TO_I32(IntCodeState& ics,
+                                             const IntCode* i) {
   ics.rf[i->dest_reg].i32 = (uint16_t)ics.rf[i->src1_reg].u8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ZERO_EXTEND_I8_TO_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ZERO_EXTEND_I8_TO_I64(IntCodeState& ics,
+                                             const IntCode* i) {
   ics.rf[i->dest_reg].i64 = (uint64_t)ics.rf[i->src1_reg].u8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ZERO_EXTEND_I16_TO_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ZERO_EXTEND_I16_TO_I32(IntCodeState& ics,
+                                              const IntCode* i) {
   ics.rf[i->dest_reg].i32 = (uint32_t)ics.rf[i->src1_reg].u16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ZERO_EXTEND_I16_TO_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ZERO_EXTEND_I16_TO_I64(IntCodeState& ics,
+                                              const IntCode* i) {
   ics.rf[i->dest_reg].i64 = (uint64_t)ics.rf[i->src1_reg].u16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ZERO_EXTEND_I32_TO_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ZERO_EXTEND_I32_TO_I64(IntCodeState& ics,
+                                              const IntCode* i) {
   ics.rf[i->dest_reg].i64 = (uint64_t)ics.rf[i->src1_reg].u32;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_ZERO_EXTEND(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -778,29 +800,35 @@ int Translate_ZERO_EXTEND(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fn);
 }
 
-uint32_t IntCode_SIGN_EXTEND_I8_TO_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SIGN_EXTEND_I8_TO_I16(IntCodeState& ics,
+                                             const IntCode* i) {
   ics.rf[i->dest_reg].i16 = (int8_t)ics.rf[i->src1_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SIGN_EXTEND_I8_TO_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SIGN_EXTEND_I8_TO_I32(IntCodeState& ics,
+                                             const IntCode* i) {
   ics.rf[i->dest_reg].i32 = (int16_t)ics.rf[i->src1_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SIGN_EXTEND_I8_TO_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SIGN_EXTEND_I8_TO_I64(IntCodeState& ics,
+                                             const IntCode* i) {
   ics.rf[i->dest_reg].i64 = (int64_t)ics.rf[i->src1_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SIGN_EXTEND_I16_TO_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SIGN_EXTEND_I16_TO_I32(IntCodeState& ics,
+                                              const IntCode* i) {
   ics.rf[i->dest_reg].i32 = (int32_t)ics.rf[i->src1_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SIGN_EXTEND_I16_TO_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SIGN_EXTEND_I16_TO_I64(IntCodeState& ics,
+                                              const IntCode* i) {
   ics.rf[i->dest_reg].i64 = (int64_t)ics.rf[i->src1_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SIGN_EXTEND_I32_TO_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SIGN_EXTEND_I32_TO_I64(IntCodeState& ics,
+                                              const IntCode* i) {
   ics.rf[i->dest_reg].i64 = (int64_t)ics.rf[i->src1_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_SIGN_EXTEND(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -834,29 +862,32 @@ int Translate_SIGN_EXTEND(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fn);
 }
 
-uint32_t IntCode_TRUNCATE_I16_TO_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRUNCATE_I16_TO_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = (int8_t)ics.rf[i->src1_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_TRUNCATE_I32_TO_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRUNCATE_I32_TO_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = (int8_t)ics.rf[i->src1_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_TRUNCATE_I32_TO_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRUNCATE_I32_TO_I16(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i16 = (int16_t)ics.rf[i->src1_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_TRUNCATE_I64_TO_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRUNCATE_I64_TO_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = (int8_t)ics.rf[i->src1_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_TRUNCATE_I64_TO_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRUNCATE_I64_TO_I16(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i16 = (int16_t)ics.rf[i->src1_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_TRUNCATE_I64_TO_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_TRUNCATE_I64_TO_I32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i32 = (int32_t)ics.rf[i->src1_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_TRUNCATE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -890,33 +921,33 @@ int Translate_TRUNCATE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fn);
 }
 
-uint32_t IntCode_CONVERT_I32_TO_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CONVERT_I32_TO_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = (float)ics.rf[i->src1_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CONVERT_I64_TO_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CONVERT_I64_TO_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = (double)ics.rf[i->src1_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CONVERT_F32_TO_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CONVERT_F32_TO_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = (int32_t)ics.rf[i->src1_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CONVERT_F32_TO_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CONVERT_F32_TO_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = (double)ics.rf[i->src1_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CONVERT_F64_TO_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CONVERT_F64_TO_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = (int32_t)ics.rf[i->src1_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CONVERT_F64_TO_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CONVERT_F64_TO_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = (int64_t)ics.rf[i->src1_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CONVERT_F64_TO_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CONVERT_F64_TO_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = (float)ics.rf[i->src1_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_CONVERT(TranslationContext& ctx, Instr* i) {
   // Can do more as needed.
@@ -951,7 +982,7 @@ int Translate_CONVERT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fn);
 }
 
-uint32_t IntCode_ROUND_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ROUND_F32(IntCodeState& ics, const IntCode* i) {
   float src1 = ics.rf[i->src1_reg].f32;
   float dest = src1;
   switch (i->flags) {
@@ -969,9 +1000,9 @@ uint32_t IntCode_ROUND_F32(IntCodeState& ics, const IntCode* i) {
       break;
   }
   ics.rf[i->dest_reg].f32 = dest;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ROUND_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ROUND_F64(IntCodeState& ics, const IntCode* i) {
   double src1 = ics.rf[i->src1_reg].f64;
   double dest = src1;
   switch (i->flags) {
@@ -989,41 +1020,41 @@ uint32_t IntCode_ROUND_F64(IntCodeState& ics, const IntCode* i) {
       break;
   }
   ics.rf[i->dest_reg].f64 = dest;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ROUND_V128_ZERO(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ROUND_V128_ZERO(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (size_t n = 0; n < 4; n++) {
     dest.f32[n] = truncf(src1.f32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ROUND_V128_NEAREST(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ROUND_V128_NEAREST(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (size_t n = 0; n < 4; n++) {
     dest.f32[n] = roundf(src1.f32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ROUND_V128_MINUS_INFINITY(IntCodeState& ics,
+const IntCode* IntCode_ROUND_V128_MINUS_INFINITY(IntCodeState& ics,
                                            const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; ++n) {
     dest.f32[n] = floorf(src1.f32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ROUND_V128_POSITIVE_INFINTIY(IntCodeState& ics,
+const IntCode* IntCode_ROUND_V128_POSITIVE_INFINTIY(IntCodeState& ics,
                                               const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; ++n) {
     dest.f32[n] = ceilf(src1.f32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_ROUND(TranslationContext& ctx, Instr* i) {
   if (i->dest->type == VEC128_TYPE) {
@@ -1042,21 +1073,23 @@ int Translate_ROUND(TranslationContext& ctx, Instr* i) {
   }
 }
 
-uint32_t IntCode_VECTOR_CONVERT_I2F_S(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_CONVERT_I2F_S(IntCodeState& ics,
+                                            const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; ++n) {
     dest.f32[n] = (float)(int32_t)src1.u32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_CONVERT_I2F_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_CONVERT_I2F_U(IntCodeState& ics,
+                                            const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; ++n) {
     dest.f32[n] = (float)(uint32_t)src1.u32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_VECTOR_CONVERT_I2F(TranslationContext& ctx, Instr* i) {
   if (i->flags & ARITHMETIC_UNSIGNED) {
@@ -1066,7 +1099,7 @@ int Translate_VECTOR_CONVERT_I2F(TranslationContext& ctx, Instr* i) {
   }
 }
 
-uint32_t IntCode_VECTOR_CONVERT_F2I(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_CONVERT_F2I(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   if (i->flags & ARITHMETIC_UNSIGNED) {
@@ -1078,9 +1111,10 @@ uint32_t IntCode_VECTOR_CONVERT_F2I(IntCodeState& ics, const IntCode* i) {
       dest.u32[n] = (int32_t)src1.f32[n];
     }
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_CONVERT_F2I_SAT(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_CONVERT_F2I_SAT(IntCodeState& ics,
+                                              const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   if (i->flags & ARITHMETIC_UNSIGNED) {
@@ -1110,7 +1144,7 @@ uint32_t IntCode_VECTOR_CONVERT_F2I_SAT(IntCodeState& ics, const IntCode* i) {
       }
     }
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_VECTOR_CONVERT_F2I(TranslationContext& ctx, Instr* i) {
   if (i->flags & ARITHMETIC_SATURATE) {
@@ -1157,60 +1191,60 @@ static const vec128_t lvsr_table[16] = {
     vec128b(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16),
 };
 
-uint32_t IntCode_LOAD_VECTOR_SHL(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_VECTOR_SHL(IntCodeState& ics, const IntCode* i) {
   int8_t sh = ics.rf[i->src1_reg].i8 & 0xF;
   ics.rf[i->dest_reg].v128 = lvsl_table[sh];
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_LOAD_VECTOR_SHL(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_LOAD_VECTOR_SHL);
 }
 
-uint32_t IntCode_LOAD_VECTOR_SHR(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_VECTOR_SHR(IntCodeState& ics, const IntCode* i) {
   int8_t sh = ics.rf[i->src1_reg].i8 & 0xF;
   ics.rf[i->dest_reg].v128 = lvsr_table[sh];
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_LOAD_VECTOR_SHR(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_LOAD_VECTOR_SHR);
 }
 
-uint32_t IntCode_LOAD_CLOCK(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_CLOCK(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = poly::threading::ticks();
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_LOAD_CLOCK(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_LOAD_CLOCK);
 }
 
-uint32_t IntCode_LOAD_LOCAL_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_LOCAL_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = *((int8_t*)(ics.locals + ics.rf[i->src1_reg].u32));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_LOCAL_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_LOCAL_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = *((int16_t*)(ics.locals + ics.rf[i->src1_reg].u32));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_LOCAL_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_LOCAL_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = *((int32_t*)(ics.locals + ics.rf[i->src1_reg].u32));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_LOCAL_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_LOCAL_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = *((int64_t*)(ics.locals + ics.rf[i->src1_reg].u32));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_LOCAL_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_LOCAL_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = *((float*)(ics.locals + ics.rf[i->src1_reg].u32));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_LOCAL_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_LOCAL_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = *((double*)(ics.locals + ics.rf[i->src1_reg].u32));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_LOCAL_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_LOCAL_V128(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].v128 =
       *((vec128_t*)(ics.locals + ics.rf[i->src1_reg].u32));
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_LOAD_LOCAL(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1221,34 +1255,34 @@ int Translate_LOAD_LOCAL(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_STORE_LOCAL_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_LOCAL_I8(IntCodeState& ics, const IntCode* i) {
   *((int8_t*)(ics.locals + ics.rf[i->src1_reg].u32)) = ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_LOCAL_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_LOCAL_I16(IntCodeState& ics, const IntCode* i) {
   *((int16_t*)(ics.locals + ics.rf[i->src1_reg].u32)) = ics.rf[i->src2_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_LOCAL_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_LOCAL_I32(IntCodeState& ics, const IntCode* i) {
   *((int32_t*)(ics.locals + ics.rf[i->src1_reg].u32)) = ics.rf[i->src2_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_LOCAL_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_LOCAL_I64(IntCodeState& ics, const IntCode* i) {
   *((int64_t*)(ics.locals + ics.rf[i->src1_reg].u32)) = ics.rf[i->src2_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_LOCAL_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_LOCAL_F32(IntCodeState& ics, const IntCode* i) {
   *((float*)(ics.locals + ics.rf[i->src1_reg].u32)) = ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_LOCAL_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_LOCAL_F64(IntCodeState& ics, const IntCode* i) {
   *((double*)(ics.locals + ics.rf[i->src1_reg].u32)) = ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_LOCAL_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_LOCAL_V128(IntCodeState& ics, const IntCode* i) {
   *((vec128_t*)(ics.locals + ics.rf[i->src1_reg].u32)) =
       ics.rf[i->src2_reg].v128;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_STORE_LOCAL(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1260,46 +1294,46 @@ int Translate_STORE_LOCAL(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src2.value->type]);
 }
 
-uint32_t IntCode_LOAD_CONTEXT_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_CONTEXT_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = *((int8_t*)(ics.context + ics.rf[i->src1_reg].u64));
   DPRINT("%d (%X) = ctx i8 +%d\n", ics.rf[i->dest_reg].i8,
          ics.rf[i->dest_reg].u8, ics.rf[i->src1_reg].u64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_CONTEXT_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_CONTEXT_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 =
       *((int16_t*)(ics.context + ics.rf[i->src1_reg].u64));
   DPRINT("%d (%X) = ctx i16 +%d\n", ics.rf[i->dest_reg].i16,
          ics.rf[i->dest_reg].u16, ics.rf[i->src1_reg].u64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_CONTEXT_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_CONTEXT_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 =
       *((int32_t*)(ics.context + ics.rf[i->src1_reg].u64));
   DPRINT("%d (%X) = ctx i32 +%d\n", ics.rf[i->dest_reg].i32,
          ics.rf[i->dest_reg].u32, ics.rf[i->src1_reg].u64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_CONTEXT_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_CONTEXT_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 =
       *((int64_t*)(ics.context + ics.rf[i->src1_reg].u64));
   DPRINT("%lld (%llX) = ctx i64 +%d\n", ics.rf[i->dest_reg].i64,
          ics.rf[i->dest_reg].u64, ics.rf[i->src1_reg].u64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_CONTEXT_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_CONTEXT_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = *((float*)(ics.context + ics.rf[i->src1_reg].u64));
   DPRINT("%e (%X) = ctx f32 +%d\n", ics.rf[i->dest_reg].f32,
          ics.rf[i->dest_reg].u32, ics.rf[i->src1_reg].u64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_CONTEXT_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_CONTEXT_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = *((double*)(ics.context + ics.rf[i->src1_reg].u64));
   DPRINT("%lle (%llX) = ctx f64 +%d\n", ics.rf[i->dest_reg].f64,
          ics.rf[i->dest_reg].u64, ics.rf[i->src1_reg].u64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_CONTEXT_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_CONTEXT_V128(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].v128 =
       *((vec128_t*)(ics.context + ics.rf[i->src1_reg].u64));
   DPRINT("[%e, %e, %e, %e] [%.8X, %.8X, %.8X, %.8X] = ctx v128 +%d\n",
@@ -1308,7 +1342,7 @@ uint32_t IntCode_LOAD_CONTEXT_V128(IntCodeState& ics, const IntCode* i) {
          ics.rf[i->dest_reg].v128.ux, ics.rf[i->dest_reg].v128.uy,
          ics.rf[i->dest_reg].v128.uz, ics.rf[i->dest_reg].v128.uw,
          ics.rf[i->src1_reg].u64);
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_LOAD_CONTEXT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1320,46 +1354,46 @@ int Translate_LOAD_CONTEXT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_STORE_CONTEXT_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_CONTEXT_I8(IntCodeState& ics, const IntCode* i) {
   *((int8_t*)(ics.context + ics.rf[i->src1_reg].u64)) = ics.rf[i->src2_reg].i8;
   DPRINT("ctx i8 +%d = %d (%X)\n", ics.rf[i->src1_reg].u64,
          ics.rf[i->src2_reg].i8, ics.rf[i->src2_reg].u8);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_CONTEXT_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_CONTEXT_I16(IntCodeState& ics, const IntCode* i) {
   *((int16_t*)(ics.context + ics.rf[i->src1_reg].u64)) =
       ics.rf[i->src2_reg].i16;
   DPRINT("ctx i16 +%d = %d (%X)\n", ics.rf[i->src1_reg].u64,
          ics.rf[i->src2_reg].i16, ics.rf[i->src2_reg].u16);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_CONTEXT_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_CONTEXT_I32(IntCodeState& ics, const IntCode* i) {
   *((int32_t*)(ics.context + ics.rf[i->src1_reg].u64)) =
       ics.rf[i->src2_reg].i32;
   DPRINT("ctx i32 +%d = %d (%X)\n", ics.rf[i->src1_reg].u64,
          ics.rf[i->src2_reg].i32, ics.rf[i->src2_reg].u32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_CONTEXT_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_CONTEXT_I64(IntCodeState& ics, const IntCode* i) {
   *((int64_t*)(ics.context + ics.rf[i->src1_reg].u64)) =
       ics.rf[i->src2_reg].i64;
   DPRINT("ctx i64 +%d = %lld (%llX)\n", ics.rf[i->src1_reg].u64,
          ics.rf[i->src2_reg].i64, ics.rf[i->src2_reg].u64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_CONTEXT_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_CONTEXT_F32(IntCodeState& ics, const IntCode* i) {
   *((float*)(ics.context + ics.rf[i->src1_reg].u64)) = ics.rf[i->src2_reg].f32;
   DPRINT("ctx f32 +%d = %e (%X)\n", ics.rf[i->src1_reg].u64,
          ics.rf[i->src2_reg].f32, ics.rf[i->src2_reg].u32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_CONTEXT_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_CONTEXT_F64(IntCodeState& ics, const IntCode* i) {
   *((double*)(ics.context + ics.rf[i->src1_reg].u64)) = ics.rf[i->src2_reg].f64;
   DPRINT("ctx f64 +%d = %lle (%llX)\n", ics.rf[i->src1_reg].u64,
          ics.rf[i->src2_reg].f64, ics.rf[i->src2_reg].u64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_CONTEXT_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_CONTEXT_V128(IntCodeState& ics, const IntCode* i) {
   *((vec128_t*)(ics.context + ics.rf[i->src1_reg].u64)) =
       ics.rf[i->src2_reg].v128;
   DPRINT("ctx v128 +%d = [%e, %e, %e, %e] [%.8X, %.8X, %.8X, %.8X]\n",
@@ -1368,7 +1402,7 @@ uint32_t IntCode_STORE_CONTEXT_V128(IntCodeState& ics, const IntCode* i) {
          ics.rf[i->src2_reg].v128.w, ics.rf[i->src2_reg].v128.ux,
          ics.rf[i->src2_reg].v128.uy, ics.rf[i->src2_reg].v128.uz,
          ics.rf[i->src2_reg].v128.uw);
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_STORE_CONTEXT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1380,75 +1414,75 @@ int Translate_STORE_CONTEXT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src2.value->type]);
 }
 
-uint32_t IntCode_LOAD_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_I8(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   if (DYNAMIC_REGISTER_ACCESS_CHECK(address)) {
     ics.rf[i->dest_reg].i8 = ics.thread_state->memory()->LoadI8(address);
-    return IA_NEXT;
+    return i + 1;
   }
   DPRINT("%d (%X) = load.i8 %.8X\n", *((int8_t*)(ics.membase + address)),
          *((uint8_t*)(ics.membase + address)), address);
   DFLUSH();
   ics.rf[i->dest_reg].i8 = *((int8_t*)(ics.membase + address));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_I16(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   if (DYNAMIC_REGISTER_ACCESS_CHECK(address)) {
     ics.rf[i->dest_reg].i16 =
         poly::byte_swap(ics.thread_state->memory()->LoadI16(address));
-    return IA_NEXT;
+    return i + 1;
   }
   DPRINT("%d (%X) = load.i16 %.8X\n", *((int16_t*)(ics.membase + address)),
          *((uint16_t*)(ics.membase + address)), address);
   DFLUSH();
   ics.rf[i->dest_reg].i16 = *((int16_t*)(ics.membase + address));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_I32(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   if (DYNAMIC_REGISTER_ACCESS_CHECK(address)) {
     ics.rf[i->dest_reg].i32 =
         poly::byte_swap(ics.thread_state->memory()->LoadI32(address));
-    return IA_NEXT;
+    return i + 1;
   }
   DFLUSH();
   DPRINT("%d (%X) = load.i32 %.8X\n", *((int32_t*)(ics.membase + address)),
          *((uint32_t*)(ics.membase + address)), address);
   DFLUSH();
   ics.rf[i->dest_reg].i32 = *((int32_t*)(ics.membase + address));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_I64(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   if (DYNAMIC_REGISTER_ACCESS_CHECK(address)) {
     ics.rf[i->dest_reg].i64 =
         poly::byte_swap(ics.thread_state->memory()->LoadI64(address));
-    return IA_NEXT;
+    return i + 1;
   }
   DPRINT("%lld (%llX) = load.i64 %.8X\n", *((int64_t*)(ics.membase + address)),
          *((uint64_t*)(ics.membase + address)), address);
   DFLUSH();
   ics.rf[i->dest_reg].i64 = *((int64_t*)(ics.membase + address));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_F32(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   DPRINT("%e (%X) = load.f32 %.8X\n", *((float*)(ics.membase + address)),
          *((uint64_t*)(ics.membase + address)), address);
   DFLUSH();
   ics.rf[i->dest_reg].f32 = *((float*)(ics.membase + address));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_F64(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   DPRINT("%lle (%llX) = load.f64 %.8X\n", *((double*)(ics.membase + address)),
          *((uint64_t*)(ics.membase + address)), address);
   DFLUSH();
   ics.rf[i->dest_reg].f64 = *((double*)(ics.membase + address));
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOAD_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOAD_V128(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
@@ -1457,7 +1491,7 @@ uint32_t IntCode_LOAD_V128(IntCodeState& ics, const IntCode* i) {
   DPRINT("[%e, %e, %e, %e] [%.8X, %.8X, %.8X, %.8X] = load.v128 %.8X\n", dest.x,
          dest.y, dest.z, dest.w, dest.ux, dest.uy, dest.uz, dest.uw, address);
   DFLUSH();
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_LOAD(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1467,86 +1501,74 @@ int Translate_LOAD(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-void MarkPageDirty(IntCodeState& ics, uint32_t address) {
-  // 16KB pages.
-  if (ics.page_table) {
-    ics.page_table[(address >> 14) & 0x7FFF] = 1;
-  }
-}
-uint32_t IntCode_STORE_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_I8(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   if (DYNAMIC_REGISTER_ACCESS_CHECK(address)) {
     ics.thread_state->memory()->StoreI8(address, ics.rf[i->src2_reg].i8);
-    return IA_NEXT;
+    return i + 1;
   }
   DPRINT("store.i8 %.8X = %d (%X)\n", address, ics.rf[i->src2_reg].i8,
          ics.rf[i->src2_reg].u8);
   DFLUSH();
   *((int8_t*)(ics.membase + address)) = ics.rf[i->src2_reg].i8;
-  MarkPageDirty(ics, address);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_I16(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   if (DYNAMIC_REGISTER_ACCESS_CHECK(address)) {
     ics.thread_state->memory()->StoreI16(
         address, poly::byte_swap(ics.rf[i->src2_reg].i16));
-    return IA_NEXT;
+    return i + 1;
   }
   DPRINT("store.i16 %.8X = %d (%X)\n", address, ics.rf[i->src2_reg].i16,
          ics.rf[i->src2_reg].u16);
   DFLUSH();
   *((int16_t*)(ics.membase + address)) = ics.rf[i->src2_reg].i16;
-  MarkPageDirty(ics, address);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_I32(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   if (DYNAMIC_REGISTER_ACCESS_CHECK(address)) {
     ics.thread_state->memory()->StoreI32(
         address, poly::byte_swap(ics.rf[i->src2_reg].i32));
-    return IA_NEXT;
+    return i + 1;
   }
   DPRINT("store.i32 %.8X = %d (%X)\n", address, ics.rf[i->src2_reg].i32,
          ics.rf[i->src2_reg].u32);
   DFLUSH();
   *((int32_t*)(ics.membase + address)) = ics.rf[i->src2_reg].i32;
-  MarkPageDirty(ics, address);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_I64(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   if (DYNAMIC_REGISTER_ACCESS_CHECK(address)) {
     ics.thread_state->memory()->StoreI64(
         address, poly::byte_swap(ics.rf[i->src2_reg].i64));
-    return IA_NEXT;
+    return i + 1;
   }
   DPRINT("store.i64 %.8X = %lld (%llX)\n", address, ics.rf[i->src2_reg].i64,
          ics.rf[i->src2_reg].u64);
   DFLUSH();
   *((int64_t*)(ics.membase + address)) = ics.rf[i->src2_reg].i64;
-  MarkPageDirty(ics, address);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_F32(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   DPRINT("store.f32 %.8X = %e (%X)\n", address, ics.rf[i->src2_reg].f32,
          ics.rf[i->src2_reg].u32);
   DFLUSH();
   *((float*)(ics.membase + address)) = ics.rf[i->src2_reg].f32;
-  MarkPageDirty(ics, address);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_F64(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   DPRINT("store.f64 %.8X = %lle (%llX)\n", address, ics.rf[i->src2_reg].f64,
          ics.rf[i->src2_reg].u64);
   DFLUSH();
   *((double*)(ics.membase + address)) = ics.rf[i->src2_reg].f64;
-  MarkPageDirty(ics, address);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_STORE_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_STORE_V128(IntCodeState& ics, const IntCode* i) {
   uint32_t address = ics.rf[i->src1_reg].u32;
   DPRINT("store.v128 %.8X = [%e, %e, %e, %e] [%.8X, %.8X, %.8X, %.8X]\n",
          address, ics.rf[i->src2_reg].v128.x, ics.rf[i->src2_reg].v128.y,
@@ -1555,8 +1577,7 @@ uint32_t IntCode_STORE_V128(IntCodeState& ics, const IntCode* i) {
          ics.rf[i->src2_reg].v128.uz, ics.rf[i->src2_reg].v128.uw);
   DFLUSH();
   *((vec128_t*)(ics.membase + address)) = ics.rf[i->src2_reg].v128;
-  MarkPageDirty(ics, address);
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_STORE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1567,55 +1588,55 @@ int Translate_STORE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src2.value->type]);
 }
 
-uint32_t IntCode_PREFETCH(IntCodeState& ics, const IntCode* i) {
-  return IA_NEXT;
+const IntCode* IntCode_PREFETCH(IntCodeState& ics, const IntCode* i) {
+  return i + 1;
 }
 int Translate_PREFETCH(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_PREFETCH);
 }
 
-uint32_t IntCode_MAX_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MAX_I8_I8(IntCodeState& ics, const IntCode* i) {
   int8_t a = ics.rf[i->src1_reg].i8;
   int8_t b = ics.rf[i->src2_reg].i8;
   ics.rf[i->dest_reg].i8 = std::max(a, b);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MAX_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MAX_I16_I16(IntCodeState& ics, const IntCode* i) {
   int16_t a = ics.rf[i->src1_reg].i16;
   int16_t b = ics.rf[i->src2_reg].i16;
   ics.rf[i->dest_reg].i16 = std::max(a, b);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MAX_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MAX_I32_I32(IntCodeState& ics, const IntCode* i) {
   int32_t a = ics.rf[i->src1_reg].i32;
   int32_t b = ics.rf[i->src2_reg].i32;
   ics.rf[i->dest_reg].i32 = std::max(a, b);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MAX_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MAX_I64_I64(IntCodeState& ics, const IntCode* i) {
   int64_t a = ics.rf[i->src1_reg].i64;
   int64_t b = ics.rf[i->src2_reg].i64;
   ics.rf[i->dest_reg].i64 = std::max(a, b);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MAX_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MAX_F32_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 =
       std::max(ics.rf[i->src1_reg].f32, ics.rf[i->src2_reg].f32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MAX_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MAX_F64_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 =
       std::max(ics.rf[i->src1_reg].f64, ics.rf[i->src2_reg].f64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MAX_V128_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MAX_V128_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.f32[n] = std::max(src1.f32[n], src2.f32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_MAX(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1626,59 +1647,65 @@ int Translate_MAX(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_VECTOR_MAX_I8_UNSIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MAX_I8_UNSIGNED(IntCodeState& ics,
+                                              const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 16; n++) {
     dest.u8[n] = std::max(src1.u8[n], src2.u8[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_MAX_I16_UNSIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MAX_I16_UNSIGNED(IntCodeState& ics,
+                                               const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 8; n++) {
     dest.u16[n] = std::max(src1.u16[n], src2.u16[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_MAX_I32_UNSIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MAX_I32_UNSIGNED(IntCodeState& ics,
+                                               const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = std::max(src1.u32[n], src2.u32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_MAX_I8_SIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MAX_I8_SIGNED(IntCodeState& ics,
+                                            const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 16; n++) {
     dest.u8[n] = std::max((int8_t)src1.u8[n], (int8_t)src2.u8[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_MAX_I16_SIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MAX_I16_SIGNED(IntCodeState& ics,
+                                             const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 8; n++) {
     dest.u16[n] = std::max((int16_t)src1.u16[n], (int16_t)src2.u16[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_MAX_I32_SIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MAX_I32_SIGNED(IntCodeState& ics,
+                                             const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = std::max((int32_t)src1.u32[n], (int32_t)src2.u32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_VECTOR_MAX(TranslationContext& ctx, Instr* i) {
   static IntCodeFn unsigned_fns[] = {
@@ -1697,48 +1724,48 @@ int Translate_VECTOR_MAX(TranslationContext& ctx, Instr* i) {
   }
 }
 
-uint32_t IntCode_MIN_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MIN_I8_I8(IntCodeState& ics, const IntCode* i) {
   int8_t a = ics.rf[i->src1_reg].i8;
   int8_t b = ics.rf[i->src2_reg].i8;
   ics.rf[i->dest_reg].i8 = std::min(a, b);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MIN_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MIN_I16_I16(IntCodeState& ics, const IntCode* i) {
   int16_t a = ics.rf[i->src1_reg].i16;
   int16_t b = ics.rf[i->src2_reg].i16;
   ics.rf[i->dest_reg].i16 = std::min(a, b);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MIN_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MIN_I32_I32(IntCodeState& ics, const IntCode* i) {
   int32_t a = ics.rf[i->src1_reg].i32;
   int32_t b = ics.rf[i->src2_reg].i32;
   ics.rf[i->dest_reg].i32 = std::min(a, b);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MIN_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MIN_I64_I64(IntCodeState& ics, const IntCode* i) {
   int64_t a = ics.rf[i->src1_reg].i64;
   int64_t b = ics.rf[i->src2_reg].i64;
   ics.rf[i->dest_reg].i64 = std::min(a, b);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MIN_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MIN_F32_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 =
       std::min(ics.rf[i->src1_reg].f32, ics.rf[i->src2_reg].f32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MIN_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MIN_F64_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 =
       std::min(ics.rf[i->src1_reg].f64, ics.rf[i->src2_reg].f64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MIN_V128_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MIN_V128_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.f32[n] = std::min(src1.f32[n], src2.f32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_MIN(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1749,59 +1776,65 @@ int Translate_MIN(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_VECTOR_MIN_I8_UNSIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MIN_I8_UNSIGNED(IntCodeState& ics,
+                                              const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 16; n++) {
     dest.u8[n] = std::min(src1.u8[n], src2.u8[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_MIN_I16_UNSIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MIN_I16_UNSIGNED(IntCodeState& ics,
+                                               const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 8; n++) {
     dest.u16[n] = std::min(src1.u16[n], src2.u16[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_MIN_I32_UNSIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MIN_I32_UNSIGNED(IntCodeState& ics,
+                                               const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = std::min(src1.u32[n], src2.u32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_MIN_I8_SIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MIN_I8_SIGNED(IntCodeState& ics,
+                                            const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 16; n++) {
     dest.u8[n] = std::min((int8_t)src1.u8[n], (int8_t)src2.u8[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_MIN_I16_SIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MIN_I16_SIGNED(IntCodeState& ics,
+                                             const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 8; n++) {
     dest.u16[n] = std::min((int16_t)src1.u16[n], (int16_t)src2.u16[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_MIN_I32_SIGNED(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_MIN_I32_SIGNED(IntCodeState& ics,
+                                             const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = std::min((int32_t)src1.u32[n], (int32_t)src2.u32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_VECTOR_MIN(TranslationContext& ctx, Instr* i) {
   static IntCodeFn unsigned_fns[] = {
@@ -1820,40 +1853,40 @@ int Translate_VECTOR_MIN(TranslationContext& ctx, Instr* i) {
   }
 }
 
-uint32_t IntCode_SELECT_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SELECT_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 =
       ics.rf[i->src1_reg].i8 ? ics.rf[i->src2_reg].i8 : ics.rf[i->src3_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SELECT_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SELECT_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ics.rf[i->src1_reg].i8 ? ics.rf[i->src2_reg].i16
                                                    : ics.rf[i->src3_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SELECT_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SELECT_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ics.rf[i->src1_reg].i8 ? ics.rf[i->src2_reg].i32
                                                    : ics.rf[i->src3_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SELECT_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SELECT_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ics.rf[i->src1_reg].i8 ? ics.rf[i->src2_reg].i64
                                                    : ics.rf[i->src3_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SELECT_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SELECT_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = ics.rf[i->src1_reg].i8 ? ics.rf[i->src2_reg].f32
                                                    : ics.rf[i->src3_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SELECT_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SELECT_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = ics.rf[i->src1_reg].i8 ? ics.rf[i->src2_reg].f64
                                                    : ics.rf[i->src3_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SELECT_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SELECT_V128(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].v128 = ics.rf[i->src1_reg].i8 ? ics.rf[i->src2_reg].v128
                                                     : ics.rf[i->src3_reg].v128;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_SELECT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1864,34 +1897,34 @@ int Translate_SELECT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_IS_TRUE_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_TRUE_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !!ics.rf[i->src1_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_TRUE_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_TRUE_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !!ics.rf[i->src1_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_TRUE_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_TRUE_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !!ics.rf[i->src1_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_TRUE_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_TRUE_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !!ics.rf[i->src1_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_TRUE_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_TRUE_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !!ics.rf[i->src1_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_TRUE_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_TRUE_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !!ics.rf[i->src1_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_TRUE_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_TRUE_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   ics.rf[i->dest_reg].i8 = src1.high && src1.low;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_IS_TRUE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1902,34 +1935,34 @@ int Translate_IS_TRUE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_IS_FALSE_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_FALSE_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !ics.rf[i->src1_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_FALSE_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_FALSE_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !ics.rf[i->src1_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_FALSE_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_FALSE_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !ics.rf[i->src1_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_FALSE_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_FALSE_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !ics.rf[i->src1_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_FALSE_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_FALSE_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !ics.rf[i->src1_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_FALSE_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_FALSE_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = !ics.rf[i->src1_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_IS_FALSE_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_IS_FALSE_V128(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 =
       !(ics.rf[i->src1_reg].v128.high && ics.rf[i->src1_reg].v128.low);
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_IS_FALSE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1940,29 +1973,29 @@ int Translate_IS_FALSE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_COMPARE_EQ_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_EQ_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 == ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_EQ_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_EQ_I16_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i16 == ics.rf[i->src2_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_EQ_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_EQ_I32_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i32 == ics.rf[i->src2_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_EQ_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_EQ_I64_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i64 == ics.rf[i->src2_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_EQ_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_EQ_F32_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f32 == ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_EQ_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_EQ_F64_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f64 == ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_COMPARE_EQ(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -1974,29 +2007,29 @@ int Translate_COMPARE_EQ(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_COMPARE_NE_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_NE_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 != ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_NE_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_NE_I16_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i16 != ics.rf[i->src2_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_NE_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_NE_I32_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i32 != ics.rf[i->src2_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_NE_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_NE_I64_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i64 != ics.rf[i->src2_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_NE_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_NE_F32_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f32 != ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_NE_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_NE_F64_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f64 != ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_COMPARE_NE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2008,29 +2041,34 @@ int Translate_COMPARE_NE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_COMPARE_SLT_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLT_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 < ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SLT_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLT_I16_I16(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i16 < ics.rf[i->src2_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SLT_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLT_I32_I32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i32 < ics.rf[i->src2_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SLT_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLT_I64_I64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i64 < ics.rf[i->src2_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SLT_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLT_F32_F32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f32 < ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SLT_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLT_F64_F64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f64 < ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_COMPARE_SLT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2042,29 +2080,34 @@ int Translate_COMPARE_SLT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_COMPARE_SLE_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLE_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 <= ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SLE_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLE_I16_I16(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i16 <= ics.rf[i->src2_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SLE_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLE_I32_I32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i32 <= ics.rf[i->src2_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SLE_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLE_I64_I64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i64 <= ics.rf[i->src2_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SLE_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLE_F32_F32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f32 <= ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SLE_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SLE_F64_F64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f64 <= ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_COMPARE_SLE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2076,29 +2119,34 @@ int Translate_COMPARE_SLE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_COMPARE_SGT_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGT_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 > ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SGT_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGT_I16_I16(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i16 > ics.rf[i->src2_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SGT_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGT_I32_I32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i32 > ics.rf[i->src2_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SGT_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGT_I64_I64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i64 > ics.rf[i->src2_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SGT_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGT_F32_F32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f32 > ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SGT_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGT_F64_F64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f64 > ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_COMPARE_SGT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2110,29 +2158,34 @@ int Translate_COMPARE_SGT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_COMPARE_SGE_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGE_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 >= ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SGE_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGE_I16_I16(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i16 >= ics.rf[i->src2_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SGE_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGE_I32_I32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i32 >= ics.rf[i->src2_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SGE_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGE_I64_I64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i64 >= ics.rf[i->src2_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SGE_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGE_F32_F32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f32 >= ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_SGE_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_SGE_F64_F64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f64 >= ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_COMPARE_SGE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2144,29 +2197,34 @@ int Translate_COMPARE_SGE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_COMPARE_ULT_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULT_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u8 < ics.rf[i->src2_reg].u8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_ULT_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULT_I16_I16(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u16 < ics.rf[i->src2_reg].u16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_ULT_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULT_I32_I32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u32 < ics.rf[i->src2_reg].u32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_ULT_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULT_I64_I64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u64 < ics.rf[i->src2_reg].u64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_ULT_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULT_F32_F32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f32 < ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_ULT_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULT_F64_F64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f64 < ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_COMPARE_ULT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2178,29 +2236,34 @@ int Translate_COMPARE_ULT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_COMPARE_ULE_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULE_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u8 <= ics.rf[i->src2_reg].u8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_ULE_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULE_I16_I16(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u16 <= ics.rf[i->src2_reg].u16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_ULE_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULE_I32_I32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u32 <= ics.rf[i->src2_reg].u32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_ULE_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULE_I64_I64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u64 <= ics.rf[i->src2_reg].u64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_ULE_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULE_F32_F32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f32 <= ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_ULE_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_ULE_F64_F64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f64 <= ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_COMPARE_ULE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2212,29 +2275,34 @@ int Translate_COMPARE_ULE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_COMPARE_UGT_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGT_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u8 > ics.rf[i->src2_reg].u8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_UGT_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGT_I16_I16(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u16 > ics.rf[i->src2_reg].u16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_UGT_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGT_I32_I32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u32 > ics.rf[i->src2_reg].u32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_UGT_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGT_I64_I64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u64 > ics.rf[i->src2_reg].u64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_UGT_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGT_F32_F32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f32 > ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_UGT_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGT_F64_F64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f64 > ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_COMPARE_UGT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2246,29 +2314,34 @@ int Translate_COMPARE_UGT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_COMPARE_UGE_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGE_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u8 >= ics.rf[i->src2_reg].u8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_UGE_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGE_I16_I16(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u16 >= ics.rf[i->src2_reg].u16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_UGE_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGE_I32_I32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u32 >= ics.rf[i->src2_reg].u32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_UGE_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGE_I64_I64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u64 >= ics.rf[i->src2_reg].u64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_UGE_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGE_F32_F32(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f32 >= ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_COMPARE_UGE_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_UGE_F64_F64(IntCodeState& ics,
+                                           const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].f64 >= ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_COMPARE_UGE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2280,17 +2353,17 @@ int Translate_COMPARE_UGE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_DID_CARRY(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DID_CARRY(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.did_carry;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_DID_CARRY(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_DID_CARRY);
 }
 
-uint32_t IntCode_DID_SATURATE(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DID_SATURATE(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.did_saturate;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_DID_SATURATE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, IntCode_DID_SATURATE);
@@ -2305,15 +2378,19 @@ int Translate_DID_SATURATE(TranslationContext& ctx, Instr* i) {
                              ? (dest_type)0xFFFFFFFF                   \
                              : 0;                                      \
   }                                                                    \
-  return IA_NEXT;
+  return i + 1;
 
-uint32_t IntCode_VECTOR_COMPARE_EQ_I8(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_EQ_I8(IntCodeState& ics,
+                                            const IntCode* i){
     VECTOR_COMPARER(uint8_t, u8, uint8_t, u8, 16, == )};
-uint32_t IntCode_VECTOR_COMPARE_EQ_I16(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_EQ_I16(IntCodeState& ics,
+                                             const IntCode* i){
     VECTOR_COMPARER(uint16_t, u16, uint16_t, u16, 8, == )};
-uint32_t IntCode_VECTOR_COMPARE_EQ_I32(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_EQ_I32(IntCodeState& ics,
+                                             const IntCode* i){
     VECTOR_COMPARER(uint32_t, u32, uint32_t, u32, 4, == )};
-uint32_t IntCode_VECTOR_COMPARE_EQ_F32(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_EQ_F32(IntCodeState& ics,
+                                             const IntCode* i){
     VECTOR_COMPARER(float, f32, uint32_t, u32, 4, == )};
 int Translate_VECTOR_COMPARE_EQ(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2325,13 +2402,17 @@ int Translate_VECTOR_COMPARE_EQ(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->flags]);
 }
 
-uint32_t IntCode_VECTOR_COMPARE_SGT_I8(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_SGT_I8(IntCodeState& ics,
+                                             const IntCode* i){
     VECTOR_COMPARER(int8_t, i8, int8_t, i8, 16, > )};
-uint32_t IntCode_VECTOR_COMPARE_SGT_I16(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_SGT_I16(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(int16_t, i16, int16_t, i16, 8, > )};
-uint32_t IntCode_VECTOR_COMPARE_SGT_I32(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_SGT_I32(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(int32_t, i32, int32_t, i32, 4, > )};
-uint32_t IntCode_VECTOR_COMPARE_SGT_F32(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_SGT_F32(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(float, f32, uint32_t, u32, 4, > )};
 int Translate_VECTOR_COMPARE_SGT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2343,13 +2424,17 @@ int Translate_VECTOR_COMPARE_SGT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->flags]);
 }
 
-uint32_t IntCode_VECTOR_COMPARE_SGE_I8(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_SGE_I8(IntCodeState& ics,
+                                             const IntCode* i){
     VECTOR_COMPARER(int8_t, i8, int8_t, i8, 16, >= )};
-uint32_t IntCode_VECTOR_COMPARE_SGE_I16(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_SGE_I16(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(int16_t, i16, int16_t, i16, 8, >= )};
-uint32_t IntCode_VECTOR_COMPARE_SGE_I32(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_SGE_I32(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(int32_t, i32, int32_t, i32, 4, >= )};
-uint32_t IntCode_VECTOR_COMPARE_SGE_F32(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_SGE_F32(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(float, f32, uint32_t, u32, 4, >= )};
 int Translate_VECTOR_COMPARE_SGE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2361,13 +2446,17 @@ int Translate_VECTOR_COMPARE_SGE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->flags]);
 }
 
-uint32_t IntCode_VECTOR_COMPARE_UGT_I8(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_UGT_I8(IntCodeState& ics,
+                                             const IntCode* i){
     VECTOR_COMPARER(uint8_t, u8, uint8_t, u8, 16, > )};
-uint32_t IntCode_VECTOR_COMPARE_UGT_I16(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_UGT_I16(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(uint16_t, u16, uint16_t, u16, 8, > )};
-uint32_t IntCode_VECTOR_COMPARE_UGT_I32(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_UGT_I32(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(uint32_t, u32, uint32_t, u32, 4, > )};
-uint32_t IntCode_VECTOR_COMPARE_UGT_F32(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_UGT_F32(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(float, f32, uint32_t, u32, 4, > )};
 int Translate_VECTOR_COMPARE_UGT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2379,13 +2468,17 @@ int Translate_VECTOR_COMPARE_UGT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->flags]);
 }
 
-uint32_t IntCode_VECTOR_COMPARE_UGE_I8(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_UGE_I8(IntCodeState& ics,
+                                             const IntCode* i){
     VECTOR_COMPARER(uint8_t, u8, uint8_t, u8, 16, >= )};
-uint32_t IntCode_VECTOR_COMPARE_UGE_I16(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_UGE_I16(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(uint16_t, u16, uint16_t, u16, 8, >= )};
-uint32_t IntCode_VECTOR_COMPARE_UGE_I32(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_UGE_I32(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(uint32_t, u32, uint32_t, u32, 4, >= )};
-uint32_t IntCode_VECTOR_COMPARE_UGE_F32(IntCodeState& ics, const IntCode* i){
+const IntCode* IntCode_VECTOR_COMPARE_UGE_F32(IntCodeState& ics,
+                                              const IntCode* i){
     VECTOR_COMPARER(float, f32, uint32_t, u32, 4, >= )};
 int Translate_VECTOR_COMPARE_UGE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2399,51 +2492,51 @@ int Translate_VECTOR_COMPARE_UGE(TranslationContext& ctx, Instr* i) {
 
 #define CHECK_DID_CARRY(v1, v2) (((uint64_t)v2) > ~((uint64_t)v1))
 #define ADD_DID_CARRY(a, b) CHECK_DID_CARRY(a, b)
-uint32_t IntCode_ADD_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_I8_I8(IntCodeState& ics, const IntCode* i) {
   int8_t a = ics.rf[i->src1_reg].i8;
   int8_t b = ics.rf[i->src2_reg].i8;
   if (i->flags == ARITHMETIC_SET_CARRY) {
     ics.did_carry = ADD_DID_CARRY(a, b);
   }
   ics.rf[i->dest_reg].i8 = a + b;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ADD_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_I16_I16(IntCodeState& ics, const IntCode* i) {
   int16_t a = ics.rf[i->src1_reg].i16;
   int16_t b = ics.rf[i->src2_reg].i16;
   if (i->flags == ARITHMETIC_SET_CARRY) {
     ics.did_carry = ADD_DID_CARRY(a, b);
   }
   ics.rf[i->dest_reg].i16 = a + b;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ADD_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_I32_I32(IntCodeState& ics, const IntCode* i) {
   int32_t a = ics.rf[i->src1_reg].i32;
   int32_t b = ics.rf[i->src2_reg].i32;
   if (i->flags == ARITHMETIC_SET_CARRY) {
     ics.did_carry = ADD_DID_CARRY(a, b);
   }
   ics.rf[i->dest_reg].i32 = a + b;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ADD_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_I64_I64(IntCodeState& ics, const IntCode* i) {
   int64_t a = ics.rf[i->src1_reg].i64;
   int64_t b = ics.rf[i->src2_reg].i64;
   if (i->flags == ARITHMETIC_SET_CARRY) {
     ics.did_carry = ADD_DID_CARRY(a, b);
   }
   ics.rf[i->dest_reg].i64 = a + b;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ADD_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_F32_F32(IntCodeState& ics, const IntCode* i) {
   assert_true(!i->flags);
   ics.rf[i->dest_reg].f32 = ics.rf[i->src1_reg].f32 + ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ADD_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_F64_F64(IntCodeState& ics, const IntCode* i) {
   assert_true(!i->flags);
   ics.rf[i->dest_reg].f64 = ics.rf[i->src1_reg].f64 + ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_ADD(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2456,7 +2549,7 @@ int Translate_ADD(TranslationContext& ctx, Instr* i) {
 
 #define ADD_CARRY_DID_CARRY(a, b, c) \
   (CHECK_DID_CARRY(a, b) || ((c) != 0) && CHECK_DID_CARRY((a) + (b), c))
-uint32_t IntCode_ADD_CARRY_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_CARRY_I8_I8(IntCodeState& ics, const IntCode* i) {
   int8_t a = ics.rf[i->src1_reg].i8;
   int8_t b = ics.rf[i->src2_reg].i8;
   uint8_t c = ics.rf[i->src3_reg].u8;
@@ -2464,9 +2557,9 @@ uint32_t IntCode_ADD_CARRY_I8_I8(IntCodeState& ics, const IntCode* i) {
     ics.did_carry = ADD_CARRY_DID_CARRY(a, b, c);
   }
   ics.rf[i->dest_reg].i8 = a + b + c;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ADD_CARRY_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_CARRY_I16_I16(IntCodeState& ics, const IntCode* i) {
   int16_t a = ics.rf[i->src1_reg].i16;
   int16_t b = ics.rf[i->src2_reg].i16;
   uint8_t c = ics.rf[i->src3_reg].u8;
@@ -2474,9 +2567,9 @@ uint32_t IntCode_ADD_CARRY_I16_I16(IntCodeState& ics, const IntCode* i) {
     ics.did_carry = ADD_CARRY_DID_CARRY(a, b, c);
   }
   ics.rf[i->dest_reg].i16 = a + b + c;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ADD_CARRY_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_CARRY_I32_I32(IntCodeState& ics, const IntCode* i) {
   int32_t a = ics.rf[i->src1_reg].i32;
   int32_t b = ics.rf[i->src2_reg].i32;
   uint8_t c = ics.rf[i->src3_reg].u8;
@@ -2484,9 +2577,9 @@ uint32_t IntCode_ADD_CARRY_I32_I32(IntCodeState& ics, const IntCode* i) {
     ics.did_carry = ADD_CARRY_DID_CARRY(a, b, c);
   }
   ics.rf[i->dest_reg].i32 = a + b + c;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ADD_CARRY_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_CARRY_I64_I64(IntCodeState& ics, const IntCode* i) {
   int64_t a = ics.rf[i->src1_reg].i64;
   int64_t b = ics.rf[i->src2_reg].i64;
   uint8_t c = ics.rf[i->src3_reg].u8;
@@ -2494,19 +2587,19 @@ uint32_t IntCode_ADD_CARRY_I64_I64(IntCodeState& ics, const IntCode* i) {
     ics.did_carry = ADD_CARRY_DID_CARRY(a, b, c);
   }
   ics.rf[i->dest_reg].i64 = a + b + c;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ADD_CARRY_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_CARRY_F32_F32(IntCodeState& ics, const IntCode* i) {
   assert_true(!i->flags);
   ics.rf[i->dest_reg].f32 = ics.rf[i->src1_reg].f32 + ics.rf[i->src2_reg].f32 +
                             ics.rf[i->src3_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ADD_CARRY_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ADD_CARRY_F64_F64(IntCodeState& ics, const IntCode* i) {
   assert_true(!i->flags);
   ics.rf[i->dest_reg].f64 = ics.rf[i->src1_reg].f64 + ics.rf[i->src2_reg].f64 +
                             ics.rf[i->src3_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_ADD_CARRY(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2518,7 +2611,7 @@ int Translate_ADD_CARRY(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t Translate_VECTOR_ADD_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* Translate_VECTOR_ADD_I8(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
@@ -2553,9 +2646,9 @@ uint32_t Translate_VECTOR_ADD_I8(IntCodeState& ics, const IntCode* i) {
       dest.u8[n] = src1.u8[n] + src2.u8[n];
     }
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t Translate_VECTOR_ADD_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* Translate_VECTOR_ADD_I16(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
@@ -2590,9 +2683,9 @@ uint32_t Translate_VECTOR_ADD_I16(IntCodeState& ics, const IntCode* i) {
       dest.u16[n] = src1.u16[n] + src2.u16[n];
     }
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t Translate_VECTOR_ADD_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* Translate_VECTOR_ADD_I32(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
@@ -2628,16 +2721,16 @@ uint32_t Translate_VECTOR_ADD_I32(IntCodeState& ics, const IntCode* i) {
       dest.u32[n] = src1.u32[n] + src2.u32[n];
     }
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t Translate_VECTOR_ADD_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* Translate_VECTOR_ADD_F32(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.f32[n] = src1.f32[n] + src2.f32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_VECTOR_ADD(TranslationContext& ctx, Instr* i) {
   TypeName part_type = (TypeName)(i->flags & 0xFF);
@@ -2651,51 +2744,51 @@ int Translate_VECTOR_ADD(TranslationContext& ctx, Instr* i) {
 }
 
 #define SUB_DID_CARRY(a, b) ((b) == 0) || CHECK_DID_CARRY(a, 0 - b)
-uint32_t IntCode_SUB_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SUB_I8_I8(IntCodeState& ics, const IntCode* i) {
   int8_t a = ics.rf[i->src1_reg].i8;
   int8_t b = ics.rf[i->src2_reg].i8;
   if (i->flags == ARITHMETIC_SET_CARRY) {
     ics.did_carry = SUB_DID_CARRY(a, b);
   }
   ics.rf[i->dest_reg].i8 = a - b;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SUB_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SUB_I16_I16(IntCodeState& ics, const IntCode* i) {
   int16_t a = ics.rf[i->src1_reg].i16;
   int16_t b = ics.rf[i->src2_reg].i16;
   if (i->flags == ARITHMETIC_SET_CARRY) {
     ics.did_carry = SUB_DID_CARRY(a, b);
   }
   ics.rf[i->dest_reg].i16 = a - b;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SUB_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SUB_I32_I32(IntCodeState& ics, const IntCode* i) {
   int32_t a = ics.rf[i->src1_reg].i32;
   int32_t b = ics.rf[i->src2_reg].i32;
   if (i->flags == ARITHMETIC_SET_CARRY) {
     ics.did_carry = SUB_DID_CARRY(a, b);
   }
   ics.rf[i->dest_reg].i32 = a - b;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SUB_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SUB_I64_I64(IntCodeState& ics, const IntCode* i) {
   int64_t a = ics.rf[i->src1_reg].i64;
   int64_t b = ics.rf[i->src2_reg].i64;
   if (i->flags == ARITHMETIC_SET_CARRY) {
     ics.did_carry = SUB_DID_CARRY(a, b);
   }
   ics.rf[i->dest_reg].i64 = a - b;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SUB_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SUB_F32_F32(IntCodeState& ics, const IntCode* i) {
   assert_true(!i->flags);
   ics.rf[i->dest_reg].f32 = ics.rf[i->src1_reg].f32 - ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SUB_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SUB_F64_F64(IntCodeState& ics, const IntCode* i) {
   assert_true(!i->flags);
   ics.rf[i->dest_reg].f64 = ics.rf[i->src1_reg].f64 - ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_SUB(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2706,7 +2799,7 @@ int Translate_SUB(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t Translate_VECTOR_SUB_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* Translate_VECTOR_SUB_I8(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
@@ -2721,9 +2814,9 @@ uint32_t Translate_VECTOR_SUB_I8(IntCodeState& ics, const IntCode* i) {
       dest.i8[n] = src1.i8[n] - src2.i8[n];
     }
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t Translate_VECTOR_SUB_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* Translate_VECTOR_SUB_I16(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
@@ -2738,9 +2831,9 @@ uint32_t Translate_VECTOR_SUB_I16(IntCodeState& ics, const IntCode* i) {
       dest.i16[n] = src1.i16[n] - src2.i16[n];
     }
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t Translate_VECTOR_SUB_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* Translate_VECTOR_SUB_I32(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
@@ -2755,9 +2848,9 @@ uint32_t Translate_VECTOR_SUB_I32(IntCodeState& ics, const IntCode* i) {
       dest.i32[n] = src1.i32[n] - src2.i32[n];
     }
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t Translate_VECTOR_SUB_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* Translate_VECTOR_SUB_F32(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
@@ -2765,7 +2858,7 @@ uint32_t Translate_VECTOR_SUB_F32(IntCodeState& ics, const IntCode* i) {
   for (int n = 0; n < 4; n++) {
     dest.f32[n] = src1.f32[n] - src2.f32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_VECTOR_SUB(TranslationContext& ctx, Instr* i) {
   TypeName part_type = (TypeName)(i->flags & 0xFF);
@@ -2778,54 +2871,54 @@ int Translate_VECTOR_SUB(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[part_type]);
 }
 
-uint32_t IntCode_MUL_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 * ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_I16_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ics.rf[i->src1_reg].i16 * ics.rf[i->src2_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_I32_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ics.rf[i->src1_reg].i32 * ics.rf[i->src2_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_I64_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ics.rf[i->src1_reg].i64 * ics.rf[i->src2_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_F32_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = ics.rf[i->src1_reg].f32 * ics.rf[i->src2_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_F64_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = ics.rf[i->src1_reg].f64 * ics.rf[i->src2_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_V128_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_V128_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.f32[n] = src1.f32[n] * src2.f32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_I8_I8_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_I8_I8_U(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].u8 = ics.rf[i->src1_reg].u8 * ics.rf[i->src2_reg].u8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_I16_I16_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_I16_I16_U(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].u16 = ics.rf[i->src1_reg].u16 * ics.rf[i->src2_reg].u16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_I32_I32_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_I32_I32_U(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].u32 = ics.rf[i->src1_reg].u32 * ics.rf[i->src2_reg].u32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_I64_I64_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_I64_I64_U(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].u64 = ics.rf[i->src1_reg].u64 * ics.rf[i->src2_reg].u64;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_MUL(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2900,24 +2993,24 @@ uint64_t Mul128(uint64_t xi_low, uint64_t xi_high, uint64_t yi_low,
 }
 #endif  // !XE_COMPILER_MSVC
 
-uint32_t IntCode_MUL_HI_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_HI_I8_I8(IntCodeState& ics, const IntCode* i) {
   int16_t v = (int16_t)ics.rf[i->src1_reg].i8 * (int16_t)ics.rf[i->src2_reg].i8;
   ics.rf[i->dest_reg].i8 = (v >> 8);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_HI_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_HI_I16_I16(IntCodeState& ics, const IntCode* i) {
   int32_t v =
       (int32_t)ics.rf[i->src1_reg].i16 * (int32_t)ics.rf[i->src2_reg].i16;
   ics.rf[i->dest_reg].i16 = (v >> 16);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_HI_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_HI_I32_I32(IntCodeState& ics, const IntCode* i) {
   int64_t v =
       (int64_t)ics.rf[i->src1_reg].i32 * (int64_t)ics.rf[i->src2_reg].i32;
   ics.rf[i->dest_reg].i32 = (v >> 32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_HI_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_HI_I64_I64(IntCodeState& ics, const IntCode* i) {
 #if !XE_COMPILER_MSVC
   // GCC can, in theory, do this:
   __int128 v =
@@ -2932,27 +3025,27 @@ uint32_t IntCode_MUL_HI_I64_I64(IntCodeState& ics, const IntCode* i) {
   int64_t yi_high = yi_low < 0 ? -1 : 0;
   ics.rf[i->dest_reg].i64 = Mul128(xi_low, xi_high, yi_low, yi_high);
 #endif  // !MSVC
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_HI_I8_I8_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_HI_I8_I8_U(IntCodeState& ics, const IntCode* i) {
   uint16_t v =
       (uint16_t)ics.rf[i->src1_reg].u8 * (uint16_t)ics.rf[i->src2_reg].u8;
   ics.rf[i->dest_reg].u8 = (v >> 8);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_HI_I16_I16_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_HI_I16_I16_U(IntCodeState& ics, const IntCode* i) {
   uint32_t v =
       (uint32_t)ics.rf[i->src1_reg].u16 * (uint32_t)ics.rf[i->src2_reg].u16;
   ics.rf[i->dest_reg].u16 = (v >> 16);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_HI_I32_I32_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_HI_I32_I32_U(IntCodeState& ics, const IntCode* i) {
   uint64_t v =
       (uint64_t)ics.rf[i->src1_reg].u32 * (uint64_t)ics.rf[i->src2_reg].u32;
   ics.rf[i->dest_reg].u32 = (v >> 32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_HI_I64_I64_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_HI_I64_I64_U(IntCodeState& ics, const IntCode* i) {
 #if !XE_COMPILER_MSVC
   // GCC can, in theory, do this:
   __int128 v =
@@ -2967,7 +3060,7 @@ uint32_t IntCode_MUL_HI_I64_I64_U(IntCodeState& ics, const IntCode* i) {
   int64_t yi_high = 0;
   ics.rf[i->dest_reg].i64 = Mul128(xi_low, xi_high, yi_low, yi_high);
 #endif  // !MSVC
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_MUL_HI(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -2988,64 +3081,64 @@ int Translate_MUL_HI(TranslationContext& ctx, Instr* i) {
   }
 }
 
-uint32_t IntCode_DIV_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DIV_I8_I8(IntCodeState& ics, const IntCode* i) {
   auto divisor = ics.rf[i->src2_reg].i8;
   ics.rf[i->dest_reg].i8 = divisor ? ics.rf[i->src1_reg].i8 / divisor : 0;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DIV_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DIV_I16_I16(IntCodeState& ics, const IntCode* i) {
   auto divisor = ics.rf[i->src2_reg].i16;
   ics.rf[i->dest_reg].i16 = divisor ? ics.rf[i->src1_reg].i16 / divisor : 0;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DIV_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DIV_I32_I32(IntCodeState& ics, const IntCode* i) {
   auto divisor = ics.rf[i->src2_reg].i32;
   ics.rf[i->dest_reg].i32 = divisor ? ics.rf[i->src1_reg].i32 / divisor : 0;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DIV_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DIV_I64_I64(IntCodeState& ics, const IntCode* i) {
   auto divisor = ics.rf[i->src2_reg].i64;
   ics.rf[i->dest_reg].i64 = divisor ? ics.rf[i->src1_reg].i64 / divisor : 0;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DIV_F32_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DIV_F32_F32(IntCodeState& ics, const IntCode* i) {
   auto divisor = ics.rf[i->src2_reg].f32;
   ics.rf[i->dest_reg].f32 = divisor ? ics.rf[i->src1_reg].f32 / divisor : 0;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DIV_F64_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DIV_F64_F64(IntCodeState& ics, const IntCode* i) {
   auto divisor = ics.rf[i->src2_reg].f64;
   ics.rf[i->dest_reg].f64 = divisor ? ics.rf[i->src1_reg].f64 / divisor : 0;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DIV_V128_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DIV_V128_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.f32[n] = src1.f32[n] / src2.f32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DIV_I8_I8_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DIV_I8_I8_U(IntCodeState& ics, const IntCode* i) {
   auto divisor = ics.rf[i->src2_reg].u8;
   ics.rf[i->dest_reg].u8 = divisor ? ics.rf[i->src1_reg].u8 / divisor : 0;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DIV_I16_I16_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DIV_I16_I16_U(IntCodeState& ics, const IntCode* i) {
   auto divisor = ics.rf[i->src2_reg].u16;
   ics.rf[i->dest_reg].u16 = divisor ? ics.rf[i->src1_reg].u16 / divisor : 0;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DIV_I32_I32_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DIV_I32_I32_U(IntCodeState& ics, const IntCode* i) {
   auto divisor = ics.rf[i->src2_reg].u32;
   ics.rf[i->dest_reg].u32 = divisor ? ics.rf[i->src1_reg].u32 / divisor : 0;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_DIV_I64_I64_U(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DIV_I64_I64_U(IntCodeState& ics, const IntCode* i) {
   auto divisor = ics.rf[i->src2_reg].u64;
   ics.rf[i->dest_reg].u64 = divisor ? ics.rf[i->src1_reg].u64 / divisor : 0;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_DIV(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3066,37 +3159,37 @@ int Translate_DIV(TranslationContext& ctx, Instr* i) {
 }
 
 // TODO(benvanik): use intrinsics or something
-uint32_t IntCode_MUL_ADD_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_ADD_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 =
       ics.rf[i->src1_reg].i8 * ics.rf[i->src2_reg].i8 + ics.rf[i->src3_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_ADD_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_ADD_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ics.rf[i->src1_reg].i16 * ics.rf[i->src2_reg].i16 +
                             ics.rf[i->src3_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_ADD_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_ADD_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ics.rf[i->src1_reg].i32 * ics.rf[i->src2_reg].i32 +
                             ics.rf[i->src3_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_ADD_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_ADD_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ics.rf[i->src1_reg].i64 * ics.rf[i->src2_reg].i64 +
                             ics.rf[i->src3_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_ADD_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_ADD_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = ics.rf[i->src1_reg].f32 * ics.rf[i->src2_reg].f32 +
                             ics.rf[i->src3_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_ADD_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_ADD_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = ics.rf[i->src1_reg].f64 * ics.rf[i->src2_reg].f64 +
                             ics.rf[i->src3_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_ADD_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_ADD_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   const vec128_t& src3 = ics.rf[i->src3_reg].v128;
@@ -3104,7 +3197,7 @@ uint32_t IntCode_MUL_ADD_V128(IntCodeState& ics, const IntCode* i) {
   for (int n = 0; n < 4; n++) {
     dest.f32[n] = src1.f32[n] * src2.f32[n] + src3.f32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_MUL_ADD(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3116,37 +3209,37 @@ int Translate_MUL_ADD(TranslationContext& ctx, Instr* i) {
 }
 
 // TODO(benvanik): use intrinsics or something
-uint32_t IntCode_MUL_SUB_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_SUB_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 =
       ics.rf[i->src1_reg].i8 * ics.rf[i->src2_reg].i8 - ics.rf[i->src3_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_SUB_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_SUB_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ics.rf[i->src1_reg].i16 * ics.rf[i->src2_reg].i16 -
                             ics.rf[i->src3_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_SUB_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_SUB_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ics.rf[i->src1_reg].i32 * ics.rf[i->src2_reg].i32 -
                             ics.rf[i->src3_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_SUB_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_SUB_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ics.rf[i->src1_reg].i64 * ics.rf[i->src2_reg].i64 -
                             ics.rf[i->src3_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_SUB_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_SUB_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = ics.rf[i->src1_reg].f32 * ics.rf[i->src2_reg].f32 -
                             ics.rf[i->src3_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_SUB_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_SUB_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = ics.rf[i->src1_reg].f64 * ics.rf[i->src2_reg].f64 -
                             ics.rf[i->src3_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_MUL_SUB_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_MUL_SUB_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   const vec128_t& src3 = ics.rf[i->src3_reg].v128;
@@ -3154,7 +3247,7 @@ uint32_t IntCode_MUL_SUB_V128(IntCodeState& ics, const IntCode* i) {
   for (int n = 0; n < 4; n++) {
     dest.f32[n] = src1.f32[n] * src2.f32[n] - src3.f32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_MUL_SUB(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3165,37 +3258,37 @@ int Translate_MUL_SUB(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_NEG_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NEG_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = -ics.rf[i->src1_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_NEG_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NEG_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = -ics.rf[i->src1_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_NEG_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NEG_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = -ics.rf[i->src1_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_NEG_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NEG_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = -ics.rf[i->src1_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_NEG_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NEG_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = -ics.rf[i->src1_reg].f32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_NEG_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NEG_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = -ics.rf[i->src1_reg].f64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_NEG_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NEG_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (size_t i = 0; i < 4; i++) {
     dest.f32[i] = -src1.f32[i];
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_NEG(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3205,37 +3298,37 @@ int Translate_NEG(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_ABS_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ABS_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = abs(ics.rf[i->src1_reg].i8);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ABS_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ABS_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = abs(ics.rf[i->src1_reg].i16);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ABS_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ABS_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = abs(ics.rf[i->src1_reg].i32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ABS_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ABS_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = abs(ics.rf[i->src1_reg].i64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ABS_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ABS_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = abs(ics.rf[i->src1_reg].f32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ABS_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ABS_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = abs(ics.rf[i->src1_reg].f64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ABS_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ABS_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (size_t i = 0; i < 4; i++) {
     dest.f32[i] = abs(src1.f32[i]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_ABS(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3245,12 +3338,12 @@ int Translate_ABS(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_DOT_PRODUCT_3_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DOT_PRODUCT_3_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   ics.rf[i->dest_reg].f32 =
       (src1.x * src2.x) + (src1.y * src2.y) + (src1.z * src2.z);
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_DOT_PRODUCT_3(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3261,12 +3354,12 @@ int Translate_DOT_PRODUCT_3(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_DOT_PRODUCT_4_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_DOT_PRODUCT_4_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   ics.rf[i->dest_reg].f32 = (src1.x * src2.x) + (src1.y * src2.y) +
                             (src1.z * src2.z) + (src1.w * src2.w);
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_DOT_PRODUCT_4(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3277,21 +3370,21 @@ int Translate_DOT_PRODUCT_4(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_SQRT_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SQRT_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = sqrt(ics.rf[i->src1_reg].f32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SQRT_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SQRT_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = sqrt(ics.rf[i->src1_reg].f64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SQRT_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SQRT_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (size_t i = 0; i < 4; i++) {
     dest.f32[i] = sqrt(src1.f32[i]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_SQRT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3302,13 +3395,13 @@ int Translate_SQRT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_RSQRT_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_RSQRT_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.f32[n] = 1 / sqrtf(src1.f32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_RSQRT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3319,21 +3412,21 @@ int Translate_RSQRT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_POW2_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_POW2_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = (float)pow(2, ics.rf[i->src1_reg].f32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_POW2_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_POW2_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = pow(2, ics.rf[i->src1_reg].f64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_POW2_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_POW2_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (size_t i = 0; i < 4; i++) {
     dest.f32[i] = (float)pow(2, src1.f32[i]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_POW2(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3344,21 +3437,21 @@ int Translate_POW2(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_LOG2_F32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOG2_F32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f32 = log2(ics.rf[i->src1_reg].f32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOG2_F64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOG2_F64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].f64 = log2(ics.rf[i->src1_reg].f64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_LOG2_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_LOG2_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (size_t i = 0; i < 4; i++) {
     dest.f32[i] = log2(src1.f32[i]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_LOG2(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3369,30 +3462,30 @@ int Translate_LOG2(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_AND_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_AND_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 & ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_AND_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_AND_I16_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ics.rf[i->src1_reg].i16 & ics.rf[i->src2_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_AND_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_AND_I32_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ics.rf[i->src1_reg].i32 & ics.rf[i->src2_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_AND_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_AND_I64_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ics.rf[i->src1_reg].i64 & ics.rf[i->src2_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_AND_V128_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_AND_V128_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = src1.u32[n] & src2.u32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_AND(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3403,30 +3496,30 @@ int Translate_AND(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_OR_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_OR_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 | ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_OR_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_OR_I16_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ics.rf[i->src1_reg].i16 | ics.rf[i->src2_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_OR_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_OR_I32_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ics.rf[i->src1_reg].i32 | ics.rf[i->src2_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_OR_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_OR_I64_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ics.rf[i->src1_reg].i64 | ics.rf[i->src2_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_OR_V128_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_OR_V128_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = src1.u32[n] | src2.u32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_OR(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3437,30 +3530,30 @@ int Translate_OR(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_XOR_I8_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_XOR_I8_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 ^ ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_XOR_I16_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_XOR_I16_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ics.rf[i->src1_reg].i16 ^ ics.rf[i->src2_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_XOR_I32_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_XOR_I32_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ics.rf[i->src1_reg].i32 ^ ics.rf[i->src2_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_XOR_I64_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_XOR_I64_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ics.rf[i->src1_reg].i64 ^ ics.rf[i->src2_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_XOR_V128_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_XOR_V128_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = src1.u32[n] ^ src2.u32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_XOR(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3471,29 +3564,29 @@ int Translate_XOR(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_NOT_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NOT_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ~ics.rf[i->src1_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_NOT_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NOT_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ~ics.rf[i->src1_reg].i16;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_NOT_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NOT_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ~ics.rf[i->src1_reg].i32;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_NOT_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NOT_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ~ics.rf[i->src1_reg].i64;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_NOT_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_NOT_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = ~src1.u32[n];
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_NOT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3504,21 +3597,21 @@ int Translate_NOT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_SHL_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHL_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 << ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SHL_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHL_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ics.rf[i->src1_reg].i16 << ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SHL_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHL_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ics.rf[i->src1_reg].i32 << ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SHL_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHL_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ics.rf[i->src1_reg].i64 << ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_SHL(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3529,32 +3622,32 @@ int Translate_SHL(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_VECTOR_SHL_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_SHL_I8(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 16; n++) {
     dest.u8[n] = src1.u8[n] << (src2.u8[n] & 0x7);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_SHL_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_SHL_I16(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 8; n++) {
     dest.u16[n] = src1.u16[n] << (src2.u16[n] & 0xF);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_SHL_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_SHL_I32(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = src1.u32[n] << (src2.u32[n] & 0x1F);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_VECTOR_SHL(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3565,21 +3658,21 @@ int Translate_VECTOR_SHL(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->flags]);
 }
 
-uint32_t IntCode_SHR_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHR_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].u8 >> ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SHR_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHR_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ics.rf[i->src1_reg].u16 >> ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SHR_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHR_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ics.rf[i->src1_reg].u32 >> ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SHR_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHR_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ics.rf[i->src1_reg].u64 >> ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_SHR(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3590,32 +3683,32 @@ int Translate_SHR(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_VECTOR_SHR_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_SHR_I8(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 16; n++) {
     dest.u8[n] = src1.u8[n] >> (src2.u8[n] & 0x7);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_SHR_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_SHR_I16(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 8; n++) {
     dest.u16[n] = src1.u16[n] >> (src2.u16[n] & 0xF);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_SHR_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_SHR_I32(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = src1.u32[n] >> (src2.u32[n] & 0x1F);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_VECTOR_SHR(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3626,21 +3719,21 @@ int Translate_VECTOR_SHR(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->flags]);
 }
 
-uint32_t IntCode_SHA_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHA_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = ics.rf[i->src1_reg].i8 >> ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SHA_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHA_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = ics.rf[i->src1_reg].i16 >> ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SHA_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHA_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = ics.rf[i->src1_reg].i32 >> ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SHA_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SHA_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = ics.rf[i->src1_reg].i64 >> ics.rf[i->src2_reg].i8;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_SHA(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3651,32 +3744,32 @@ int Translate_SHA(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_VECTOR_SHA_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_SHA_I8(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 16; n++) {
     dest.u8[n] = int8_t(src1.u8[n]) >> (src2.u8[n] & 0x7);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_SHA_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_SHA_I16(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 8; n++) {
     dest.u16[n] = int16_t(src1.u16[n]) >> (src2.u16[n] & 0xF);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_SHA_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_SHA_I32(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = int32_t(src1.u32[n]) >> (src2.u32[n] & 0x1F);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_VECTOR_SHA(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3687,27 +3780,27 @@ int Translate_VECTOR_SHA(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->flags]);
 }
 
-uint32_t IntCode_ROTATE_LEFT_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ROTATE_LEFT_I8(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = poly::rotate_left<uint8_t>(ics.rf[i->src1_reg].i8,
                                                       ics.rf[i->src2_reg].i8);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ROTATE_LEFT_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ROTATE_LEFT_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = poly::rotate_left<uint16_t>(ics.rf[i->src1_reg].i16,
                                                         ics.rf[i->src2_reg].i8);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ROTATE_LEFT_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ROTATE_LEFT_I32(IntCodeState& ics, const IntCode* i) {
   // TODO(benvanik): use _rtol on vc++
   ics.rf[i->dest_reg].i32 = poly::rotate_left<uint32_t>(ics.rf[i->src1_reg].i32,
                                                         ics.rf[i->src2_reg].i8);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ROTATE_LEFT_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ROTATE_LEFT_I64(IntCodeState& ics, const IntCode* i) {
   // TODO(benvanik): use _rtol64 on vc++
   ics.rf[i->dest_reg].i64 = poly::rotate_left<uint64_t>(ics.rf[i->src1_reg].i64,
                                                         ics.rf[i->src2_reg].i8);
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_ROTATE_LEFT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3718,32 +3811,35 @@ int Translate_ROTATE_LEFT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_VECTOR_ROTATE_LEFT_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_ROTATE_LEFT_I8(IntCodeState& ics,
+                                             const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 16; n++) {
     dest.u8[n] = poly::rotate_left<uint8_t>(src1.u8[n], src2.u8[n] & 0x7);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_ROTATE_LEFT_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_ROTATE_LEFT_I16(IntCodeState& ics,
+                                              const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 8; n++) {
     dest.u16[n] = poly::rotate_left<uint16_t>(src1.u16[n], src2.u16[n] & 0xF);
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_VECTOR_ROTATE_LEFT_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_VECTOR_ROTATE_LEFT_I32(IntCodeState& ics,
+                                              const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = poly::rotate_left<uint32_t>(src1.u32[n], src2.u32[n] & 0x1F);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_VECTOR_ROTATE_LEFT(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3755,25 +3851,25 @@ int Translate_VECTOR_ROTATE_LEFT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->flags]);
 }
 
-uint32_t IntCode_BYTE_SWAP_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BYTE_SWAP_I16(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i16 = poly::byte_swap(ics.rf[i->src1_reg].i16);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BYTE_SWAP_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BYTE_SWAP_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i32 = poly::byte_swap(ics.rf[i->src1_reg].i32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BYTE_SWAP_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BYTE_SWAP_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i64 = poly::byte_swap(ics.rf[i->src1_reg].i64);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_BYTE_SWAP_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_BYTE_SWAP_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (int n = 0; n < 4; n++) {
     dest.u32[n] = poly::byte_swap(src1.u32[n]);
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_BYTE_SWAP(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3784,25 +3880,25 @@ int Translate_BYTE_SWAP(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->dest->type]);
 }
 
-uint32_t IntCode_CNTLZ_I8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CNTLZ_I8(IntCodeState& ics, const IntCode* i) {
   // CHECK
   assert_always();
   ics.rf[i->dest_reg].i8 = poly::lzcnt(ics.rf[i->src1_reg].i8);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CNTLZ_I16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CNTLZ_I16(IntCodeState& ics, const IntCode* i) {
   // CHECK
   assert_always();
   ics.rf[i->dest_reg].i8 = poly::lzcnt(ics.rf[i->src1_reg].i16);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CNTLZ_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CNTLZ_I32(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = poly::lzcnt(ics.rf[i->src1_reg].i32);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_CNTLZ_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_CNTLZ_I64(IntCodeState& ics, const IntCode* i) {
   ics.rf[i->dest_reg].i8 = poly::lzcnt(ics.rf[i->src1_reg].i64);
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_CNTLZ(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -3813,20 +3909,20 @@ int Translate_CNTLZ(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_EXTRACT_INT8_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_EXTRACT_INT8_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   ics.rf[i->dest_reg].i8 = src1.i8[ics.rf[i->src2_reg].i8 ^ 0x3];
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_EXTRACT_INT16_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_EXTRACT_INT16_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   ics.rf[i->dest_reg].i16 = src1.i16[ics.rf[i->src2_reg].i8 ^ 0x1];
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_EXTRACT_INT32_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_EXTRACT_INT32_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   ics.rf[i->dest_reg].i32 = src1.i32[ics.rf[i->src2_reg].i8];
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_EXTRACT(TranslationContext& ctx, Instr* i) {
   // Can do more as needed.
@@ -3861,32 +3957,32 @@ int Translate_EXTRACT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fn);
 }
 
-uint32_t IntCode_INSERT_INT8_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_INSERT_INT8_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const size_t offset = ics.rf[i->src2_reg].i64;
   const uint8_t part = ics.rf[i->src3_reg].i8;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   dest = src1;
   dest.u8[offset ^ 0x3] = part;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_INSERT_INT16_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_INSERT_INT16_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const size_t offset = ics.rf[i->src2_reg].i64;
   const uint16_t part = ics.rf[i->src3_reg].i16;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   dest = src1;
   dest.u16[offset ^ 0x1] = part;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_INSERT_INT32_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_INSERT_INT32_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   const size_t offset = ics.rf[i->src2_reg].i64;
   const uint32_t part = ics.rf[i->src3_reg].i32;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   dest = src1;
   dest.u32[offset] = part;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_INSERT(TranslationContext& ctx, Instr* i) {
   // Can do more as needed.
@@ -3921,37 +4017,37 @@ int Translate_INSERT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fn);
 }
 
-uint32_t IntCode_SPLAT_V128_INT8(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SPLAT_V128_INT8(IntCodeState& ics, const IntCode* i) {
   int8_t src1 = ics.rf[i->src1_reg].i8;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (size_t i = 0; i < 16; i++) {
     dest.u8[i] = src1;
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SPLAT_V128_INT16(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SPLAT_V128_INT16(IntCodeState& ics, const IntCode* i) {
   int16_t src1 = ics.rf[i->src1_reg].i16;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (size_t i = 0; i < 8; i++) {
     dest.u16[i] = src1;
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SPLAT_V128_INT32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SPLAT_V128_INT32(IntCodeState& ics, const IntCode* i) {
   int32_t src1 = ics.rf[i->src1_reg].i32;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (size_t i = 0; i < 4; i++) {
     dest.u32[i] = src1;
   }
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_SPLAT_V128_FLOAT32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SPLAT_V128_FLOAT32(IntCodeState& ics, const IntCode* i) {
   float src1 = ics.rf[i->src1_reg].f32;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   for (size_t i = 0; i < 4; i++) {
     dest.f32[i] = src1;
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_SPLAT(TranslationContext& ctx, Instr* i) {
   // Can do more as needed.
@@ -3986,7 +4082,8 @@ int Translate_SPLAT(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fn);
 }
 
-uint32_t IntCode_PERMUTE_V128_BY_INT32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_PERMUTE_V128_BY_INT32(IntCodeState& ics,
+                                             const IntCode* i) {
   uint32_t table = ics.rf[i->src1_reg].i32;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   const vec128_t& src3 = ics.rf[i->src3_reg].v128;
@@ -3999,9 +4096,10 @@ uint32_t IntCode_PERMUTE_V128_BY_INT32(IntCodeState& ics, const IntCode* i) {
                                      : src2.i32[(table >> 16) & 0x3];
   dest.i32[3] = (table & 0x04000000) ? src3.i32[(table >> 24) & 0x3]
                                      : src2.i32[(table >> 24) & 0x3];
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_PERMUTE_V128_BY_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_PERMUTE_V128_BY_V128(IntCodeState& ics,
+                                            const IntCode* i) {
   const vec128_t& table = ics.rf[i->src1_reg].v128;
   const vec128_t& src2 = ics.rf[i->src2_reg].v128;
   const vec128_t& src3 = ics.rf[i->src3_reg].v128;
@@ -4011,7 +4109,7 @@ uint32_t IntCode_PERMUTE_V128_BY_V128(IntCodeState& ics, const IntCode* i) {
     uint8_t index = (table.u8[n] & 0x1F) ^ 0x3;
     dest.u8[n] = index < 16 ? src2.u8[index] : src3.u8[index - 16];
   }
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_PERMUTE(TranslationContext& ctx, Instr* i) {
   // Can do more as needed.
@@ -4046,7 +4144,7 @@ int Translate_PERMUTE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fn);
 }
 
-uint32_t IntCode_SWIZZLE_V128(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_SWIZZLE_V128(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   uint32_t swizzle_mask = ics.rf[i->src2_reg].u32;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
@@ -4054,7 +4152,7 @@ uint32_t IntCode_SWIZZLE_V128(IntCodeState& ics, const IntCode* i) {
   dest.i32[1] = src1.i32[(swizzle_mask >> 2) & 0x3];
   dest.i32[2] = src1.i32[(swizzle_mask >> 4) & 0x3];
   dest.i32[3] = src1.i32[(swizzle_mask >> 6) & 0x3];
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_SWIZZLE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -4065,24 +4163,24 @@ int Translate_SWIZZLE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src1.value->type]);
 }
 
-uint32_t IntCode_PACK_D3DCOLOR(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_PACK_D3DCOLOR(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   // RGBA (XYZW) -> ARGB (WXYZ)
   dest.ux = dest.uy = dest.uz = 0;
   dest.uw = ((src1.uw & 0xFF) << 24) | ((src1.ux & 0xFF) << 16) |
             ((src1.uy & 0xFF) << 8) | (src1.uz & 0xFF);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_PACK_FLOAT16_2(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_PACK_FLOAT16_2(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   dest.ux = dest.uy = dest.uz = 0;
   dest.uw = (uint32_t(poly::float_to_half(src1.x)) << 16) |
             poly::float_to_half(src1.y);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_PACK_FLOAT16_4(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_PACK_FLOAT16_4(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   dest.ux = dest.uy = 0;
@@ -4090,16 +4188,16 @@ uint32_t IntCode_PACK_FLOAT16_4(IntCodeState& ics, const IntCode* i) {
             poly::float_to_half(src1.y);
   dest.uw = (uint32_t(poly::float_to_half(src1.z)) << 16) |
             poly::float_to_half(src1.w);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_PACK_SHORT_2(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_PACK_SHORT_2(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   int16_t dx = int16_t(poly::saturate(src1.x) * 32767.0f);
   int16_t dy = int16_t(poly::saturate(src1.y) * 32767.0f);
   dest.ux = dest.uy = dest.uz = 0;
   dest.uw = (uint32_t(uint16_t(dx)) << 16) | uint32_t(uint16_t(dy));
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_PACK(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -4110,7 +4208,7 @@ int Translate_PACK(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->flags]);
 }
 
-uint32_t IntCode_UNPACK_D3DCOLOR(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_UNPACK_D3DCOLOR(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   // ARGB (WXYZ) -> RGBA (XYZW)
@@ -4120,27 +4218,27 @@ uint32_t IntCode_UNPACK_D3DCOLOR(IntCodeState& ics, const IntCode* i) {
   dest.u32[1] = 0x3F800000 | ((src >> 8) & 0xFF);
   dest.u32[2] = 0x3F800000 | (src & 0xFF);
   dest.u32[3] = 0x3F800000 | ((src >> 24) & 0xFF);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_UNPACK_FLOAT16_2(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_UNPACK_FLOAT16_2(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   dest.f32[0] = poly::half_to_float(uint16_t(src1.uw >> 16));
   dest.f32[1] = poly::half_to_float(uint16_t(src1.uw));
   dest.f32[2] = 0.0f;
   dest.f32[3] = 1.0f;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_UNPACK_FLOAT16_4(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_UNPACK_FLOAT16_4(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   dest.f32[0] = poly::half_to_float(src1.u16[5]);
   dest.f32[1] = poly::half_to_float(src1.u16[4]);
   dest.f32[2] = poly::half_to_float(src1.u16[7]);
   dest.f32[3] = poly::half_to_float(src1.u16[6]);
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_UNPACK_SHORT_2(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_UNPACK_SHORT_2(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   // XMLoadShortN2
@@ -4150,9 +4248,9 @@ uint32_t IntCode_UNPACK_SHORT_2(IntCodeState& ics, const IntCode* i) {
   dest.u32[1] = sy & 0x8000 ? (0x403F0000 | sy) : (0x40400000 | sy);
   dest.u32[2] = 0;
   dest.u32[3] = 0x3F800000;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_UNPACK_S8_IN_16_LO(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_UNPACK_S8_IN_16_LO(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   dest.i16[0] = (int16_t)src1.i8[8 + 0];
@@ -4163,9 +4261,9 @@ uint32_t IntCode_UNPACK_S8_IN_16_LO(IntCodeState& ics, const IntCode* i) {
   dest.i16[5] = (int16_t)src1.i8[8 + 5];
   dest.i16[6] = (int16_t)src1.i8[8 + 6];
   dest.i16[7] = (int16_t)src1.i8[8 + 7];
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_UNPACK_S8_IN_16_HI(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_UNPACK_S8_IN_16_HI(IntCodeState& ics, const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   dest.i16[0] = (int16_t)src1.i8[0];
@@ -4176,25 +4274,27 @@ uint32_t IntCode_UNPACK_S8_IN_16_HI(IntCodeState& ics, const IntCode* i) {
   dest.i16[5] = (int16_t)src1.i8[5];
   dest.i16[6] = (int16_t)src1.i8[6];
   dest.i16[7] = (int16_t)src1.i8[7];
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_UNPACK_S16_IN_32_LO(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_UNPACK_S16_IN_32_LO(IntCodeState& ics,
+                                           const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   dest.i32[0] = (int32_t)src1.i16[4 + 0];
   dest.i32[1] = (int32_t)src1.i16[4 + 1];
   dest.i32[2] = (int32_t)src1.i16[4 + 2];
   dest.i32[3] = (int32_t)src1.i16[4 + 3];
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_UNPACK_S16_IN_32_HI(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_UNPACK_S16_IN_32_HI(IntCodeState& ics,
+                                           const IntCode* i) {
   const vec128_t& src1 = ics.rf[i->src1_reg].v128;
   vec128_t& dest = ics.rf[i->dest_reg].v128;
   dest.i32[0] = (int32_t)src1.i16[0];
   dest.i32[1] = (int32_t)src1.i16[1];
   dest.i32[2] = (int32_t)src1.i16[2];
   dest.i32[3] = (int32_t)src1.i16[3];
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_UNPACK(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -4206,19 +4306,57 @@ int Translate_UNPACK(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->flags]);
 }
 
-uint32_t IntCode_ATOMIC_EXCHANGE_I32(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_COMPARE_EXCHANGE_I32(IntCodeState& ics,
+                                           const IntCode* i) {
+  auto address = (volatile uint32_t*)ics.rf[i->src1_reg].u64;
+  auto compare_value = ics.rf[i->src2_reg].u32;
+  auto exchange_value = ics.rf[i->src3_reg].u32;
+  uint32_t old_value;
+  do {
+    old_value = *address;
+  } while (old_value == compare_value &&
+           !poly::atomic_cas(compare_value, exchange_value, address));
+  ics.rf[i->dest_reg].u32 = old_value;
+  return i + 1;
+}
+const IntCode* IntCode_COMPARE_EXCHANGE_I64(IntCodeState& ics,
+                                           const IntCode* i) {
+  auto address = (volatile uint64_t*)ics.rf[i->src1_reg].u64;
+  auto compare_value = ics.rf[i->src2_reg].u64;
+  auto exchange_value = ics.rf[i->src3_reg].u64;
+  uint64_t old_value;
+  do {
+    old_value = *address;
+  } while (old_value == compare_value &&
+           !poly::atomic_cas(compare_value, exchange_value, address));
+  ics.rf[i->dest_reg].u64 = old_value;
+  return i + 1;
+}
+int Translate_COMPARE_EXCHANGE(TranslationContext& ctx, Instr* i) {
+  static IntCodeFn fns[] = {
+      IntCode_INVALID_TYPE,         IntCode_INVALID_TYPE,
+      IntCode_COMPARE_EXCHANGE_I32, IntCode_COMPARE_EXCHANGE_I64,
+      IntCode_INVALID_TYPE,         IntCode_INVALID_TYPE,
+      IntCode_INVALID_TYPE,
+  };
+  return DispatchToC(ctx, i, fns[i->dest->type]);
+}
+
+const IntCode* IntCode_ATOMIC_EXCHANGE_I32(IntCodeState& ics,
+                                           const IntCode* i) {
   auto address = (uint32_t*)ics.rf[i->src1_reg].u64;
   auto new_value = ics.rf[i->src2_reg].u32;
   auto old_value = poly::atomic_exchange(new_value, address);
   ics.rf[i->dest_reg].u32 = old_value;
-  return IA_NEXT;
+  return i + 1;
 }
-uint32_t IntCode_ATOMIC_EXCHANGE_I64(IntCodeState& ics, const IntCode* i) {
+const IntCode* IntCode_ATOMIC_EXCHANGE_I64(IntCodeState& ics,
+                                           const IntCode* i) {
   auto address = (uint64_t*)ics.rf[i->src1_reg].u64;
   auto new_value = ics.rf[i->src2_reg].u64;
   auto old_value = poly::atomic_exchange(new_value, address);
   ics.rf[i->dest_reg].u64 = old_value;
-  return IA_NEXT;
+  return i + 1;
 }
 int Translate_ATOMIC_EXCHANGE(TranslationContext& ctx, Instr* i) {
   static IntCodeFn fns[] = {
@@ -4230,6 +4368,243 @@ int Translate_ATOMIC_EXCHANGE(TranslationContext& ctx, Instr* i) {
   return DispatchToC(ctx, i, fns[i->src2.value->type]);
 }
 
+// Superinstructions.
+// These take over the first intcode of a common sequence and return past the
+// end of it. The rest of the sequence is left as it was, so nothing that
+// jumps into the middle of it needs fixing up. Operands the head doesn't use
+// carry whatever else the sequence needs.
+
+// COMPARE_xx; INT_LOAD_CONSTANT label; BRANCH_TRUE/FALSE
+// src3_reg = branch target.
+template <IntCodeFn COMPARE_FN, bool BRANCH_IF>
+const IntCode* IntCode_COMPARE_BRANCH(IntCodeState& ics, const IntCode* i) {
+  COMPARE_FN(ics, i);
+  if (!!ics.rf[i->dest_reg].u8 == BRANCH_IF) {
+    return ics.intcodes + i->src3_reg;
+  }
+  return i + 3;
+}
+
+// INT_LOAD_CONSTANT offset; LOAD_CONTEXT
+// dest_reg = load dest. Constant registers are only read by the intcode they
+// were loaded for, so the offset itself never needs to be written.
+template <typename T>
+const IntCode* IntCode_LOAD_CONTEXT_IMM(IntCodeState& ics, const IntCode* i) {
+  *reinterpret_cast<T*>(&ics.rf[i->dest_reg]) =
+      *reinterpret_cast<T*>(ics.context + i->constant.u64);
+  return i + 2;
+}
+
+// INT_LOAD_CONSTANT offset; STORE_CONTEXT
+// dest_reg = value to store.
+template <typename T>
+const IntCode* IntCode_STORE_CONTEXT_IMM(IntCodeState& ics, const IntCode* i) {
+  *reinterpret_cast<T*>(ics.context + i->constant.u64) =
+      *reinterpret_cast<T*>(&ics.rf[i->dest_reg]);
+  return i + 2;
+}
+
+// LOAD; BYTE_SWAP
+// src2_reg = swapped dest. Register accesses go the long way.
+template <typename T, IntCodeFn LOAD_FN>
+const IntCode* IntCode_LOAD_BYTE_SWAP(IntCodeState& ics, const IntCode* i) {
+  uint32_t address = ics.rf[i->src1_reg].u32;
+  if (DYNAMIC_REGISTER_ACCESS_CHECK(address)) {
+    return LOAD_FN(ics, i);
+  }
+  T value = *reinterpret_cast<T*>(ics.membase + address);
+  *reinterpret_cast<T*>(&ics.rf[i->dest_reg]) = value;
+  *reinterpret_cast<T*>(&ics.rf[i->src2_reg]) = poly::byte_swap(value);
+  return i + 2;
+}
+
+// BYTE_SWAP; STORE
+// src2_reg = store address. Register accesses go the long way.
+template <typename T>
+const IntCode* IntCode_BYTE_SWAP_STORE(IntCodeState& ics, const IntCode* i) {
+  T value = poly::byte_swap(*reinterpret_cast<T*>(&ics.rf[i->src1_reg]));
+  *reinterpret_cast<T*>(&ics.rf[i->dest_reg]) = value;
+  uint32_t address = ics.rf[i->src2_reg].u32;
+  if (DYNAMIC_REGISTER_ACCESS_CHECK(address)) {
+    return i + 1;
+  }
+  *reinterpret_cast<T*>(ics.membase + address) = value;
+  return i + 2;
+}
+
+// Keyed on the second intcode, as the first is always INT_LOAD_CONSTANT.
+struct FusedConstantPair {
+  IntCodeFn fn;
+  IntCodeFn fused_fn;
+};
+struct FusedPair {
+  IntCodeFn first_fn;
+  IntCodeFn second_fn;
+  IntCodeFn fused_fn;
+};
+struct FusedBranch {
+  IntCodeFn compare_fn;
+  IntCodeFn branch_true_fn;
+  IntCodeFn branch_false_fn;
+};
+
+#define COMPARE_BRANCH(op, type)                                      \
+  {                                                                   \
+    IntCode_COMPARE_##op##_##type##_##type,                           \
+        IntCode_COMPARE_BRANCH<IntCode_COMPARE_##op##_##type##_##type, \
+                               true>,                                 \
+        IntCode_COMPARE_BRANCH<IntCode_COMPARE_##op##_##type##_##type, \
+                               false>,                                \
+  }
+#define COMPARE_BRANCHES(op)                                                \
+  COMPARE_BRANCH(op, I8), COMPARE_BRANCH(op, I16), COMPARE_BRANCH(op, I32), \
+      COMPARE_BRANCH(op, I64), COMPARE_BRANCH(op, F32),                     \
+      COMPARE_BRANCH(op, F64)
+static const FusedBranch fused_compare_branches[] = {
+    COMPARE_BRANCHES(EQ),  COMPARE_BRANCHES(NE),  COMPARE_BRANCHES(SLT),
+    COMPARE_BRANCHES(SLE), COMPARE_BRANCHES(SGT), COMPARE_BRANCHES(SGE),
+    COMPARE_BRANCHES(ULT), COMPARE_BRANCHES(ULE), COMPARE_BRANCHES(UGT),
+    COMPARE_BRANCHES(UGE),
+};
+#undef COMPARE_BRANCHES
+#undef COMPARE_BRANCH
+
+static const FusedConstantPair fused_context_loads[] = {
+    {IntCode_LOAD_CONTEXT_I8, IntCode_LOAD_CONTEXT_IMM<int8_t>},
+    {IntCode_LOAD_CONTEXT_I16, IntCode_LOAD_CONTEXT_IMM<int16_t>},
+    {IntCode_LOAD_CONTEXT_I32, IntCode_LOAD_CONTEXT_IMM<int32_t>},
+    {IntCode_LOAD_CONTEXT_I64, IntCode_LOAD_CONTEXT_IMM<int64_t>},
+    {IntCode_LOAD_CONTEXT_F32, IntCode_LOAD_CONTEXT_IMM<float>},
+    {IntCode_LOAD_CONTEXT_F64, IntCode_LOAD_CONTEXT_IMM<double>},
+    {IntCode_LOAD_CONTEXT_V128, IntCode_LOAD_CONTEXT_IMM<vec128_t>},
+};
+static const FusedConstantPair fused_context_stores[] = {
+    {IntCode_STORE_CONTEXT_I8, IntCode_STORE_CONTEXT_IMM<int8_t>},
+    {IntCode_STORE_CONTEXT_I16, IntCode_STORE_CONTEXT_IMM<int16_t>},
+    {IntCode_STORE_CONTEXT_I32, IntCode_STORE_CONTEXT_IMM<int32_t>},
+    {IntCode_STORE_CONTEXT_I64, IntCode_STORE_CONTEXT_IMM<int64_t>},
+    {IntCode_STORE_CONTEXT_F32, IntCode_STORE_CONTEXT_IMM<float>},
+    {IntCode_STORE_CONTEXT_F64, IntCode_STORE_CONTEXT_IMM<double>},
+    {IntCode_STORE_CONTEXT_V128, IntCode_STORE_CONTEXT_IMM<vec128_t>},
+};
+static const FusedPair fused_swapped_loads[] = {
+    {IntCode_LOAD_I16, IntCode_BYTE_SWAP_I16,
+     IntCode_LOAD_BYTE_SWAP<int16_t, IntCode_LOAD_I16>},
+    {IntCode_LOAD_I32, IntCode_BYTE_SWAP_I32,
+     IntCode_LOAD_BYTE_SWAP<int32_t, IntCode_LOAD_I32>},
+    {IntCode_LOAD_I64, IntCode_BYTE_SWAP_I64,
+     IntCode_LOAD_BYTE_SWAP<int64_t, IntCode_LOAD_I64>},
+};
+static const FusedPair fused_swapped_stores[] = {
+    {IntCode_BYTE_SWAP_I16, IntCode_STORE_I16,
+     IntCode_BYTE_SWAP_STORE<int16_t>},
+    {IntCode_BYTE_SWAP_I32, IntCode_STORE_I32,
+     IntCode_BYTE_SWAP_STORE<int32_t>},
+    {IntCode_BYTE_SWAP_I64, IntCode_STORE_I64,
+     IntCode_BYTE_SWAP_STORE<int64_t>},
+};
+
+template <size_t N>
+IntCodeFn FindFused(const FusedConstantPair (&table)[N], IntCodeFn fn) {
+  for (size_t n = 0; n < N; ++n) {
+    if (table[n].fn == fn) {
+      return table[n].fused_fn;
+    }
+  }
+  return nullptr;
+}
+
+template <size_t N>
+IntCodeFn FindFused(const FusedPair (&table)[N], IntCodeFn first_fn,
+                    IntCodeFn second_fn) {
+  for (size_t n = 0; n < N; ++n) {
+    if (table[n].first_fn == first_fn && table[n].second_fn == second_fn) {
+      return table[n].fused_fn;
+    }
+  }
+  return nullptr;
+}
+
+bool FuseConstantPair(IntCode* i, const IntCode* next) {
+  if (next->src1_reg != i->dest_reg) {
+    return false;
+  }
+  IntCodeFn fused_fn;
+  if ((fused_fn = FindFused(fused_context_loads, next->intcode_fn))) {
+    i->intcode_fn = fused_fn;
+    i->dest_reg = next->dest_reg;
+    return true;
+  }
+  if ((fused_fn = FindFused(fused_context_stores, next->intcode_fn))) {
+    i->intcode_fn = fused_fn;
+    i->dest_reg = next->src2_reg;
+    return true;
+  }
+  return false;
+}
+
+bool FusePair(IntCode* i, const IntCode* next) {
+  IntCodeFn fused_fn;
+  if ((fused_fn = FindFused(fused_swapped_loads, i->intcode_fn,
+                            next->intcode_fn)) &&
+      next->src1_reg == i->dest_reg) {
+    i->intcode_fn = fused_fn;
+    i->src2_reg = next->dest_reg;
+    return true;
+  }
+  if ((fused_fn = FindFused(fused_swapped_stores, i->intcode_fn,
+                            next->intcode_fn)) &&
+      next->src2_reg == i->dest_reg) {
+    i->intcode_fn = fused_fn;
+    i->src2_reg = next->src1_reg;
+    return true;
+  }
+  return false;
+}
+
+bool FuseCompareBranch(IntCode* i, const IntCode* label,
+                       const IntCode* branch) {
+  if (label->intcode_fn != IntCode_INT_LOAD_CONSTANT ||
+      branch->src1_reg != i->dest_reg || branch->src2_reg != label->dest_reg) {
+    return false;
+  }
+  for (auto& entry : fused_compare_branches) {
+    if (i->intcode_fn != entry.compare_fn) {
+      continue;
+    }
+    if (branch->intcode_fn == IntCode_BRANCH_TRUE_I8) {
+      i->intcode_fn = entry.branch_true_fn;
+    } else if (branch->intcode_fn == IntCode_BRANCH_FALSE_I8) {
+      i->intcode_fn = entry.branch_false_fn;
+    } else {
+      return false;
+    }
+    i->src3_reg = static_cast<uint32_t>(label->constant.u64);
+    return true;
+  }
+  return false;
+}
+
+uint32_t FuseIntCodes(IntCode* intcodes, size_t intcode_count) {
+  uint32_t fused_count = 0;
+  for (size_t n = 0; n + 1 < intcode_count; ++n) {
+    IntCode* i = &intcodes[n];
+    const IntCode* next = &intcodes[n + 1];
+    bool fused;
+    if (i->intcode_fn == IntCode_INT_LOAD_CONSTANT) {
+      fused = FuseConstantPair(i, next);
+    } else {
+      fused = FusePair(i, next) ||
+              (n + 2 < intcode_count &&
+               FuseCompareBranch(i, next, &intcodes[n + 2]));
+    }
+    if (fused) {
+      ++fused_count;
+    }
+  }
+  return fused_count;
+}
+
 typedef int (*TranslateFn)(TranslationContext& ctx, Instr* i);
 static const TranslateFn dispatch_table[] = {
     Translate_COMMENT,            Translate_NOP,
@@ -4284,7 +4659,7 @@ static const TranslateFn dispatch_table[] = {
     Translate_SPLAT,              Translate_PERMUTE,
     Translate_SWIZZLE,            Translate_PACK,
     Translate_UNPACK,
-    TranslateInvalid,  // Translate_COMPARE_EXCHANGE,
+    Translate_COMPARE_EXCHANGE,
     Translate_ATOMIC_EXCHANGE,
     TranslateInvalid,  // Translate_ATOMIC_ADD,
     TranslateInvalid,  // Translate_ATOMIC_SUB,
@@ -37,24 +37,29 @@ typedef union {
   vec128_t v128;
 } Register;
 
+struct IntCode_s;
+
 typedef struct {
   Register* rf;
   uint8_t* locals;
   uint8_t* context;
   uint8_t* membase;
-  uint8_t* page_table;
   int8_t did_carry;
   int8_t did_saturate;
   runtime::ThreadState* thread_state;
   uint64_t return_address;
   uint64_t call_return_address;
+  // Base of the function's intcodes, for branches to resolve targets.
+  const struct IntCode_s* intcodes;
 } IntCodeState;
 
-struct IntCode_s;
-typedef uint32_t (*IntCodeFn)(IntCodeState& ics, const struct IntCode_s* i);
+// Intcodes are direct threaded: each one returns the next to run (usually
+// i + 1), or IA_RETURN to leave the function. Superinstructions return past
+// the intcodes they fused.
+typedef const struct IntCode_s* (*IntCodeFn)(IntCodeState& ics,
+                                             const struct IntCode_s* i);
 
-#define IA_RETURN 0xA0000000
-#define IA_NEXT 0xB0000000
+#define IA_RETURN nullptr
 
 typedef struct IntCode_s {
   IntCodeFn intcode_fn;
@@ -101,6 +106,10 @@ typedef struct {
 
 int TranslateIntCodes(TranslationContext& ctx, hir::Instr* i);
 
+// Replaces common intcode sequences with superinstructions in place, once
+// all labels have been resolved. Returns the number of sequences fused.
+uint32_t FuseIntCodes(IntCode* intcodes, size_t intcode_count);
+
 }  // namespace ivm
 }  // namespace backend
 }  // namespace alloy
@@ -11,8 +11,11 @@
 
 #include <alloy/reset_scope.h>
 #include <alloy/backend/x64/x64_backend.h>
+#include <alloy/backend/x64/x64_code_cache.h>
 #include <alloy/backend/x64/x64_emitter.h>
 #include <alloy/backend/x64/x64_function.h>
+#include <alloy/backend/x64/x64_persistent_cache.h>
+#include <alloy/backend/x64/x64_tracers.h>
 #include <alloy/hir/hir_builder.h>
 #include <alloy/hir/label.h>
 #include <alloy/runtime/runtime.h>
@@ -78,6 +81,17 @@ int X64Assembler::Assemble(FunctionInfo* symbol_info, HIRBuilder* builder,
     return result;
   }
 
+  // Keep for later runs. Debug info and tracing hooks aren't persisted, so
+  // only plain functions qualify.
+  auto persistent_cache = x64_backend_->persistent_cache();
+  if (persistent_cache && !debug_info_flags && !trace_flags &&
+      !GetTracingMode()) {
+    persistent_cache->StoreFunction(symbol_info, machine_code, code_size,
+                                    emitter_->stack_size(),
+                                    emitter_->relocations(),
+                                    builder->inlined_ranges());
+  }
+
   // Stash generated machine code.
   if (debug_info_flags & DebugInfoFlags::DEBUG_INFO_MACHINE_CODE_DISASM) {
     DumpMachineCode(debug_info.get(), machine_code, code_size, &string_buffer_);
@@ -89,6 +103,10 @@ int X64Assembler::Assemble(FunctionInfo* symbol_info, HIRBuilder* builder,
     X64Function* fn = new X64Function(symbol_info);
     fn->set_debug_info(std::move(debug_info));
     fn->Setup(machine_code, code_size);
+    fn->SetupIndirectCallSites(emitter_->indirect_call_sites());
+
+    // Publish to the dispatch table so calls can skip the resolver.
+    x64_backend_->code_cache()->CommitFunction(fn);
 
     *out_function = fn;
   }
@@ -9,10 +9,18 @@
 
 #include <alloy/backend/x64/x64_backend.h>
 
+#include <algorithm>
+#include <string>
+
+#include <alloy/alloy-private.h>
 #include <alloy/backend/x64/x64_assembler.h>
 #include <alloy/backend/x64/x64_code_cache.h>
+#include <alloy/backend/x64/x64_function.h>
+#include <alloy/backend/x64/x64_persistent_cache.h>
 #include <alloy/backend/x64/x64_sequences.h>
 #include <alloy/backend/x64/x64_thunk_emitter.h>
+#include <alloy/runtime/runtime.h>
+#include <third_party/xbyak/xbyak/xbyak_util.h>
 
 namespace alloy {
 namespace backend {
@@ -20,9 +28,30 @@ namespace x64 {
 
 using alloy::runtime::Runtime;
 
-X64Backend::X64Backend(Runtime* runtime) : Backend(runtime), code_cache_(0) {}
+X64Backend::X64Backend(Runtime* runtime, uint32_t emit_feature_mask)
+    : Backend(runtime),
+      emit_feature_mask_(emit_feature_mask),
+      emit_features_(0),
+      code_cache_(0),
+      persistent_cache_(nullptr) {}
 
-X64Backend::~X64Backend() { delete code_cache_; }
+X64Backend::~X64Backend() {
+  if (FLAGS_x64_indirect_call_stats) {
+    DumpIndirectCallStats();
+  }
+  if (persistent_cache_) {
+    PLOGI("Code cache: %u functions loaded, %u stored",
+          persistent_cache_->load_count(), persistent_cache_->store_count());
+    delete persistent_cache_;
+  }
+  if (code_cache_) {
+    code_cache_->DumpCounters();
+  }
+  delete code_cache_;
+  for (auto call_site : call_sites_) {
+    delete call_site;
+  }
+}
 
 int X64Backend::Initialize() {
   int result = Backend::Initialize();
@@ -30,6 +59,11 @@ int X64Backend::Initialize() {
     return result;
   }
 
+  result = DetectEmitFeatures();
+  if (result) {
+    return result;
+  }
+
   RegisterSequences();
 
   machine_info_.register_sets[0] = {
@@ -41,7 +75,7 @@ int X64Backend::Initialize() {
       X64Emitter::XMM_COUNT,
   };
 
-  code_cache_ = new X64CodeCache();
+  code_cache_ = new X64CodeCache(this);
   result = code_cache_->Initialize();
   if (result) {
     return result;
@@ -52,14 +86,170 @@ int X64Backend::Initialize() {
   auto thunk_emitter = std::make_unique<X64ThunkEmitter>(this, allocator.get());
   host_to_guest_thunk_ = thunk_emitter->EmitHostToGuestThunk();
   guest_to_host_thunk_ = thunk_emitter->EmitGuestToHostThunk();
+  link_call_thunk_ = thunk_emitter->EmitLinkCallThunk();
+
+  if (FLAGS_x64_code_cache_path.size()) {
+    persistent_cache_ = new X64PersistentCache(this);
+    if (persistent_cache_->Initialize(FLAGS_x64_code_cache_path)) {
+      // Not fatal; everything will just be translated as usual.
+      delete persistent_cache_;
+      persistent_cache_ = nullptr;
+    }
+  }
 
   return result;
 }
 
+int X64Backend::DetectEmitFeatures() {
+  Xbyak::util::Cpu cpu;
+  if (!cpu.has(Xbyak::util::Cpu::tAVX)) {
+    PLOGE("The x64 backend requires AVX");
+    return 1;
+  }
+
+  struct {
+    uint32_t flag;
+    Xbyak::util::Cpu::Type cpu_type;
+    bool enabled;
+    const char* name;
+  } features[] = {
+      {EMIT_AVX2, Xbyak::util::Cpu::tAVX2, FLAGS_x64_enable_avx2, "avx2"},
+      {EMIT_FMA, Xbyak::util::Cpu::tFMA, FLAGS_x64_enable_fma, "fma"},
+      {EMIT_BMI2, Xbyak::util::Cpu::tBMI2, FLAGS_x64_enable_bmi2, "bmi2"},
+      {EMIT_MOVBE, Xbyak::util::Cpu::tMOVBE, FLAGS_x64_enable_movbe, "movbe"},
+      {EMIT_F16C, Xbyak::util::Cpu::tF16C, FLAGS_x64_enable_f16c, "f16c"},
+  };
+  std::string names;
+  for (auto& feature : features) {
+    if (cpu.has(feature.cpu_type) && feature.enabled &&
+        (emit_feature_mask_ & feature.flag)) {
+      emit_features_ |= feature.flag;
+      names += " ";
+      names += feature.name;
+    }
+  }
+  PLOGI("x64 backend extensions:%s", names.size() ? names.c_str() : " none");
+  return 0;
+}
+
+void* X64Backend::AllocThreadData() {
+  auto thread_data = new X64ThreadData();
+  thread_data->code_cache_thread = code_cache_->RegisterThread();
+  return thread_data;
+}
+
+void X64Backend::FreeThreadData(void* thread_data) {
+  auto x64_thread_data = reinterpret_cast<X64ThreadData*>(thread_data);
+  code_cache_->UnregisterThread(x64_thread_data->code_cache_thread);
+  delete x64_thread_data;
+}
+
+void X64Backend::EnterGuest(void* thread_data, const void* stack_top) {
+  auto x64_thread_data = reinterpret_cast<X64ThreadData*>(thread_data);
+  code_cache_->EnterGuest(x64_thread_data->code_cache_thread, stack_top);
+}
+
+void X64Backend::LeaveGuest(void* thread_data) {
+  auto x64_thread_data = reinterpret_cast<X64ThreadData*>(thread_data);
+  code_cache_->LeaveGuest(x64_thread_data->code_cache_thread);
+}
+
 std::unique_ptr<Assembler> X64Backend::CreateAssembler() {
   return std::make_unique<X64Assembler>(this);
 }
 
+int X64Backend::LoadCachedFunction(runtime::FunctionInfo* symbol_info,
+                                   runtime::Function** out_function) {
+  if (!persistent_cache_) {
+    return 1;
+  }
+  return persistent_cache_->LoadFunction(symbol_info, out_function);
+}
+
+int X64Backend::WrapTier0Function(runtime::Function* tier0_function,
+                                  runtime::Function** out_function) {
+  auto function = new X64Function(tier0_function->symbol_info());
+  function->SetupTier0(std::unique_ptr<runtime::Function>(tier0_function));
+
+  // Stubs are tiny, so one emitter (and its buffer) does for all of them.
+  size_t code_size;
+  void* machine_code;
+  {
+    std::lock_guard<std::mutex> guard(tier0_stub_lock_);
+    if (!tier0_stub_emitter_) {
+      tier0_stub_allocator_ = std::make_unique<XbyakAllocator>();
+      tier0_stub_emitter_ =
+          std::make_unique<X64ThunkEmitter>(this, tier0_stub_allocator_.get());
+    }
+    machine_code =
+        tier0_stub_emitter_->EmitTier0EntryStub(function, &code_size);
+  }
+  function->Setup(machine_code, code_size);
+
+  // From here on it's linked and dispatched to like any other function.
+  code_cache_->CommitFunction(function);
+
+  *out_function = function;
+  return 0;
+}
+
+int X64Backend::PromoteTier0Function(X64Function* function) {
+  runtime::Function* new_function;
+  if (runtime_->PromoteFunction(function, &new_function)) {
+    return 1;
+  }
+  // The full translation replaced the stub in the dispatch table when it was
+  // committed. Whatever is still linked to the stub will now come back through
+  // the resolver and get linked to the new code instead.
+  return code_cache_->RetireFunction(function);
+}
+
+IndirectCallSite* X64Backend::AllocateIndirectCallSite() {
+  auto call_site = new IndirectCallSite();
+  call_site->ic_table_distance = 0;
+  call_site->call_count = 0;
+  call_site->table_hit_count = 0;
+  call_site->resolve_count = 0;
+  std::lock_guard<std::mutex> guard(call_sites_lock_);
+  call_sites_.insert(call_site);
+  return call_site;
+}
+
+void X64Backend::FreeIndirectCallSites(
+    const std::vector<IndirectCallSite*>& call_sites) {
+  std::lock_guard<std::mutex> guard(call_sites_lock_);
+  for (auto call_site : call_sites) {
+    if (call_sites_.erase(call_site)) {
+      delete call_site;
+    }
+  }
+}
+
+void X64Backend::DumpIndirectCallStats() {
+  std::lock_guard<std::mutex> guard(call_sites_lock_);
+  std::vector<IndirectCallSite*> sites;
+  for (auto call_site : call_sites_) {
+    if (call_site->call_count) {
+      sites.push_back(call_site);
+    }
+  }
+  std::sort(sites.begin(), sites.end(),
+            [](IndirectCallSite* a, IndirectCallSite* b) {
+    return a->table_hit_count + a->resolve_count >
+           b->table_hit_count + b->resolve_count;
+  });
+  PLOGI("Indirect call sites (%d used of %d live), by inline cache misses:",
+        static_cast<int>(sites.size()), static_cast<int>(call_sites_.size()));
+  for (size_t i = 0; i < std::min(sites.size(), static_cast<size_t>(64)); ++i) {
+    auto call_site = sites[i];
+    uint64_t misses = call_site->table_hit_count + call_site->resolve_count;
+    PLOGI("  %p: %10lld calls, %5.1f%% ic miss, %5.1f%% table miss",
+          call_site, call_site->call_count,
+          100.0 * misses / call_site->call_count,
+          misses ? 100.0 * call_site->resolve_count / misses : 0.0);
+  }
+}
+
 }  // namespace x64
 }  // namespace backend
 }  // namespace alloy
@@ -10,36 +10,105 @@
 #ifndef ALLOY_BACKEND_X64_X64_BACKEND_H_
 #define ALLOY_BACKEND_X64_X64_BACKEND_H_
 
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
 #include <alloy/backend/backend.h>
+#include <alloy/backend/x64/x64_code_cache.h>
 
 namespace alloy {
 namespace backend {
 namespace x64 {
 
-class X64CodeCache;
+class X64PersistentCache;
+class X64ThunkEmitter;
+class XbyakAllocator;
 
 #define ALLOY_HAS_X64_BACKEND 1
 
 typedef void* (*HostToGuestThunk)(void* target, void* arg0, void* arg1);
 typedef void* (*GuestToHostThunk)(void* target, void* arg0, void* arg1);
+typedef void (*LinkCallThunk)();
+
+// Book-keeping for a single indirect call site emitted by CallIndirect.
+// Counts are only approximate, as generated code updates them without locks.
+struct IndirectCallSite {
+  // Bytes from the start of the inline cache to the resolver return address.
+  uint32_t ic_table_distance;
+  // All calls through the site (--x64_indirect_call_stats only).
+  uint64_t call_count;
+  // Inline cache misses satisfied by the dispatch table (stats only).
+  uint64_t table_hit_count;
+  // Calls that fell all the way through to the resolver.
+  uint64_t resolve_count;
+};
+
+// Backend state of each guest thread, in ThreadState::backend_data().
+struct X64ThreadData {
+  X64CodeCache::ThreadRecord* code_cache_thread;
+};
 
 class X64Backend : public Backend {
  public:
-  X64Backend(runtime::Runtime* runtime);
+  // emit_feature_mask limits the EmitFeatureFlags that may be used on top of
+  // the --x64_enable_* flags, e.g. to test the fallback sequences.
+  X64Backend(runtime::Runtime* runtime, uint32_t emit_feature_mask = ~0u);
   ~X64Backend() override;
 
   X64CodeCache* code_cache() const { return code_cache_; }
+  // Null unless --x64_code_cache_path is set.
+  X64PersistentCache* persistent_cache() const { return persistent_cache_; }
   HostToGuestThunk host_to_guest_thunk() const { return host_to_guest_thunk_; }
   GuestToHostThunk guest_to_host_thunk() const { return guest_to_host_thunk_; }
+  LinkCallThunk link_call_thunk() const { return link_call_thunk_; }
+  // EmitFeatureFlags the host supports and are enabled.
+  uint32_t emit_features() const { return emit_features_; }
 
   int Initialize() override;
 
+  void* AllocThreadData() override;
+  void FreeThreadData(void* thread_data) override;
+  void EnterGuest(void* thread_data, const void* stack_top) override;
+  void LeaveGuest(void* thread_data) override;
+
   std::unique_ptr<Assembler> CreateAssembler() override;
 
+  int LoadCachedFunction(runtime::FunctionInfo* symbol_info,
+                         runtime::Function** out_function) override;
+
+  int WrapTier0Function(runtime::Function* tier0_function,
+                        runtime::Function** out_function) override;
+  // Swaps a hot first tier function for a full translation and unlinks its
+  // entry stub.
+  int PromoteTier0Function(X64Function* function);
+
+  // Call sites belong to the function they were emitted into and are freed
+  // along with it.
+  IndirectCallSite* AllocateIndirectCallSite();
+  void FreeIndirectCallSites(const std::vector<IndirectCallSite*>& call_sites);
+
+ private:
+  int DetectEmitFeatures();
+  void DumpIndirectCallStats();
+
  private:
+  uint32_t emit_feature_mask_;
+  uint32_t emit_features_;
   X64CodeCache* code_cache_;
+  X64PersistentCache* persistent_cache_;
   HostToGuestThunk host_to_guest_thunk_;
   GuestToHostThunk guest_to_host_thunk_;
+  LinkCallThunk link_call_thunk_;
+
+  // Shared by all tier 0 entry stubs, created on first use.
+  std::mutex tier0_stub_lock_;
+  std::unique_ptr<XbyakAllocator> tier0_stub_allocator_;
+  std::unique_ptr<X64ThunkEmitter> tier0_stub_emitter_;
+
+  std::mutex call_sites_lock_;
+  std::unordered_set<IndirectCallSite*> call_sites_;
 };
 
 }  // namespace x64
@@ -0,0 +1,712 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/backend/x64/x64_code_cache.h>
+
+#include <algorithm>
+
+#include <alloy/alloy-private.h>
+#include <alloy/backend/x64/x64_backend.h>
+#include <alloy/backend/x64/x64_function.h>
+#include <alloy/runtime/runtime.h>
+#include <poly/poly.h>
+#include <xenia/profiling.h>
+
+namespace alloy {
+namespace backend {
+namespace x64 {
+
+namespace {
+// Bounds on the reserved region. It's only backed as it's used.
+const size_t kMinRegionSize = 64 * 1024 * 1024;
+const size_t kMaxRegionSize = 1024 * 1024 * 1024;
+}  // namespace
+
+X64CodeCache::X64CodeCache(X64Backend* backend)
+    : backend_(backend),
+      exec_base_(nullptr),
+      write_base_(nullptr),
+      write_delta_(0),
+      region_size_(0),
+      committed_size_(0),
+      limit_size_(0),
+      trim_requested_(false),
+      epoch_(1),
+      retired_count_(0),
+      indirection_table_(nullptr),
+      used_size_(0),
+      peak_used_size_(0),
+      pending_free_size_(0),
+      place_count_(0),
+      evict_count_(0),
+      free_count_(0),
+      hit_count_(0),
+      miss_count_(0) {}
+
+X64CodeCache::~X64CodeCache() {
+  std::lock_guard<std::mutex> guard(lock_);
+  for (auto block : retired_) {
+    // Nobody else knows about these anymore.
+    delete block->function;
+  }
+  for (auto& it : blocks_) {
+    delete it.second;
+  }
+  blocks_.clear();
+  lru_.clear();
+  retired_.clear();
+  for (auto thread : threads_) {
+    delete thread;
+  }
+  threads_.clear();
+
+  UnmapRegion();
+  FreeIndirectionTable();
+}
+
+int X64CodeCache::Initialize() {
+  if (FLAGS_x64_code_cache_limit_mb > 0) {
+    limit_size_ = static_cast<size_t>(FLAGS_x64_code_cache_limit_mb) << 20;
+  }
+
+  // Leave headroom over the soft limit for code that can't be evicted yet
+  // (thunks, functions still in use after eviction).
+  region_size_ = limit_size_ ? std::max(limit_size_ * 2, kMinRegionSize)
+                             : kMaxRegionSize;
+  region_size_ = std::min(region_size_, kMaxRegionSize);
+  limit_size_ = std::min(limit_size_, region_size_ / 2);
+
+  if (AllocateIndirectionTable()) {
+    PLOGE("Unable to allocate code cache dispatch table");
+    return 1;
+  }
+  if (MapRegion()) {
+    PLOGE("Unable to map %u bytes of code cache",
+          static_cast<uint32_t>(region_size_));
+    return 1;
+  }
+  write_delta_ = write_base_ - exec_base_;
+  committed_chunks_.resize(region_size_ / kCommitChunkSize, false);
+
+  AddFreeRange(0, region_size_);
+  return 0;
+}
+
+void X64CodeCache::AddIndirection(uint64_t guest_address, void* host_address) {
+  uint64_t offset = guest_address - kIndirectionBase;
+  if (offset >= kIndirectionSize || (guest_address & 0x3)) {
+    return;
+  }
+  // Aligned 8b stores are atomic, so readers see either 0 or the address.
+  indirection_table_[offset >> 2] = reinterpret_cast<uint64_t>(host_address);
+}
+
+void* X64CodeCache::PlaceCode(void* machine_code, size_t code_size,
+                              size_t stack_size) {
+  SCOPE_profile_cpu_f("alloy");
+  runtime::TranslationProfiler::ScopedPhase profile_phase(
+      runtime::TranslationProfiler::PHASE_PLACE_CODE);
+  if (runtime::TranslationProfiler::current()) {
+    runtime::TranslationProfiler::current()->code_size += code_size;
+  }
+
+  // Always move the code to land on 16b alignment. Unwind data, if any, goes
+  // in the tail.
+  size_t alloc_size =
+      poly::round_up(code_size + kUnwindReserveSize, kAlignment);
+
+  uint8_t* final_address;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    size_t offset;
+    if (!Allocate(alloc_size, &offset)) {
+      // Anything evicted that threads have since moved past can go now.
+      ReclaimBlocks();
+      if (!Allocate(alloc_size, &offset)) {
+        PLOGE("Code cache exhausted: %u bytes used, %u awaiting free",
+              static_cast<uint32_t>(used_size_),
+              static_cast<uint32_t>(pending_free_size_));
+        assert_always();
+        return nullptr;
+      }
+    }
+    final_address = exec_base_ + offset;
+
+    auto block = new Block();
+    block->code = final_address;
+    block->code_size = code_size;
+    block->alloc_size = alloc_size;
+    block->stack_size = stack_size;
+    block->function = nullptr;
+    block->guest_address = 0;
+    block->retire_epoch = 0;
+    block->on_probation = false;
+    block->was_touched = false;
+    block->is_referenced = false;
+    block->lru_it = lru_.end();
+    blocks_.emplace(final_address, block);
+
+    used_size_ += alloc_size;
+    peak_used_size_ = std::max(peak_used_size_, used_size_);
+    ++place_count_;
+    if (limit_size_ && used_size_ - pending_free_size_ > limit_size_) {
+      trim_requested_ = true;
+    }
+
+    WriteUnwindInfo(block, stack_size);
+  }
+
+  // Copy code. Nothing can be running it yet.
+  memcpy(ToWritable(final_address), machine_code, code_size);
+  FlushCode(final_address, alloc_size);
+  return final_address;
+}
+
+void X64CodeCache::CommitFunction(X64Function* function) {
+  uint64_t guest_address = function->symbol_info()->address();
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    Block* block = LookupBlock(function->machine_code());
+    assert_not_null(block);
+    block->function = function;
+    block->guest_address = guest_address;
+    block->lru_it = lru_.insert(lru_.end(), block);
+    function->set_code_cache_block(block);
+  }
+  ++miss_count_;
+
+  // Publish to the dispatch table so calls can skip the resolver.
+  AddIndirection(guest_address, function->machine_code());
+}
+
+bool X64CodeCache::LinkInlineCacheSlot(uint32_t* address_site,
+                                       uint64_t* target_site,
+                                       uint32_t guest_address,
+                                       void* host_address) {
+  std::lock_guard<std::mutex> guard(lock_);
+  Block* target = LookupBlock(host_address);
+  Block* caller = LookupBlock(address_site);
+  if (!target || target->retire_epoch || !caller || caller->retire_epoch) {
+    // Either end is on its way out; not worth caching.
+    return false;
+  }
+
+  // NOTE: order matters here - we update the target BEFORE we switch the code
+  // over to passing the compare.
+  if (!poly::atomic_cas(
+          kInlineCacheInvalidTarget, reinterpret_cast<uint64_t>(host_address),
+          reinterpret_cast<volatile uint64_t*>(ToWritable(target_site)))) {
+    return false;
+  }
+  poly::atomic_exchange(
+      guest_address,
+      reinterpret_cast<volatile uint32_t*>(ToWritable(address_site)));
+
+  if (target->function) {
+    target->incoming_links.push_back(address_site);
+    caller->outgoing_links.push_back(target);
+  }
+  return true;
+}
+
+bool X64CodeCache::LinkDirectCall(int32_t* displacement_site,
+                                  void* host_address) {
+  std::lock_guard<std::mutex> guard(lock_);
+  Block* target = LookupBlock(host_address);
+  Block* caller = LookupBlock(displacement_site);
+  if (!target || !target->function || target->retire_epoch ||
+      target->on_probation || !caller || caller->retire_epoch) {
+    return false;
+  }
+
+  auto site_end = reinterpret_cast<uint8_t*>(displacement_site + 1);
+  int64_t displacement = reinterpret_cast<uint8_t*>(host_address) - site_end;
+  if (displacement != static_cast<int32_t>(displacement)) {
+    return false;
+  }
+  int32_t current_displacement = *displacement_site;
+  if (current_displacement == displacement) {
+    // Another thread got here first.
+    return true;
+  }
+  // Only we write these, under the lock, so anything else is the stub.
+  uint8_t* stub = site_end + current_displacement;
+  poly::atomic_exchange(
+      static_cast<uint32_t>(displacement),
+      reinterpret_cast<volatile uint32_t*>(ToWritable(displacement_site)));
+
+  target->incoming_calls.push_back({displacement_site, stub});
+  caller->outgoing_links.push_back(target);
+  return true;
+}
+
+bool X64CodeCache::LookupGuestFrame(const void* return_address,
+                                    size_t* out_stack_size) {
+  if (!ContainsAddress(return_address)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(lock_);
+  Block* block = LookupBlock(return_address);
+  if (!block || !block->function) {
+    // Thunks have host frames.
+    return false;
+  }
+  *out_stack_size = block->stack_size;
+  return true;
+}
+
+void X64CodeCache::Touch(X64Function* function) {
+  // The block can't be freed under us, as the caller is in guest code and
+  // hasn't passed a safe point since resolving the function.
+  auto block = static_cast<Block*>(function->code_cache_block());
+  if (!block || !function->machine_code()) {
+    // Evicted.
+    return;
+  }
+  // The first lookup is the one that had it translated.
+  if (block->was_touched) {
+    ++hit_count_;
+  } else {
+    block->was_touched = true;
+  }
+  // Only written when it changes, to keep hot blocks from bouncing between
+  // cores.
+  if (!block->is_referenced) {
+    block->is_referenced = true;
+  }
+  if (block->on_probation) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (block->on_probation && !block->retire_epoch) {
+      // Still wanted; put it back.
+      block->on_probation = false;
+      AddIndirection(block->guest_address, block->code);
+    }
+  }
+}
+
+int X64CodeCache::EvictFunction(X64Function* function) {
+  // Unpublish from the runtime first, so that new lookups retranslate. This
+  // fails if it was already evicted or is in the middle of being replaced.
+  if (backend_->runtime()->InvalidateFunction(function)) {
+    return 1;
+  }
+  return RetireFunction(function);
+}
+
+int X64CodeCache::RetireFunction(X64Function* function) {
+  std::lock_guard<std::mutex> guard(lock_);
+  Block* block = LookupBlock(function->machine_code());
+  if (!block || block->function != function || block->retire_epoch) {
+    return 1;
+  }
+  RetireBlock(block);
+  ReclaimBlocks();
+  return 0;
+}
+
+void X64CodeCache::TrimIfNeeded() {
+  if (!trim_requested_ || !trim_requested_.exchange(false)) {
+    return;
+  }
+  std::unique_lock<std::mutex> trim_guard(trim_lock_, std::try_to_lock);
+  if (!trim_guard.owns_lock()) {
+    // Someone else is on it.
+    return;
+  }
+
+  // Trim to below the limit so this doesn't happen on every placement.
+  auto victims = SelectVictims(limit_size_ - limit_size_ / 8);
+  for (auto function : victims) {
+    EvictFunction(function);
+  }
+}
+
+std::vector<X64Function*> X64CodeCache::SelectVictims(size_t target_size) {
+  // Approximate LRU. Functions only get touched when they go through the
+  // resolver, so those called straight from the dispatch table or linked
+  // call sites would look idle forever. Instead the coldest are first put on
+  // probation: pulled out of the dispatch table and unlinked from their
+  // callers so that their next call is resolved (and touched).
+  // Only those still untouched on the next trim are evicted.
+  // Touches only set a bit, so recency is applied here: anything referenced
+  // since the last trim moves to the back and gets another round.
+  std::lock_guard<std::mutex> guard(lock_);
+  std::vector<X64Function*> victims;
+  size_t live_size = used_size_ - pending_free_size_;
+  if (live_size <= target_size) {
+    return victims;
+  }
+  size_t excess_size = live_size - target_size;
+  size_t victim_size = 0;
+  size_t probation_size = 0;
+  auto it = lru_.begin();
+  for (size_t count = lru_.size(); count; --count) {
+    if (victim_size >= excess_size && probation_size >= excess_size) {
+      break;
+    }
+    Block* block = *it++;
+    if (block->is_referenced.exchange(false)) {
+      lru_.splice(lru_.end(), lru_, block->lru_it);
+      continue;
+    }
+    if (block->on_probation) {
+      victims.push_back(block->function);
+      victim_size += block->alloc_size;
+    } else if (probation_size < excess_size) {
+      block->on_probation = true;
+      probation_size += block->alloc_size;
+      AddIndirection(block->guest_address, nullptr);
+      UnlinkIncomingCalls(block);
+    }
+  }
+  if (victim_size < excess_size) {
+    // Not enough on probation yet; try again after more placements.
+    trim_requested_ = true;
+  }
+  return victims;
+}
+
+X64CodeCache::ThreadRecord* X64CodeCache::RegisterThread() {
+  auto thread = new ThreadRecord();
+  thread->epoch = kInactiveEpoch;
+  thread->stack_top = 0;
+  thread->depth = 0;
+  std::lock_guard<std::mutex> guard(lock_);
+  threads_.push_back(thread);
+  return thread;
+}
+
+void X64CodeCache::UnregisterThread(ThreadRecord* thread) {
+  std::lock_guard<std::mutex> guard(lock_);
+  auto it = std::find(threads_.begin(), threads_.end(), thread);
+  if (it != threads_.end()) {
+    threads_.erase(it);
+  }
+  delete thread;
+  ReclaimBlocks();
+}
+
+void X64CodeCache::EnterGuest(ThreadRecord* thread, const void* stack_top) {
+  if (!thread || thread->depth++) {
+    return;
+  }
+  thread->stack_top = reinterpret_cast<uintptr_t>(stack_top);
+  // Anything evicted before this point has already been unpublished, so we
+  // can't find it anymore.
+  thread->epoch = epoch_.load();
+}
+
+void X64CodeCache::LeaveGuest(ThreadRecord* thread) {
+  if (!thread || --thread->depth) {
+    return;
+  }
+  thread->epoch = kInactiveEpoch;
+  if (retired_count_) {
+    std::lock_guard<std::mutex> guard(lock_);
+    ReclaimBlocks();
+  }
+}
+
+void X64CodeCache::SafePoint(ThreadRecord* thread, const void* stack_pointer) {
+  if (!thread || !thread->depth || !retired_count_) {
+    // Nothing waiting on us.
+    return;
+  }
+  // Evicted code we will return into must stay around, so hold the epoch back
+  // to before it was evicted. Any value on the stack that looks like a
+  // pointer into such code counts; being conservative only delays freeing.
+  // The stack may be deep, so it is scanned against a copy of the evicted
+  // ranges without the lock. Anything evicted after the copy is past the
+  // epoch we publish anyway.
+  struct RetiredRange {
+    const uint8_t* start;
+    const uint8_t* end;
+    uint64_t retire_epoch;
+  };
+  std::vector<RetiredRange> ranges;
+  uint64_t epoch;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    epoch = epoch_;
+    ranges.reserve(retired_.size());
+    for (auto block : retired_) {
+      ranges.push_back(
+          {block->code, block->code + block->alloc_size, block->retire_epoch});
+    }
+  }
+  std::sort(ranges.begin(), ranges.end(),
+            [](const RetiredRange& a, const RetiredRange& b) {
+              return a.start < b.start;
+            });
+
+  auto p = reinterpret_cast<const uint64_t*>(
+      poly::align<uintptr_t>(reinterpret_cast<uintptr_t>(stack_pointer), 8));
+  auto end = reinterpret_cast<const uint64_t*>(thread->stack_top);
+  for (; p < end; ++p) {
+    auto value = reinterpret_cast<const uint8_t*>(*p);
+    if (!ContainsAddress(value)) {
+      continue;
+    }
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), value,
+                               [](const uint8_t* v, const RetiredRange& range) {
+                                 return v < range.start;
+                               });
+    if (it == ranges.begin() || value >= (--it)->end) {
+      continue;
+    }
+    if (it->retire_epoch <= epoch) {
+      epoch = it->retire_epoch - 1;
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(lock_);
+  thread->epoch = epoch;
+  ReclaimBlocks();
+}
+
+void X64CodeCache::UnlinkIncomingCalls(Block* block) {
+  // Callers go back through their stubs. Anyone already past the call site
+  // is covered by the epoch.
+  for (auto& link : block->incoming_calls) {
+    auto site_end = reinterpret_cast<uint8_t*>(link.displacement + 1);
+    poly::atomic_exchange(
+        static_cast<uint32_t>(link.stub - site_end),
+        reinterpret_cast<volatile uint32_t*>(ToWritable(link.displacement)));
+    RemoveOutgoingLink(link.displacement, block);
+  }
+  block->incoming_calls.clear();
+}
+
+void X64CodeCache::RemoveOutgoingLink(const void* site, Block* target) {
+  Block* caller = LookupBlock(site);
+  if (!caller) {
+    return;
+  }
+  // Only the one link; the caller may have others to the same target.
+  auto& links = caller->outgoing_links;
+  auto it = std::find(links.begin(), links.end(), target);
+  if (it != links.end()) {
+    links.erase(it);
+  }
+}
+
+void X64CodeCache::RetireBlock(Block* block) {
+  // Unpublish everywhere generated code could find it. Callers that already
+  // have the address are covered by the epoch.
+  uint64_t table_offset = block->guest_address - kIndirectionBase;
+  if (table_offset < kIndirectionSize &&
+      indirection_table_[table_offset >> 2] ==
+          reinterpret_cast<uint64_t>(block->code)) {
+    AddIndirection(block->guest_address, nullptr);
+  }
+  for (auto address_site : block->incoming_links) {
+    // Failing the compare is enough. The stale target is left in place for
+    // anyone who has already passed it, and the slot is never reused.
+    poly::atomic_exchange(
+        kInlineCacheInvalidAddress,
+        reinterpret_cast<volatile uint32_t*>(ToWritable(address_site)));
+    RemoveOutgoingLink(address_site, block);
+  }
+  block->incoming_links.clear();
+  UnlinkIncomingCalls(block);
+
+  lru_.erase(block->lru_it);
+  block->lru_it = lru_.end();
+  block->function->Evict();
+
+  block->retire_epoch = ++epoch_;
+  retired_.push_back(block);
+  ++retired_count_;
+  pending_free_size_ += block->alloc_size;
+  ++evict_count_;
+}
+
+void X64CodeCache::ReclaimBlocks() {
+  if (retired_.empty()) {
+    return;
+  }
+  uint64_t min_epoch = epoch_;
+  for (auto thread : threads_) {
+    min_epoch = std::min(min_epoch, thread->epoch.load());
+  }
+  while (!retired_.empty() && retired_.front()->retire_epoch <= min_epoch) {
+    Block* block = retired_.front();
+    retired_.pop_front();
+    --retired_count_;
+
+    // Drop links from our inline cache slots and call sites, as they're
+    // going away.
+    uint8_t* block_end = block->code + block->alloc_size;
+    auto is_ours = [block, block_end](const void* site) {
+      auto p = reinterpret_cast<const uint8_t*>(site);
+      return p >= block->code && p < block_end;
+    };
+    for (auto target : block->outgoing_links) {
+      auto& links = target->incoming_links;
+      links.erase(std::remove_if(links.begin(), links.end(), is_ours),
+                  links.end());
+      auto& calls = target->incoming_calls;
+      calls.erase(std::remove_if(calls.begin(), calls.end(),
+                                 [&is_ours](const CallLink& link) {
+                    return is_ours(link.displacement);
+                  }),
+                  calls.end());
+    }
+
+    blocks_.erase(block->code);
+    used_size_ -= block->alloc_size;
+    pending_free_size_ -= block->alloc_size;
+    ++free_count_;
+    Free(block->code - exec_base_, block->alloc_size);
+    // Nothing can be running it anymore, and the runtime has forgotten it.
+    backend_->FreeIndirectCallSites(block->function->indirect_call_sites());
+    delete block->function;
+    delete block;
+  }
+}
+
+bool X64CodeCache::Allocate(size_t size, size_t* out_offset) {
+  // Best fit.
+  auto it = free_sizes_.lower_bound(size);
+  if (it == free_sizes_.end()) {
+    return false;
+  }
+  size_t range_size = it->first;
+  size_t offset = it->second;
+  free_sizes_.erase(it);
+  free_ranges_.erase(offset);
+  if (range_size > size) {
+    free_ranges_[offset + size] = range_size - size;
+    free_sizes_.emplace(range_size - size, offset + size);
+  }
+
+  // Back whatever chunks of the range aren't yet.
+  for (size_t n = offset / kCommitChunkSize;
+       n <= (offset + size - 1) / kCommitChunkSize; ++n) {
+    if (committed_chunks_[n]) {
+      continue;
+    }
+    if (CommitRegion(n * kCommitChunkSize, kCommitChunkSize)) {
+      Free(offset, size);
+      return false;
+    }
+    committed_chunks_[n] = true;
+    committed_size_ += kCommitChunkSize;
+  }
+
+  *out_offset = offset;
+  return true;
+}
+
+void X64CodeCache::Free(size_t offset, size_t size) {
+  // Merge with neighbors.
+  auto next = free_ranges_.lower_bound(offset);
+  if (next != free_ranges_.end() && offset + size == next->first) {
+    size += next->second;
+    RemoveFreeSize(next->second, next->first);
+    next = free_ranges_.erase(next);
+  }
+  if (next != free_ranges_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      size += prev->second;
+      RemoveFreeSize(prev->second, prev->first);
+      free_ranges_.erase(prev);
+    }
+  }
+
+  // Give whole chunks back. One that couldn't be mapped again is gone for
+  // good and stays out of the free list.
+  size_t end = offset + size;
+  for (size_t chunk_offset = poly::round_up(offset, kCommitChunkSize);
+       chunk_offset + kCommitChunkSize <= end;
+       chunk_offset += kCommitChunkSize) {
+    size_t n = chunk_offset / kCommitChunkSize;
+    if (!committed_chunks_[n]) {
+      continue;
+    }
+    committed_chunks_[n] = false;
+    committed_size_ -= kCommitChunkSize;
+    if (DecommitRegion(chunk_offset, kCommitChunkSize)) {
+      PLOGW("Code cache lost %uKB at offset %.8X",
+            static_cast<uint32_t>(kCommitChunkSize / 1024),
+            static_cast<uint32_t>(chunk_offset));
+      AddFreeRange(offset, chunk_offset - offset);
+      offset = chunk_offset + kCommitChunkSize;
+    }
+  }
+  AddFreeRange(offset, end - offset);
+}
+
+void X64CodeCache::AddFreeRange(size_t offset, size_t size) {
+  if (size) {
+    free_ranges_[offset] = size;
+    free_sizes_.emplace(size, offset);
+  }
+}
+
+void X64CodeCache::RemoveFreeSize(size_t size, size_t offset) {
+  auto range = free_sizes_.equal_range(size);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == offset) {
+      free_sizes_.erase(it);
+      return;
+    }
+  }
+}
+
+X64CodeCache::Block* X64CodeCache::LookupBlock(const void* address) {
+  auto p = reinterpret_cast<uint8_t*>(const_cast<void*>(address));
+  auto it = blocks_.upper_bound(p);
+  if (it == blocks_.begin()) {
+    return nullptr;
+  }
+  Block* block = (--it)->second;
+  return p < block->code + block->alloc_size ? block : nullptr;
+}
+
+X64CodeCache::Counters X64CodeCache::GetCounters() {
+  std::lock_guard<std::mutex> guard(lock_);
+  Counters counters;
+  counters.reserved_bytes = region_size_;
+  counters.committed_bytes = committed_size_;
+  counters.used_bytes = used_size_;
+  counters.peak_used_bytes = peak_used_size_;
+  counters.pending_free_bytes = pending_free_size_;
+  counters.function_count = lru_.size();
+  counters.place_count = place_count_;
+  counters.evict_count = evict_count_;
+  counters.free_count = free_count_;
+  counters.hit_count = hit_count_;
+  counters.miss_count = miss_count_;
+  return counters;
+}
+
+void X64CodeCache::DumpCounters() {
+  auto counters = GetCounters();
+  const double mb = 1024.0 * 1024.0;
+  uint64_t lookup_count = counters.hit_count + counters.miss_count;
+  PLOGI(
+      "Code cache: %.1fMB used (%.1fMB peak, %.1fMB awaiting free), "
+      "%.1fMB committed of %.1fMB",
+      counters.used_bytes / mb, counters.peak_used_bytes / mb,
+      counters.pending_free_bytes / mb, counters.committed_bytes / mb,
+      counters.reserved_bytes / mb);
+  PLOGI(
+      "Code cache: %llu functions, %llu placed, %llu evicted, %llu freed, "
+      "%.1f%% hit rate",
+      counters.function_count, counters.place_count, counters.evict_count,
+      counters.free_count,
+      lookup_count ? 100.0 * counters.hit_count / lookup_count : 0.0);
+}
+
+}  // namespace x64
+}  // namespace backend
+}  // namespace alloy
@@ -10,33 +10,267 @@
 #ifndef ALLOY_BACKEND_X64_X64_CODE_CACHE_H_
 #define ALLOY_BACKEND_X64_X64_CODE_CACHE_H_
 
+#include <atomic>
+#include <deque>
+#include <list>
+#include <map>
 #include <mutex>
+#include <vector>
+
+#include <alloy/runtime/entry_table.h>
 
 namespace alloy {
 namespace backend {
 namespace x64 {
 
-class X64CodeChunk;
+class X64Backend;
+class X64Function;
 
+// Executable memory for generated code.
+//
+// All code lives in one reserved region that is mapped twice: once RX, where
+// it runs, and once RW, where it is written. Nothing is ever both writable and
+// executable. Space is handed out by a best-fit free list, so functions of
+// any size can be placed and freed individually.
+//
+// Guest functions can be evicted, either explicitly or to stay under
+// --x64_code_cache_limit_mb. Eviction unpublishes the function (runtime entry,
+// dispatch table, inline cache slots, direct call sites) so that new calls
+// retranslate it, but the memory is only reused once no thread can still be
+// running it:
+//  - Every eviction bumps a global epoch and is tagged with it.
+//  - Guest threads publish the epoch they've seen at safe points (the
+//    resolvers, host calls and entry from the host). Before publishing they
+//    scan their own stack for return addresses into evicted code, and hold
+//    back the epoch of any they find.
+//  - Evicted code is freed once every thread running guest code has
+//    published an epoch at or past its tag, along with its X64Function.
+// Threads parked in host code (waits, etc) hold back reclamation until they
+// next reach a safe point; evicted code just sticks around a little longer.
+// Host code must resolve and call functions within EnterGuest/LeaveGuest (see
+// Runtime::CallFunction), or the function may be freed in between.
 class X64CodeCache {
  public:
-  X64CodeCache(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+  // Guest thread state, one per ThreadState.
+  struct ThreadRecord {
+    // Last epoch published at a safe point, or kInactiveEpoch.
+    std::atomic<uint64_t> epoch;
+    // Highest stack address that may hold guest frames, from the outermost
+    // entry into guest code.
+    uintptr_t stack_top;
+    uint32_t depth;
+  };
+
+  struct Counters {
+    size_t reserved_bytes;
+    size_t committed_bytes;
+    size_t used_bytes;
+    size_t peak_used_bytes;
+    size_t pending_free_bytes;
+    uint64_t function_count;
+    uint64_t place_count;
+    uint64_t evict_count;
+    uint64_t free_count;
+    // Resolves that found the function in the cache, and translations.
+    uint64_t hit_count;
+    uint64_t miss_count;
+  };
+
+  X64CodeCache(X64Backend* backend);
   virtual ~X64CodeCache();
 
   int Initialize();
 
-  // TODO(benvanik): ELF serialization/etc
-  // TODO(benvanik): keep track of code blocks
-  // TODO(benvanik): padding/guards/etc
-
+  // Copies the code into the cache and returns its executable address.
+  // The code is not evictable until CommitFunction is called on it.
   void* PlaceCode(void* machine_code, size_t code_size, size_t stack_size);
+  // Makes the placed function visible to generated code and eligible for
+  // eviction.
+  void CommitFunction(X64Function* function);
+
+  // Writable alias of an address in the cache. Patches to placed code must
+  // go through here.
+  void* ToWritable(void* address) const {
+    return reinterpret_cast<uint8_t*>(address) + write_delta_;
+  }
+  bool ContainsAddress(const void* address) const {
+    return address >= exec_base_ && address < exec_base_ + region_size_;
+  }
+
+  // Guest address -> host machine code table used by generated code for
+  // indirect calls that miss the inline cache. Covers the same guest range as
+  // the runtime EntryTable, indexed by (guest_address - kIndirectionBase) >> 2.
+  // Slots of functions not yet compiled read as zero.
+  static const uint64_t kIndirectionBase = runtime::EntryTable::kCodeBase;
+  static const uint64_t kIndirectionSize = runtime::EntryTable::kCodeSize;
+  uint64_t* indirection_table() const { return indirection_table_; }
+  void AddIndirection(uint64_t guest_address, void* host_address);
+
+  // Immediates of an empty indirect call inline cache slot.
+  static const uint32_t kInlineCacheInvalidAddress = 0x0F0F0F0F;
+  static const uint64_t kInlineCacheInvalidTarget = 0x0F0F0F0F0F0F0F0F;
+  // Fills an empty inline cache slot for a resolved indirect call. The slot is
+  // unlinked if the target is evicted, after which it stays unused.
+  // address_site/target_site point at the compare and target immediates.
+  bool LinkInlineCacheSlot(uint32_t* address_site, uint64_t* target_site,
+                           uint32_t guest_address, void* host_address);
+
+  // Points a direct call site (the rel32 displacement of a call/jmp, currently
+  // targeting its stub) at the given function. The site is pointed back at
+  // its stub if the target is evicted. Fails if the target is out of range.
+  bool LinkDirectCall(int32_t* displacement_site, void* host_address);
+
+  // Finds the guest function a host return address is in, for walking guest
+  // frames. False if it's not in guest code (thunks, host code).
+  bool LookupGuestFrame(const void* return_address, size_t* out_stack_size);
+
+  // Notes a use of the function for LRU eviction. Called on the resolve
+  // paths, so it only takes the lock when the function has to be put back in
+  // the dispatch table. Also counts hits for the hit rate.
+  void Touch(X64Function* function);
+
+  // Evicts the given function now. Returns 0 if it was evicted.
+  int EvictFunction(X64Function* function);
+  // Unlinks and frees a function the runtime no longer knows about, such as
+  // one that has been replaced. Returns 0 if it was retired.
+  int RetireFunction(X64Function* function);
+  // Evicts least recently used functions if over the size limit.
+  // Must not be called while translating. Only call it from guest code
+  // (within EnterGuest/LeaveGuest), which keeps the victims from being freed
+  // by someone else before they're evicted.
+  void TrimIfNeeded();
+
+  ThreadRecord* RegisterThread();
+  void UnregisterThread(ThreadRecord* thread);
+  // Brackets execution of guest code by the thread. Entries may nest through
+  // host calls; only the outermost one publishes anything.
+  void EnterGuest(ThreadRecord* thread, const void* stack_top);
+  void LeaveGuest(ThreadRecord* thread);
+  // Publishes the epoch seen by the thread and frees what it can.
+  // stack_pointer bounds the live frames of the thread.
+  void SafePoint(ThreadRecord* thread, const void* stack_pointer);
+  // Nonzero when evicted code is waiting on threads. Generated code checks
+  // this to skip calling SafePoint.
+  const uint32_t* reclaim_pending_ptr() const {
+    return reinterpret_cast<const uint32_t*>(&retired_count_);
+  }
+
+  Counters GetCounters();
+  void DumpCounters();
+
+  // Unwind entry for a pc in the cache (Windows function table callback).
+  static void* LookupUnwindEntry(uint64_t control_pc, void* context);
 
  private:
-  const static size_t DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+  const static size_t INDIRECTION_TABLE_SIZE =
+      (kIndirectionSize >> 2) * sizeof(uint64_t);
+  static const uint64_t kInactiveEpoch = ~0ull;
+  // Allocation granularity. Code must be 16b aligned.
+  static const size_t kAlignment = 16;
+  // Tail of each allocation reserved for unwind data (platform dependent).
+  static const size_t kUnwindReserveSize;
+  // The region is backed and given back in chunks of this (platform
+  // dependent).
+  static const size_t kCommitChunkSize;
+
+  struct CallLink {
+    int32_t* displacement;
+    // Where the site goes when unlinked.
+    uint8_t* stub;
+  };
+  struct Block {
+    uint8_t* code;
+    size_t code_size;
+    size_t alloc_size;
+    size_t stack_size;
+    // Owning function, or null for thunks and pending placements.
+    X64Function* function;
+    uint64_t guest_address;
+    // Epoch of the eviction, 0 while live.
+    uint64_t retire_epoch;
+    // Removed from the dispatch table by a trim; evicted by the next one
+    // unless it's resolved again before then. Only set with the lock held.
+    std::atomic<bool> on_probation;
+    // Resolved at least once since it was placed.
+    std::atomic<bool> was_touched;
+    // Resolved since the last trim looked at it.
+    std::atomic<bool> is_referenced;
+    std::list<Block*>::iterator lru_it;
+    // Compare immediates of inline cache slots currently targeting us.
+    std::vector<uint32_t*> incoming_links;
+    // Direct call sites currently targeting us.
+    std::vector<CallLink> incoming_calls;
+    // Blocks that inline cache slots and direct calls in this block target,
+    // once per link.
+    std::vector<Block*> outgoing_links;
+  };
+
+  // Platform specific; see x64_code_cache_{posix,win}.cc.
+  int MapRegion();
+  void UnmapRegion();
+  int CommitRegion(size_t offset, size_t length);
+  // Fails if the range couldn't be mapped again and must not be used.
+  int DecommitRegion(size_t offset, size_t length);
+  void WriteUnwindInfo(Block* block, size_t stack_size);
+  void FlushCode(void* address, size_t length);
+  int AllocateIndirectionTable();
+  void FreeIndirectionTable();
+
+  // All of these require lock_.
+  bool Allocate(size_t size, size_t* out_offset);
+  void Free(size_t offset, size_t size);
+  void AddFreeRange(size_t offset, size_t size);
+  void RemoveFreeSize(size_t size, size_t offset);
+  Block* LookupBlock(const void* address);
+  void UnlinkIncomingCalls(Block* block);
+  void RemoveOutgoingLink(const void* site, Block* target);
+  void RetireBlock(Block* block);
+  void ReclaimBlocks();
+  std::vector<X64Function*> SelectVictims(size_t target_size);
+
+  X64Backend* backend_;
   std::mutex lock_;
-  size_t chunk_size_;
-  X64CodeChunk* head_chunk_;
-  X64CodeChunk* active_chunk_;
+
+  // Executable and writable views of the same memory.
+  uint8_t* exec_base_;
+  uint8_t* write_base_;
+  intptr_t write_delta_;
+  size_t region_size_;
+  size_t committed_size_;
+  std::vector<bool> committed_chunks_;
+  // Platform specific, per chunk.
+  std::vector<void*> chunk_handles_;
+
+  // Soft limit on used bytes for guest functions, 0 for no limit.
+  size_t limit_size_;
+  std::atomic<bool> trim_requested_;
+  std::mutex trim_lock_;
+
+  // Free space, by offset and by size.
+  std::map<size_t, size_t> free_ranges_;
+  std::multimap<size_t, size_t> free_sizes_;
+
+  std::map<uint8_t*, Block*> blocks_;
+  // Evictable blocks, roughly least recently used first. Trims move the ones
+  // referenced since the last trim to the back.
+  std::list<Block*> lru_;
+
+  std::atomic<uint64_t> epoch_;
+  // Evicted blocks in retire_epoch order.
+  std::deque<Block*> retired_;
+  std::atomic<uint32_t> retired_count_;
+  std::vector<ThreadRecord*> threads_;
+
+  uint64_t* indirection_table_;
+
+  size_t used_size_;
+  size_t peak_used_size_;
+  size_t pending_free_size_;
+  uint64_t place_count_;
+  uint64_t evict_count_;
+  uint64_t free_count_;
+  std::atomic<uint64_t> hit_count_;
+  std::atomic<uint64_t> miss_count_;
 };
 
 }  // namespace x64
@@ -9,89 +9,110 @@
 
 #include <alloy/backend/x64/x64_code_cache.h>
 
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdio>
 
 #include <poly/assert.h>
 #include <poly/math.h>
-#include <xenia/profiling.h>
 
 namespace alloy {
 namespace backend {
 namespace x64 {
 
-class X64CodeChunk {
- public:
-  X64CodeChunk(size_t chunk_size);
-  ~X64CodeChunk();
-
- public:
-  X64CodeChunk* next;
-  size_t capacity;
-  uint8_t* buffer;
-  size_t offset;
-};
-
-X64CodeCache::X64CodeCache(size_t chunk_size)
-    : chunk_size_(chunk_size), head_chunk_(NULL), active_chunk_(NULL) {}
-
-X64CodeCache::~X64CodeCache() {
-  std::lock_guard<std::mutex> guard(lock_);
-  auto chunk = head_chunk_;
-  while (chunk) {
-    auto next = chunk->next;
-    delete chunk;
-    chunk = next;
+// No unwind tables to maintain.
+const size_t X64CodeCache::kUnwindReserveSize = 0;
+const size_t X64CodeCache::kCommitChunkSize = 64 * 1024;
+
+int X64CodeCache::AllocateIndirectionTable() {
+  // Sparse; pages are only committed as slots are written.
+  void* p = mmap(nullptr, INDIRECTION_TABLE_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) {
+    return 1;
   }
-  head_chunk_ = NULL;
+  indirection_table_ = reinterpret_cast<uint64_t*>(p);
+  return 0;
 }
 
-int X64CodeCache::Initialize() { return 0; }
-
-void* X64CodeCache::PlaceCode(void* machine_code, size_t code_size,
-                              size_t stack_size) {
-  SCOPE_profile_cpu_f("alloy");
-
-  // Always move the code to land on 16b alignment. We do this by rounding up
-  // to 16b so that all offsets are aligned.
-  code_size = poly::round_up(code_size, 16);
+void X64CodeCache::FreeIndirectionTable() {
+  if (indirection_table_) {
+    munmap(indirection_table_, INDIRECTION_TABLE_SIZE);
+    indirection_table_ = nullptr;
+  }
+}
 
-  lock_.lock();
+int X64CodeCache::MapRegion() {
+  // Shared memory object to map twice. It's unlinked right away so it goes
+  // away with the process; the descriptor is all we need.
+  char path[64];
+  snprintf(path, sizeof(path), "/xenia_code_cache_%d_%p",
+           static_cast<int>(getpid()), this);
+  int fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd == -1) {
+    return 1;
+  }
+  shm_unlink(path);
+  // Sparse; only touched pages get backed.
+  if (ftruncate(fd, region_size_)) {
+    close(fd);
+    return 1;
+  }
 
-  if (active_chunk_) {
-    if (active_chunk_->capacity - active_chunk_->offset < code_size) {
-      auto next = active_chunk_->next;
-      if (!next) {
-        assert_true(code_size < chunk_size_, "need to support larger chunks");
-        next = new X64CodeChunk(chunk_size_);
-        active_chunk_->next = next;
-      }
-      active_chunk_ = next;
+  void* exec_view =
+      mmap(nullptr, region_size_, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+  void* write_view =
+      mmap(nullptr, region_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (exec_view == MAP_FAILED || write_view == MAP_FAILED) {
+    if (exec_view != MAP_FAILED) {
+      munmap(exec_view, region_size_);
+    }
+    if (write_view != MAP_FAILED) {
+      munmap(write_view, region_size_);
     }
-  } else {
-    head_chunk_ = active_chunk_ = new X64CodeChunk(chunk_size_);
+    return 1;
   }
+  exec_base_ = reinterpret_cast<uint8_t*>(exec_view);
+  write_base_ = reinterpret_cast<uint8_t*>(write_view);
+  return 0;
+}
 
-  uint8_t* final_address = active_chunk_->buffer + active_chunk_->offset;
-  active_chunk_->offset += code_size;
-
-  lock_.unlock();
+void X64CodeCache::UnmapRegion() {
+  if (exec_base_) {
+    munmap(exec_base_, region_size_);
+    exec_base_ = nullptr;
+  }
+  if (write_base_) {
+    munmap(write_base_, region_size_);
+    write_base_ = nullptr;
+  }
+}
 
-  // Copy code.
-  memcpy(final_address, machine_code, code_size);
+int X64CodeCache::CommitRegion(size_t offset, size_t length) {
+  // Backed on first touch.
+  return 0;
+}
 
-  return final_address;
+int X64CodeCache::DecommitRegion(size_t offset, size_t length) {
+#if defined(MADV_REMOVE)
+  // Frees the backing pages of the shared object, so both views read zeros.
+  madvise(write_base_ + offset, length, MADV_REMOVE);
+#endif  // MADV_REMOVE
+  // The views stay usable either way.
+  return 0;
 }
 
-X64CodeChunk::X64CodeChunk(size_t chunk_size)
-    : next(NULL), capacity(chunk_size), buffer(0), offset(0) {
-  buffer = (uint8_t*)mmap(nullptr, chunk_size, PROT_WRITE | PROT_EXEC,
-                          MAP_ANON | MAP_PRIVATE, -1, 0);
+void X64CodeCache::WriteUnwindInfo(Block* block, size_t stack_size) {}
+
+void X64CodeCache::FlushCode(void* address, size_t length) {
+  // x64 keeps instruction caches coherent with the other view.
 }
 
-X64CodeChunk::~X64CodeChunk() {
-  if (buffer) {
-    munmap(buffer, capacity);
-  }
+void* X64CodeCache::LookupUnwindEntry(uint64_t control_pc, void* context) {
+  return nullptr;
 }
 
 }  // namespace x64
@@ -10,121 +10,191 @@
 #include <alloy/backend/x64/x64_code_cache.h>
 
 #include <poly/poly.h>
-#include <xenia/profiling.h>
 
 namespace alloy {
 namespace backend {
 namespace x64 {
 
-class X64CodeChunk {
- public:
-  X64CodeChunk(size_t chunk_size);
-  ~X64CodeChunk();
-
- public:
-  X64CodeChunk* next;
-  size_t capacity;
-  uint8_t* buffer;
-  size_t offset;
-
-  // Estimate of function sized use to determine initial table capacity.
-  const static uint32_t ESTIMATED_FN_SIZE = 512;
-  // Size of unwind info per function.
-  // TODO(benvanik): move this to emitter.
-  const static uint32_t UNWIND_INFO_SIZE = 4 + (2 * 1 + 2 + 2);
-
-  void* fn_table_handle;
-  RUNTIME_FUNCTION* fn_table;
-  uint32_t fn_table_count;
-  uint32_t fn_table_capacity;
-
-  void AddTableEntry(uint8_t* code, size_t code_size, size_t stack_size);
-};
-
-X64CodeCache::X64CodeCache(size_t chunk_size)
-    : chunk_size_(chunk_size), head_chunk_(NULL), active_chunk_(NULL) {}
-
-X64CodeCache::~X64CodeCache() {
-  std::lock_guard<std::mutex> guard(lock_);
-  auto chunk = head_chunk_;
-  while (chunk) {
-    auto next = chunk->next;
-    delete chunk;
-    chunk = next;
+// Unwind data at the tail of each allocation:
+//   RUNTIME_FUNCTION (12b), UNWIND_INFO (4b + 2b per code, up to 3 codes)
+const size_t X64CodeCache::kUnwindReserveSize = 32;
+// Each chunk is a section and two views, so they can't be too small.
+const size_t X64CodeCache::kCommitChunkSize = 1024 * 1024;
+
+int X64CodeCache::AllocateIndirectionTable() {
+  // Sparse; pages are only backed as slots are written.
+  indirection_table_ = reinterpret_cast<uint64_t*>(
+      VirtualAlloc(NULL, INDIRECTION_TABLE_SIZE, MEM_RESERVE | MEM_COMMIT,
+                   PAGE_READWRITE));
+  if (!indirection_table_) {
+    return 1;
   }
-  head_chunk_ = NULL;
+  return 0;
 }
 
-int X64CodeCache::Initialize() { return 0; }
-
-void* X64CodeCache::PlaceCode(void* machine_code, size_t code_size,
-                              size_t stack_size) {
-  SCOPE_profile_cpu_f("alloy");
-
-  size_t alloc_size = code_size;
+void X64CodeCache::FreeIndirectionTable() {
+  if (indirection_table_) {
+    VirtualFree(indirection_table_, 0, MEM_RELEASE);
+    indirection_table_ = nullptr;
+  }
+}
 
-  // Add unwind info into the allocation size. Keep things 16b aligned.
-  alloc_size += poly::round_up(X64CodeChunk::UNWIND_INFO_SIZE, 16);
+namespace {
+PRUNTIME_FUNCTION GetRuntimeFunctionCallback(DWORD64 control_pc,
+                                             PVOID context) {
+  return reinterpret_cast<PRUNTIME_FUNCTION>(
+      X64CodeCache::LookupUnwindEntry(control_pc, context));
+}
 
-  // Always move the code to land on 16b alignment. We do this by rounding up
-  // to 16b so that all offsets are aligned.
-  alloc_size = poly::round_up(alloc_size, 16);
+// Maps a new reserved (not committed) section at the given addresses of both
+// views. The section allows RWX, but no single view does.
+HANDLE MapChunk(uint8_t* exec_address, uint8_t* write_address, size_t size) {
+  HANDLE mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL,
+                                     PAGE_EXECUTE_READWRITE | SEC_RESERVE, 0,
+                                     static_cast<DWORD>(size), NULL);
+  if (!mapping) {
+    return nullptr;
+  }
+  void* exec_view = MapViewOfFileEx(mapping, FILE_MAP_READ | FILE_MAP_EXECUTE,
+                                    0, 0, size, exec_address);
+  void* write_view =
+      MapViewOfFileEx(mapping, FILE_MAP_WRITE, 0, 0, size, write_address);
+  if (!exec_view || !write_view) {
+    if (exec_view) {
+      UnmapViewOfFile(exec_view);
+    }
+    if (write_view) {
+      UnmapViewOfFile(write_view);
+    }
+    CloseHandle(mapping);
+    return nullptr;
+  }
+  return mapping;
+}
 
-  lock_.lock();
+void UnmapChunk(uint8_t* exec_address, uint8_t* write_address,
+                HANDLE mapping) {
+  UnmapViewOfFile(exec_address);
+  UnmapViewOfFile(write_address);
+  CloseHandle(mapping);
+}
+}  // namespace
 
-  if (active_chunk_) {
-    if (active_chunk_->capacity - active_chunk_->offset < alloc_size) {
-      auto next = active_chunk_->next;
-      if (!next) {
-        assert_true(alloc_size < chunk_size_, "need to support larger chunks");
-        next = new X64CodeChunk(chunk_size_);
-        active_chunk_->next = next;
+int X64CodeCache::MapRegion() {
+  // Pages of a mapped section can't be decommitted, so each chunk gets a
+  // section of its own that can be swapped for a fresh one when it's freed.
+  // The chunks have to be contiguous in both views: find two free ranges and
+  // map into them, trying again if someone else takes the space first.
+  size_t chunk_count = region_size_ / kCommitChunkSize;
+  chunk_handles_.resize(chunk_count, nullptr);
+  for (int attempt = 0; attempt < 8 && !exec_base_; ++attempt) {
+    auto exec_base = reinterpret_cast<uint8_t*>(
+        VirtualAlloc(NULL, region_size_, MEM_RESERVE, PAGE_NOACCESS));
+    auto write_base = reinterpret_cast<uint8_t*>(
+        VirtualAlloc(NULL, region_size_, MEM_RESERVE, PAGE_NOACCESS));
+    if (exec_base) {
+      VirtualFree(exec_base, 0, MEM_RELEASE);
+    }
+    if (write_base) {
+      VirtualFree(write_base, 0, MEM_RELEASE);
+    }
+    if (!exec_base || !write_base) {
+      return 1;
+    }
+    size_t n = 0;
+    for (; n < chunk_count; ++n) {
+      size_t offset = n * kCommitChunkSize;
+      chunk_handles_[n] = MapChunk(exec_base + offset, write_base + offset,
+                                   kCommitChunkSize);
+      if (!chunk_handles_[n]) {
+        break;
       }
-      active_chunk_ = next;
     }
-  } else {
-    head_chunk_ = active_chunk_ = new X64CodeChunk(chunk_size_);
+    if (n == chunk_count) {
+      exec_base_ = exec_base;
+      write_base_ = write_base;
+      break;
+    }
+    while (n--) {
+      size_t offset = n * kCommitChunkSize;
+      UnmapChunk(exec_base + offset, write_base + offset, chunk_handles_[n]);
+      chunk_handles_[n] = nullptr;
+    }
+  }
+  if (!exec_base_) {
+    return 1;
   }
 
-  uint8_t* final_address = active_chunk_->buffer + active_chunk_->offset;
-  active_chunk_->offset += alloc_size;
-
-  // Add entry to fn table.
-  active_chunk_->AddTableEntry(final_address, alloc_size, stack_size);
-
-  lock_.unlock();
+  // Functions come and go in any order, so rather than keep a sorted table
+  // the unwinder asks us for entries as it needs them.
+  if (!RtlInstallFunctionTableCallback(
+          reinterpret_cast<DWORD64>(exec_base_) | 0x3,
+          reinterpret_cast<DWORD64>(exec_base_),
+          static_cast<DWORD>(region_size_), GetRuntimeFunctionCallback, this,
+          NULL)) {
+    return 1;
+  }
+  return 0;
+}
 
-  // Copy code.
-  memcpy(final_address, machine_code, code_size);
+void X64CodeCache::UnmapRegion() {
+  if (exec_base_) {
+    RtlDeleteFunctionTable(reinterpret_cast<PRUNTIME_FUNCTION>(
+        reinterpret_cast<DWORD64>(exec_base_) | 0x3));
+    for (size_t n = 0; n < chunk_handles_.size(); ++n) {
+      if (chunk_handles_[n]) {
+        size_t offset = n * kCommitChunkSize;
+        UnmapChunk(exec_base_ + offset, write_base_ + offset,
+                   chunk_handles_[n]);
+      }
+    }
+    chunk_handles_.clear();
+    exec_base_ = nullptr;
+    write_base_ = nullptr;
+  }
+}
 
-  // This isn't needed on x64 (probably), but is convention.
-  FlushInstructionCache(GetCurrentProcess(), final_address, alloc_size);
-  return final_address;
+int X64CodeCache::CommitRegion(size_t offset, size_t length) {
+  if (!VirtualAlloc(write_base_ + offset, length, MEM_COMMIT,
+                    PAGE_READWRITE) ||
+      !VirtualAlloc(exec_base_ + offset, length, MEM_COMMIT,
+                    PAGE_EXECUTE_READ)) {
+    return 1;
+  }
+  return 0;
 }
 
-X64CodeChunk::X64CodeChunk(size_t chunk_size)
-    : next(NULL), capacity(chunk_size), buffer(0), offset(0) {
-  buffer = (uint8_t*)VirtualAlloc(NULL, capacity, MEM_RESERVE | MEM_COMMIT,
-                                  PAGE_EXECUTE_READWRITE);
+int X64CodeCache::DecommitRegion(size_t offset, size_t length) {
+  // Nothing can be running in a free chunk, so its views can briefly go away
+  // while the section is replaced. Another allocation in the process may take
+  // the space in the meantime, in which case the chunk is lost.
+  for (size_t chunk_offset = offset; chunk_offset < offset + length;
+       chunk_offset += kCommitChunkSize) {
+    size_t n = chunk_offset / kCommitChunkSize;
+    UnmapChunk(exec_base_ + chunk_offset, write_base_ + chunk_offset,
+               chunk_handles_[n]);
+    chunk_handles_[n] = MapChunk(exec_base_ + chunk_offset,
+                                 write_base_ + chunk_offset, kCommitChunkSize);
+    if (!chunk_handles_[n]) {
+      return 1;
+    }
+  }
+  return 0;
+}
 
-  fn_table_capacity =
-      static_cast<uint32_t>(poly::round_up(capacity / ESTIMATED_FN_SIZE, 16));
-  size_t table_size = fn_table_capacity * sizeof(RUNTIME_FUNCTION);
-  fn_table = (RUNTIME_FUNCTION*)malloc(table_size);
-  fn_table_count = 0;
-  fn_table_handle = 0;
-  RtlAddGrowableFunctionTable(&fn_table_handle, fn_table, fn_table_count,
-                              fn_table_capacity, (ULONG_PTR)buffer,
-                              (ULONG_PTR)buffer + capacity);
+void X64CodeCache::FlushCode(void* address, size_t length) {
+  // This isn't needed on x64 (probably), but is convention.
+  FlushInstructionCache(GetCurrentProcess(), address, length);
 }
 
-X64CodeChunk::~X64CodeChunk() {
-  if (fn_table_handle) {
-    RtlDeleteGrowableFunctionTable(fn_table_handle);
-  }
-  if (buffer) {
-    VirtualFree(buffer, 0, MEM_RELEASE);
+void* X64CodeCache::LookupUnwindEntry(uint64_t control_pc, void* context) {
+  auto code_cache = reinterpret_cast<X64CodeCache*>(context);
+  std::lock_guard<std::mutex> guard(code_cache->lock_);
+  Block* block = code_cache->LookupBlock(reinterpret_cast<void*>(control_pc));
+  if (!block) {
+    return nullptr;
   }
+  return block->code + block->alloc_size - kUnwindReserveSize;
 }
 
 // http://msdn.microsoft.com/en-us/library/ssa62fwe.aspx
@@ -188,32 +258,15 @@ typedef struct _UNWIND_INFO {
 } UNWIND_INFO, *PUNWIND_INFO;
 }  // namespace
 
-void X64CodeChunk::AddTableEntry(uint8_t* code, size_t code_size,
-                                 size_t stack_size) {
-  // NOTE: we assume a chunk lock.
-
-  if (fn_table_count + 1 > fn_table_capacity) {
-    // Table exhausted, need to realloc. If this happens a lot we should tune
-    // the table size to prevent this.
-    PLOGW("X64CodeCache growing FunctionTable - adjust ESTIMATED_FN_SIZE");
-    RtlDeleteGrowableFunctionTable(fn_table_handle);
-    size_t old_size = fn_table_capacity * sizeof(RUNTIME_FUNCTION);
-    size_t new_size = old_size * 2;
-    auto new_table = (RUNTIME_FUNCTION*)realloc(fn_table, new_size);
-    assert_not_null(new_table);
-    if (!new_table) {
-      return;
-    }
-    fn_table = new_table;
-    fn_table_capacity *= 2;
-    RtlAddGrowableFunctionTable(&fn_table_handle, fn_table, fn_table_count,
-                                fn_table_capacity, (ULONG_PTR)buffer,
-                                (ULONG_PTR)buffer + capacity);
-  }
+void X64CodeCache::WriteUnwindInfo(Block* block, size_t stack_size) {
+  // NOTE: we assume the cache lock.
 
   // Allocate unwind data. We know we have space because we overallocated.
-  // This should be the tailing 16b with 16b alignment.
-  size_t unwind_info_offset = offset - UNWIND_INFO_SIZE;
+  // This should be the tailing 32b with 16b alignment.
+  size_t fn_entry_offset =
+      block->code - exec_base_ + block->alloc_size - kUnwindReserveSize;
+  size_t unwind_info_offset = fn_entry_offset + sizeof(RUNTIME_FUNCTION);
+  uint8_t* buffer = write_base_;
 
   if (!stack_size) {
     // http://msdn.microsoft.com/en-us/library/ddssxxy8.aspx
@@ -267,14 +320,11 @@ void X64CodeChunk::AddTableEntry(uint8_t* code, size_t code_size,
     unwind_code.FrameOffset = (USHORT)(stack_size) / 8;
   }
 
-  // Add entry.
-  auto& fn_entry = fn_table[fn_table_count++];
-  fn_entry.BeginAddress = (DWORD)(code - buffer);
-  fn_entry.EndAddress = (DWORD)(fn_entry.BeginAddress + code_size);
-  fn_entry.UnwindData = (DWORD)unwind_info_offset;
-
-  // Notify the function table that it has new entries.
-  RtlGrowFunctionTable(fn_table_handle, fn_table_count);
+  // Add entry. Offsets are from the start of the executable view.
+  auto fn_entry = (RUNTIME_FUNCTION*)(buffer + fn_entry_offset);
+  fn_entry->BeginAddress = (DWORD)(block->code - exec_base_);
+  fn_entry->EndAddress = (DWORD)(fn_entry->BeginAddress + block->code_size);
+  fn_entry->UnwindData = (DWORD)unwind_info_offset;
 }
 
 }  // namespace x64
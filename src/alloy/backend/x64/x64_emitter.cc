@@ -9,6 +9,7 @@
 
 #include <alloy/backend/x64/x64_emitter.h>
 
+#include <alloy/alloy-private.h>
 #include <alloy/backend/x64/x64_backend.h>
 #include <alloy/backend/x64/x64_code_cache.h>
 #include <alloy/backend/x64/x64_function.h>
@@ -62,6 +63,7 @@ X64Emitter::X64Emitter(X64Backend* backend, XbyakAllocator* allocator)
       backend_(backend),
       code_cache_(backend->code_cache()),
       allocator_(allocator),
+      feature_flags_(backend->emit_features()),
       current_instr_(0) {}
 
 X64Emitter::~X64Emitter() {}
@@ -79,11 +81,16 @@ int X64Emitter::Emit(HIRBuilder* builder, uint32_t debug_info_flags,
     source_map_arena_.Reset();
   }
   trace_flags_ = trace_flags;
+  relocations_.clear();
+  indirect_call_sites_.clear();
+  direct_call_sites_.clear();
 
   // Fill the generator with code.
   size_t stack_size = 0;
   int result = Emit(builder, stack_size);
   if (result) {
+    backend_->FreeIndirectCallSites(indirect_call_sites_);
+    indirect_call_sites_.clear();
     return result;
   }
 
@@ -101,15 +108,12 @@ int X64Emitter::Emit(HIRBuilder* builder, uint32_t debug_info_flags,
 }
 
 void* X64Emitter::Emplace(size_t stack_size) {
-  // To avoid changing xbyak, we do a switcharoo here.
   // top_ points to the Xbyak buffer, and since we are in AutoGrow mode
-  // it has pending relocations. We copy the top_ to our buffer, swap the
-  // pointer, relocate, then return the original scratch pointer for use.
-  uint8_t* old_address = top_;
-  void* new_address = code_cache_->PlaceCode(top_, size_, stack_size);
-  top_ = (uint8_t*)new_address;
+  // it has pending relocations. We never take the absolute address of a
+  // label, so they're all relative and can be applied in the scratch buffer
+  // before copying. The placed code is not writable from here.
   ready();
-  top_ = old_address;
+  void* new_address = code_cache_->PlaceCode(top_, size_, stack_size);
   reset();
   return new_address;
 }
@@ -213,6 +217,9 @@ int X64Emitter::Emit(HIRBuilder* builder, size_t& out_stack_size) {
   }
   ret();
 
+  // Out of line paths.
+  EmitDirectCallStubs();
+
 #if XE_DEBUG
   nop();
   nop();
@@ -386,72 +393,54 @@ void X64Emitter::UnimplementedInstr(const hir::Instr* i) {
   assert_always();
 }
 
-// Total size of ResolveFunctionSymbol call site in bytes.
-// Used to overwrite it with nops as needed.
-const size_t TOTAL_RESOLVE_SIZE = 27;
-const size_t ASM_OFFSET = 2 + 2 + 8 + 2 + 8;
+// Resolves the current translation of a function for generated code, at a
+// code cache safe point. Returns its machine code.
+uint64_t ResolveMachineCode(ThreadState* thread_state, uint64_t address) {
+  auto backend = static_cast<X64Backend*>(thread_state->runtime()->backend());
+  auto code_cache = backend->code_cache();
+  auto thread_data =
+      reinterpret_cast<X64ThreadData*>(thread_state->backend_data());
+  // Our caller's frames are all above us.
+  code_cache->SafePoint(thread_data->code_cache_thread, &backend);
+  code_cache->TrimIfNeeded();
 
-uint64_t ResolveFunctionSymbol(void* raw_context, uint64_t symbol_info_ptr) {
-  // TODO(benvanik): generate this thunk at runtime? or a shim?
+  // Resolve function. This will demand compile as required.
+  // It may be evicted again before we see it, in which case go again.
+  X64Function* function = nullptr;
+  void* machine_code = nullptr;
+  while (!machine_code) {
+    Function* fn = NULL;
+    thread_state->runtime()->ResolveFunction(address, &fn);
+    assert_not_null(fn);
+    function = static_cast<X64Function*>(fn);
+    machine_code = function->machine_code();
+  }
+  code_cache->Touch(function);
+  return reinterpret_cast<uint64_t>(machine_code);
+}
+
+uint64_t ResolveDirectCall(void* raw_context, uint64_t symbol_info_ptr,
+                           uint64_t call_site_ptr) {
   auto thread_state = *reinterpret_cast<ThreadState**>(raw_context);
   auto symbol_info = reinterpret_cast<FunctionInfo*>(symbol_info_ptr);
 
-  // Resolve function. This will demand compile as required.
-  Function* fn = NULL;
-  thread_state->runtime()->ResolveFunction(symbol_info->address(), &fn);
-  assert_not_null(fn);
-  auto x64_fn = static_cast<X64Function*>(fn);
-  uint64_t addr = reinterpret_cast<uint64_t>(x64_fn->machine_code());
-
-// Overwrite the call site.
-// The return address points to ReloadRCX work after the call.
-#if XE_LIKE_WIN32
-  uint64_t return_address = reinterpret_cast<uint64_t>(_ReturnAddress());
-#else
-  uint64_t return_address =
-      reinterpret_cast<uint64_t>(__builtin_return_address(0));
-#endif  // XE_LIKE_WIN32
-#pragma pack(push, 1)
-  struct Asm {
-    uint16_t mov_rax;
-    uint64_t rax_constant;
-    uint16_t mov_rdx;
-    uint64_t rdx_constant;
-    uint16_t call_rax;
-    uint8_t mov_rcx[5];
-  };
-#pragma pack(pop)
-  static_assert_size(Asm, TOTAL_RESOLVE_SIZE);
-  Asm* code = reinterpret_cast<Asm*>(return_address - ASM_OFFSET);
-  code->rax_constant = addr;
-  code->call_rax = 0x9066;
+  uint64_t addr = ResolveMachineCode(thread_state, symbol_info->address());
 
-  // We need to return the target in rax so that it gets called.
+  // If linking fails the call keeps coming through here, which is slow but
+  // still correct.
+  auto backend = static_cast<X64Backend*>(thread_state->runtime()->backend());
+  backend->code_cache()->LinkDirectCall(
+      reinterpret_cast<int32_t*>(call_site_ptr), reinterpret_cast<void*>(addr));
+
+  // The thunk jumps to the target in rax.
   return addr;
 }
 
 void X64Emitter::Call(const hir::Instr* instr,
                       runtime::FunctionInfo* symbol_info) {
-  auto fn = reinterpret_cast<X64Function*>(symbol_info->function());
-  // Resolve address to the function to call and store in rax.
-  if (fn) {
-    mov(rax, reinterpret_cast<uint64_t>(fn->machine_code()));
-  } else {
-    size_t start = getSize();
-    // 2b + 8b constant
-    mov(rax, reinterpret_cast<uint64_t>(ResolveFunctionSymbol));
-    // 2b + 8b constant
-    mov(rdx, reinterpret_cast<uint64_t>(symbol_info));
-    // 2b
-    call(rax);
-    // 5b
-    ReloadECX();
-    size_t total_size = getSize() - start;
-    assert_true(total_size == TOTAL_RESOLVE_SIZE);
-    // EDX overwritten, don't bother reloading.
-  }
-
-  // Actually jump/call to rax.
+  // Calls go straight to the target with a rel32 call/jmp. Until the target
+  // is translated (or after it's evicted) the call site points at a stub at
+  // the end of this function instead, which has it resolved and linked.
   if (instr->flags & CALL_TAIL) {
     // Since we skip the prolog we need to mark the return here.
     EmitTraceUserCallReturn();
@@ -460,32 +449,64 @@ void X64Emitter::Call(const hir::Instr* instr,
     mov(rdx, qword[rsp + StackLayout::GUEST_RET_ADDR]);
 
     add(rsp, static_cast<uint32_t>(stack_size()));
-    jmp(rax);
+    EmitDirectCallSite(0xE9, symbol_info);  // jmp rel32
   } else {
     // Return address is from the previous SET_RETURN_ADDRESS.
     mov(rdx, qword[rsp + StackLayout::GUEST_CALL_RET_ADDR]);
-    call(rax);
+    EmitDirectCallSite(0xE8, symbol_info);  // call rel32
+  }
+}
+
+void X64Emitter::EmitDirectCallSite(uint8_t opcode,
+                                    runtime::FunctionInfo* symbol_info) {
+  // The displacement is rewritten while other threads may be executing it,
+  // so it must be 4b aligned to be written atomically. Code is placed 16b
+  // aligned, so aligning the offset is enough.
+  nop((4 - (getSize() + 1) % 4) % 4);
+  db(opcode);
+  direct_call_sites_.push_back({getSize(), symbol_info});
+  dd(0);  // Pointed at the stub by EmitDirectCallStubs.
+}
+
+void X64Emitter::EmitDirectCallStubs() {
+  // One stub per call site, which the site points back at when unlinked.
+  // Everything in here is relative or relocated, so the initial state of the
+  // function can be persisted as is.
+  auto thunk = reinterpret_cast<uint64_t>(backend_->link_call_thunk());
+  for (auto& site : direct_call_sites_) {
+    size_t site_end = site.displacement_offset + 4;
+    rewrite(site.displacement_offset, getSize() - site_end, 4);
+
+    // rax = target FunctionInfo*
+    MovRelocated(rax, reinterpret_cast<uint64_t>(site.symbol_info),
+                 X64RelocationType::SYMBOL_INFO, site.symbol_info->address());
+    // r8 = call site displacement
+    // lea r8, [rip + disp32]
+    db(0x4C);
+    db(0x8D);
+    db(0x05);
+    dd(static_cast<uint32_t>(site.displacement_offset - (getSize() + 4)));
+    MovRelocated(r9, thunk, X64RelocationType::LINK_CALL_THUNK, 0);
+    jmp(r9);
   }
 }
 
 // NOTE: slot count limited by short jump size.
 const int kICSlotCount = 4;
 const int kICSlotSize = 23;
-const uint64_t kICSlotInvalidTargetAddress = 0x0F0F0F0F0F0F0F0F;
 
-uint64_t ResolveFunctionAddress(void* raw_context, uint64_t target_address) {
+uint64_t ResolveFunctionAddress(void* raw_context, uint64_t target_address,
+                                uint64_t call_site_ptr) {
   // TODO(benvanik): generate this thunk at runtime? or a shim?
   auto thread_state = *reinterpret_cast<ThreadState**>(raw_context);
+  auto call_site = reinterpret_cast<IndirectCallSite*>(call_site_ptr);
+  ++call_site->resolve_count;
 
   // TODO(benvanik): required?
   target_address &= 0xFFFFFFFF;
   assert_not_zero(target_address);
 
-  Function* fn = NULL;
-  thread_state->runtime()->ResolveFunction(target_address, &fn);
-  assert_not_null(fn);
-  auto x64_fn = static_cast<X64Function*>(fn);
-  uint64_t addr = reinterpret_cast<uint64_t>(x64_fn->machine_code());
+  uint64_t addr = ResolveMachineCode(thread_state, target_address);
 
 // Add an IC slot, if there is room.
 #if XE_LIKE_WIN32
@@ -506,51 +527,103 @@ uint64_t ResolveFunctionAddress(void* raw_context, uint64_t target_address) {
 #pragma pack(pop)
   static_assert_size(Asm, kICSlotSize);
   // The return address points to ReloadRCX work after the call.
-  // To get the top of the table, look back a ways.
-  uint64_t table_start = return_address - 12 - kICSlotSize * kICSlotCount;
-  // NOTE: order matters here - we update the address BEFORE we switch the code
-  // over to passing the compare.
+  // The emitter recorded how far back the top of the table is.
+  uint64_t table_start = return_address - call_site->ic_table_distance;
+  // If the IC is full future calls will hit in the dispatch table instead.
+  auto backend = static_cast<X64Backend*>(thread_state->runtime()->backend());
   Asm* table_slot = reinterpret_cast<Asm*>(table_start);
-  bool wrote_ic = false;
   for (int i = 0; i < kICSlotCount; ++i) {
-    if (poly::atomic_cas(kICSlotInvalidTargetAddress, addr,
-                         &table_slot->target_constant)) {
-      // Got slot! Just write the compare and we're done.
-      table_slot->address_constant = static_cast<uint32_t>(target_address);
-      wrote_ic = true;
+    if (backend->code_cache()->LinkInlineCacheSlot(
+            &table_slot->address_constant, &table_slot->target_constant,
+            static_cast<uint32_t>(target_address),
+            reinterpret_cast<void*>(addr))) {
       break;
     }
     ++table_slot;
   }
-  if (!wrote_ic) {
-    // TODO(benvanik): log that IC table is full.
-  }
 
   // We need to return the target in rax so that it gets called.
   return addr;
 }
 
+uint64_t ResolveReturn(void* raw_context, uint64_t target_address,
+                       uint64_t return_slot) {
+  auto thread_state = *reinterpret_cast<ThreadState**>(raw_context);
+  auto backend = static_cast<X64Backend*>(thread_state->runtime()->backend());
+  auto code_cache = backend->code_cache();
+  target_address &= 0xFFFFFFFF;
+
+  // Walk out through the guest frames on the host stack, each of which holds
+  // the guest address it returns to. The walk stops at the first host frame
+  // (the host to guest thunk), as we can't unwind through host code.
+  size_t stack_size;
+  while (code_cache->LookupGuestFrame(
+      *reinterpret_cast<void**>(return_slot), &stack_size)) {
+    uint64_t frame = return_slot + 8;
+    return_slot = frame + stack_size;
+    uint32_t return_address = *reinterpret_cast<uint32_t*>(
+        frame + StackLayout::GUEST_RET_ADDR);
+    if (return_address == target_address) {
+      return return_slot;
+    }
+  }
+  return 0;
+}
+
 void X64Emitter::CallIndirect(const hir::Instr* instr, const Reg64& reg) {
   // Check if return.
   if (instr->flags & CALL_POSSIBLE_RETURN) {
     cmp(reg.cvt32(), dword[rsp + StackLayout::GUEST_RET_ADDR]);
     je("epilog", CodeGenerator::T_NEAR);
-  }
 
-  if (reg.getIdx() != rdx.getIdx()) {
+    // Not our return address, but it may be one further out, as with longjmp
+    // or returns from helpers that were branched into. If so unwind the host
+    // stack to that frame and return from it, so that host calls and returns
+    // stay paired. Otherwise it's a plain indirect branch.
+    Xbyak::Label not_return;
+    mov(qword[rsp + STASH_OFFSET], reg);
+    mov(rdx, reg);
+    lea(r8, ptr[rsp + static_cast<uint32_t>(stack_size())]);
+    MovHostAddress(rax, reinterpret_cast<void*>(ResolveReturn));
+    call(rax);
+    test(rax, rax);
+    jz(not_return, T_NEAR);
+    ReloadECX();
+    ReloadEDX();
+    mov(rsp, rax);
+    ret();
+    L(not_return);
+    ReloadECX();
+    mov(rdx, qword[rsp + STASH_OFFSET]);
+  } else if (reg.getIdx() != rdx.getIdx()) {
     mov(rdx, reg);
   }
 
+  auto call_site = backend_->AllocateIndirectCallSite();
+  uint32_t call_site_index =
+      static_cast<uint32_t>(indirect_call_sites_.size());
+  indirect_call_sites_.push_back(call_site);
+  const bool record_stats = FLAGS_x64_indirect_call_stats;
+
   inLocalLabel();
   Xbyak::Label skip_resolve;
+  Xbyak::Label resolve;
+
+  // The distance is only known after the table is emitted, so relocations of
+  // the call site pointer are fixed up at the end.
+  size_t first_call_site_relocation = relocations_.size();
+  if (record_stats) {
+    MovRelocated(rax, reinterpret_cast<uint64_t>(call_site),
+                 X64RelocationType::INDIRECT_CALL_SITE, 0);
+    inc(qword[rax + offsetof(IndirectCallSite, call_count)]);
+  }
 
   // TODO(benvanik): make empty tables skippable (cmp, jump right to resolve).
 
   // IC table, initially empty.
   // This will get filled in as functions are resolved.
   // Note that we only have a limited cache, and once it's full all calls
-  // will fall through.
-  // TODO(benvanik): check miss rate when full and add a 2nd-level table?
+  // will fall through to the dispatch table below.
   // 0000000264BD4DC3 81 FA 0F0F0F0F         cmp         edx,0F0F0F0Fh
   // 0000000264BD4DC9 75 0C                  jne         0000000264BD4DD7
   // 0000000264BD4DCB 48 B8 0F0F0F0F0F0F0F0F mov         rax,0F0F0F0F0F0F0F0Fh
@@ -560,13 +633,13 @@ void X64Emitter::CallIndirect(const hir::Instr* instr, const Reg64& reg) {
     // Compare target address with constant, if matches jump there.
     // Otherwise, fall through.
     // 6b
-    cmp(edx, 0x0F0F0F0F);
+    cmp(edx, X64CodeCache::kInlineCacheInvalidAddress);
     Xbyak::Label next_slot;
     // 2b
     jne(next_slot, T_SHORT);
     // Match! Load up rax and skip down to the jmp code.
     // 10b
-    mov(rax, kICSlotInvalidTargetAddress);
+    mov(rax, X64CodeCache::kInlineCacheInvalidTarget);
     // 5b
     jmp(skip_resolve, T_NEAR);
     L(next_slot);
@@ -574,9 +647,45 @@ void X64Emitter::CallIndirect(const hir::Instr* instr, const Reg64& reg) {
   size_t table_size = getSize() - table_start;
   assert_true(table_size == kICSlotSize * kICSlotCount);
 
+  // Second level: guest->host dispatch table shared by all call sites.
+  // Holds every compiled function, so only calls to functions that have never
+  // been compiled (or targets outside the code range) go to the resolver.
+  mov(eax, edx);
+  sub(eax, static_cast<uint32_t>(X64CodeCache::kIndirectionBase));
+  cmp(eax, static_cast<uint32_t>(X64CodeCache::kIndirectionSize));
+  jae(resolve, T_NEAR);
+  shr(eax, 2);
+  MovRelocated(r8, reinterpret_cast<uint64_t>(code_cache_->indirection_table()),
+               X64RelocationType::INDIRECTION_TABLE, 0);
+  mov(rax, qword[r8 + rax * 8]);
+  test(rax, rax);
+  jz(resolve, T_NEAR);
+  if (record_stats) {
+    MovRelocated(r8, reinterpret_cast<uint64_t>(call_site),
+                 X64RelocationType::INDIRECT_CALL_SITE, 0);
+    inc(qword[r8 + offsetof(IndirectCallSite, table_hit_count)]);
+  }
+  jmp(skip_resolve, T_NEAR);
+
   // Resolve address to the function to call and store in rax.
-  // We fall through to this when there are no hits in the IC table.
-  CallNative(ResolveFunctionAddress);
+  // We fall through to this when there are no hits in either table.
+  // rcx = context, rdx = target, r8 = call site
+  L(resolve);
+  MovRelocated(r8, reinterpret_cast<uint64_t>(call_site),
+               X64RelocationType::INDIRECT_CALL_SITE, 0);
+  MovHostAddress(rax, reinterpret_cast<void*>(ResolveFunctionAddress));
+  call(rax);
+  call_site->ic_table_distance =
+      static_cast<uint32_t>(getSize() - table_start);
+  for (size_t n = first_call_site_relocation; n < relocations_.size(); ++n) {
+    auto& relocation = relocations_[n];
+    if (relocation.type == X64RelocationType::INDIRECT_CALL_SITE) {
+      relocation.value = (static_cast<uint64_t>(call_site_index) << 32) |
+                         call_site->ic_table_distance;
+    }
+  }
+  ReloadECX();
+  ReloadEDX();
 
   // Actually jump/call to rax.
   L(skip_resolve);
@@ -626,17 +735,24 @@ void X64Emitter::CallExtern(const hir::Instr* instr,
   }
 
   if (!symbol_info->extern_handler()) {
-    CallNative(UndefinedCallExtern, reinterpret_cast<uint64_t>(symbol_info));
+    MovRelocated(rdx, reinterpret_cast<uint64_t>(symbol_info),
+                 X64RelocationType::SYMBOL_INFO, symbol_info->address());
+    CallNative(UndefinedCallExtern);
   } else {
     // rcx = context
     // rdx = target host function
     // r8  = arg0
     // r9  = arg1
-    mov(rdx, reinterpret_cast<uint64_t>(symbol_info->extern_handler()));
-    mov(r8, reinterpret_cast<uint64_t>(symbol_info->extern_arg0()));
-    mov(r9, reinterpret_cast<uint64_t>(symbol_info->extern_arg1()));
+    uint64_t address = symbol_info->address();
+    MovRelocated(rdx, reinterpret_cast<uint64_t>(symbol_info->extern_handler()),
+                 X64RelocationType::EXTERN_HANDLER, address);
+    MovRelocated(r8, reinterpret_cast<uint64_t>(symbol_info->extern_arg0()),
+                 X64RelocationType::EXTERN_ARG0, address);
+    MovRelocated(r9, reinterpret_cast<uint64_t>(symbol_info->extern_arg1()),
+                 X64RelocationType::EXTERN_ARG1, address);
     auto thunk = backend()->guest_to_host_thunk();
-    mov(rax, reinterpret_cast<uint64_t>(thunk));
+    MovRelocated(rax, reinterpret_cast<uint64_t>(thunk),
+                 X64RelocationType::GUEST_TO_HOST_THUNK, 0);
     call(rax);
     ReloadECX();
     ReloadEDX();
@@ -658,21 +774,21 @@ void X64Emitter::CallExtern(const hir::Instr* instr,
 }
 
 void X64Emitter::CallNative(void* fn) {
-  mov(rax, reinterpret_cast<uint64_t>(fn));
+  MovHostAddress(rax, reinterpret_cast<void*>(fn));
   call(rax);
   ReloadECX();
   ReloadEDX();
 }
 
 void X64Emitter::CallNative(uint64_t (*fn)(void* raw_context)) {
-  mov(rax, reinterpret_cast<uint64_t>(fn));
+  MovHostAddress(rax, reinterpret_cast<void*>(fn));
   call(rax);
   ReloadECX();
   ReloadEDX();
 }
 
 void X64Emitter::CallNative(uint64_t (*fn)(void* raw_context, uint64_t arg0)) {
-  mov(rax, reinterpret_cast<uint64_t>(fn));
+  MovHostAddress(rax, reinterpret_cast<void*>(fn));
   call(rax);
   ReloadECX();
   ReloadEDX();
@@ -681,7 +797,7 @@ void X64Emitter::CallNative(uint64_t (*fn)(void* raw_context, uint64_t arg0)) {
 void X64Emitter::CallNative(uint64_t (*fn)(void* raw_context, uint64_t arg0),
                             uint64_t arg0) {
   mov(rdx, arg0);
-  mov(rax, reinterpret_cast<uint64_t>(fn));
+  MovHostAddress(rax, reinterpret_cast<void*>(fn));
   call(rax);
   ReloadECX();
   ReloadEDX();
@@ -692,9 +808,10 @@ void X64Emitter::CallNativeSafe(void* fn) {
   // rdx = target host function
   // r8  = arg0
   // r9  = arg1
-  mov(rdx, reinterpret_cast<uint64_t>(fn));
+  MovHostAddress(rdx, fn);
   auto thunk = backend()->guest_to_host_thunk();
-  mov(rax, reinterpret_cast<uint64_t>(thunk));
+  MovRelocated(rax, reinterpret_cast<uint64_t>(thunk),
+               X64RelocationType::GUEST_TO_HOST_THUNK, 0);
   call(rax);
   ReloadECX();
   ReloadEDX();
@@ -713,6 +830,26 @@ void X64Emitter::ReloadEDX() {
   mov(rdx, qword[rcx + 8]);  // membase
 }
 
+void X64Emitter::MovRelocated(const Reg64& dest, uint64_t address,
+                              X64RelocationType type, uint64_t value) {
+  // REX.W B8+r imm64
+  db(0x48 | (dest.getIdx() >= 8 ? 0x01 : 0x00));
+  db(0xB8 | (dest.getIdx() & 0x7));
+  relocations_.push_back({static_cast<uint32_t>(getSize()), type, value});
+  dq(address);
+}
+
+void X64Emitter::MovHostAddress(const Reg64& dest, const void* address) {
+  uint64_t value = reinterpret_cast<uint64_t>(address);
+  MovRelocated(dest, value, X64RelocationType::HOST_IMAGE,
+               value - host_image_anchor());
+}
+
+uint64_t X64Emitter::host_image_anchor() {
+  // Anything in the executable will do, as the whole image moves together.
+  return reinterpret_cast<uint64_t>(ResolveDirectCall);
+}
+
 // Len Assembly                                   Byte Sequence
 // ============================================================================
 // 2b  66 NOP                                     66 90H
@@ -749,11 +886,6 @@ void X64Emitter::StoreEflags() {
 #endif  // STORE_EFLAGS
 }
 
-uint32_t X64Emitter::page_table_address() const {
-  uint64_t addr = runtime_->memory()->page_table();
-  return static_cast<uint32_t>(addr);
-}
-
 bool X64Emitter::ConstantFitsIn32Reg(uint64_t v) {
   if ((v & ~0x7FFFFFFF) == 0) {
     // Fits under 31 bits, so just load using normal mov.
@@ -812,6 +944,8 @@ Address X64Emitter::GetXmmConstPtr(XmmConst id) {
       /* XMMByteSwapMask        */ vec128i(0x00010203u, 0x04050607u,
                                            0x08090A0Bu, 0x0C0D0E0Fu),
       /* XMMPermuteControl15    */ vec128b(15),
+      /* XMMPermuteControlI32   */ vec128i(0x80808000u, 0x80808001u,
+                                           0x80808002u, 0x80808003u),
       /* XMMPackD3DCOLOR        */ vec128i(0xFFFFFFFFu, 0xFFFFFFFFu,
                                            0xFFFFFFFFu, 0x0C000408u),
       /* XMMUnpackD3DCOLOR      */ vec128i(0xFFFFFF0Eu, 0xFFFFFF0Du,
@@ -858,7 +992,7 @@ Address X64Emitter::GetXmmConstPtr(XmmConst id) {
   // prevent this move.
   // TODO(benvanik): move to predictable location in PPCContext? could then
   // just do rcx relative addression with no rax overwriting.
-  mov(rax, (uint64_t)&xmm_consts[id]);
+  MovHostAddress(rax, &xmm_consts[id]);
   return ptr[rax];
 }
 
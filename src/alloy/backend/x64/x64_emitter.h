@@ -10,6 +10,8 @@
 #ifndef ALLOY_BACKEND_X64_X64_EMITTER_H_
 #define ALLOY_BACKEND_X64_X64_EMITTER_H_
 
+#include <vector>
+
 #include <alloy/hir/value.h>
 #include <third_party/xbyak/xbyak/xbyak.h>
 
@@ -32,12 +34,24 @@ namespace x64 {
 
 class X64Backend;
 class X64CodeCache;
+struct IndirectCallSite;
 
 enum RegisterFlags {
   REG_DEST = (1 << 0),
   REG_ABCD = (1 << 1),
 };
 
+// Optional instruction set extensions sequences may pick variants for.
+// AVX itself is required. Detected once by X64Backend and masked by the
+// --x64_enable_* flags.
+enum EmitFeatureFlags {
+  EMIT_AVX2 = (1 << 0),
+  EMIT_FMA = (1 << 1),
+  EMIT_BMI2 = (1 << 2),
+  EMIT_MOVBE = (1 << 3),
+  EMIT_F16C = (1 << 4),
+};
+
 enum XmmConst {
   XMMZero = 0,
   XMMOne,
@@ -55,6 +69,7 @@ enum XmmConst {
   XMMAbsMaskPD,
   XMMByteSwapMask,
   XMMPermuteControl15,
+  XMMPermuteControlI32,
   XMMPackD3DCOLOR,
   XMMUnpackD3DCOLOR,
   XMMPackFLOAT16_2,
@@ -80,6 +95,42 @@ enum XmmConst {
   XMMShortMaxPS,
 };
 
+// Kinds of absolute host addresses embedded in generated code.
+// They're recorded as the code is emitted so that it can be persisted and
+// placed again in another process, where all of them will have moved.
+enum class X64RelocationType : uint32_t {
+  // Static function/data in the host executable.
+  // value = address - X64Emitter::host_image_anchor().
+  HOST_IMAGE,
+  // X64Backend::guest_to_host_thunk().
+  GUEST_TO_HOST_THUNK,
+  // X64CodeCache::indirection_table() + value (byte offset).
+  INDIRECTION_TABLE,
+  // FunctionInfo* of the guest function at address value.
+  SYMBOL_INFO,
+  // extern_handler/arg0/arg1 of the guest function at address value.
+  EXTERN_HANDLER,
+  EXTERN_ARG0,
+  EXTERN_ARG1,
+  // IndirectCallSite*. value = (site index << 32) | ic_table_distance.
+  INDIRECT_CALL_SITE,
+  // X64Backend::link_call_thunk().
+  LINK_CALL_THUNK,
+};
+
+struct X64Relocation {
+  // Offset of the 8b immediate from the start of the function.
+  uint32_t offset;
+  X64RelocationType type;
+  uint64_t value;
+};
+
+// Resolves the target of an unlinked direct call and links the call site
+// (its rel32 displacement) to it. Returns the target machine code.
+// Called from the link call thunk.
+uint64_t ResolveDirectCall(void* raw_context, uint64_t symbol_info_ptr,
+                           uint64_t call_site_ptr);
+
 // Unfortunately due to the design of xbyak we have to pass this to the ctor.
 class XbyakAllocator : public Xbyak::Allocator {
  public:
@@ -96,6 +147,11 @@ class X64Emitter : public Xbyak::CodeGenerator {
 
   int Initialize();
 
+  // True if sequences may use the given EmitFeatureFlags extension.
+  bool IsFeatureEnabled(uint32_t feature_flag) const {
+    return (feature_flags_ & feature_flag) != 0;
+  }
+
   int Emit(hir::HIRBuilder* builder, uint32_t debug_info_flags,
            runtime::DebugInfo* debug_info, uint32_t trace_flags,
            void*& out_code_address, size_t& out_code_size);
@@ -151,6 +207,21 @@ class X64Emitter : public Xbyak::CodeGenerator {
   void ReloadECX();
   void ReloadEDX();
 
+  // Loads a host address that must be fixed up if the code moves processes.
+  // Always emits the 10b mov so the immediate can be patched in place.
+  void MovRelocated(const Xbyak::Reg64& dest, uint64_t address,
+                    X64RelocationType type, uint64_t value);
+  void MovHostAddress(const Xbyak::Reg64& dest, const void* address);
+  static uint64_t host_image_anchor();
+  const std::vector<X64Relocation>& relocations() const {
+    return relocations_;
+  }
+  // Records of the indirect call sites in the last function emitted, for the
+  // function to own.
+  const std::vector<IndirectCallSite*>& indirect_call_sites() const {
+    return indirect_call_sites_;
+  }
+
   void nop(size_t length = 1);
 
   // TODO(benvanik): Label for epilog (don't use strings).
@@ -158,8 +229,6 @@ class X64Emitter : public Xbyak::CodeGenerator {
   void LoadEflags();
   void StoreEflags();
 
-  uint32_t page_table_address() const;
-
   // Moves a 64bit immediate into memory.
   bool ConstantFitsIn32Reg(uint64_t v);
   void MovMem64(const Xbyak::RegExp& addr, uint64_t v);
@@ -179,12 +248,15 @@ class X64Emitter : public Xbyak::CodeGenerator {
   void EmitTraceSourceAppendValue(const hir::Value* value, size_t r8_offset);
   void EmitGetCurrentThreadId();
   void EmitTraceUserCallReturn();
+  void EmitDirectCallSite(uint8_t opcode, runtime::FunctionInfo* symbol_info);
+  void EmitDirectCallStubs();
 
  protected:
   runtime::Runtime* runtime_;
   X64Backend* backend_;
   X64CodeCache* code_cache_;
   XbyakAllocator* allocator_;
+  uint32_t feature_flags_;
 
   hir::Instr* current_instr_;
 
@@ -195,6 +267,17 @@ class X64Emitter : public Xbyak::CodeGenerator {
 
   uint32_t trace_flags_;
 
+  std::vector<X64Relocation> relocations_;
+  std::vector<IndirectCallSite*> indirect_call_sites_;
+
+  // Direct call sites waiting on a stub at the end of the function.
+  struct DirectCallSite {
+    // Offset of the rel32 displacement.
+    size_t displacement_offset;
+    runtime::FunctionInfo* symbol_info;
+  };
+  std::vector<DirectCallSite> direct_call_sites_;
+
   static const uint32_t gpr_reg_map_[GPR_COUNT];
   static const uint32_t xmm_reg_map_[XMM_COUNT];
 };
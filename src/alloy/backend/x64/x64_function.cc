@@ -10,6 +10,7 @@
 #include <alloy/backend/x64/x64_function.h>
 
 #include <alloy/backend/x64/x64_backend.h>
+#include <alloy/backend/x64/x64_code_cache.h>
 #include <alloy/runtime/runtime.h>
 #include <alloy/runtime/thread_state.h>
 
@@ -23,7 +24,12 @@ using alloy::runtime::FunctionInfo;
 using alloy::runtime::ThreadState;
 
 X64Function::X64Function(FunctionInfo* symbol_info)
-    : Function(symbol_info), machine_code_(nullptr), code_size_(0) {}
+    : Function(symbol_info),
+      machine_code_(nullptr),
+      code_size_(0),
+      code_cache_block_(nullptr),
+      tier0_entry_count_(0),
+      tier0_promotion_claimed_(false) {}
 
 X64Function::~X64Function() {
   // machine_code_ is freed by code cache.
@@ -40,8 +46,32 @@ int X64Function::RemoveBreakpointImpl(Breakpoint* breakpoint) { return 0; }
 
 int X64Function::CallImpl(ThreadState* thread_state, uint64_t return_address) {
   auto backend = (X64Backend*)thread_state->runtime()->backend();
+  auto code_cache = backend->code_cache();
+  auto thread_data =
+      reinterpret_cast<X64ThreadData*>(thread_state->backend_data());
+
+  // Everything above this frame is host code.
+  code_cache->EnterGuest(thread_data->code_cache_thread, &thread_data);
+  code_cache->TrimIfNeeded();
+
+  // Callers resolve us from guest code or within a guest bracket (see
+  // Runtime::CallFunction), so we can't have been freed yet. Our code may
+  // have been evicted since, though.
+  void* machine_code = machine_code_;
+  while (!machine_code) {
+    Function* fn;
+    if (thread_state->runtime()->ResolveFunction(symbol_info()->address(),
+                                                 &fn)) {
+      code_cache->LeaveGuest(thread_data->code_cache_thread);
+      return 1;
+    }
+    machine_code = static_cast<X64Function*>(fn)->machine_code();
+  }
+
   auto thunk = backend->host_to_guest_thunk();
-  thunk(machine_code_, thread_state->raw_context(), (void*)return_address);
+  thunk(machine_code, thread_state->raw_context(), (void*)return_address);
+
+  code_cache->LeaveGuest(thread_data->code_cache_thread);
   return 0;
 }
 
@@ -10,6 +10,10 @@
 #ifndef ALLOY_BACKEND_X64_X64_FUNCTION_H_
 #define ALLOY_BACKEND_X64_X64_FUNCTION_H_
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include <alloy/runtime/function.h>
 #include <alloy/runtime/symbol_info.h>
 
@@ -17,15 +21,51 @@ namespace alloy {
 namespace backend {
 namespace x64 {
 
+struct IndirectCallSite;
+
 class X64Function : public runtime::Function {
  public:
   X64Function(runtime::FunctionInfo* symbol_info);
   virtual ~X64Function();
 
+  // Null once evicted from the code cache.
   void* machine_code() const { return machine_code_; }
   size_t code_size() const { return code_size_; }
 
   void Setup(void* machine_code, size_t code_size);
+  void Evict() { machine_code_ = nullptr; }
+
+  // The code cache's record of the code, so that it can be found without a
+  // lookup. Owned by the code cache.
+  void* code_cache_block() const { return code_cache_block_; }
+  void set_code_cache_block(void* block) { code_cache_block_ = block; }
+
+  // Records of the indirect call sites in the code, freed by the code cache
+  // with the function.
+  const std::vector<IndirectCallSite*>& indirect_call_sites() const {
+    return indirect_call_sites_;
+  }
+  void SetupIndirectCallSites(std::vector<IndirectCallSite*> call_sites) {
+    indirect_call_sites_ = std::move(call_sites);
+  }
+
+  // Set on the entry stubs wrapping --runtime_tiered first tier functions,
+  // which run the given function instead of any code of their own.
+  runtime::Function* tier0_function() const { return tier0_function_.get(); }
+  void SetupTier0(std::unique_ptr<runtime::Function> tier0_function) {
+    tier0_function_ = std::move(tier0_function);
+  }
+  // Counts an entry to the tier0 function, returning the new total.
+  uint32_t CountTier0Entry() { return ++tier0_entry_count_; }
+  // True for the one caller that gets to promote the function. A failed
+  // promotion must be released so that it's tried again later.
+  bool ClaimTier0Promotion() {
+    return !tier0_promotion_claimed_.exchange(true);
+  }
+  void ReleaseTier0Promotion() {
+    tier0_entry_count_ = 0;
+    tier0_promotion_claimed_ = false;
+  }
 
  protected:
   virtual int AddBreakpointImpl(runtime::Breakpoint* breakpoint);
@@ -34,8 +74,13 @@ class X64Function : public runtime::Function {
                        uint64_t return_address);
 
  private:
-  void* machine_code_;
+  std::atomic<void*> machine_code_;
   size_t code_size_;
+  void* code_cache_block_;
+  std::vector<IndirectCallSite*> indirect_call_sites_;
+  std::unique_ptr<runtime::Function> tier0_function_;
+  std::atomic<uint32_t> tier0_entry_count_;
+  std::atomic<bool> tier0_promotion_claimed_;
 };
 
 }  // namespace x64
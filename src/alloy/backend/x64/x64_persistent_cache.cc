@@ -0,0 +1,401 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/backend/x64/x64_persistent_cache.h>
+
+#include <algorithm>
+
+#include <alloy/alloy-private.h>
+#include <alloy/backend/x64/x64_backend.h>
+#include <alloy/backend/x64/x64_code_cache.h>
+#include <alloy/backend/x64/x64_function.h>
+#include <alloy/runtime/module.h>
+#include <alloy/runtime/runtime.h>
+#include <poly/poly.h>
+#include <xenia/core/hash.h>
+#include <xenia/profiling.h>
+
+#if XE_LIKE_WIN32
+#include <windows.h>
+#else
+#include <limits.h>
+#include <sys/stat.h>
+#if XE_LIKE_OSX
+#include <mach-o/dyld.h>
+#endif  // XE_LIKE_OSX
+#endif  // XE_LIKE_WIN32
+
+namespace alloy {
+namespace backend {
+namespace x64 {
+
+using alloy::runtime::Function;
+using alloy::runtime::FunctionInfo;
+
+namespace {
+
+uint64_t MakeKey(uint64_t module_hash, uint64_t guest_address) {
+  return module_hash ^ (guest_address * 0x9E3779B97F4A7C15ull);
+}
+
+// Size and modification time of the running executable.
+// Host function/data offsets within the image change with every build, so
+// the cache can't outlive it. Returns false if the image can't be found.
+bool HashHostImage(uint64_t* out_hash) {
+  uint64_t values[2] = {0, 0};
+#if XE_LIKE_WIN32
+  wchar_t path[MAX_PATH];
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetModuleFileNameW(nullptr, path, poly::countof(path)) ||
+      !GetFileAttributesExW(path, GetFileExInfoStandard, &data)) {
+    return false;
+  }
+  values[0] =
+      (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+  values[1] =
+      (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+      data.ftLastWriteTime.dwLowDateTime;
+#else
+#if XE_LIKE_OSX
+  char path[PATH_MAX];
+  uint32_t path_size = sizeof(path);
+  if (_NSGetExecutablePath(path, &path_size)) {
+    return false;
+  }
+#else
+  const char* path = "/proc/self/exe";
+#endif  // XE_LIKE_OSX
+  struct stat st;
+  if (stat(path, &st)) {
+    return false;
+  }
+  values[0] = st.st_size;
+  values[1] = st.st_mtime;
+#endif  // XE_LIKE_WIN32
+  *out_hash = xe::hash64(values, sizeof(values));
+  return true;
+}
+
+}  // namespace
+
+X64PersistentCache::X64PersistentCache(X64Backend* backend)
+    : backend_(backend),
+      fingerprint_(0),
+      file_(nullptr),
+      load_count_(0),
+      store_count_(0) {}
+
+X64PersistentCache::~X64PersistentCache() {
+  if (file_) {
+    fclose(file_);
+  }
+}
+
+int X64PersistentCache::Initialize(const std::string& path) {
+  // Without a way to tell builds apart, stale code could be loaded.
+  uint64_t image_hash;
+  if (!HashHostImage(&image_hash)) {
+    PLOGW("Unable to identify the host executable; code cache disabled");
+    return 1;
+  }
+  fingerprint_ = CalculateFingerprint(image_hash);
+
+  // Use the existing file only if it was written by this exact build.
+  bool is_valid = false;
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file) {
+    FileHeader header;
+    if (fread(&header, sizeof(header), 1, file) == 1 &&
+        header.magic == kFileMagic && header.version == kFileVersion &&
+        header.fingerprint == fingerprint_) {
+      is_valid = true;
+    }
+    fclose(file);
+  }
+  if (is_valid) {
+    mapping_ = poly::MappedMemory::Open(poly::to_wstring(path),
+                                        poly::MappedMemory::Mode::READ);
+    if (!mapping_ || ReadRecords()) {
+      records_.clear();
+      mapping_.reset();
+      is_valid = false;
+    }
+  }
+
+  // Reopen for appending new translations. A stale file is started over.
+  if (is_valid) {
+    file_ = fopen(path.c_str(), "ab");
+  } else {
+    file_ = fopen(path.c_str(), "wb");
+    if (file_) {
+      FileHeader header = {kFileMagic, kFileVersion, fingerprint_};
+      fwrite(&header, sizeof(header), 1, file_);
+    }
+  }
+  if (!file_) {
+    PLOGE("Unable to open code cache file %s", path.c_str());
+    return 1;
+  }
+
+  PLOGI("Code cache %s: %u functions", path.c_str(),
+        static_cast<uint32_t>(records_.size()));
+  return 0;
+}
+
+uint64_t X64PersistentCache::CalculateFingerprint(uint64_t image_hash) {
+  // Anything that changes the generated code must be folded in here.
+  uint64_t values[] = {
+      kFileVersion, FLAGS_x64_indirect_call_stats ? 1ull : 0ull,
+      FLAGS_ppc_global_lock_stats ? 1ull : 0ull, backend_->emit_features(),
+  };
+  return xe::hash64(values, sizeof(values), image_hash);
+}
+
+uint64_t X64PersistentCache::HashModule(FunctionInfo* symbol_info) {
+  // The name alone would match a different build of the same title.
+  auto module = symbol_info->module();
+  const std::string& name = module->name();
+  return xe::hash64(name.data(), name.size(), module->content_hash());
+}
+
+uint64_t X64PersistentCache::HashGuestCode(uint64_t address,
+                                           uint64_t end_address,
+                                           uint64_t seed) {
+  // end_address is the address of the last instruction.
+  auto memory = backend_->runtime()->memory();
+  return xe::hash64(memory->Translate(address), end_address - address + 4,
+                    seed);
+}
+
+int X64PersistentCache::ReadRecords() {
+  const uint8_t* base = mapping_->data();
+  size_t size = mapping_->size();
+  size_t offset = sizeof(FileHeader);
+  while (offset + sizeof(FunctionRecord) <= size) {
+    auto record = reinterpret_cast<const FunctionRecord*>(base + offset);
+    size_t record_size = sizeof(FunctionRecord) +
+                         record->inlined_count * sizeof(InlinedRange) +
+                         record->relocation_count * sizeof(X64Relocation) +
+                         poly::round_up(record->code_size, 16);
+    if (offset + record_size > size) {
+      // Truncated by a crash mid-write; everything before it is still good.
+      break;
+    }
+    offset += record_size;
+    // Relocations are patched in place, so they must land inside the code.
+    auto relocations = reinterpret_cast<const X64Relocation*>(
+        reinterpret_cast<const InlinedRange*>(record + 1) +
+        record->inlined_count);
+    // Every call site is referenced by at least one relocation, and each
+    // call site index must be one of the sites that was recorded.
+    bool is_valid = record->call_site_count <= record->relocation_count;
+    for (uint32_t n = 0; is_valid && n < record->relocation_count; ++n) {
+      if (relocations[n].offset > record->code_size ||
+          record->code_size - relocations[n].offset < sizeof(uint64_t)) {
+        is_valid = false;
+      } else if (relocations[n].type ==
+                     X64RelocationType::INDIRECT_CALL_SITE &&
+                 (relocations[n].value >> 32) >= record->call_site_count) {
+        is_valid = false;
+      }
+    }
+    if (!is_valid) {
+      PLOGW("Dropping code cache record for %.8X: bad relocation",
+            record->guest_address);
+      continue;
+    }
+    // Later records replace earlier ones for the same function.
+    records_[MakeKey(record->module_hash, record->guest_address)] = record;
+  }
+  return 0;
+}
+
+int X64PersistentCache::LoadFunction(FunctionInfo* symbol_info,
+                                     Function** out_function) {
+  SCOPE_profile_cpu_f("alloy");
+
+  uint64_t module_hash = HashModule(symbol_info);
+  auto it = records_.find(MakeKey(module_hash, symbol_info->address()));
+  if (it == records_.end()) {
+    return 1;
+  }
+  auto record = it->second;
+  if (record->module_hash != module_hash ||
+      record->guest_address != symbol_info->address()) {
+    return 1;
+  }
+  if (symbol_info->has_end_address() &&
+      symbol_info->end_address() != record->guest_end_address) {
+    return 1;
+  }
+  auto module = symbol_info->module();
+  if (!module->ContainsAddress(record->guest_end_address)) {
+    return 1;
+  }
+  uint64_t guest_hash =
+      HashGuestCode(record->guest_address, record->guest_end_address, 0);
+  auto inlined_ranges = reinterpret_cast<const InlinedRange*>(record + 1);
+  for (uint32_t n = 0; n < record->inlined_count; ++n) {
+    auto& range = inlined_ranges[n];
+    if (!module->ContainsAddress(range.end_address)) {
+      return 1;
+    }
+    guest_hash = HashGuestCode(range.address, range.end_address, guest_hash);
+  }
+  if (guest_hash != record->guest_hash) {
+    // Guest code changed (or was patched) since it was cached.
+    return 1;
+  }
+
+  // Resolve everything up front so that a failure doesn't waste code cache
+  // space.
+  auto relocations = reinterpret_cast<const X64Relocation*>(
+      inlined_ranges + record->inlined_count);
+  auto code = reinterpret_cast<const uint8_t*>(relocations +
+                                               record->relocation_count);
+  std::vector<uint64_t> values(record->relocation_count);
+  std::vector<IndirectCallSite*> call_sites(record->call_site_count, nullptr);
+  for (uint32_t n = 0; n < record->relocation_count; ++n) {
+    if (ResolveRelocation(relocations[n], call_sites, &values[n])) {
+      backend_->FreeIndirectCallSites(call_sites);
+      return 1;
+    }
+  }
+  call_sites.erase(std::remove(call_sites.begin(), call_sites.end(), nullptr),
+                   call_sites.end());
+
+  // Placed code can't be written to directly, so relocate a copy.
+  std::vector<uint8_t> relocated_code(code, code + record->code_size);
+  for (uint32_t n = 0; n < record->relocation_count; ++n) {
+    poly::store<uint64_t>(relocated_code.data() + relocations[n].offset,
+                          values[n]);
+  }
+  auto code_cache = backend_->code_cache();
+  void* machine_code = code_cache->PlaceCode(
+      relocated_code.data(), record->code_size, record->stack_size);
+
+  if (!symbol_info->has_end_address()) {
+    symbol_info->set_end_address(record->guest_end_address);
+  }
+  X64Function* fn = new X64Function(symbol_info);
+  fn->Setup(machine_code, record->code_size);
+  fn->SetupIndirectCallSites(std::move(call_sites));
+  code_cache->CommitFunction(fn);
+
+  ++load_count_;
+  *out_function = fn;
+  return 0;
+}
+
+int X64PersistentCache::ResolveRelocation(
+    const X64Relocation& relocation, std::vector<IndirectCallSite*>& call_sites,
+    uint64_t* out_value) {
+  switch (relocation.type) {
+    case X64RelocationType::HOST_IMAGE:
+      *out_value = X64Emitter::host_image_anchor() + relocation.value;
+      return 0;
+    case X64RelocationType::GUEST_TO_HOST_THUNK:
+      *out_value = reinterpret_cast<uint64_t>(backend_->guest_to_host_thunk());
+      return 0;
+    case X64RelocationType::LINK_CALL_THUNK:
+      *out_value = reinterpret_cast<uint64_t>(backend_->link_call_thunk());
+      return 0;
+    case X64RelocationType::INDIRECTION_TABLE:
+      *out_value = reinterpret_cast<uint64_t>(
+                       backend_->code_cache()->indirection_table()) +
+                   relocation.value;
+      return 0;
+    case X64RelocationType::SYMBOL_INFO:
+    case X64RelocationType::EXTERN_HANDLER:
+    case X64RelocationType::EXTERN_ARG0:
+    case X64RelocationType::EXTERN_ARG1: {
+      FunctionInfo* target;
+      if (backend_->runtime()->LookupFunctionInfo(relocation.value, &target)) {
+        return 1;
+      }
+      if (relocation.type == X64RelocationType::SYMBOL_INFO) {
+        *out_value = reinterpret_cast<uint64_t>(target);
+        return 0;
+      }
+      if (target->behavior() != FunctionInfo::BEHAVIOR_EXTERN) {
+        return 1;
+      }
+      if (relocation.type == X64RelocationType::EXTERN_HANDLER) {
+        *out_value = reinterpret_cast<uint64_t>(target->extern_handler());
+      } else if (relocation.type == X64RelocationType::EXTERN_ARG0) {
+        *out_value = reinterpret_cast<uint64_t>(target->extern_arg0());
+      } else {
+        *out_value = reinterpret_cast<uint64_t>(target->extern_arg1());
+      }
+      return 0;
+    }
+    case X64RelocationType::INDIRECT_CALL_SITE: {
+      // Each site gets a fresh record; all references to it share it.
+      size_t index = static_cast<size_t>(relocation.value >> 32);
+      if (index >= call_sites.size()) {
+        return 1;
+      }
+      if (!call_sites[index]) {
+        auto call_site = backend_->AllocateIndirectCallSite();
+        call_site->ic_table_distance =
+            static_cast<uint32_t>(relocation.value & 0xFFFFFFFF);
+        call_sites[index] = call_site;
+      }
+      *out_value = reinterpret_cast<uint64_t>(call_sites[index]);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void X64PersistentCache::StoreFunction(
+    FunctionInfo* symbol_info, const void* machine_code, size_t code_size,
+    size_t stack_size, const std::vector<X64Relocation>& relocations,
+    const std::vector<hir::HIRBuilder::GuestRange>& inlined_ranges) {
+  if (!file_) {
+    return;
+  }
+
+  FunctionRecord record = {0};
+  record.module_hash = HashModule(symbol_info);
+  record.guest_hash =
+      HashGuestCode(symbol_info->address(), symbol_info->end_address(), 0);
+  std::vector<InlinedRange> ranges;
+  for (auto& range : inlined_ranges) {
+    ranges.push_back({static_cast<uint32_t>(range.address),
+                      static_cast<uint32_t>(range.end_address)});
+    record.guest_hash =
+        HashGuestCode(range.address, range.end_address, record.guest_hash);
+  }
+  record.guest_address = static_cast<uint32_t>(symbol_info->address());
+  record.guest_end_address = static_cast<uint32_t>(symbol_info->end_address());
+  record.code_size = static_cast<uint32_t>(code_size);
+  record.stack_size = static_cast<uint32_t>(stack_size);
+  record.relocation_count = static_cast<uint32_t>(relocations.size());
+  record.inlined_count = static_cast<uint32_t>(ranges.size());
+  for (auto& relocation : relocations) {
+    if (relocation.type == X64RelocationType::INDIRECT_CALL_SITE) {
+      record.call_site_count =
+          std::max(record.call_site_count,
+                   static_cast<uint32_t>(relocation.value >> 32) + 1);
+    }
+  }
+
+  // Placed code is always padded to 16b, so this doesn't read past the end.
+  std::lock_guard<std::mutex> guard(write_lock_);
+  fwrite(&record, sizeof(record), 1, file_);
+  fwrite(ranges.data(), sizeof(InlinedRange), ranges.size(), file_);
+  fwrite(relocations.data(), sizeof(X64Relocation), relocations.size(), file_);
+  fwrite(machine_code, 1, poly::round_up(code_size, 16), file_);
+  ++store_count_;
+}
+
+}  // namespace x64
+}  // namespace backend
+}  // namespace alloy
@@ -0,0 +1,128 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef ALLOY_BACKEND_X64_X64_PERSISTENT_CACHE_H_
+#define ALLOY_BACKEND_X64_X64_PERSISTENT_CACHE_H_
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <alloy/backend/x64/x64_emitter.h>
+#include <alloy/hir/hir_builder.h>
+#include <alloy/runtime/function.h>
+#include <alloy/runtime/symbol_info.h>
+#include <poly/mapped_memory.h>
+
+namespace alloy {
+namespace backend {
+namespace x64 {
+
+class X64Backend;
+struct IndirectCallSite;
+
+// On-disk cache of translated functions, so that warm launches can skip the
+// frontend, compiler and assembler for functions whose guest code has not
+// changed.
+//
+// Functions are keyed by module name and guest address and validated against
+// a hash of their guest instruction bytes, including those of any functions
+// inlined into them. The whole file is tied to a fingerprint of the build and
+// any options affecting codegen, and is thrown away if that changes. Host
+// addresses in the code are stored as relocations (see X64RelocationType) and
+// fixed up when the code is placed.
+//
+// File layout:
+//   FileHeader
+//   { FunctionRecord, InlinedRange[inlined_count],
+//     X64Relocation[relocation_count], code (16b padded) }*
+// New translations are appended as they are made. If a function changes, the
+// latest record for it wins.
+class X64PersistentCache {
+ public:
+  X64PersistentCache(X64Backend* backend);
+  ~X64PersistentCache();
+
+  int Initialize(const std::string& path);
+
+  // Places the cached translation of the given function, if there is a valid
+  // one. Returns 0 and a new function on success.
+  int LoadFunction(runtime::FunctionInfo* symbol_info,
+                   runtime::Function** out_function);
+
+  // Appends a freshly emitted function to the cache file.
+  void StoreFunction(runtime::FunctionInfo* symbol_info,
+                     const void* machine_code, size_t code_size,
+                     size_t stack_size,
+                     const std::vector<X64Relocation>& relocations,
+                     const std::vector<hir::HIRBuilder::GuestRange>&
+                         inlined_ranges);
+
+  uint32_t load_count() const { return load_count_; }
+  uint32_t store_count() const { return store_count_; }
+
+ private:
+  static const uint32_t kFileMagic = 0x31434358;  // 'XCC1'
+  static const uint32_t kFileVersion = 7;
+
+#pragma pack(push, 8)
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fingerprint;
+  };
+  struct FunctionRecord {
+    uint64_t module_hash;
+    uint64_t guest_hash;
+    uint32_t guest_address;
+    uint32_t guest_end_address;
+    uint32_t code_size;
+    uint32_t stack_size;
+    uint32_t relocation_count;
+    uint32_t inlined_count;
+    // Distinct INDIRECT_CALL_SITE indices referenced by the relocations.
+    uint32_t call_site_count;
+  };
+  struct InlinedRange {
+    uint32_t address;
+    uint32_t end_address;
+  };
+#pragma pack(pop)
+
+  uint64_t CalculateFingerprint(uint64_t image_hash);
+  uint64_t HashModule(runtime::FunctionInfo* symbol_info);
+  uint64_t HashGuestCode(uint64_t address, uint64_t end_address,
+                         uint64_t seed);
+  int ReadRecords();
+  int ResolveRelocation(const X64Relocation& relocation,
+                        std::vector<IndirectCallSite*>& call_sites,
+                        uint64_t* out_value);
+
+  X64Backend* backend_;
+  uint64_t fingerprint_;
+
+  std::unique_ptr<poly::MappedMemory> mapping_;
+  std::unordered_map<uint64_t, const FunctionRecord*> records_;
+
+  std::mutex write_lock_;
+  FILE* file_;
+
+  std::atomic<uint32_t> load_count_;
+  std::atomic<uint32_t> store_count_;
+};
+
+}  // namespace x64
+}  // namespace backend
+}  // namespace alloy
+
+#endif  // ALLOY_BACKEND_X64_X64_PERSISTENT_CACHE_H_
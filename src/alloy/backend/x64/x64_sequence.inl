@@ -432,10 +432,10 @@ protected:
   template <typename SEQ, typename... Ti> friend struct Sequence;
   bool Check(const Instr* i, TagTable& tag_table, const Instr** new_tail) {
     if (SequenceFields<I1>::Check(i, tag_table, new_tail)) {
-      auto ni = i->next;
+      auto ni = *new_tail;
       if (ni && i2.Load(ni, tag_table)) {
-        *new_tail = ni;
-        return i;
+        *new_tail = ni->next;
+        return true;
       }
     }
     return false;
@@ -448,10 +448,10 @@ protected:
   template <typename SEQ, typename... Ti> friend struct Sequence;
   bool Check(const Instr* i, TagTable& tag_table, const Instr** new_tail) {
     if (SequenceFields<I1, I2>::Check(i, tag_table, new_tail)) {
-      auto ni = i->next;
+      auto ni = *new_tail;
       if (ni && i3.Load(ni, tag_table)) {
-        *new_tail = ni;
-        return i;
+        *new_tail = ni->next;
+        return true;
       }
     }
     return false;
@@ -464,10 +464,10 @@ protected:
   template <typename SEQ, typename... Ti> friend struct Sequence;
   bool Check(const Instr* i, TagTable& tag_table, const Instr** new_tail) {
     if (SequenceFields<I1, I2, I3>::Check(i, tag_table, new_tail)) {
-      auto ni = i->next;
+      auto ni = *new_tail;
       if (ni && i4.Load(ni, tag_table)) {
-        *new_tail = ni;
-        return i;
+        *new_tail = ni->next;
+        return true;
       }
     }
     return false;
@@ -480,10 +480,10 @@ protected:
   template <typename SEQ, typename... Ti> friend struct Sequence;
   bool Check(const Instr* i, TagTable& tag_table, const Instr** new_tail) {
     if (SequenceFields<I1, I2, I3, I4>::Check(i, tag_table, new_tail)) {
-      auto ni = i->next;
+      auto ni = *new_tail;
       if (ni && i5.Load(ni, tag_table)) {
-        *new_tail = ni;
-        return i;
+        *new_tail = ni->next;
+        return true;
       }
     }
     return false;
@@ -494,10 +494,21 @@ template <typename SEQ, typename... Ti>
 struct Sequence {
   struct EmitArgs : SequenceFields<Ti...> {};
 
+  // TODO(benvanik): find a way to do this cross-compiler.
+#if XE_COMPILER_MSVC
+  static uint32_t head_key() { return decltype(EmitArgs::i1)::key; }
+#else
+  static constexpr uint32_t head_key() { return decltype(EmitArgs::i1)::key; }
+#endif  // XE_COMPILER_MSVC
+
+  // Sequences can hide this to turn down a match, such as when the host
+  // lacks the instructions they use. The next sequence is tried instead.
+  static bool CanEmit(X64Emitter& e, const EmitArgs& _) { return true; }
+
   static bool Select(X64Emitter& e, const Instr* i, const Instr** new_tail) {
     EmitArgs args;
-    TagTable tag_table;
-    if (!args.Check(i, tag_table, new_tail)) {
+    TagTable tag_table = {};
+    if (!args.Check(i, tag_table, new_tail) || !SEQ::CanEmit(e, args)) {
       return false;
     }
     SEQ::Emit(e, args);
@@ -737,9 +748,11 @@ static const tag_t TAG5 = 5;
 static const tag_t TAG6 = 6;
 static const tag_t TAG7 = 7;
 
+// Sequences with the same head are tried in the order they're registered, so
+// multi-instruction ones must come before the single ones they overlap.
 template <typename T>
 void Register() {
-  sequence_table.insert({ T::head_key(), T::Select });
+  sequence_table[T::head_key()].push_back(T::Select);
 }
 template <typename T, typename Tn, typename... Ts>
 void Register() {
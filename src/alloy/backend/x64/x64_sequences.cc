@@ -40,7 +40,7 @@ using namespace alloy::hir;
 using namespace alloy::runtime;
 
 typedef bool (*SequenceSelectFn)(X64Emitter&, const Instr*, const Instr**);
-std::unordered_multimap<uint32_t, SequenceSelectFn> sequence_table;
+std::unordered_map<uint32_t, std::vector<SequenceSelectFn>> sequence_table;
 
 // Utilities/types used only in this file:
 #include <alloy/backend/x64/x64_sequence.inl>
@@ -634,37 +634,52 @@ EMITTER_OPCODE_TABLE(
 // ============================================================================
 EMITTER(ASSIGN_I8, MATCH(I<OPCODE_ASSIGN, I8<>, I8<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.mov(i.dest, i.src1);
+    // Usually coalesced away by the register allocator.
+    if (i.dest != i.src1) {
+      e.mov(i.dest, i.src1);
+    }
   }
 };
 EMITTER(ASSIGN_I16, MATCH(I<OPCODE_ASSIGN, I16<>, I16<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.mov(i.dest, i.src1);
+    if (i.dest != i.src1) {
+      e.mov(i.dest, i.src1);
+    }
   }
 };
 EMITTER(ASSIGN_I32, MATCH(I<OPCODE_ASSIGN, I32<>, I32<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.mov(i.dest, i.src1);
+    if (i.dest != i.src1) {
+      e.mov(i.dest, i.src1);
+    }
   }
 };
 EMITTER(ASSIGN_I64, MATCH(I<OPCODE_ASSIGN, I64<>, I64<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.mov(i.dest, i.src1);
+    if (i.dest != i.src1) {
+      e.mov(i.dest, i.src1);
+    }
   }
 };
 EMITTER(ASSIGN_F32, MATCH(I<OPCODE_ASSIGN, F32<>, F32<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.vmovaps(i.dest, i.src1);
+    if (i.dest != i.src1) {
+      e.vmovaps(i.dest, i.src1);
+    }
   }
 };
 EMITTER(ASSIGN_F64, MATCH(I<OPCODE_ASSIGN, F64<>, F64<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.vmovaps(i.dest, i.src1);
+    if (i.dest != i.src1) {
+      e.vmovaps(i.dest, i.src1);
+    }
   }
 };
 EMITTER(ASSIGN_V128, MATCH(I<OPCODE_ASSIGN, V128<>, V128<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.vmovaps(i.dest, i.src1);
+    if (i.dest != i.src1) {
+      e.vmovaps(i.dest, i.src1);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(
@@ -1017,14 +1032,14 @@ EMITTER(LOAD_VECTOR_SHL_I8, MATCH(I<OPCODE_LOAD_VECTOR_SHL, V128<>, I8<>>)) {
     if (i.src1.is_constant) {
       auto sh = i.src1.constant();
       assert_true(sh < poly::countof(lvsl_table));
-      e.mov(e.rax, (uintptr_t)&lvsl_table[sh]);
+      e.MovHostAddress(e.rax, &lvsl_table[sh]);
       e.vmovaps(i.dest, e.ptr[e.rax]);
     } else {
       // TODO(benvanik): find a cheaper way of doing this.
       e.movzx(e.rdx, i.src1);
       e.and(e.dx, 0xF);
       e.shl(e.dx, 4);
-      e.mov(e.rax, (uintptr_t)lvsl_table);
+      e.MovHostAddress(e.rax, lvsl_table);
       e.vmovaps(i.dest, e.ptr[e.rax + e.rdx]);
       e.ReloadEDX();
     }
@@ -1061,14 +1076,14 @@ EMITTER(LOAD_VECTOR_SHR_I8, MATCH(I<OPCODE_LOAD_VECTOR_SHR, V128<>, I8<>>)) {
     if (i.src1.is_constant) {
       auto sh = i.src1.constant();
       assert_true(sh < poly::countof(lvsr_table));
-      e.mov(e.rax, (uintptr_t)&lvsr_table[sh]);
+      e.MovHostAddress(e.rax, &lvsr_table[sh]);
       e.vmovaps(i.dest, e.ptr[e.rax]);
     } else {
       // TODO(benvanik): find a cheaper way of doing this.
       e.movzx(e.rdx, i.src1);
       e.and(e.dx, 0xF);
       e.shl(e.dx, 4);
-      e.mov(e.rax, (uintptr_t)lvsr_table);
+      e.MovHostAddress(e.rax, lvsr_table);
       e.vmovaps(i.dest, e.ptr[e.rax + e.rdx]);
       e.ReloadEDX();
     }
@@ -1524,8 +1539,64 @@ EMITTER(LOAD_V128, MATCH(I<OPCODE_LOAD, V128<>, I64<>>)) {
     }
   }
 };
+// The frontend swaps nearly every guest load, and with movbe the load and swap
+// are one instruction. Only if nothing else wants the value as loaded.
+bool IsSingleUse(const Value* value) {
+  return value->use_head && !value->use_head->next;
+}
+SEQUENCE(LOAD_BYTE_SWAP_I16, MATCH(
+    I<OPCODE_LOAD, I16<TAG0>, I64<>>,
+    I<OPCODE_BYTE_SWAP, I16<>, I16<TAG0>>)) {
+  static bool CanEmit(X64Emitter& e, const EmitArgs& _) {
+    return e.IsFeatureEnabled(EMIT_MOVBE) && IsSingleUse(_.i1.dest.value);
+  }
+  static void Emit(X64Emitter& e, const EmitArgs& _) {
+    auto addr = ComputeMemoryAddress(e, _.i1.src1);
+    e.movbe(_.i2.dest, e.word[addr]);
+    if (IsTracingData()) {
+      e.mov(e.r8w, e.word[addr]);
+      e.lea(e.rdx, e.ptr[addr]);
+      e.CallNative(reinterpret_cast<void*>(TraceMemoryLoadI16));
+    }
+  }
+};
+SEQUENCE(LOAD_BYTE_SWAP_I32, MATCH(
+    I<OPCODE_LOAD, I32<TAG0>, I64<>>,
+    I<OPCODE_BYTE_SWAP, I32<>, I32<TAG0>>)) {
+  static bool CanEmit(X64Emitter& e, const EmitArgs& _) {
+    return e.IsFeatureEnabled(EMIT_MOVBE) && IsSingleUse(_.i1.dest.value);
+  }
+  static void Emit(X64Emitter& e, const EmitArgs& _) {
+    auto addr = ComputeMemoryAddress(e, _.i1.src1);
+    e.movbe(_.i2.dest, e.dword[addr]);
+    if (IsTracingData()) {
+      e.mov(e.r8d, e.dword[addr]);
+      e.lea(e.rdx, e.ptr[addr]);
+      e.CallNative(reinterpret_cast<void*>(TraceMemoryLoadI32));
+    }
+  }
+};
+SEQUENCE(LOAD_BYTE_SWAP_I64, MATCH(
+    I<OPCODE_LOAD, I64<TAG0>, I64<>>,
+    I<OPCODE_BYTE_SWAP, I64<>, I64<TAG0>>)) {
+  static bool CanEmit(X64Emitter& e, const EmitArgs& _) {
+    return e.IsFeatureEnabled(EMIT_MOVBE) && IsSingleUse(_.i1.dest.value);
+  }
+  static void Emit(X64Emitter& e, const EmitArgs& _) {
+    auto addr = ComputeMemoryAddress(e, _.i1.src1);
+    e.movbe(_.i2.dest, e.qword[addr]);
+    if (IsTracingData()) {
+      e.mov(e.r8, e.qword[addr]);
+      e.lea(e.rdx, e.ptr[addr]);
+      e.CallNative(reinterpret_cast<void*>(TraceMemoryLoadI64));
+    }
+  }
+};
 EMITTER_OPCODE_TABLE(
     OPCODE_LOAD,
+    LOAD_BYTE_SWAP_I16,
+    LOAD_BYTE_SWAP_I32,
+    LOAD_BYTE_SWAP_I64,
     LOAD_I8,
     LOAD_I16,
     LOAD_I32,
@@ -1539,15 +1610,6 @@ EMITTER_OPCODE_TABLE(
 // OPCODE_STORE
 // ============================================================================
 // Note: most *should* be aligned, but needs to be checked!
-void EmitMarkPageDirty(X64Emitter& e, RegExp& addr) {
-  // 16KB pages.
-  auto page_table_address = e.page_table_address();
-  if (page_table_address) {
-    e.shr(e.eax, 14);
-    e.and(e.eax, 0x7FFF);
-    e.mov(e.byte[e.rdx + e.rax + page_table_address], 1);
-  }
-}
 EMITTER(STORE_I8, MATCH(I<OPCODE_STORE, VoidOp, I64<>, I8<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     auto addr = ComputeMemoryAddress(e, i.src1);
@@ -1556,7 +1618,6 @@ EMITTER(STORE_I8, MATCH(I<OPCODE_STORE, VoidOp, I64<>, I8<>>)) {
     } else {
       e.mov(e.byte[addr], i.src2);
     }
-    EmitMarkPageDirty(e, addr);
     if (IsTracingData()) {
       auto addr = ComputeMemoryAddress(e, i.src1);
       e.mov(e.r8b, e.byte[addr]);
@@ -1573,7 +1634,6 @@ EMITTER(STORE_I16, MATCH(I<OPCODE_STORE, VoidOp, I64<>, I16<>>)) {
     } else {
       e.mov(e.word[addr], i.src2);
     }
-    EmitMarkPageDirty(e, addr);
     if (IsTracingData()) {
       auto addr = ComputeMemoryAddress(e, i.src1);
       e.mov(e.r8w, e.word[addr]);
@@ -1590,7 +1650,6 @@ EMITTER(STORE_I32, MATCH(I<OPCODE_STORE, VoidOp, I64<>, I32<>>)) {
     } else {
       e.mov(e.dword[addr], i.src2);
     }
-    EmitMarkPageDirty(e, addr);
     if (IsTracingData()) {
       auto addr = ComputeMemoryAddress(e, i.src1);
       e.mov(e.r8d, e.dword[addr]);
@@ -1607,7 +1666,6 @@ EMITTER(STORE_I64, MATCH(I<OPCODE_STORE, VoidOp, I64<>, I64<>>)) {
     } else {
       e.mov(e.qword[addr], i.src2);
     }
-    EmitMarkPageDirty(e, addr);
     if (IsTracingData()) {
       auto addr = ComputeMemoryAddress(e, i.src1);
       e.mov(e.r8, e.qword[addr]);
@@ -1624,7 +1682,6 @@ EMITTER(STORE_F32, MATCH(I<OPCODE_STORE, VoidOp, I64<>, F32<>>)) {
     } else {
       e.vmovss(e.dword[addr], i.src2);
     }
-    EmitMarkPageDirty(e, addr);
     if (IsTracingData()) {
       auto addr = ComputeMemoryAddress(e, i.src1);
       e.lea(e.r8, e.ptr[addr]);
@@ -1641,7 +1698,6 @@ EMITTER(STORE_F64, MATCH(I<OPCODE_STORE, VoidOp, I64<>, F64<>>)) {
     } else {
       e.vmovsd(e.qword[addr], i.src2);
     }
-    EmitMarkPageDirty(e, addr);
     if (IsTracingData()) {
       auto addr = ComputeMemoryAddress(e, i.src1);
       e.lea(e.r8, e.ptr[addr]);
@@ -1659,7 +1715,6 @@ EMITTER(STORE_V128, MATCH(I<OPCODE_STORE, VoidOp, I64<>, V128<>>)) {
     } else {
       e.vmovaps(e.ptr[addr], i.src2);
     }
-    EmitMarkPageDirty(e, addr);
     if (IsTracingData()) {
       auto addr = ComputeMemoryAddress(e, i.src1);
       e.lea(e.r8, e.ptr[addr]);
@@ -2007,7 +2062,7 @@ EMITTER(SELECT_V128_I8, MATCH(I<OPCODE_SELECT, V128<>, I8<>, V128<>, V128<>>)) {
     // xmm0 = src1 != 0 ? 1111... : 0000....
     e.movzx(e.eax, i.src1);
     e.vmovd(e.xmm1, e.eax);
-    e.vpbroadcastd(e.xmm1, e.xmm1);
+    e.vpshufd(e.xmm1, e.xmm1, 0);
     e.vxorps(e.xmm0, e.xmm0);
     e.vcmpneqps(e.xmm0, e.xmm1);
     e.vpand(e.xmm1, e.xmm0, i.src2);
@@ -2163,6 +2218,245 @@ EMITTER_OPCODE_TABLE(
     IS_FALSE_V128);
 
 
+// ============================================================================
+// OPCODE_COMPARE_* + OPCODE_BRANCH_TRUE/OPCODE_BRANCH_FALSE
+// ============================================================================
+// Branching on a compare result directly off the host flags, instead of
+// setcc'ing it into a register and testing that. CompareSinkingPass puts the
+// compare (and a context store of it, for CR bits) right before the branch.
+enum CompareCond {
+  COMPARE_COND_EQ,
+  COMPARE_COND_NE,
+  COMPARE_COND_SLT,
+  COMPARE_COND_SLE,
+  COMPARE_COND_SGT,
+  COMPARE_COND_SGE,
+  COMPARE_COND_ULT,
+  COMPARE_COND_ULE,
+  COMPARE_COND_UGT,
+  COMPARE_COND_UGE,
+};
+// Condition with the operands exchanged.
+CompareCond SwapCompareCond(CompareCond cond) {
+  switch (cond) {
+    case COMPARE_COND_SLT: return COMPARE_COND_SGT;
+    case COMPARE_COND_SLE: return COMPARE_COND_SGE;
+    case COMPARE_COND_SGT: return COMPARE_COND_SLT;
+    case COMPARE_COND_SGE: return COMPARE_COND_SLE;
+    case COMPARE_COND_ULT: return COMPARE_COND_UGT;
+    case COMPARE_COND_ULE: return COMPARE_COND_UGE;
+    case COMPARE_COND_UGT: return COMPARE_COND_ULT;
+    case COMPARE_COND_UGE: return COMPARE_COND_ULE;
+    default: return cond;
+  }
+}
+// Condition that is true when the original is false.
+CompareCond InvertCompareCond(CompareCond cond) {
+  switch (cond) {
+    case COMPARE_COND_EQ: return COMPARE_COND_NE;
+    case COMPARE_COND_NE: return COMPARE_COND_EQ;
+    case COMPARE_COND_SLT: return COMPARE_COND_SGE;
+    case COMPARE_COND_SLE: return COMPARE_COND_SGT;
+    case COMPARE_COND_SGT: return COMPARE_COND_SLE;
+    case COMPARE_COND_SGE: return COMPARE_COND_SLT;
+    case COMPARE_COND_ULT: return COMPARE_COND_UGE;
+    case COMPARE_COND_ULE: return COMPARE_COND_UGT;
+    case COMPARE_COND_UGT: return COMPARE_COND_ULE;
+    case COMPARE_COND_UGE: return COMPARE_COND_ULT;
+    default: assert_unhandled_case(cond); return cond;
+  }
+}
+void EmitSetCompareCond(X64Emitter& e, CompareCond cond,
+                        const Operand& dest) {
+  switch (cond) {
+    case COMPARE_COND_EQ: e.sete(dest); break;
+    case COMPARE_COND_NE: e.setne(dest); break;
+    case COMPARE_COND_SLT: e.setl(dest); break;
+    case COMPARE_COND_SLE: e.setle(dest); break;
+    case COMPARE_COND_SGT: e.setg(dest); break;
+    case COMPARE_COND_SGE: e.setge(dest); break;
+    case COMPARE_COND_ULT: e.setb(dest); break;
+    case COMPARE_COND_ULE: e.setbe(dest); break;
+    case COMPARE_COND_UGT: e.seta(dest); break;
+    case COMPARE_COND_UGE: e.setae(dest); break;
+  }
+}
+void EmitJumpCompareCond(X64Emitter& e, CompareCond cond, const char* label) {
+  switch (cond) {
+    case COMPARE_COND_EQ: e.je(label, e.T_NEAR); break;
+    case COMPARE_COND_NE: e.jne(label, e.T_NEAR); break;
+    case COMPARE_COND_SLT: e.jl(label, e.T_NEAR); break;
+    case COMPARE_COND_SLE: e.jle(label, e.T_NEAR); break;
+    case COMPARE_COND_SGT: e.jg(label, e.T_NEAR); break;
+    case COMPARE_COND_SGE: e.jge(label, e.T_NEAR); break;
+    case COMPARE_COND_ULT: e.jb(label, e.T_NEAR); break;
+    case COMPARE_COND_ULE: e.jbe(label, e.T_NEAR); break;
+    case COMPARE_COND_UGT: e.ja(label, e.T_NEAR); break;
+    case COMPARE_COND_UGE: e.jae(label, e.T_NEAR); break;
+  }
+}
+// Sets the host flags for the compare and returns the condition to test
+// them with, which differs from cond if the operands had to be swapped.
+template <typename SRC>
+CompareCond EmitFusedCompare(X64Emitter& e, const SRC& src1, const SRC& src2,
+                             CompareCond cond) {
+  typedef typename SRC::reg_type REG;
+  if (src1.is_constant) {
+    assert_true(!src2.is_constant);
+    if (src1.ConstantFitsIn32Reg()) {
+      e.cmp(src2.reg(), static_cast<int32_t>(src1.constant()));
+    } else {
+      auto temp = GetTempReg<REG>(e);
+      e.mov(temp, src1.constant());
+      e.cmp(src2.reg(), temp);
+    }
+    return SwapCompareCond(cond);
+  } else if (src2.is_constant) {
+    if (src2.ConstantFitsIn32Reg()) {
+      e.cmp(src1.reg(), static_cast<int32_t>(src2.constant()));
+    } else {
+      auto temp = GetTempReg<REG>(e);
+      e.mov(temp, src2.constant());
+      e.cmp(src1.reg(), temp);
+    }
+  } else {
+    e.cmp(src1.reg(), src2.reg());
+  }
+  return cond;
+}
+// vcomiss/vcomisd set the flags like an unsigned compare, with unordered
+// operands reading as less than, as in the setcc sequences.
+CompareCond GetFloatCompareCond(CompareCond cond) {
+  switch (cond) {
+    case COMPARE_COND_SLT: return COMPARE_COND_ULT;
+    case COMPARE_COND_SLE: return COMPARE_COND_ULE;
+    case COMPARE_COND_SGT: return COMPARE_COND_UGT;
+    case COMPARE_COND_SGE: return COMPARE_COND_UGE;
+    default: return cond;
+  }
+}
+template <int TAG>
+CompareCond EmitFusedCompare(X64Emitter& e, const F32<TAG>& src1,
+                             const F32<TAG>& src2, CompareCond cond) {
+  if (src1.is_constant) {
+    e.LoadConstantXmm(e.xmm0, src1.constant());
+    e.vcomiss(e.xmm0, src2.reg());
+  } else if (src2.is_constant) {
+    e.LoadConstantXmm(e.xmm0, src2.constant());
+    e.vcomiss(src1.reg(), e.xmm0);
+  } else {
+    e.vcomiss(src1.reg(), src2.reg());
+  }
+  return GetFloatCompareCond(cond);
+}
+template <int TAG>
+CompareCond EmitFusedCompare(X64Emitter& e, const F64<TAG>& src1,
+                             const F64<TAG>& src2, CompareCond cond) {
+  if (src1.is_constant) {
+    e.LoadConstantXmm(e.xmm0, src1.constant());
+    e.vcomisd(e.xmm0, src2.reg());
+  } else if (src2.is_constant) {
+    e.LoadConstantXmm(e.xmm0, src2.constant());
+    e.vcomisd(src1.reg(), e.xmm0);
+  } else {
+    e.vcomisd(src1.reg(), src2.reg());
+  }
+  return GetFloatCompareCond(cond);
+}
+// The compare result is only materialized if something besides the branch
+// (and the context store, which gets it straight from the flags) uses it.
+template <typename COMPARE>
+CompareCond EmitFusedCompareDest(X64Emitter& e, const COMPARE& compare,
+                                 CompareCond cond, uint32_t fused_use_count) {
+  cond = EmitFusedCompare(e, compare.src1, compare.src2, cond);
+  uint32_t use_count = 0;
+  for (auto use = compare.dest.value->use_head; use; use = use->next) {
+    ++use_count;
+  }
+  if (use_count > fused_use_count) {
+    EmitSetCompareCond(e, cond, compare.dest.reg());
+  }
+  return cond;
+}
+#define SEQUENCE_COMPARE_BRANCH(op, type) \
+    SEQUENCE(COMPARE_##op##_##type##_BRANCH_TRUE, MATCH( \
+        I<OPCODE_COMPARE_##op, I8<TAG0>, type<>, type<>>, \
+        I<OPCODE_BRANCH_TRUE, VoidOp, I8<TAG0>, LabelOp>)) { \
+      static void Emit(X64Emitter& e, const EmitArgs& _) { \
+        auto cond = EmitFusedCompareDest(e, _.i1, COMPARE_COND_##op, 1); \
+        EmitJumpCompareCond(e, cond, _.i2.src2.value->name); \
+      } \
+    }; \
+    SEQUENCE(COMPARE_##op##_##type##_BRANCH_FALSE, MATCH( \
+        I<OPCODE_COMPARE_##op, I8<TAG0>, type<>, type<>>, \
+        I<OPCODE_BRANCH_FALSE, VoidOp, I8<TAG0>, LabelOp>)) { \
+      static void Emit(X64Emitter& e, const EmitArgs& _) { \
+        auto cond = EmitFusedCompareDest(e, _.i1, COMPARE_COND_##op, 1); \
+        EmitJumpCompareCond(e, InvertCompareCond(cond), \
+                            _.i2.src2.value->name); \
+      } \
+    }; \
+    SEQUENCE(COMPARE_##op##_##type##_STORE_BRANCH_TRUE, MATCH( \
+        I<OPCODE_COMPARE_##op, I8<TAG0>, type<>, type<>>, \
+        I<OPCODE_STORE_CONTEXT, VoidOp, OffsetOp, I8<TAG0>>, \
+        I<OPCODE_BRANCH_TRUE, VoidOp, I8<TAG0>, LabelOp>)) { \
+      static bool CanEmit(X64Emitter& e, const EmitArgs& _) { \
+        return !IsTracingData(); \
+      } \
+      static void Emit(X64Emitter& e, const EmitArgs& _) { \
+        auto cond = EmitFusedCompareDest(e, _.i1, COMPARE_COND_##op, 2); \
+        EmitSetCompareCond(e, cond, \
+                           e.byte[ComputeContextAddress(e, _.i2.src1)]); \
+        EmitJumpCompareCond(e, cond, _.i3.src2.value->name); \
+      } \
+    }; \
+    SEQUENCE(COMPARE_##op##_##type##_STORE_BRANCH_FALSE, MATCH( \
+        I<OPCODE_COMPARE_##op, I8<TAG0>, type<>, type<>>, \
+        I<OPCODE_STORE_CONTEXT, VoidOp, OffsetOp, I8<TAG0>>, \
+        I<OPCODE_BRANCH_FALSE, VoidOp, I8<TAG0>, LabelOp>)) { \
+      static bool CanEmit(X64Emitter& e, const EmitArgs& _) { \
+        return !IsTracingData(); \
+      } \
+      static void Emit(X64Emitter& e, const EmitArgs& _) { \
+        auto cond = EmitFusedCompareDest(e, _.i1, COMPARE_COND_##op, 2); \
+        EmitSetCompareCond(e, cond, \
+                           e.byte[ComputeContextAddress(e, _.i2.src1)]); \
+        EmitJumpCompareCond(e, InvertCompareCond(cond), \
+                            _.i3.src2.value->name); \
+      } \
+    };
+#define SEQUENCE_COMPARE_BRANCH_NAMES(op, type) \
+    COMPARE_##op##_##type##_STORE_BRANCH_TRUE, \
+    COMPARE_##op##_##type##_STORE_BRANCH_FALSE, \
+    COMPARE_##op##_##type##_BRANCH_TRUE, \
+    COMPARE_##op##_##type##_BRANCH_FALSE
+#define SEQUENCE_COMPARE_BRANCH_XX(op) \
+    SEQUENCE_COMPARE_BRANCH(op, I8); \
+    SEQUENCE_COMPARE_BRANCH(op, I16); \
+    SEQUENCE_COMPARE_BRANCH(op, I32); \
+    SEQUENCE_COMPARE_BRANCH(op, I64); \
+    SEQUENCE_COMPARE_BRANCH(op, F32); \
+    SEQUENCE_COMPARE_BRANCH(op, F64); \
+    EMITTER_OPCODE_TABLE( \
+        OPCODE_COMPARE_##op##_BRANCH, \
+        SEQUENCE_COMPARE_BRANCH_NAMES(op, I8), \
+        SEQUENCE_COMPARE_BRANCH_NAMES(op, I16), \
+        SEQUENCE_COMPARE_BRANCH_NAMES(op, I32), \
+        SEQUENCE_COMPARE_BRANCH_NAMES(op, I64), \
+        SEQUENCE_COMPARE_BRANCH_NAMES(op, F32), \
+        SEQUENCE_COMPARE_BRANCH_NAMES(op, F64));
+SEQUENCE_COMPARE_BRANCH_XX(EQ);
+SEQUENCE_COMPARE_BRANCH_XX(NE);
+SEQUENCE_COMPARE_BRANCH_XX(SLT);
+SEQUENCE_COMPARE_BRANCH_XX(SLE);
+SEQUENCE_COMPARE_BRANCH_XX(SGT);
+SEQUENCE_COMPARE_BRANCH_XX(SGE);
+SEQUENCE_COMPARE_BRANCH_XX(ULT);
+SEQUENCE_COMPARE_BRANCH_XX(ULE);
+SEQUENCE_COMPARE_BRANCH_XX(UGT);
+SEQUENCE_COMPARE_BRANCH_XX(UGE);
+
+
 // ============================================================================
 // OPCODE_COMPARE_EQ
 // ============================================================================
@@ -2364,31 +2658,54 @@ EMITTER_ASSOCIATIVE_COMPARE_FLT_XX(UGE, setae);
 // ============================================================================
 // TODO(benvanik): salc/setalc
 // https://code.google.com/p/corkami/wiki/x86oddities
+// did_carry is paired with the instruction before it, so if that is the
+// add/sub whose carry it reads, CF is still in the host flags and neither side
+// needs to go through the eflags stash.
+bool IsCarryReadNext(const Instr* i) {
+  if (!i || !(i->flags & ARITHMETIC_SET_CARRY)) {
+    return false;
+  }
+  if (i->opcode != &OPCODE_ADD_info && i->opcode != &OPCODE_ADD_CARRY_info &&
+      i->opcode != &OPCODE_SUB_info) {
+    return false;
+  }
+  auto next = i->next;
+  return next && next->opcode == &OPCODE_DID_CARRY_info &&
+         next->src1.value == i->dest;
+}
 EMITTER(DID_CARRY_I8, MATCH(I<OPCODE_DID_CARRY, I8<>, I8<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     assert_true(!i.src1.is_constant);
-    e.LoadEflags();
+    if (!IsCarryReadNext(i.instr->prev)) {
+      e.LoadEflags();
+    }
     e.setc(i.dest);
   }
 };
 EMITTER(DID_CARRY_I16, MATCH(I<OPCODE_DID_CARRY, I8<>, I16<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     assert_true(!i.src1.is_constant);
-    e.LoadEflags();
+    if (!IsCarryReadNext(i.instr->prev)) {
+      e.LoadEflags();
+    }
     e.setc(i.dest);
   }
 };
 EMITTER(DID_CARRY_I32, MATCH(I<OPCODE_DID_CARRY, I8<>, I32<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     assert_true(!i.src1.is_constant);
-    e.LoadEflags();
+    if (!IsCarryReadNext(i.instr->prev)) {
+      e.LoadEflags();
+    }
     e.setc(i.dest);
   }
 };
 EMITTER(DID_CARRY_I64, MATCH(I<OPCODE_DID_CARRY, I8<>, I64<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     assert_true(!i.src1.is_constant);
-    e.LoadEflags();
+    if (!IsCarryReadNext(i.instr->prev)) {
+      e.LoadEflags();
+    }
     e.setc(i.dest);
   }
 };
@@ -2646,7 +2963,7 @@ void EmitAddXX(X64Emitter& e, const ARGS& i) {
       e, i,
       [](X64Emitter& e, const REG& dest_src, const REG& src) { e.add(dest_src, src); },
       [](X64Emitter& e, const REG& dest_src, int32_t constant) { e.add(dest_src, constant); });
-  if (i.instr->flags & ARITHMETIC_SET_CARRY) {
+  if (i.instr->flags & ARITHMETIC_SET_CARRY && !IsCarryReadNext(i.instr)) {
     // CF is set if carried.
     e.StoreEflags();
   }
@@ -2737,7 +3054,7 @@ void EmitAddCarryXX(X64Emitter& e, const ARGS& i) {
       e.adc(dest_src, constant);
     });
   }
-  if (i.instr->flags & ARITHMETIC_SET_CARRY) {
+  if (i.instr->flags & ARITHMETIC_SET_CARRY && !IsCarryReadNext(i.instr)) {
     // CF is set if carried.
     e.StoreEflags();
   }
@@ -2945,7 +3262,9 @@ void EmitSubXX(X64Emitter& e, const ARGS& i) {
           e.stc();
           e.adc(dest_src, temp);
         });
-    e.StoreEflags();
+    if (!IsCarryReadNext(i.instr)) {
+      e.StoreEflags();
+    }
   } else {
     SEQ::EmitAssociativeBinaryOp(
         e, i,
@@ -3535,6 +3854,12 @@ EMITTER_OPCODE_TABLE(
 // perhaps use other 132/213/etc
 EMITTER(MUL_ADD_F32, MATCH(I<OPCODE_MUL_ADD, F32<>, F32<>, F32<>, F32<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    if (!e.IsFeatureEnabled(EMIT_FMA)) {
+      // Not fused, so the product is rounded first.
+      e.vmulss(e.xmm0, i.src1, i.src2);
+      e.vaddss(i.dest, e.xmm0, i.src3);
+      return;
+    }
     if (i.dest == i.src1) {
       e.vfmadd213ss(i.dest, i.src2, i.src3);
     } else {
@@ -3551,6 +3876,11 @@ EMITTER(MUL_ADD_F32, MATCH(I<OPCODE_MUL_ADD, F32<>, F32<>, F32<>, F32<>>)) {
 };
 EMITTER(MUL_ADD_F64, MATCH(I<OPCODE_MUL_ADD, F64<>, F64<>, F64<>, F64<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    if (!e.IsFeatureEnabled(EMIT_FMA)) {
+      e.vmulsd(e.xmm0, i.src1, i.src2);
+      e.vaddsd(i.dest, e.xmm0, i.src3);
+      return;
+    }
     if (i.dest == i.src1) {
       e.vfmadd213sd(i.dest, i.src2, i.src3);
     } else {
@@ -3567,6 +3897,11 @@ EMITTER(MUL_ADD_F64, MATCH(I<OPCODE_MUL_ADD, F64<>, F64<>, F64<>, F64<>>)) {
 };
 EMITTER(MUL_ADD_V128, MATCH(I<OPCODE_MUL_ADD, V128<>, V128<>, V128<>, V128<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    if (!e.IsFeatureEnabled(EMIT_FMA)) {
+      e.vmulps(e.xmm0, i.src1, i.src2);
+      e.vaddps(i.dest, e.xmm0, i.src3);
+      return;
+    }
     if (i.dest == i.src1) {
       e.vfmadd213ps(i.dest, i.src2, i.src3);
     } else {
@@ -3598,6 +3933,11 @@ EMITTER_OPCODE_TABLE(
 // perhaps use other 132/213/etc
 EMITTER(MUL_SUB_F32, MATCH(I<OPCODE_MUL_SUB, F32<>, F32<>, F32<>, F32<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    if (!e.IsFeatureEnabled(EMIT_FMA)) {
+      e.vmulss(e.xmm0, i.src1, i.src2);
+      e.vsubss(i.dest, e.xmm0, i.src3);
+      return;
+    }
     if (i.dest == i.src1) {
       e.vfmsub213ss(i.dest, i.src2, i.src3);
     } else {
@@ -3614,6 +3954,11 @@ EMITTER(MUL_SUB_F32, MATCH(I<OPCODE_MUL_SUB, F32<>, F32<>, F32<>, F32<>>)) {
 };
 EMITTER(MUL_SUB_F64, MATCH(I<OPCODE_MUL_SUB, F64<>, F64<>, F64<>, F64<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    if (!e.IsFeatureEnabled(EMIT_FMA)) {
+      e.vmulsd(e.xmm0, i.src1, i.src2);
+      e.vsubsd(i.dest, e.xmm0, i.src3);
+      return;
+    }
     if (i.dest == i.src1) {
       e.vfmsub213sd(i.dest, i.src2, i.src3);
     } else {
@@ -3630,6 +3975,11 @@ EMITTER(MUL_SUB_F64, MATCH(I<OPCODE_MUL_SUB, F64<>, F64<>, F64<>, F64<>>)) {
 };
 EMITTER(MUL_SUB_V128, MATCH(I<OPCODE_MUL_SUB, V128<>, V128<>, V128<>, V128<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    if (!e.IsFeatureEnabled(EMIT_FMA)) {
+      e.vmulps(e.xmm0, i.src1, i.src2);
+      e.vsubps(i.dest, e.xmm0, i.src3);
+      return;
+    }
     if (i.dest == i.src1) {
       e.vfmsub213ps(i.dest, i.src2, i.src3);
     } else {
@@ -4130,7 +4480,11 @@ void EmitShlXX(X64Emitter& e, const ARGS& i) {
   SEQ::EmitAssociativeBinaryOp(
         e, i,
         [](X64Emitter& e, const REG& dest_src, const Reg8& src) {
-          if (dest_src.getBit() == 64) {
+          if (!e.IsFeatureEnabled(EMIT_BMI2)) {
+            e.mov(e.cl, src);
+            e.shl(dest_src, e.cl);
+            e.ReloadECX();
+          } else if (dest_src.getBit() == 64) {
             e.shlx(dest_src.cvt64(), dest_src.cvt64(), src.cvt64());
           } else {
             e.shlx(dest_src.cvt32(), dest_src.cvt32(), src.cvt32());
@@ -4176,7 +4530,11 @@ void EmitShrXX(X64Emitter& e, const ARGS& i) {
   SEQ::EmitAssociativeBinaryOp(
         e, i,
         [](X64Emitter& e, const REG& dest_src, const Reg8& src) {
-          if (dest_src.getBit() == 64) {
+          if (!e.IsFeatureEnabled(EMIT_BMI2)) {
+            e.mov(e.cl, src);
+            e.shr(dest_src, e.cl);
+            e.ReloadECX();
+          } else if (dest_src.getBit() == 64) {
             e.shrx(dest_src.cvt64(), dest_src.cvt64(), src.cvt64());
           } else if (dest_src.getBit() == 32) {
             e.shrx(dest_src.cvt32(), dest_src.cvt32(), src.cvt32());
@@ -4225,7 +4583,11 @@ void EmitSarXX(X64Emitter& e, const ARGS& i) {
   SEQ::EmitAssociativeBinaryOp(
         e, i,
         [](X64Emitter& e, const REG& dest_src, const Reg8& src) {
-          if (dest_src.getBit() == 64) {
+          if (!e.IsFeatureEnabled(EMIT_BMI2)) {
+            e.mov(e.cl, src);
+            e.sar(dest_src, e.cl);
+            e.ReloadECX();
+          } else if (dest_src.getBit() == 64) {
             e.sarx(dest_src.cvt64(), dest_src.cvt64(), src.cvt64());
           } else if (dest_src.getBit() == 32) {
             e.sarx(dest_src.cvt32(), dest_src.cvt32(), src.cvt32());
@@ -4344,6 +4706,28 @@ EMITTER(VECTOR_SHL_V128, MATCH(I<OPCODE_VECTOR_SHL, V128<>, V128<>, V128<>>)) {
     e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShlI16));
     e.vmovaps(i.dest, e.xmm0);
   }
+  static __m128i EmulateVectorShlI32(void*, __m128i src1, __m128i src2) {
+    alignas(16) uint32_t value[4];
+    alignas(16) uint32_t shamt[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(value), src1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(shamt), src2);
+    for (size_t i = 0; i < 4; ++i) {
+      value[i] = value[i] << (shamt[i] & 0x1F);
+    }
+    return _mm_load_si128(reinterpret_cast<__m128i*>(value));
+  }
+  static void EmitInt32Emulated(X64Emitter& e, const EmitArgType& i) {
+    // Only AVX2 has variable dword shifts.
+    if (i.src2.is_constant) {
+      e.LoadConstantXmm(e.xmm0, i.src2.constant());
+      e.lea(e.r9, e.StashXmm(1, e.xmm0));
+    } else {
+      e.lea(e.r9, e.StashXmm(1, i.src2));
+    }
+    e.lea(e.r8, e.StashXmm(0, i.src1));
+    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShlI32));
+    e.vmovaps(i.dest, e.xmm0);
+  }
   static void EmitInt32(X64Emitter& e, const EmitArgType& i) {
     if (i.src2.is_constant) {
       const auto& shamt = i.src2.constant();
@@ -4357,6 +4741,8 @@ EMITTER(VECTOR_SHL_V128, MATCH(I<OPCODE_VECTOR_SHL, V128<>, V128<>, V128<>>)) {
       if (all_same) {
         // Every count is the same, so we can use vpslld.
         e.vpslld(i.dest, i.src1, shamt.u8[0] & 0x1F);
+      } else if (!e.IsFeatureEnabled(EMIT_AVX2)) {
+        EmitInt32Emulated(e, i);
       } else {
         // Counts differ, so pre-mask and load constant.
         vec128_t masked = i.src2.constant();
@@ -4366,6 +4752,8 @@ EMITTER(VECTOR_SHL_V128, MATCH(I<OPCODE_VECTOR_SHL, V128<>, V128<>, V128<>>)) {
         e.LoadConstantXmm(e.xmm0, masked);
         e.vpsllvd(i.dest, i.src1, e.xmm0);
       }
+    } else if (!e.IsFeatureEnabled(EMIT_AVX2)) {
+      EmitInt32Emulated(e, i);
     } else {
       // Fully variable shift.
       // src shift mask may have values >31, and x86 sets to zero when
@@ -4459,6 +4847,28 @@ EMITTER(VECTOR_SHR_V128, MATCH(I<OPCODE_VECTOR_SHR, V128<>, V128<>, V128<>>)) {
     e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShrI16));
     e.vmovaps(i.dest, e.xmm0);
   }
+  static __m128i EmulateVectorShrI32(void*, __m128i src1, __m128i src2) {
+    alignas(16) uint32_t value[4];
+    alignas(16) uint32_t shamt[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(value), src1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(shamt), src2);
+    for (size_t i = 0; i < 4; ++i) {
+      value[i] = value[i] >> (shamt[i] & 0x1F);
+    }
+    return _mm_load_si128(reinterpret_cast<__m128i*>(value));
+  }
+  static void EmitInt32Emulated(X64Emitter& e, const EmitArgType& i) {
+    // Only AVX2 has variable dword shifts.
+    if (i.src2.is_constant) {
+      e.LoadConstantXmm(e.xmm0, i.src2.constant());
+      e.lea(e.r9, e.StashXmm(1, e.xmm0));
+    } else {
+      e.lea(e.r9, e.StashXmm(1, i.src2));
+    }
+    e.lea(e.r8, e.StashXmm(0, i.src1));
+    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShrI32));
+    e.vmovaps(i.dest, e.xmm0);
+  }
   static void EmitInt32(X64Emitter& e, const EmitArgType& i) {
     if (i.src2.is_constant) {
       const auto& shamt = i.src2.constant();
@@ -4472,6 +4882,8 @@ EMITTER(VECTOR_SHR_V128, MATCH(I<OPCODE_VECTOR_SHR, V128<>, V128<>, V128<>>)) {
       if (all_same) {
         // Every count is the same, so we can use vpslld.
         e.vpsrld(i.dest, i.src1, shamt.u8[0] & 0x1F);
+      } else if (!e.IsFeatureEnabled(EMIT_AVX2)) {
+        EmitInt32Emulated(e, i);
       } else {
         // Counts differ, so pre-mask and load constant.
         vec128_t masked = i.src2.constant();
@@ -4481,6 +4893,8 @@ EMITTER(VECTOR_SHR_V128, MATCH(I<OPCODE_VECTOR_SHR, V128<>, V128<>, V128<>>)) {
         e.LoadConstantXmm(e.xmm0, masked);
         e.vpsrlvd(i.dest, i.src1, e.xmm0);
       }
+    } else if (!e.IsFeatureEnabled(EMIT_AVX2)) {
+      EmitInt32Emulated(e, i);
     } else {
       // Fully variable shift.
       // src shift mask may have values >31, and x86 sets to zero when
@@ -4519,6 +4933,28 @@ EMITTER(VECTOR_SHA_V128, MATCH(I<OPCODE_VECTOR_SHA, V128<>, V128<>, V128<>>)) {
     }
     return _mm_load_si128(reinterpret_cast<__m128i*>(value));
   }
+  static __m128i EmulateVectorShaI32(void*, __m128i src1, __m128i src2) {
+    alignas(16) int32_t value[4];
+    alignas(16) int32_t shamt[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(value), src1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(shamt), src2);
+    for (size_t i = 0; i < 4; ++i) {
+      value[i] = value[i] >> (shamt[i] & 0x1F);
+    }
+    return _mm_load_si128(reinterpret_cast<__m128i*>(value));
+  }
+  static void EmitInt32Emulated(X64Emitter& e, const EmitArgType& i) {
+    // Only AVX2 has variable dword shifts.
+    if (i.src2.is_constant) {
+      e.LoadConstantXmm(e.xmm0, i.src2.constant());
+      e.lea(e.r9, e.StashXmm(1, e.xmm0));
+    } else {
+      e.lea(e.r9, e.StashXmm(1, i.src2));
+    }
+    e.lea(e.r8, e.StashXmm(0, i.src1));
+    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShaI32));
+    e.vmovaps(i.dest, e.xmm0);
+  }
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     switch (i.instr->flags) {
     case INT8_TYPE:
@@ -4546,6 +4982,10 @@ EMITTER(VECTOR_SHA_V128, MATCH(I<OPCODE_VECTOR_SHA, V128<>, V128<>, V128<>>)) {
       e.vmovaps(i.dest, e.xmm0);
       break;
     case INT32_TYPE:
+      if (!e.IsFeatureEnabled(EMIT_AVX2)) {
+        EmitInt32Emulated(e, i);
+        break;
+      }
       // src shift mask may have values >31, and x86 sets to zero when
       // that happens so we mask.
       if (i.src2.is_constant) {
@@ -4573,6 +5013,37 @@ EMITTER_OPCODE_TABLE(
 // TODO(benvanik): put dest/src1 together, src2 in cl.
 template <typename SEQ, typename REG, typename ARGS>
 void EmitRotateLeftXX(X64Emitter& e, const ARGS& i) {
+  const int bits = i.dest.reg().getBit();
+  if (bits >= 32 && !i.src1.is_constant && e.IsFeatureEnabled(EMIT_BMI2)) {
+    if (i.src2.is_constant) {
+      // rorx is three operand, so no move. Right by the inverse count.
+      uint8_t count = (bits - (i.src2.constant() & (bits - 1))) & (bits - 1);
+      if (bits == 64) {
+        e.rorx(i.dest.reg().cvt64(), i.src1.reg().cvt64(), count);
+      } else {
+        e.rorx(i.dest.reg().cvt32(), i.src1.reg().cvt32(), count);
+      }
+      return;
+    } else if (i.dest != i.src1 && i.dest != i.src2) {
+      // (x << n) | (x >> -n); both only use the low bits of the count, so
+      // this holds for n = 0 as well, and ecx is left alone.
+      const Reg64 dest = i.dest.reg().cvt64();
+      const Reg64 src1 = i.src1.reg().cvt64();
+      const Reg64 count = i.src2.reg().cvt64();
+      e.mov(dest.cvt32(), count.cvt32());
+      e.neg(dest.cvt32());
+      if (bits == 64) {
+        e.shrx(dest, src1, dest);
+        e.shlx(e.rax, src1, count);
+        e.or(dest, e.rax);
+      } else {
+        e.shrx(dest.cvt32(), src1.cvt32(), dest.cvt32());
+        e.shlx(e.eax, src1.cvt32(), count.cvt32());
+        e.or(dest.cvt32(), e.eax);
+      }
+      return;
+    }
+  }
   if (i.src2.is_constant) {
     // Constant rotate.
     if (i.dest != i.src1) {
@@ -4652,6 +5123,27 @@ EMITTER(VECTOR_ROTATE_LEFT_V128, MATCH(I<OPCODE_VECTOR_ROTATE_LEFT, V128<>, V128
     }
     return _mm_load_si128(reinterpret_cast<__m128i*>(value));
   }
+  static __m128i EmulateVectorRotateLeftI32(void*, __m128i src1, __m128i src2) {
+    alignas(16) uint32_t value[4];
+    alignas(16) uint32_t shamt[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(value), src1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(shamt), src2);
+    for (size_t i = 0; i < 4; ++i) {
+      value[i] = poly::rotate_left<uint32_t>(value[i], shamt[i] & 0x1F);
+    }
+    return _mm_load_si128(reinterpret_cast<__m128i*>(value));
+  }
+  static void EmitInt32Emulated(X64Emitter& e, const EmitArgType& i) {
+    if (i.src2.is_constant) {
+      e.LoadConstantXmm(e.xmm0, i.src2.constant());
+      e.lea(e.r9, e.StashXmm(1, e.xmm0));
+    } else {
+      e.lea(e.r9, e.StashXmm(1, i.src2));
+    }
+    e.lea(e.r8, e.StashXmm(0, i.src1));
+    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorRotateLeftI32));
+    e.vmovaps(i.dest, e.xmm0);
+  }
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     switch (i.instr->flags) {
     case INT8_TYPE:
@@ -4669,6 +5161,10 @@ EMITTER(VECTOR_ROTATE_LEFT_V128, MATCH(I<OPCODE_VECTOR_ROTATE_LEFT, V128<>, V128
       e.vmovaps(i.dest, e.xmm0);
       break;
     case INT32_TYPE: {
+      if (!e.IsFeatureEnabled(EMIT_AVX2)) {
+        EmitInt32Emulated(e, i);
+        break;
+      }
       Xmm temp = i.dest;
       if (i.dest == i.src1 || i.dest == i.src2) {
         temp = e.xmm2;
@@ -4698,6 +5194,61 @@ EMITTER_OPCODE_TABLE(
 // ============================================================================
 // OPCODE_BYTE_SWAP
 // ============================================================================
+// Swaps of values only being stored, as above for loads.
+SEQUENCE(BYTE_SWAP_STORE_I16, MATCH(
+    I<OPCODE_BYTE_SWAP, I16<TAG0>, I16<>>,
+    I<OPCODE_STORE, VoidOp, I64<>, I16<TAG0>>)) {
+  static bool CanEmit(X64Emitter& e, const EmitArgs& _) {
+    return e.IsFeatureEnabled(EMIT_MOVBE) && !_.i1.src1.is_constant &&
+           IsSingleUse(_.i1.dest.value);
+  }
+  static void Emit(X64Emitter& e, const EmitArgs& _) {
+    auto addr = ComputeMemoryAddress(e, _.i2.src1);
+    e.movbe(e.word[addr], _.i1.src1);
+    if (IsTracingData()) {
+      auto addr = ComputeMemoryAddress(e, _.i2.src1);
+      e.mov(e.r8w, e.word[addr]);
+      e.lea(e.rdx, e.ptr[addr]);
+      e.CallNative(reinterpret_cast<void*>(TraceMemoryStoreI16));
+    }
+  }
+};
+SEQUENCE(BYTE_SWAP_STORE_I32, MATCH(
+    I<OPCODE_BYTE_SWAP, I32<TAG0>, I32<>>,
+    I<OPCODE_STORE, VoidOp, I64<>, I32<TAG0>>)) {
+  static bool CanEmit(X64Emitter& e, const EmitArgs& _) {
+    return e.IsFeatureEnabled(EMIT_MOVBE) && !_.i1.src1.is_constant &&
+           IsSingleUse(_.i1.dest.value);
+  }
+  static void Emit(X64Emitter& e, const EmitArgs& _) {
+    auto addr = ComputeMemoryAddress(e, _.i2.src1);
+    e.movbe(e.dword[addr], _.i1.src1);
+    if (IsTracingData()) {
+      auto addr = ComputeMemoryAddress(e, _.i2.src1);
+      e.mov(e.r8d, e.dword[addr]);
+      e.lea(e.rdx, e.ptr[addr]);
+      e.CallNative(reinterpret_cast<void*>(TraceMemoryStoreI32));
+    }
+  }
+};
+SEQUENCE(BYTE_SWAP_STORE_I64, MATCH(
+    I<OPCODE_BYTE_SWAP, I64<TAG0>, I64<>>,
+    I<OPCODE_STORE, VoidOp, I64<>, I64<TAG0>>)) {
+  static bool CanEmit(X64Emitter& e, const EmitArgs& _) {
+    return e.IsFeatureEnabled(EMIT_MOVBE) && !_.i1.src1.is_constant &&
+           IsSingleUse(_.i1.dest.value);
+  }
+  static void Emit(X64Emitter& e, const EmitArgs& _) {
+    auto addr = ComputeMemoryAddress(e, _.i2.src1);
+    e.movbe(e.qword[addr], _.i1.src1);
+    if (IsTracingData()) {
+      auto addr = ComputeMemoryAddress(e, _.i2.src1);
+      e.mov(e.r8, e.qword[addr]);
+      e.lea(e.rdx, e.ptr[addr]);
+      e.CallNative(reinterpret_cast<void*>(TraceMemoryStoreI64));
+    }
+  }
+};
 // TODO(benvanik): put dest/src1 together.
 EMITTER(BYTE_SWAP_I16, MATCH(I<OPCODE_BYTE_SWAP, I16<>, I16<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
@@ -4728,6 +5279,9 @@ EMITTER(BYTE_SWAP_V128, MATCH(I<OPCODE_BYTE_SWAP, V128<>, V128<>>)) {
 };
 EMITTER_OPCODE_TABLE(
     OPCODE_BYTE_SWAP,
+    BYTE_SWAP_STORE_I16,
+    BYTE_SWAP_STORE_I32,
+    BYTE_SWAP_STORE_I64,
     BYTE_SWAP_I16,
     BYTE_SWAP_I32,
     BYTE_SWAP_I64,
@@ -4857,7 +5411,7 @@ EMITTER(EXTRACT_I32, MATCH(I<OPCODE_EXTRACT, I32<>, V128<>, I8<>>)) {
       e.mov(e.al, i.src2);
       e.and(e.al, 0x03);
       e.shl(e.al, 4);
-      e.mov(e.rdx, reinterpret_cast<uint64_t>(extract_table_32));
+      e.MovHostAddress(e.rdx, extract_table_32);
       e.vmovaps(e.xmm0, e.ptr[e.rdx + e.rax]);
       e.vpshufb(e.xmm0, i.src1, e.xmm0);
       e.vpextrd(i.dest, e.xmm0, 0);
@@ -4875,17 +5429,45 @@ EMITTER_OPCODE_TABLE(
 // ============================================================================
 // OPCODE_SPLAT
 // ============================================================================
+// Splats the low element of xmm0, with shuffles if AVX2 is unavailable.
+void EmitSplatXmm0(X64Emitter& e, const Xmm& dest, TypeName type) {
+  if (e.IsFeatureEnabled(EMIT_AVX2)) {
+    switch (type) {
+    case INT8_TYPE: e.vpbroadcastb(dest, e.xmm0); break;
+    case INT16_TYPE: e.vpbroadcastw(dest, e.xmm0); break;
+    case INT32_TYPE: e.vpbroadcastd(dest, e.xmm0); break;
+    case FLOAT32_TYPE: e.vbroadcastss(dest, e.xmm0); break;
+    default: assert_unhandled_case(type); break;
+    }
+  } else {
+    switch (type) {
+    case INT8_TYPE:
+      // An all zero control picks byte 0 for every byte.
+      e.vpxor(e.xmm1, e.xmm1);
+      e.vpshufb(dest, e.xmm0, e.xmm1);
+      break;
+    case INT16_TYPE:
+      e.vpshuflw(e.xmm0, e.xmm0, 0);
+      e.vpshufd(dest, e.xmm0, 0);
+      break;
+    case INT32_TYPE:
+    case FLOAT32_TYPE:
+      e.vpshufd(dest, e.xmm0, 0);
+      break;
+    default: assert_unhandled_case(type); break;
+    }
+  }
+}
 EMITTER(SPLAT_I8, MATCH(I<OPCODE_SPLAT, V128<>, I8<>>)) {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     if (i.src1.is_constant) {
       // TODO(benvanik): faster constant splats.
       e.mov(e.al, i.src1.constant());
       e.vmovd(e.xmm0, e.eax);
-      e.vpbroadcastb(i.dest, e.xmm0);
     } else {
       e.vmovd(e.xmm0, i.src1.reg().cvt32());
-      e.vpbroadcastb(i.dest, e.xmm0);
     }
+    EmitSplatXmm0(e, i.dest, INT8_TYPE);
   }
 };
 EMITTER(SPLAT_I16, MATCH(I<OPCODE_SPLAT, V128<>, I16<>>)) {
@@ -4894,11 +5476,10 @@ EMITTER(SPLAT_I16, MATCH(I<OPCODE_SPLAT, V128<>, I16<>>)) {
       // TODO(benvanik): faster constant splats.
       e.mov(e.ax, i.src1.constant());
       e.vmovd(e.xmm0, e.eax);
-      e.vpbroadcastw(i.dest, e.xmm0);
     } else {
       e.vmovd(e.xmm0, i.src1.reg().cvt32());
-      e.vpbroadcastw(i.dest, e.xmm0);
     }
+    EmitSplatXmm0(e, i.dest, INT16_TYPE);
   }
 };
 EMITTER(SPLAT_I32, MATCH(I<OPCODE_SPLAT, V128<>, I32<>>)) {
@@ -4907,11 +5488,10 @@ EMITTER(SPLAT_I32, MATCH(I<OPCODE_SPLAT, V128<>, I32<>>)) {
       // TODO(benvanik): faster constant splats.
       e.mov(e.eax, i.src1.constant());
       e.vmovd(e.xmm0, e.eax);
-      e.vpbroadcastd(i.dest, e.xmm0);
     } else {
       e.vmovd(e.xmm0, i.src1);
-      e.vpbroadcastd(i.dest, e.xmm0);
     }
+    EmitSplatXmm0(e, i.dest, INT32_TYPE);
   }
 };
 EMITTER(SPLAT_F32, MATCH(I<OPCODE_SPLAT, V128<>, F32<>>)) {
@@ -4920,9 +5500,11 @@ EMITTER(SPLAT_F32, MATCH(I<OPCODE_SPLAT, V128<>, F32<>>)) {
       // TODO(benvanik): faster constant splats.
       e.mov(e.eax, i.src1.value->constant.i32);
       e.vmovd(e.xmm0, e.eax);
-      e.vbroadcastss(i.dest, e.xmm0);
-    } else {
+      EmitSplatXmm0(e, i.dest, FLOAT32_TYPE);
+    } else if (e.IsFeatureEnabled(EMIT_AVX2)) {
       e.vbroadcastss(i.dest, i.src1);
+    } else {
+      e.vpshufd(i.dest, i.src1, 0);
     }
   }
 };
@@ -4973,16 +5555,36 @@ EMITTER(PERMUTE_I32, MATCH(I<OPCODE_PERMUTE, V128<>, I32<>, V128<>, V128<>>)) {
       if (i.dest != src3) {
         e.vpshufd(i.dest, src2, src_control);
         e.vpshufd(e.xmm0, src3, src_control);
-        e.vpblendd(i.dest, e.xmm0, blend_control);
       } else {
         e.vmovaps(e.xmm0, src3);
         e.vpshufd(i.dest, src2, src_control);
         e.vpshufd(e.xmm0, e.xmm0, src_control);
+      }
+      if (e.IsFeatureEnabled(EMIT_AVX2)) {
         e.vpblendd(i.dest, e.xmm0, blend_control);
+      } else {
+        e.vblendps(i.dest, i.dest, e.xmm0, blend_control);
       }
     } else {
       // Permute by non-constant.
-      assert_always();
+      // Spread the control bytes out to one per dword, then shuffle both
+      // sources with them and pick by bit 2 (moved up to the sign bit).
+      e.vmovd(e.xmm0, i.src1);
+      e.vpshufb(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMPermuteControlI32));
+      if (i.src2.is_constant) {
+        e.LoadConstantXmm(e.xmm1, i.src2.constant());
+        e.vpermilps(e.xmm1, e.xmm1, e.xmm0);
+      } else {
+        e.vpermilps(e.xmm1, i.src2, e.xmm0);
+      }
+      if (i.src3.is_constant) {
+        e.LoadConstantXmm(e.xmm2, i.src3.constant());
+        e.vpermilps(e.xmm2, e.xmm2, e.xmm0);
+      } else {
+        e.vpermilps(e.xmm2, i.src3, e.xmm0);
+      }
+      e.vpslld(e.xmm0, e.xmm0, 29);
+      e.vblendvps(i.dest, e.xmm1, e.xmm2, e.xmm0);
     }
   }
 };
@@ -5121,18 +5723,64 @@ EMITTER(PACK, MATCH(I<OPCODE_PACK, V128<>, V128<>>)) {
       e.vpshufb(i.dest, i.src1, e.GetXmmConstPtr(XMMPackD3DCOLOR));
     }
   }
+  static __m128i EmulateFLOAT16_2(void*, __m128 src1) {
+    alignas(16) float src[4];
+    alignas(16) uint32_t dest[4];
+    _mm_store_ps(src, src1);
+    dest[0] = dest[1] = dest[2] = 0;
+    dest[3] = (uint32_t(poly::float_to_half(src[0])) << 16) |
+              poly::float_to_half(src[1]);
+    return _mm_load_si128(reinterpret_cast<__m128i*>(dest));
+  }
   static void EmitFLOAT16_2(X64Emitter& e, const EmitArgType& i) {
     // http://blogs.msdn.com/b/chuckw/archive/2012/09/11/directxmath-f16c-and-fma.aspx
     // dest = [(src1.x | src1.y), 0, 0, 0]
+    Xmm src;
+    if (i.src1.is_constant) {
+      src = e.xmm0;
+      e.LoadConstantXmm(src, i.src1.constant());
+    } else {
+      src = i.src1;
+    }
+    if (!e.IsFeatureEnabled(EMIT_F16C)) {
+      e.lea(e.r8, e.StashXmm(0, src));
+      e.CallNativeSafe(reinterpret_cast<void*>(EmulateFLOAT16_2));
+      e.vmovaps(i.dest, e.xmm0);
+      return;
+    }
     // 0|0|0|0|W|Z|Y|X
-    e.vcvtps2ph(i.dest, i.dest, B00000011);
+    e.vcvtps2ph(i.dest, src, B00000011);
     // Shuffle to X|Y|0|0|0|0|0|0
     e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMPackFLOAT16_2));
   }
+  static __m128i EmulateFLOAT16_4(void*, __m128 src1) {
+    alignas(16) float src[4];
+    alignas(16) uint32_t dest[4];
+    _mm_store_ps(src, src1);
+    dest[0] = dest[1] = 0;
+    dest[2] = (uint32_t(poly::float_to_half(src[0])) << 16) |
+              poly::float_to_half(src[1]);
+    dest[3] = (uint32_t(poly::float_to_half(src[2])) << 16) |
+              poly::float_to_half(src[3]);
+    return _mm_load_si128(reinterpret_cast<__m128i*>(dest));
+  }
   static void EmitFLOAT16_4(X64Emitter& e, const EmitArgType& i) {
     // dest = [(src1.x | src1.y), (src1.z | src1.w), 0, 0]
+    Xmm src;
+    if (i.src1.is_constant) {
+      src = e.xmm0;
+      e.LoadConstantXmm(src, i.src1.constant());
+    } else {
+      src = i.src1;
+    }
+    if (!e.IsFeatureEnabled(EMIT_F16C)) {
+      e.lea(e.r8, e.StashXmm(0, src));
+      e.CallNativeSafe(reinterpret_cast<void*>(EmulateFLOAT16_4));
+      e.vmovaps(i.dest, e.xmm0);
+      return;
+    }
     // 0|0|0|0|W|Z|Y|X
-    e.vcvtps2ph(e.xmm0, i.src1, B00000011);
+    e.vcvtps2ph(i.dest, src, B00000011);
     // Shuffle to X|Y|Z|W|0|0|0|0
     e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMPackFLOAT16_4));
   }
@@ -5215,6 +5863,16 @@ EMITTER(UNPACK, MATCH(I<OPCODE_UNPACK, V128<>, V128<>>)) {
     // Add 1.0f to each.
     e.vpor(i.dest, e.GetXmmConstPtr(XMMOne));
   }
+  static __m128 EmulateFLOAT16_2(void*, __m128i src1) {
+    alignas(16) uint32_t src[4];
+    alignas(16) float dest[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(src), src1);
+    dest[0] = poly::half_to_float(uint16_t(src[3] >> 16));
+    dest[1] = poly::half_to_float(uint16_t(src[3]));
+    dest[2] = 0.0f;
+    dest[3] = 1.0f;
+    return _mm_load_ps(dest);
+  }
   static void EmitFLOAT16_2(X64Emitter& e, const EmitArgType& i) {
     // 1 bit sign, 5 bit exponent, 10 bit mantissa
     // D3D10 half float format
@@ -5232,14 +5890,36 @@ EMITTER(UNPACK, MATCH(I<OPCODE_UNPACK, V128<>, V128<>>)) {
     //          XMConvertHalfToFloat(sy),
     //          0.0,
     //          1.0 };
+    if (!e.IsFeatureEnabled(EMIT_F16C)) {
+      e.lea(e.r8, e.StashXmm(0, i.src1));
+      e.CallNativeSafe(reinterpret_cast<void*>(EmulateFLOAT16_2));
+      e.vmovaps(i.dest, e.xmm0);
+      return;
+    }
     // Shuffle to 0|0|0|0|0|0|Y|X
     e.vpshufb(i.dest, i.src1, e.GetXmmConstPtr(XMMUnpackFLOAT16_2));
     e.vcvtph2ps(i.dest, i.dest);
     e.vpshufd(i.dest, i.dest, B10100100);
     e.vpor(i.dest, e.GetXmmConstPtr(XMM0001));
   }
+  static __m128 EmulateFLOAT16_4(void*, __m128i src1) {
+    alignas(16) uint16_t src[8];
+    alignas(16) float dest[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(src), src1);
+    dest[0] = poly::half_to_float(src[5]);
+    dest[1] = poly::half_to_float(src[4]);
+    dest[2] = poly::half_to_float(src[7]);
+    dest[3] = poly::half_to_float(src[6]);
+    return _mm_load_ps(dest);
+  }
   static void EmitFLOAT16_4(X64Emitter& e, const EmitArgType& i) {
     // src = [(dest.x | dest.y), (dest.z | dest.w), 0, 0]
+    if (!e.IsFeatureEnabled(EMIT_F16C)) {
+      e.lea(e.r8, e.StashXmm(0, i.src1));
+      e.CallNativeSafe(reinterpret_cast<void*>(EmulateFLOAT16_4));
+      e.vmovaps(i.dest, e.xmm0);
+      return;
+    }
     // Shuffle to 0|0|0|0|W|Z|Y|X
     e.vpshufb(i.dest, i.src1, e.GetXmmConstPtr(XMMUnpackFLOAT16_4));
     e.vcvtph2ps(i.dest, i.dest);
@@ -5296,6 +5976,41 @@ EMITTER_OPCODE_TABLE(
 // ============================================================================
 // OPCODE_COMPARE_EXCHANGE
 // ============================================================================
+// Like ATOMIC_EXCHANGE the address is a host address.
+template <typename SEQ, typename REG, typename ARGS>
+void EmitCompareExchangeXX(X64Emitter& e, const ARGS& i, const REG& acc,
+                           const REG& temp) {
+  // cmpxchg compares against and returns the old value in the accumulator.
+  if (i.src2.is_constant) {
+    e.mov(acc, i.src2.constant());
+  } else {
+    e.mov(acc, i.src2);
+  }
+  if (i.src3.is_constant) {
+    e.mov(temp, i.src3.constant());
+    e.lock();
+    e.cmpxchg(e.ptr[i.src1.reg()], temp);
+    e.ReloadECX();
+  } else {
+    e.lock();
+    e.cmpxchg(e.ptr[i.src1.reg()], i.src3);
+  }
+  e.mov(i.dest, acc);
+}
+EMITTER(COMPARE_EXCHANGE_I32, MATCH(I<OPCODE_COMPARE_EXCHANGE, I32<>, I64<>, I32<>, I32<>>)) {
+  static void Emit(X64Emitter& e, const EmitArgType& i) {
+    EmitCompareExchangeXX<COMPARE_EXCHANGE_I32, Reg32>(e, i, e.eax, e.ecx);
+  }
+};
+EMITTER(COMPARE_EXCHANGE_I64, MATCH(I<OPCODE_COMPARE_EXCHANGE, I64<>, I64<>, I64<>, I64<>>)) {
+  static void Emit(X64Emitter& e, const EmitArgType& i) {
+    EmitCompareExchangeXX<COMPARE_EXCHANGE_I64, Reg64>(e, i, e.rax, e.rcx);
+  }
+};
+EMITTER_OPCODE_TABLE(
+    OPCODE_COMPARE_EXCHANGE,
+    COMPARE_EXCHANGE_I32,
+    COMPARE_EXCHANGE_I64);
 
 
 // ============================================================================
@@ -5424,6 +6139,16 @@ void RegisterSequences() {
   REGISTER_EMITTER_OPCODE_TABLE(OPCODE_SELECT);
   REGISTER_EMITTER_OPCODE_TABLE(OPCODE_IS_TRUE);
   REGISTER_EMITTER_OPCODE_TABLE(OPCODE_IS_FALSE);
+  REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_EQ_BRANCH);
+  REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_NE_BRANCH);
+  REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_SLT_BRANCH);
+  REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_SLE_BRANCH);
+  REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_SGT_BRANCH);
+  REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_SGE_BRANCH);
+  REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_ULT_BRANCH);
+  REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_ULE_BRANCH);
+  REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_UGT_BRANCH);
+  REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_UGE_BRANCH);
   REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_EQ);
   REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_NE);
   REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_SLT);
@@ -5489,7 +6214,7 @@ void RegisterSequences() {
   REGISTER_EMITTER_OPCODE_TABLE(OPCODE_SWIZZLE);
   REGISTER_EMITTER_OPCODE_TABLE(OPCODE_PACK);
   REGISTER_EMITTER_OPCODE_TABLE(OPCODE_UNPACK);
-  //REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_EXCHANGE);
+  REGISTER_EMITTER_OPCODE_TABLE(OPCODE_COMPARE_EXCHANGE);
   REGISTER_EMITTER_OPCODE_TABLE(OPCODE_ATOMIC_EXCHANGE);
   //REGISTER_EMITTER_OPCODE_TABLE(OPCODE_ATOMIC_ADD);
   //REGISTER_EMITTER_OPCODE_TABLE(OPCODE_ATOMIC_SUB);
@@ -5497,10 +6222,12 @@ void RegisterSequences() {
 
 bool SelectSequence(X64Emitter& e, const Instr* i, const Instr** new_tail) {
   const InstrKey key(i);
-  const auto its = sequence_table.equal_range(key);
-  for (auto it = its.first; it != its.second; ++it) {
-    if (it->second(e, i, new_tail)) {
-      return true;
+  const auto it = sequence_table.find(key);
+  if (it != sequence_table.end()) {
+    for (auto select_fn : it->second) {
+      if (select_fn(e, i, new_tail)) {
+        return true;
+      }
     }
   }
   PLOGE("No sequence match for variant %s", i->opcode->name);
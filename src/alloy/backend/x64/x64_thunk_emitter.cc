@@ -9,6 +9,14 @@
 
 #include <alloy/backend/x64/x64_thunk_emitter.h>
 
+#include <algorithm>
+
+#include <alloy/alloy-private.h>
+#include <alloy/backend/x64/x64_backend.h>
+#include <alloy/backend/x64/x64_code_cache.h>
+#include <alloy/backend/x64/x64_function.h>
+#include <alloy/runtime/runtime.h>
+#include <alloy/runtime/thread_state.h>
 #include <third_party/xbyak/xbyak/xbyak.h>
 
 namespace alloy {
@@ -16,6 +24,38 @@ namespace backend {
 namespace x64 {
 
 using namespace Xbyak;
+using alloy::runtime::ThreadState;
+
+uint64_t GuestToHostSafePoint(void* raw_context, uint64_t stack_pointer) {
+  auto thread_state = *reinterpret_cast<ThreadState**>(raw_context);
+  auto backend = static_cast<X64Backend*>(thread_state->runtime()->backend());
+  auto thread_data =
+      reinterpret_cast<X64ThreadData*>(thread_state->backend_data());
+  backend->code_cache()->SafePoint(thread_data->code_cache_thread,
+                                   reinterpret_cast<void*>(stack_pointer));
+  return 0;
+}
+
+uint64_t ExecuteTier0(void* raw_context, uint64_t function_ptr,
+                      uint64_t return_address) {
+  auto thread_state = *reinterpret_cast<ThreadState**>(raw_context);
+  auto function = reinterpret_cast<X64Function*>(function_ptr);
+  uint32_t threshold =
+      static_cast<uint32_t>(std::max(1, FLAGS_runtime_tier_up_threshold));
+  if (function->CountTier0Entry() >= threshold &&
+      function->ClaimTier0Promotion()) {
+    // Others keep running the first tier until the stub is unlinked. The
+    // stub and the first tier function are freed once nothing is running
+    // them anymore.
+    auto backend = static_cast<X64Backend*>(thread_state->runtime()->backend());
+    if (backend->PromoteTier0Function(function)) {
+      // Try again after another threshold worth of entries.
+      function->ReleaseTier0Promotion();
+    }
+  }
+  function->tier0_function()->Call(thread_state, return_address);
+  return 0;
+}
 
 X64ThunkEmitter::X64ThunkEmitter(X64Backend* backend, XbyakAllocator* allocator)
     : X64Emitter(backend, allocator) {}
@@ -115,6 +155,23 @@ GuestToHostThunk X64ThunkEmitter::EmitGuestToHostThunk() {
 
   // TODO(benvanik): save things? XMM0-5?
 
+  // Code cache safe point, only if evicted code is waiting on one. The guest
+  // frames above us can't change until we return.
+  Xbyak::Label skip_safe_point;
+  mov(rax, reinterpret_cast<uint64_t>(code_cache_->reclaim_pending_ptr()));
+  cmp(dword[rax], 0);
+  je(skip_safe_point, T_NEAR);
+  mov(qword[rsp + 32], r8);
+  mov(qword[rsp + 40], r9);
+  mov(rdx, rsp);
+  mov(rax, reinterpret_cast<uint64_t>(GuestToHostSafePoint));
+  call(rax);
+  mov(rcx, qword[rsp + 56]);
+  mov(rdx, qword[rsp + stack_size + 8 * 2]);
+  mov(r8, qword[rsp + 32]);
+  mov(r9, qword[rsp + 40]);
+  L(skip_safe_point);
+
   mov(rax, rdx);
   mov(rdx, r8);
   mov(r8, r9);
@@ -139,6 +196,63 @@ GuestToHostThunk X64ThunkEmitter::EmitGuestToHostThunk() {
   return (HostToGuestThunk)fn;
 }
 
+LinkCallThunk X64ThunkEmitter::EmitLinkCallThunk() {
+  // rcx = context
+  // rdx = guest return address for the target
+  // rax = target FunctionInfo*
+  // r8  = call site displacement
+  // Reached by jmp from the call site stub, so the stack is as the target
+  // would see it.
+
+  const size_t stack_size = 56;
+  // rsp + 0 = return address
+  sub(rsp, stack_size);
+  mov(qword[rsp + 32], rcx);
+  mov(qword[rsp + 40], rdx);
+
+  mov(rdx, rax);
+  mov(rax, reinterpret_cast<uint64_t>(ResolveDirectCall));
+  call(rax);
+
+  mov(rcx, qword[rsp + 32]);
+  mov(rdx, qword[rsp + 40]);
+  add(rsp, stack_size);
+  jmp(rax);
+
+  void* fn = Emplace(stack_size);
+  return (LinkCallThunk)fn;
+}
+
+void* X64ThunkEmitter::EmitTier0EntryStub(X64Function* function,
+                                          size_t* out_code_size) {
+  // rcx = context
+  // rdx = guest return address
+  // Laid out like any other guest frame so that return address lookups
+  // and the code cache see it as one.
+
+  const size_t stack_size = StackLayout::GUEST_STACK_SIZE;
+  // rsp + 0 = return address
+  sub(rsp, stack_size);
+  mov(qword[rsp + StackLayout::GUEST_RCX_HOME], rcx);
+  mov(qword[rsp + StackLayout::GUEST_RET_ADDR], rdx);
+  mov(qword[rsp + StackLayout::GUEST_CALL_RET_ADDR], 0);
+
+  mov(r9, rdx);
+  mov(r8, reinterpret_cast<uint64_t>(function));
+  mov(rdx, reinterpret_cast<uint64_t>(ExecuteTier0));
+  mov(rax, reinterpret_cast<uint64_t>(backend_->guest_to_host_thunk()));
+  call(rax);
+
+  // Callers expect the membase back in rdx, as from any guest function.
+  mov(rcx, qword[rsp + StackLayout::GUEST_RCX_HOME]);
+  mov(rdx, qword[rcx + 8]);
+  add(rsp, stack_size);
+  ret();
+
+  *out_code_size = getSize();
+  return Emplace(stack_size);
+}
+
 }  // namespace x64
 }  // namespace backend
 }  // namespace alloy
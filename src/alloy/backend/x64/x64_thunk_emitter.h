@@ -112,6 +112,11 @@ namespace x64 {
  *
  */
 
+// Runs the first tier function of an entry stub, counting the entry.
+// Called from the stubs through the guest to host thunk.
+uint64_t ExecuteTier0(void* raw_context, uint64_t function_ptr,
+                      uint64_t return_address);
+
 class StackLayout {
  public:
   const static size_t THUNK_STACK_SIZE = 120;
@@ -132,6 +137,15 @@ class X64ThunkEmitter : public X64Emitter {
 
   // Function that guest code can call to transition into host code.
   GuestToHostThunk EmitGuestToHostThunk();
+
+  // Target of unlinked direct calls. Resolves the callee, links the call site
+  // to it and jumps to it as if it had been called directly.
+  LinkCallThunk EmitLinkCallThunk();
+
+  // Entry point for a --runtime_tiered first tier function. Has a regular
+  // guest frame and hands the call to the backend through the guest to host
+  // thunk.
+  void* EmitTier0EntryStub(X64Function* function, size_t* out_code_size);
 };
 
 }  // namespace x64
@@ -9,7 +9,10 @@
 
 #include <alloy/compiler/compiler.h>
 
+#include <chrono>
+
 #include <alloy/compiler/compiler_pass.h>
+#include <alloy/runtime/translation_profiler.h>
 #include <xenia/profiling.h>
 
 namespace alloy {
@@ -34,12 +37,18 @@ int Compiler::Compile(HIRBuilder* builder) {
 
   // TODO(benvanik): sophisticated stuff. Run passes in parallel, run until they
   //                 stop changing things, etc.
+  auto profile_record = runtime::TranslationProfiler::current();
   for (size_t i = 0; i < passes_.size(); ++i) {
     auto& pass = passes_[i];
     scratch_arena_.Reset();
+    auto start_time = std::chrono::steady_clock::now();
     if (pass->Run(builder)) {
       return 1;
     }
+    if (profile_record) {
+      profile_record->pass_ns.emplace_back(
+          pass->name(), runtime::TranslationProfiler::ElapsedNs(start_time));
+    }
   }
 
   return 0;
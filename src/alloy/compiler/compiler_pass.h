@@ -30,6 +30,9 @@ class CompilerPass {
 
   virtual int Initialize(Compiler* compiler);
 
+  // Short name for profiling.
+  virtual const char* name() const = 0;
+
   virtual int Run(hir::HIRBuilder* builder) = 0;
 
  protected:
@@ -10,17 +10,21 @@
 #ifndef ALLOY_COMPILER_COMPILER_PASSES_H_
 #define ALLOY_COMPILER_COMPILER_PASSES_H_
 
+#include <alloy/compiler/passes/compare_sinking_pass.h>
 #include <alloy/compiler/passes/constant_propagation_pass.h>
 #include <alloy/compiler/passes/context_promotion_pass.h>
 #include <alloy/compiler/passes/control_flow_analysis_pass.h>
 #include <alloy/compiler/passes/control_flow_simplification_pass.h>
 #include <alloy/compiler/passes/data_flow_analysis_pass.h>
 #include <alloy/compiler/passes/dead_code_elimination_pass.h>
-//#include <alloy/compiler/passes/dead_store_elimination_pass.h>
+#include <alloy/compiler/passes/dead_store_elimination_pass.h>
 #include <alloy/compiler/passes/finalization_pass.h>
+#include <alloy/compiler/passes/global_context_promotion_pass.h>
+#include <alloy/compiler/passes/loop_invariant_code_motion_pass.h>
 #include <alloy/compiler/passes/register_allocation_pass.h>
 #include <alloy/compiler/passes/simplification_pass.h>
 #include <alloy/compiler/passes/validation_pass.h>
+#include <alloy/compiler/passes/value_numbering_pass.h>
 #include <alloy/compiler/passes/value_reduction_pass.h>
 
 // TODO:
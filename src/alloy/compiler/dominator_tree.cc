@@ -0,0 +1,128 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/compiler/dominator_tree.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace alloy {
+namespace compiler {
+
+using alloy::hir::Block;
+using alloy::hir::Edge;
+using alloy::hir::HIRBuilder;
+
+const uint32_t DominatorTree::kNone;
+
+DominatorTree::DominatorTree() = default;
+
+DominatorTree::~DominatorTree() = default;
+
+bool DominatorTree::Compute(HIRBuilder* builder) {
+  // Cooper, Harvey, Kennedy: "A Simple, Fast Dominance Algorithm".
+  blocks_.clear();
+  auto block = builder->first_block();
+  while (block) {
+    block->ordinal = static_cast<uint16_t>(blocks_.size());
+    blocks_.push_back(block);
+    block = block->next;
+  }
+  if (blocks_.empty()) {
+    return false;
+  }
+  uint32_t count = block_count();
+
+  // Reverse postorder from the entry.
+  rpo_.clear();
+  rpo_numbers_.assign(count, kNone);
+  std::vector<bool> visited(count, false);
+  std::vector<std::pair<Block*, Edge*>> stack;
+  stack.emplace_back(blocks_[0], blocks_[0]->outgoing_edge_head);
+  visited[0] = true;
+  while (!stack.empty()) {
+    auto& top = stack.back();
+    if (top.second) {
+      auto dest = top.second->dest;
+      top.second = top.second->outgoing_next;
+      if (!visited[dest->ordinal]) {
+        visited[dest->ordinal] = true;
+        stack.emplace_back(dest, dest->outgoing_edge_head);
+      }
+      continue;
+    }
+    rpo_.push_back(top.first);
+    stack.pop_back();
+  }
+  std::reverse(rpo_.begin(), rpo_.end());
+  for (uint32_t n = 0; n < rpo_.size(); ++n) {
+    rpo_numbers_[rpo_[n]->ordinal] = n;
+  }
+
+  idoms_.assign(count, kNone);
+  idoms_[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t n = 1; n < rpo_.size(); ++n) {
+      uint32_t new_idom = kNone;
+      auto edge = rpo_[n]->incoming_edge_head;
+      while (edge) {
+        uint32_t pred = edge->src->ordinal;
+        edge = edge->incoming_next;
+        if (idoms_[pred] == kNone) {
+          continue;
+        }
+        if (new_idom == kNone) {
+          new_idom = pred;
+          continue;
+        }
+        // Intersect.
+        uint32_t a = pred;
+        uint32_t b = new_idom;
+        while (a != b) {
+          while (rpo_numbers_[a] > rpo_numbers_[b]) {
+            a = idoms_[a];
+          }
+          while (rpo_numbers_[b] > rpo_numbers_[a]) {
+            b = idoms_[b];
+          }
+        }
+        new_idom = a;
+      }
+      if (idoms_[rpo_[n]->ordinal] != new_idom) {
+        idoms_[rpo_[n]->ordinal] = new_idom;
+        changed = true;
+      }
+    }
+  }
+
+  if (children_.size() < count) {
+    children_.resize(count);
+  }
+  for (uint32_t n = 0; n < count; ++n) {
+    children_[n].clear();
+  }
+  for (size_t n = 1; n < rpo_.size(); ++n) {
+    uint32_t ordinal = rpo_[n]->ordinal;
+    children_[idoms_[ordinal]].push_back(ordinal);
+  }
+  return true;
+}
+
+bool DominatorTree::Dominates(uint32_t a, uint32_t b) const {
+  // Immediate dominators always come earlier in reverse postorder.
+  while (rpo_numbers_[b] > rpo_numbers_[a]) {
+    b = idoms_[b];
+  }
+  return a == b;
+}
+
+}  // namespace compiler
+}  // namespace alloy
@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef ALLOY_COMPILER_DOMINATOR_TREE_H_
+#define ALLOY_COMPILER_DOMINATOR_TREE_H_
+
+#include <vector>
+
+#include <alloy/hir/hir_builder.h>
+
+namespace alloy {
+namespace compiler {
+
+// Dominators of the blocks reachable from the entry block.
+// Requires the CFG from ControlFlowAnalysisPass. It may be stale from later
+// simplifications, but only by having extra edges, which is safe.
+// Computing renumbers Block::ordinal in layout order; everything here is
+// indexed by it.
+class DominatorTree {
+ public:
+  static const uint32_t kNone = UINT32_MAX;
+
+  DominatorTree();
+  ~DominatorTree();
+
+  // Returns false if there are no blocks.
+  bool Compute(hir::HIRBuilder* builder);
+
+  uint32_t block_count() const {
+    return static_cast<uint32_t>(blocks_.size());
+  }
+  hir::Block* block(uint32_t ordinal) const { return blocks_[ordinal]; }
+  // Reachable blocks in reverse postorder, starting with the entry.
+  const std::vector<hir::Block*>& reverse_postorder() const { return rpo_; }
+
+  bool is_reachable(uint32_t ordinal) const {
+    return idoms_[ordinal] != kNone;
+  }
+  // The entry is its own immediate dominator. kNone if unreachable.
+  uint32_t idom(uint32_t ordinal) const { return idoms_[ordinal]; }
+  const std::vector<uint32_t>& children(uint32_t ordinal) const {
+    return children_[ordinal];
+  }
+  // Whether a dominates b. Both must be reachable.
+  bool Dominates(uint32_t a, uint32_t b) const;
+
+ private:
+  std::vector<hir::Block*> blocks_;
+  std::vector<hir::Block*> rpo_;
+  std::vector<uint32_t> rpo_numbers_;
+  std::vector<uint32_t> idoms_;
+  std::vector<std::vector<uint32_t>> children_;
+};
+
+}  // namespace compiler
+}  // namespace alloy
+
+#endif  // ALLOY_COMPILER_DOMINATOR_TREE_H_
@@ -0,0 +1,121 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/compiler/loop_analysis.h>
+
+#include <algorithm>
+
+namespace alloy {
+namespace compiler {
+
+using alloy::hir::Block;
+
+const uint32_t LoopAnalysis::kNone;
+
+LoopAnalysis::LoopAnalysis() : block_count_(0) {}
+
+LoopAnalysis::~LoopAnalysis() = default;
+
+void LoopAnalysis::Compute(const DominatorTree& dom_tree) {
+  loops_.clear();
+  block_count_ = dom_tree.block_count();
+
+  // Find back edges and walk backwards from their sources to the header.
+  std::vector<uint32_t> loop_map(block_count_, kNone);
+  std::vector<Block*> worklist;
+  for (auto header : dom_tree.reverse_postorder()) {
+    auto edge = header->incoming_edge_head;
+    while (edge) {
+      auto src = edge->src;
+      edge = edge->incoming_next;
+      if (!dom_tree.is_reachable(src->ordinal) ||
+          !dom_tree.Dominates(header->ordinal, src->ordinal)) {
+        continue;
+      }
+      uint32_t& index = loop_map[header->ordinal];
+      if (index == kNone) {
+        index = static_cast<uint32_t>(loops_.size());
+        loops_.emplace_back();
+        auto& loop = loops_.back();
+        loop.header = header;
+        loop.parent = kNone;
+        loop.depth = 1;
+        loop.block_count = 1;
+        loop.blocks.assign(block_count_, false);
+        loop.blocks[header->ordinal] = true;
+      }
+      auto& loop = loops_[index];
+      worklist.push_back(src);
+      while (!worklist.empty()) {
+        auto block = worklist.back();
+        worklist.pop_back();
+        if (loop.blocks[block->ordinal]) {
+          continue;
+        }
+        loop.blocks[block->ordinal] = true;
+        ++loop.block_count;
+        auto pred_edge = block->incoming_edge_head;
+        while (pred_edge) {
+          if (dom_tree.is_reachable(pred_edge->src->ordinal)) {
+            worklist.push_back(pred_edge->src);
+          }
+          pred_edge = pred_edge->incoming_next;
+        }
+      }
+    }
+  }
+
+  // Natural loops with different headers are either nested or disjoint, so
+  // the parent is the smallest larger loop containing the header.
+  std::stable_sort(loops_.begin(), loops_.end(),
+                   [](const Loop& a, const Loop& b) {
+                     return a.block_count < b.block_count;
+                   });
+  for (uint32_t n = 0; n < loops_.size(); ++n) {
+    auto& loop = loops_[n];
+    for (uint32_t m = n + 1; m < loops_.size(); ++m) {
+      if (Contains(m, loop.header)) {
+        loop.parent = m;
+        break;
+      }
+    }
+  }
+  for (uint32_t n = loop_count(); n-- > 0;) {
+    auto& loop = loops_[n];
+    loop.depth = loop.parent == kNone ? 1 : loops_[loop.parent].depth + 1;
+  }
+
+  for (uint32_t n = 0; n < block_count_; ++n) {
+    auto block = dom_tree.block(n);
+    block->loop_depth = 0;
+    for (uint32_t m = 0; m < loops_.size(); ++m) {
+      if (Contains(m, block)) {
+        ++block->loop_depth;
+      }
+    }
+  }
+}
+
+void LoopAnalysis::AddBlock(Block* block, uint32_t index) {
+  block->ordinal = static_cast<uint16_t>(block_count_++);
+  block->loop_depth = 0;
+  for (auto& loop : loops_) {
+    loop.blocks.push_back(false);
+  }
+  while (index != kNone) {
+    auto& loop = loops_[index];
+    loop.blocks[block->ordinal] = true;
+    ++loop.block_count;
+    ++block->loop_depth;
+    index = loop.parent;
+  }
+}
+
+}  // namespace compiler
+}  // namespace alloy
@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef ALLOY_COMPILER_LOOP_ANALYSIS_H_
+#define ALLOY_COMPILER_LOOP_ANALYSIS_H_
+
+#include <vector>
+
+#include <alloy/compiler/dominator_tree.h>
+
+namespace alloy {
+namespace compiler {
+
+// Natural loops: an edge to a block that dominates its source is a back edge,
+// and the loop is its target (the header) plus every block that can reach
+// the source without going through the header. Loops sharing a header are
+// merged. Irreducible cycles have no such edge and are not found.
+// Computing sets Block::loop_depth on every block.
+class LoopAnalysis {
+ public:
+  static const uint32_t kNone = UINT32_MAX;
+
+  struct Loop {
+    hir::Block* header;
+    // Smallest enclosing loop, or kNone.
+    uint32_t parent;
+    uint32_t depth;
+    uint32_t block_count;
+    // Membership by block ordinal.
+    std::vector<bool> blocks;
+  };
+
+  LoopAnalysis();
+  ~LoopAnalysis();
+
+  void Compute(const DominatorTree& dom_tree);
+
+  // Sorted by size, so inner loops come before those enclosing them.
+  uint32_t loop_count() const { return static_cast<uint32_t>(loops_.size()); }
+  const Loop& loop(uint32_t index) const { return loops_[index]; }
+  bool Contains(uint32_t index, const hir::Block* block) const {
+    return loops_[index].blocks[block->ordinal];
+  }
+
+  // Registers a block added after computing (such as a preheader), giving it
+  // the next ordinal and making it part of the given loop and those enclosing
+  // it. index may be kNone.
+  void AddBlock(hir::Block* block, uint32_t index);
+
+ private:
+  std::vector<Loop> loops_;
+  uint32_t block_count_;
+};
+
+}  // namespace compiler
+}  // namespace alloy
+
+#endif  // ALLOY_COMPILER_LOOP_ANALYSIS_H_
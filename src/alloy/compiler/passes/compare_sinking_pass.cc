@@ -0,0 +1,139 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/compiler/passes/compare_sinking_pass.h>
+
+#include <xenia/profiling.h>
+
+namespace alloy {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace alloy::hir;
+
+using alloy::hir::Block;
+using alloy::hir::HIRBuilder;
+using alloy::hir::Instr;
+
+CompareSinkingPass::CompareSinkingPass() : CompilerPass(), sunk_count_(0) {}
+
+CompareSinkingPass::~CompareSinkingPass() {}
+
+int CompareSinkingPass::Run(HIRBuilder* builder) {
+  SCOPE_profile_cpu_f("alloy");
+
+  sunk_count_ = 0;
+  auto block = builder->first_block();
+  while (block) {
+    SinkIntoBranch(block);
+    block = block->next;
+  }
+
+  return 0;
+}
+
+void CompareSinkingPass::SinkIntoBranch(Block* block) {
+  // The conditional branch may be followed by one for the fallthrough.
+  auto branch = block->instr_tail;
+  if (branch && branch->opcode == &OPCODE_BRANCH_info) {
+    branch = branch->prev;
+  }
+  if (!branch || (branch->opcode != &OPCODE_BRANCH_TRUE_info &&
+                  branch->opcode != &OPCODE_BRANCH_FALSE_info)) {
+    return;
+  }
+  auto compare = branch->src1.value->def;
+  if (!compare || compare->block != block || !IsCompare(compare)) {
+    return;
+  }
+
+  // Moving the compare down is only safe if everything using it in this
+  // block comes after the new position. Uses in other blocks are fine, as the
+  // compare still dominates them; the backend keeps the result around for
+  // them.
+  Instr* store = nullptr;
+  auto use = compare->dest->use_head;
+  while (use) {
+    auto user = use->instr;
+    if (user != branch && user->block == block) {
+      if (store || user->opcode != &OPCODE_STORE_CONTEXT_info ||
+          !CanSinkStore(user, branch)) {
+        return;
+      }
+      store = user;
+    }
+    use = use->next;
+  }
+
+  if (store) {
+    if (compare->next == store && store->next == branch) {
+      return;
+    }
+    store->MoveBefore(branch);
+    compare->MoveBefore(store);
+  } else {
+    if (compare->next == branch) {
+      return;
+    }
+    compare->MoveBefore(branch);
+  }
+  ++sunk_count_;
+}
+
+bool CompareSinkingPass::IsCompare(const Instr* i) {
+  switch (i->opcode->num) {
+    case OPCODE_COMPARE_EQ:
+    case OPCODE_COMPARE_NE:
+    case OPCODE_COMPARE_SLT:
+    case OPCODE_COMPARE_SLE:
+    case OPCODE_COMPARE_SGT:
+    case OPCODE_COMPARE_SGE:
+    case OPCODE_COMPARE_ULT:
+    case OPCODE_COMPARE_ULE:
+    case OPCODE_COMPARE_UGT:
+    case OPCODE_COMPARE_UGE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool CompareSinkingPass::CanSinkStore(const Instr* store,
+                                      const Instr* branch) {
+  // Compare results are single bytes.
+  uint32_t offset = static_cast<uint32_t>(store->src1.offset);
+  auto i = store->next;
+  while (i && i != branch) {
+    if (i->opcode->flags & OPCODE_FLAG_VOLATILE) {
+      return false;
+    }
+    if (i->opcode == &OPCODE_LOAD_CONTEXT_info) {
+      uint32_t load_offset = static_cast<uint32_t>(i->src1.offset);
+      uint32_t load_size = static_cast<uint32_t>(GetTypeSize(i->dest->type));
+      if (offset >= load_offset && offset < load_offset + load_size) {
+        return false;
+      }
+    } else if (i->opcode == &OPCODE_STORE_CONTEXT_info) {
+      uint32_t store_offset = static_cast<uint32_t>(i->src1.offset);
+      uint32_t store_size =
+          static_cast<uint32_t>(GetTypeSize(i->src2.value->type));
+      if (offset >= store_offset && offset < store_offset + store_size) {
+        return false;
+      }
+    }
+    i = i->next;
+  }
+  // Not found if the store was after the branch.
+  return i == branch;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace alloy
@@ -0,0 +1,52 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef ALLOY_COMPILER_PASSES_COMPARE_SINKING_PASS_H_
+#define ALLOY_COMPILER_PASSES_COMPARE_SINKING_PASS_H_
+
+#include <alloy/compiler/compiler_pass.h>
+
+namespace alloy {
+namespace compiler {
+namespace passes {
+
+// Moves the compare a conditional branch tests down to just before it, so
+// that backends can emit the two as a single compare-and-jump. A context
+// store of the compare result (a CR bit) moves along with it if nothing in
+// between touches the same byte:
+//   v0 = compare_eq v1, v2            store_context +8, v3
+//   store_context +4, v0              v0 = compare_eq v1, v2
+//   store_context +8, v3        -->   store_context +4, v0
+//   branch_true v0, label0            branch_true v0, label0
+// Should run late, after anything that could put instructions back in
+// between.
+class CompareSinkingPass : public CompilerPass {
+ public:
+  CompareSinkingPass();
+  ~CompareSinkingPass() override;
+
+  const char* name() const override { return "compare_sinking"; }
+  int Run(hir::HIRBuilder* builder) override;
+
+  // Compares moved in the last run.
+  uint32_t sunk_count() const { return sunk_count_; }
+
+ private:
+  void SinkIntoBranch(hir::Block* block);
+  bool IsCompare(const hir::Instr* i);
+  bool CanSinkStore(const hir::Instr* store, const hir::Instr* branch);
+
+  uint32_t sunk_count_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace alloy
+
+#endif  // ALLOY_COMPILER_PASSES_COMPARE_SINKING_PASS_H_
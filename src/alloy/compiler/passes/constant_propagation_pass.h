@@ -21,6 +21,7 @@ class ConstantPropagationPass : public CompilerPass {
   ConstantPropagationPass();
   ~ConstantPropagationPass() override;
 
+  const char* name() const override { return "constant_propagation"; }
   int Run(hir::HIRBuilder* builder) override;
 
  private:
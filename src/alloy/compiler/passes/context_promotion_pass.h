@@ -34,6 +34,7 @@ class ContextPromotionPass : public CompilerPass {
 
   int Initialize(Compiler* compiler) override;
 
+  const char* name() const override { return "context_promotion"; }
   int Run(hir::HIRBuilder* builder) override;
 
  private:
@@ -59,6 +59,15 @@ int ControlFlowAnalysisPass::Run(HIRBuilder* builder) {
       }
       instr = instr->prev;
     }
+    // Fall through to the next block unless it ends with an unconditional
+    // branch or return. These edges are never marked unconditional, so block
+    // merging is unaffected.
+    auto tail = block->instr_tail;
+    if (block->next &&
+        (!tail || (tail->opcode != &OPCODE_BRANCH_info &&
+                   tail->opcode != &OPCODE_RETURN_info))) {
+      builder->AddEdge(block, block->next, 0);
+    }
     block = block->next;
   }
 
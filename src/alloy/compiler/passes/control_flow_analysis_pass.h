@@ -21,6 +21,7 @@ class ControlFlowAnalysisPass : public CompilerPass {
   ControlFlowAnalysisPass();
   ~ControlFlowAnalysisPass() override;
 
+  const char* name() const override { return "control_flow_analysis"; }
   int Run(hir::HIRBuilder* builder) override;
 
  private:
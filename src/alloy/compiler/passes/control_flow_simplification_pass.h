@@ -21,6 +21,7 @@ class ControlFlowSimplificationPass : public CompilerPass {
   ControlFlowSimplificationPass();
   ~ControlFlowSimplificationPass() override;
 
+  const char* name() const override { return "control_flow_simplification"; }
   int Run(hir::HIRBuilder* builder) override;
 
  private:
@@ -10,24 +10,41 @@
 #ifndef ALLOY_COMPILER_PASSES_DATA_FLOW_ANALYSIS_PASS_H_
 #define ALLOY_COMPILER_PASSES_DATA_FLOW_ANALYSIS_PASS_H_
 
+#include <memory>
+#include <vector>
+
 #include <alloy/compiler/compiler_pass.h>
 
+namespace llvm {
+class BitVector;
+}  // namespace llvm
+
 
 namespace alloy {
 namespace compiler {
 namespace passes {
 
 
+// Computes the values live into and out of each block
+// (Block::incoming_values/outgoing_values), following all edges including
+// loop back edges. Requires ControlFlowAnalysisPass to have run.
 class DataFlowAnalysisPass : public CompilerPass {
 public:
   DataFlowAnalysisPass();
   ~DataFlowAnalysisPass() override;
 
+  const char* name() const override { return "data_flow_analysis"; }
   int Run(hir::HIRBuilder* builder) override;
 
 private:
   uint32_t LinearizeBlocks(hir::HIRBuilder* builder);
-  void AnalyzeFlow(hir::HIRBuilder* builder, uint32_t block_count);
+  void AllocateValueSets(hir::HIRBuilder* builder, uint32_t block_count);
+  void AnalyzeFlow(hir::HIRBuilder* builder);
+  void MarkLiveIn(hir::Value* value, hir::Block* block);
+
+  // Reused across runs; blocks point into this until the next run.
+  std::vector<std::unique_ptr<llvm::BitVector>> value_sets_;
+  std::vector<hir::Block*> worklist_;
 };
 
 
@@ -23,6 +23,7 @@ public:
   DeadCodeEliminationPass();
   ~DeadCodeEliminationPass() override;
 
+  const char* name() const override { return "dead_code_elimination"; }
   int Run(hir::HIRBuilder* builder) override;
 
 private:
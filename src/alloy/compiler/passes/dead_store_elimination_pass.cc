@@ -0,0 +1,216 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/compiler/passes/dead_store_elimination_pass.h>
+
+#include <gflags/gflags.h>
+
+#include <alloy/compiler/compiler.h>
+#include <alloy/runtime/runtime.h>
+#include <xenia/profiling.h>
+
+DECLARE_bool(store_all_context_values);
+
+namespace alloy {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace alloy::hir;
+
+using alloy::frontend::ContextInfo;
+using alloy::hir::Block;
+using alloy::hir::HIRBuilder;
+using alloy::hir::Instr;
+
+DeadStoreEliminationPass::DeadStoreEliminationPass()
+    : CompilerPass(), context_size_(0) {}
+
+DeadStoreEliminationPass::~DeadStoreEliminationPass() {}
+
+int DeadStoreEliminationPass::Initialize(Compiler* compiler) {
+  if (CompilerPass::Initialize(compiler)) {
+    return 1;
+  }
+
+  ContextInfo* context_info = runtime_->frontend()->context_info();
+  context_size_ = static_cast<uint32_t>(context_info->size());
+  live_.resize(context_size_);
+
+  return 0;
+}
+
+int DeadStoreEliminationPass::Run(HIRBuilder* builder) {
+  SCOPE_profile_cpu_f("alloy");
+
+  // Backwards liveness of context bytes:
+  //   store_context +100, v0  <-- removed, +100 is written on all paths
+  //   branch_true v1, label0      before being read
+  //   store_context +100, v2
+  //   ...
+  // label0:
+  //   store_context +100, v3
+  // Guest code we call or return to may read any of the context, so
+  // everything is live at calls, returns and other volatile instructions.
+  // The CFG may be stale from later simplifications, but only by having
+  // extra edges, which is safe.
+  if (FLAGS_store_all_context_values) {
+    return 0;
+  }
+
+  uint32_t block_count = 0;
+  auto block = builder->first_block();
+  while (block) {
+    block->ordinal = block_count++;
+    block = block->next;
+  }
+  if (block_states_.size() < block_count) {
+    block_states_.resize(block_count);
+  }
+
+  // Summarize each block, then iterate to a fixed point. Walking the blocks
+  // in reverse usually gets there in a couple of iterations.
+  block = builder->first_block();
+  while (block) {
+    SummarizeBlock(block, block_states_[block->ordinal]);
+    block = block->next;
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    block = builder->last_block();
+    while (block) {
+      auto& state = block_states_[block->ordinal];
+      ComputeLiveOut(block, live_);
+      live_.reset(state.kill);
+      live_ |= state.gen;
+      if (live_ != state.live_in) {
+        state.live_in = live_;
+        changed = true;
+      }
+      block = block->prev;
+    }
+  }
+
+  block = builder->first_block();
+  while (block) {
+    ComputeLiveOut(block, live_);
+    RemoveDeadStoresBlock(block, live_);
+    block = block->next;
+  }
+
+  return 0;
+}
+
+bool DeadStoreEliminationPass::ReadsAllContext(const Instr* instr) {
+  // Calls, returns, traps, etc. Conditional branches are marked volatile but
+  // only read their condition.
+  return instr->opcode->flags & OPCODE_FLAG_VOLATILE &&
+         instr->opcode != &OPCODE_BRANCH_TRUE_info &&
+         instr->opcode != &OPCODE_BRANCH_FALSE_info;
+}
+
+void DeadStoreEliminationPass::SetBytes(llvm::BitVector& bits,
+                                        const Instr* instr) {
+  // Only valid on context loads/stores.
+  size_t offset = instr->src1.offset;
+  size_t size = instr->opcode == &OPCODE_LOAD_CONTEXT_info
+                    ? GetTypeSize(instr->dest->type)
+                    : GetTypeSize(instr->src2.value->type);
+  assert_true(offset + size <= context_size_);
+  for (size_t n = offset; n < offset + size; ++n) {
+    bits.set(static_cast<uint32_t>(n));
+  }
+}
+
+void DeadStoreEliminationPass::ResetBytes(llvm::BitVector& bits,
+                                          const Instr* instr) {
+  size_t offset = instr->src1.offset;
+  size_t size = GetTypeSize(instr->src2.value->type);
+  for (size_t n = offset; n < offset + size; ++n) {
+    bits.reset(static_cast<uint32_t>(n));
+  }
+}
+
+bool DeadStoreEliminationPass::AnyBytes(const llvm::BitVector& bits,
+                                        const Instr* instr) {
+  size_t offset = instr->src1.offset;
+  size_t size = GetTypeSize(instr->src2.value->type);
+  for (size_t n = offset; n < offset + size; ++n) {
+    if (bits.test(static_cast<uint32_t>(n))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void DeadStoreEliminationPass::SummarizeBlock(Block* block,
+                                              BlockState& state) {
+  state.gen.reset();
+  state.gen.resize(context_size_);
+  state.kill.reset();
+  state.kill.resize(context_size_);
+  state.live_in.reset();
+  state.live_in.resize(context_size_);
+
+  Instr* i = block->instr_tail;
+  while (i) {
+    if (ReadsAllContext(i)) {
+      state.gen.set();
+      state.kill.set();
+    } else if (i->opcode == &OPCODE_LOAD_CONTEXT_info) {
+      SetBytes(state.gen, i);
+    } else if (i->opcode == &OPCODE_STORE_CONTEXT_info) {
+      ResetBytes(state.gen, i);
+      SetBytes(state.kill, i);
+    }
+    i = i->prev;
+  }
+  state.live_in = state.gen;
+}
+
+void DeadStoreEliminationPass::ComputeLiveOut(Block* block,
+                                              llvm::BitVector& live_out) {
+  live_out.reset();
+  if (!block->outgoing_edge_head) {
+    // Leaving the function; the caller sees everything.
+    live_out.set();
+    return;
+  }
+  auto edge = block->outgoing_edge_head;
+  while (edge) {
+    live_out |= block_states_[edge->dest->ordinal].live_in;
+    edge = edge->outgoing_next;
+  }
+}
+
+void DeadStoreEliminationPass::RemoveDeadStoresBlock(Block* block,
+                                                     llvm::BitVector& live) {
+  Instr* i = block->instr_tail;
+  while (i) {
+    Instr* prev = i->prev;
+    if (ReadsAllContext(i)) {
+      live.set();
+    } else if (i->opcode == &OPCODE_LOAD_CONTEXT_info) {
+      SetBytes(live, i);
+    } else if (i->opcode == &OPCODE_STORE_CONTEXT_info) {
+      if (AnyBytes(live, i)) {
+        ResetBytes(live, i);
+      } else {
+        // Overwritten before anything reads it.
+        i->Remove();
+      }
+    }
+    i = prev;
+  }
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace alloy
@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef ALLOY_COMPILER_PASSES_DEAD_STORE_ELIMINATION_PASS_H_
+#define ALLOY_COMPILER_PASSES_DEAD_STORE_ELIMINATION_PASS_H_
+
+#include <vector>
+
+#include <alloy/compiler/compiler_pass.h>
+
+#if XE_COMPILER_MSVC
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 4267)
+#include <llvm/ADT/BitVector.h>
+#pragma warning(pop)
+#else
+#include <cmath>
+#include <llvm/ADT/BitVector.h>
+#endif  // XE_COMPILER_MSVC
+
+namespace alloy {
+namespace compiler {
+namespace passes {
+
+// Removes context stores that are overwritten on every path before anything
+// can read them, across blocks.
+// Liveness is tracked per context byte so that partial overlaps (such as the
+// individually stored cr0 bytes vs. whole cr0 loads) are handled.
+// Requires the CFG from ControlFlowAnalysisPass.
+class DeadStoreEliminationPass : public CompilerPass {
+ public:
+  DeadStoreEliminationPass();
+  ~DeadStoreEliminationPass() override;
+
+  int Initialize(Compiler* compiler) override;
+
+  const char* name() const override { return "dead_store_elimination"; }
+  int Run(hir::HIRBuilder* builder) override;
+
+ private:
+  struct BlockState {
+    // Bytes read before being written in the block, and written before being
+    // read.
+    llvm::BitVector gen;
+    llvm::BitVector kill;
+    llvm::BitVector live_in;
+  };
+
+  bool ReadsAllContext(const hir::Instr* instr);
+  void SetBytes(llvm::BitVector& bits, const hir::Instr* instr);
+  void ResetBytes(llvm::BitVector& bits, const hir::Instr* instr);
+  bool AnyBytes(const llvm::BitVector& bits, const hir::Instr* instr);
+  void SummarizeBlock(hir::Block* block, BlockState& state);
+  void ComputeLiveOut(hir::Block* block, llvm::BitVector& live_out);
+  void RemoveDeadStoresBlock(hir::Block* block, llvm::BitVector& live);
+
+ private:
+  uint32_t context_size_;
+  std::vector<BlockState> block_states_;
+  llvm::BitVector live_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace alloy
+
+#endif  // ALLOY_COMPILER_PASSES_DEAD_STORE_ELIMINATION_PASS_H_
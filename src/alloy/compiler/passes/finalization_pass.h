@@ -21,6 +21,7 @@ class FinalizationPass : public CompilerPass {
   FinalizationPass();
   ~FinalizationPass() override;
 
+  const char* name() const override { return "finalization"; }
   int Run(hir::HIRBuilder* builder) override;
 
  private:
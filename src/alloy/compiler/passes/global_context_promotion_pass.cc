@@ -0,0 +1,206 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/compiler/passes/global_context_promotion_pass.h>
+
+#include <algorithm>
+
+#include <xenia/profiling.h>
+
+namespace alloy {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace alloy::hir;
+
+using alloy::hir::Block;
+using alloy::hir::HIRBuilder;
+using alloy::hir::Instr;
+using alloy::hir::Value;
+
+namespace {
+
+// Largest context load/store (vec128).
+const uint32_t kMaxSlotSize = 16;
+
+// Loads define the slot when it isn't known, so a slot can go from one value
+// to another as its predecessors are narrowed down. That settles quickly in
+// practice, but don't rely on it.
+const uint32_t kMaxIterations = 32;
+
+// Looks through assigns so that copies of the same value merge.
+Value* Resolve(Value* value) {
+  while (value->def && value->def->opcode == &OPCODE_ASSIGN_info) {
+    value = value->def->src1.value;
+  }
+  return value;
+}
+
+// Branches only end the block; everything else volatile may touch the
+// context (calls, externs, traps, etc).
+bool ClobbersContext(const Instr* i) {
+  return i->opcode->flags & OPCODE_FLAG_VOLATILE &&
+         i->opcode != &OPCODE_BRANCH_TRUE_info &&
+         i->opcode != &OPCODE_BRANCH_FALSE_info &&
+         i->opcode != &OPCODE_RETURN_info &&
+         i->opcode != &OPCODE_RETURN_TRUE_info;
+}
+
+}  // namespace
+
+GlobalContextPromotionPass::GlobalContextPromotionPass()
+    : CompilerPass(), stats_({0}) {}
+
+GlobalContextPromotionPass::~GlobalContextPromotionPass() {}
+
+int GlobalContextPromotionPass::Run(HIRBuilder* builder) {
+  SCOPE_profile_cpu_f("alloy");
+
+  stats_ = {0};
+  if (!dom_tree_.Compute(builder)) {
+    return 0;
+  }
+  uint32_t block_count = dom_tree_.block_count();
+  if (out_slots_.size() < block_count) {
+    out_slots_.resize(block_count);
+  }
+  computed_.assign(block_count, false);
+
+  // Forward dataflow to a fixed point. Blocks not yet computed don't limit
+  // what their successors know, so loops start out optimistic and are
+  // narrowed down on later iterations.
+  auto& rpo = dom_tree_.reverse_postorder();
+  bool changed = true;
+  for (uint32_t iteration = 0; changed; ++iteration) {
+    if (iteration == kMaxIterations) {
+      return 0;
+    }
+    changed = false;
+    for (auto block : rpo) {
+      MeetPredecessors(block, scratch_);
+      Transfer(block, scratch_, false);
+      auto& out_slots = out_slots_[block->ordinal];
+      if (!computed_[block->ordinal] || out_slots != scratch_) {
+        out_slots.swap(scratch_);
+        computed_[block->ordinal] = true;
+        changed = true;
+      }
+    }
+  }
+
+  // Promote with what is known on entry to each block. Promoting doesn't
+  // change what is known on exit, as a promoted load leaves the slot as is.
+  for (auto block : rpo) {
+    MeetPredecessors(block, scratch_);
+    Transfer(block, scratch_, true);
+  }
+
+  return 0;
+}
+
+void GlobalContextPromotionPass::MeetPredecessors(Block* block,
+                                                  SlotSet& slots) {
+  slots.clear();
+  if (block->ordinal == 0) {
+    // Nothing is known coming into the function.
+    return;
+  }
+  bool first = true;
+  auto edge = block->incoming_edge_head;
+  while (edge) {
+    auto src = edge->src;
+    edge = edge->incoming_next;
+    if (!dom_tree_.is_reachable(src->ordinal) || !computed_[src->ordinal]) {
+      continue;
+    }
+    auto& src_slots = out_slots_[src->ordinal];
+    if (first) {
+      slots = src_slots;
+      first = false;
+      continue;
+    }
+    // Keep only slots with the same value on both sides.
+    auto it = slots.begin();
+    auto src_it = src_slots.begin();
+    auto out = slots.begin();
+    while (it != slots.end() && src_it != src_slots.end()) {
+      if (it->offset < src_it->offset) {
+        ++it;
+      } else if (src_it->offset < it->offset) {
+        ++src_it;
+      } else {
+        if (it->value == src_it->value) {
+          *out++ = *it;
+        }
+        ++it;
+        ++src_it;
+      }
+    }
+    slots.erase(out, slots.end());
+  }
+}
+
+void GlobalContextPromotionPass::Transfer(Block* block, SlotSet& slots,
+                                          bool promote) {
+  auto i = block->instr_head;
+  while (i) {
+    if (ClobbersContext(i)) {
+      slots.clear();
+    } else if (i->opcode == &OPCODE_LOAD_CONTEXT_info) {
+      uint32_t offset = static_cast<uint32_t>(i->src1.offset);
+      auto it = std::lower_bound(
+          slots.begin(), slots.end(), offset,
+          [](const Slot& slot, uint32_t offset) {
+            return slot.offset < offset;
+          });
+      if (promote) {
+        ++stats_.load_count;
+      }
+      if (it != slots.end() && it->offset == offset &&
+          it->value->type == i->dest->type) {
+        if (promote) {
+          i->Replace(&OPCODE_ASSIGN_info, 0);
+          i->set_src1(it->value);
+          ++stats_.promoted_count;
+        }
+      } else {
+        SetSlot(slots, offset, i->dest);
+      }
+    } else if (i->opcode == &OPCODE_STORE_CONTEXT_info) {
+      SetSlot(slots, static_cast<uint32_t>(i->src1.offset),
+              Resolve(i->src2.value));
+    }
+    i = i->next;
+  }
+}
+
+void GlobalContextPromotionPass::SetSlot(SlotSet& slots, uint32_t offset,
+                                         Value* value) {
+  // Forget anything overlapping the new value first.
+  uint32_t end = offset + static_cast<uint32_t>(GetTypeSize(value->type));
+  uint32_t first_offset = offset >= kMaxSlotSize ? offset - kMaxSlotSize : 0;
+  auto it = std::lower_bound(
+      slots.begin(), slots.end(), first_offset,
+      [](const Slot& slot, uint32_t offset) { return slot.offset < offset; });
+  while (it != slots.end() && it->offset < end) {
+    uint32_t slot_end =
+        it->offset + static_cast<uint32_t>(GetTypeSize(it->value->type));
+    if (slot_end > offset) {
+      it = slots.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  slots.insert(it, {offset, value});
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace alloy
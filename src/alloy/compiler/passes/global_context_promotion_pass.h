@@ -0,0 +1,80 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef ALLOY_COMPILER_PASSES_GLOBAL_CONTEXT_PROMOTION_PASS_H_
+#define ALLOY_COMPILER_PASSES_GLOBAL_CONTEXT_PROMOTION_PASS_H_
+
+#include <vector>
+
+#include <alloy/compiler/compiler_pass.h>
+#include <alloy/compiler/dominator_tree.h>
+
+namespace alloy {
+namespace compiler {
+namespace passes {
+
+// ContextPromotionPass across blocks. The value known to be in each context
+// slot is carried along the CFG, and at joins a slot stays known if every
+// predecessor has the same value in it:
+//   v0 = load_context +8             v0 = load_context +8
+//   branch_true v1, label0           branch_true v1, label0
+//   ...                        -->   ...
+// label0:                          label0:
+//   v2 = load_context +8             v2 = v0
+// Loads of a known slot (of the same type) are turned into assigns for
+// SimplificationPass to fold. Stores make their value known, and calls and
+// other volatile instructions forget everything.
+// Requires the CFG from ControlFlowAnalysisPass. It may be stale from later
+// simplifications, but only by having extra edges, which is safe.
+class GlobalContextPromotionPass : public CompilerPass {
+ public:
+  struct Stats {
+    // Context loads seen, before any were promoted.
+    uint32_t load_count;
+    uint32_t promoted_count;
+  };
+
+  GlobalContextPromotionPass();
+  ~GlobalContextPromotionPass() override;
+
+  const char* name() const override { return "global_context_promotion"; }
+  int Run(hir::HIRBuilder* builder) override;
+
+  // Stats from the last run.
+  const Stats& stats() const { return stats_; }
+
+ private:
+  struct Slot {
+    uint32_t offset;
+    hir::Value* value;
+    bool operator==(const Slot& other) const {
+      return offset == other.offset && value == other.value;
+    }
+  };
+  // Known slots, sorted by offset.
+  typedef std::vector<Slot> SlotSet;
+
+  void MeetPredecessors(hir::Block* block, SlotSet& slots);
+  void Transfer(hir::Block* block, SlotSet& slots, bool promote);
+  void SetSlot(SlotSet& slots, uint32_t offset, hir::Value* value);
+
+  DominatorTree dom_tree_;
+  // By block ordinal.
+  std::vector<SlotSet> out_slots_;
+  std::vector<bool> computed_;
+  SlotSet scratch_;
+
+  Stats stats_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace alloy
+
+#endif  // ALLOY_COMPILER_PASSES_GLOBAL_CONTEXT_PROMOTION_PASS_H_
@@ -0,0 +1,237 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/compiler/passes/loop_invariant_code_motion_pass.h>
+
+#include <xenia/profiling.h>
+
+namespace alloy {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace alloy::hir;
+
+using alloy::hir::Block;
+using alloy::hir::HIRBuilder;
+using alloy::hir::Instr;
+using alloy::hir::Value;
+
+LoopInvariantCodeMotionPass::LoopInvariantCodeMotionPass()
+    : CompilerPass(), context_clobbered_(false), hoisted_count_(0) {}
+
+LoopInvariantCodeMotionPass::~LoopInvariantCodeMotionPass() {}
+
+int LoopInvariantCodeMotionPass::Run(HIRBuilder* builder) {
+  SCOPE_profile_cpu_f("alloy");
+
+  hoisted_count_ = 0;
+  if (!dom_tree_.Compute(builder)) {
+    return 0;
+  }
+  loops_.Compute(dom_tree_);
+  for (uint32_t n = 0; n < loops_.loop_count(); ++n) {
+    ProcessLoop(builder, n);
+  }
+
+  return 0;
+}
+
+void LoopInvariantCodeMotionPass::ProcessLoop(HIRBuilder* builder,
+                                              uint32_t index) {
+  // Gather what the loop does to the context.
+  context_stores_.clear();
+  context_clobbered_ = false;
+  auto block = builder->first_block();
+  while (block) {
+    if (loops_.Contains(index, block)) {
+      auto i = block->instr_head;
+      while (i) {
+        if (i->opcode == &OPCODE_STORE_CONTEXT_info) {
+          uint32_t offset = static_cast<uint32_t>(i->src1.offset);
+          context_stores_.emplace_back(
+              offset, offset + uint32_t(GetTypeSize(i->src2.value->type)));
+        } else if (i->opcode->flags & OPCODE_FLAG_VOLATILE &&
+                   i->opcode != &OPCODE_BRANCH_TRUE_info &&
+                   i->opcode != &OPCODE_BRANCH_FALSE_info &&
+                   i->opcode != &OPCODE_RETURN_info &&
+                   i->opcode != &OPCODE_RETURN_TRUE_info) {
+          // Calls and the like.
+          context_clobbered_ = true;
+        }
+        i = i->next;
+      }
+    }
+    block = block->next;
+  }
+
+  // Anything hoisted may make its users invariant, so go until nothing
+  // changes. They are appended in order, so defs stay before uses.
+  Block* preheader = nullptr;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    block = builder->first_block();
+    while (block) {
+      if (loops_.Contains(index, block)) {
+        auto i = block->instr_head;
+        while (i) {
+          auto next = i->next;
+          if (IsInvariant(index, i)) {
+            if (!preheader) {
+              preheader = GetPreheader(builder, index);
+              if (!preheader) {
+                return;
+              }
+            }
+            Hoist(i, preheader);
+            changed = true;
+          }
+          i = next;
+        }
+      }
+      block = block->next;
+    }
+  }
+}
+
+bool LoopInvariantCodeMotionPass::IsInvariant(uint32_t index,
+                                              const Instr* i) {
+  auto opcode = i->opcode;
+  uint32_t signature = opcode->signature;
+  if (GET_OPCODE_SIG_TYPE_DEST(signature) != OPCODE_SIG_TYPE_V) {
+    return false;
+  }
+  if (opcode->flags & (OPCODE_FLAG_VOLATILE | OPCODE_FLAG_BRANCH |
+                       OPCODE_FLAG_MEMORY | OPCODE_FLAG_PAIRED_PREV)) {
+    return false;
+  }
+  // did_carry/etc read the host flags of the instruction before them.
+  if (i->next && i->next->opcode->flags & OPCODE_FLAG_PAIRED_PREV) {
+    return false;
+  }
+  // Division may be guarded by a zero check somewhere in the loop and must
+  // not run before it.
+  if (opcode == &OPCODE_LOAD_CLOCK_info || opcode == &OPCODE_LOAD_LOCAL_info ||
+      opcode == &OPCODE_ATOMIC_ADD_info || opcode == &OPCODE_ATOMIC_SUB_info ||
+      opcode == &OPCODE_DIV_info) {
+    return false;
+  }
+
+  if (opcode == &OPCODE_LOAD_CONTEXT_info) {
+    if (context_clobbered_) {
+      return false;
+    }
+    uint32_t start = static_cast<uint32_t>(i->src1.offset);
+    uint32_t end = start + uint32_t(GetTypeSize(i->dest->type));
+    for (auto& range : context_stores_) {
+      if (start < range.second && range.first < end) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  auto IsOutside = [&](const Value* value) {
+    return value->IsConstant() || !value->def ||
+           !loops_.Contains(index, value->def->block);
+  };
+  if (GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V &&
+      !IsOutside(i->src1.value)) {
+    return false;
+  }
+  if (GET_OPCODE_SIG_TYPE_SRC2(signature) == OPCODE_SIG_TYPE_V &&
+      !IsOutside(i->src2.value)) {
+    return false;
+  }
+  if (GET_OPCODE_SIG_TYPE_SRC3(signature) == OPCODE_SIG_TYPE_V &&
+      !IsOutside(i->src3.value)) {
+    return false;
+  }
+  return true;
+}
+
+Block* LoopInvariantCodeMotionPass::GetPreheader(HIRBuilder* builder,
+                                                 uint32_t index) {
+  auto& loop = loops_.loop(index);
+  auto header = loop.header;
+
+  // Use the block before the loop if it is the only way in and goes nowhere
+  // else. It must not end in a call, as the context may change across it.
+  Block* outside = nullptr;
+  uint32_t outside_count = 0;
+  auto edge = header->incoming_edge_head;
+  while (edge) {
+    if (!loops_.Contains(index, edge->src)) {
+      outside = edge->src;
+      ++outside_count;
+    }
+    edge = edge->incoming_next;
+  }
+  if (outside_count == 1 && header != builder->first_block() &&
+      !outside->outgoing_edge_head->outgoing_next) {
+    auto tail = outside->instr_tail;
+    if (!tail || tail->opcode == &OPCODE_BRANCH_info ||
+        !(tail->opcode->flags & OPCODE_FLAG_BRANCH)) {
+      return outside;
+    }
+  }
+
+  // Otherwise add one right before the header. If the block there is part of
+  // the loop and falls into the header it would be run on every iteration.
+  auto prev = header->prev;
+  if (prev && loops_.Contains(index, prev) &&
+      (!prev->instr_tail || prev->instr_tail->opcode != &OPCODE_BRANCH_info)) {
+    return nullptr;
+  }
+  auto preheader = builder->InsertBlockBefore(header);
+  loops_.AddBlock(preheader, loop.parent);
+  auto label = builder->NewLabel();
+  builder->MarkLabel(label, preheader);
+
+  // Everything from outside the loop now goes through the preheader. The
+  // block before it (if any) falls through into it as before.
+  edge = header->incoming_edge_head;
+  while (edge) {
+    auto src = edge->src;
+    edge = edge->incoming_next;
+    if (loops_.Contains(index, src)) {
+      continue;
+    }
+    auto i = src->instr_head;
+    while (i) {
+      if (i->opcode == &OPCODE_BRANCH_info) {
+        if (i->src1.label->block == header) {
+          i->src1.label = label;
+        }
+      } else if (i->opcode == &OPCODE_BRANCH_TRUE_info ||
+                 i->opcode == &OPCODE_BRANCH_FALSE_info) {
+        if (i->src2.label->block == header) {
+          i->src2.label = label;
+        }
+      }
+      i = i->next;
+    }
+  }
+  return preheader;
+}
+
+void LoopInvariantCodeMotionPass::Hoist(Instr* i, Block* preheader) {
+  auto tail = preheader->instr_tail;
+  if (tail && tail->opcode == &OPCODE_BRANCH_info) {
+    i->MoveBefore(tail);
+  } else {
+    i->MoveToEnd(preheader);
+  }
+  ++hoisted_count_;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace alloy
@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef ALLOY_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
+#define ALLOY_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
+
+#include <utility>
+#include <vector>
+
+#include <alloy/compiler/compiler_pass.h>
+#include <alloy/compiler/dominator_tree.h>
+#include <alloy/compiler/loop_analysis.h>
+
+namespace alloy {
+namespace compiler {
+namespace passes {
+
+// Moves instructions computing the same thing on every iteration of a loop
+// into its preheader, a block run once right before entering it:
+//   loop:                              v1 = add v0, 4
+//     v1 = add v0, 4          -->    loop:
+//     v2 = load_context +16            ...
+//     ...                              branch_true v3, loop
+//     branch_true v3, loop
+// Pure arithmetic is moved once all of its operands come from outside the
+// loop. Context loads are moved when nothing in the loop stores to the same
+// bytes and the loop has no calls or other volatile instructions. Guest
+// memory loads are left alone.
+// Inner loops are done first, so that whatever they hoist can move out of
+// the enclosing loops too. Blocks get their loop depth set, which the
+// register allocator uses to keep the hoisted values in registers.
+// Requires the CFG from ControlFlowAnalysisPass and leaves it stale; run it
+// again afterwards.
+class LoopInvariantCodeMotionPass : public CompilerPass {
+ public:
+  LoopInvariantCodeMotionPass();
+  ~LoopInvariantCodeMotionPass() override;
+
+  const char* name() const override { return "loop_invariant_code_motion"; }
+  int Run(hir::HIRBuilder* builder) override;
+
+  // Instructions hoisted in the last run.
+  uint32_t hoisted_count() const { return hoisted_count_; }
+
+ private:
+  void ProcessLoop(hir::HIRBuilder* builder, uint32_t index);
+  bool IsInvariant(uint32_t index, const hir::Instr* i);
+  hir::Block* GetPreheader(hir::HIRBuilder* builder, uint32_t index);
+  void Hoist(hir::Instr* i, hir::Block* preheader);
+
+  DominatorTree dom_tree_;
+  LoopAnalysis loops_;
+
+  // Context bytes stored to by the current loop, as [start, end) ranges.
+  std::vector<std::pair<uint32_t, uint32_t>> context_stores_;
+  // Whether the current loop may change the context in other ways.
+  bool context_clobbered_;
+
+  uint32_t hoisted_count_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace alloy
+
+#endif  // ALLOY_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
@@ -11,8 +11,19 @@
 
 #include <algorithm>
 
+#include <poly/math.h>
 #include <xenia/profiling.h>
 
+#if XE_COMPILER_MSVC
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 4267)
+#include <llvm/ADT/BitVector.h>
+#pragma warning(pop)
+#else
+#include <llvm/ADT/BitVector.h>
+#endif  // XE_COMPILER_MSVC
+
 namespace alloy {
 namespace compiler {
 namespace passes {
@@ -24,539 +35,425 @@ using alloy::backend::MachineInfo;
 using alloy::hir::HIRBuilder;
 using alloy::hir::Instr;
 using alloy::hir::OpcodeSignatureType;
-using alloy::hir::RegAssignment;
 using alloy::hir::TypeName;
 using alloy::hir::Value;
 
-#define ASSERT_NO_CYCLES 0
+namespace {
+
+bool IsCall(const Instr* instr) {
+  // Guest code doesn't preserve any of our registers. Extern calls preserve
+  // the integer ones in the thunk, but the host ABI may not keep the vector
+  // ones, so those are treated the same.
+  return instr->opcode == &OPCODE_CALL_info ||
+         instr->opcode == &OPCODE_CALL_TRUE_info ||
+         instr->opcode == &OPCODE_CALL_INDIRECT_info ||
+         instr->opcode == &OPCODE_CALL_INDIRECT_TRUE_info ||
+         instr->opcode == &OPCODE_CALL_EXTERN_info;
+}
+
+}  // namespace
 
 RegisterAllocationPass::RegisterAllocationPass(const MachineInfo* machine_info)
-    : CompilerPass() {
-  // Initialize register sets.
-  // TODO(benvanik): rewrite in a way that makes sense - this is terrible.
+    : CompilerPass(),
+      set_count_(0),
+      int_set_index_(0),
+      float_set_index_(0),
+      vec_set_index_(0) {
+  memset(&stats_, 0, sizeof(stats_));
   auto mi_sets = machine_info->register_sets;
-  memset(&usage_sets_, 0, sizeof(usage_sets_));
-  uint32_t n = 0;
-  while (mi_sets[n].count) {
-    auto& mi_set = mi_sets[n];
-    auto usage_set = new RegisterSetUsage();
-    usage_sets_.all_sets[n] = usage_set;
-    usage_set->count = mi_set.count;
-    usage_set->set = &mi_set;
+  while (set_count_ < poly::countof(sets_) && mi_sets[set_count_].count) {
+    auto& mi_set = mi_sets[set_count_];
+    auto& usage_set = sets_[set_count_];
+    usage_set.set = &mi_set;
+    usage_set.count = std::min(mi_set.count, 32u);
+    usage_set.free_mask = 0;
     if (mi_set.types & MachineInfo::RegisterSet::INT_TYPES) {
-      usage_sets_.int_set = usage_set;
+      int_set_index_ = set_count_;
     }
     if (mi_set.types & MachineInfo::RegisterSet::FLOAT_TYPES) {
-      usage_sets_.float_set = usage_set;
+      float_set_index_ = set_count_;
     }
     if (mi_set.types & MachineInfo::RegisterSet::VEC_TYPES) {
-      usage_sets_.vec_set = usage_set;
+      vec_set_index_ = set_count_;
     }
-    n++;
+    set_count_++;
   }
 }
 
-RegisterAllocationPass::~RegisterAllocationPass() {
-  for (size_t n = 0; n < poly::countof(usage_sets_.all_sets); n++) {
-    if (!usage_sets_.all_sets[n]) {
+RegisterAllocationPass::~RegisterAllocationPass() = default;
+
+int RegisterAllocationPass::Run(HIRBuilder* builder) {
+  SCOPE_profile_cpu_f("alloy");
+
+  memset(&stats_, 0, sizeof(stats_));
+  stats_.instr_count_before = NumberInstructions(builder);
+  fixed_values_.clear();
+
+  // Allocate, split whatever didn't fit and go again until everything fits.
+  // Split values and their reloads are never split again, so this ends.
+  while (true) {
+    NumberInstructions(builder);
+    BuildIntervals(builder);
+    if (AllocateIntervals()) {
+      PLOGE("Register allocation failed");
+      assert_always();
+      return 1;
+    }
+    if (split_list_.empty()) {
       break;
     }
-    delete usage_sets_.all_sets[n];
+    for (auto value : split_list_) {
+      SplitValue(builder, value);
+    }
   }
-}
+  stats_.instr_count_after = NumberInstructions(builder);
 
-int RegisterAllocationPass::Run(HIRBuilder* builder) {
-  SCOPE_profile_cpu_f("alloy");
+  for (auto& interval : intervals_) {
+    interval.value->reg.set = sets_[interval.set_index].set;
+    interval.value->reg.index = interval.reg;
+  }
 
-  // Simple per-block allocator that operates on SSA form.
-  // Registers do not move across blocks, though this could be
-  // optimized with some intra-block analysis (dominators/etc).
-  // Really, it'd just be nice to have someone who knew what they
-  // were doing lower SSA and do this right.
+  return 0;
+}
 
+uint32_t RegisterAllocationPass::NumberInstructions(HIRBuilder* builder) {
+  // Sequential block and global instruction ordinals. Blocks are laid out
+  // in the order they are emitted, which is what the intervals describe.
   uint32_t block_ordinal = 0;
   uint32_t instr_ordinal = 0;
   auto block = builder->first_block();
   while (block) {
-    // Sequential block ordinals.
     block->ordinal = block_ordinal++;
-
-    // Reset all state.
-    PrepareBlockState();
-
-    // Renumber all instructions in the block. This is required so that
-    // we can sort the usage pointers below.
     auto instr = block->instr_head;
     while (instr) {
-      // Sequential global instruction ordinals.
       instr->ordinal = instr_ordinal++;
       instr = instr->next;
     }
+    block = block->next;
+  }
+  return instr_ordinal;
+}
+
+void RegisterAllocationPass::BuildIntervals(HIRBuilder* builder) {
+  uint32_t value_count = builder->max_value_ordinal() + 1;
+  intervals_.clear();
+  intervals_.reserve(value_count);
+  interval_map_.assign(value_count, 0);
+  values_.assign(value_count, nullptr);
+  fixed_values_.resize(value_count, false);
+  call_positions_.clear();
 
-    instr = block->instr_head;
+  // Defs and uses.
+  auto block = builder->first_block();
+  while (block) {
+    auto instr = block->instr_head;
     while (instr) {
-      const auto info = instr->opcode;
-      uint32_t signature = info->signature;
-
-      // Update the register use heaps.
-      AdvanceUses(instr);
-
-      // Check sources for retirement. If any are unused after this instruction
-      // we can eagerly evict them to speed up register allocation.
-      // Since X64 (and other platforms) can often take advantage of dest==src1
-      // register mappings we track retired src1 so that we can attempt to
-      // reuse it.
-      // NOTE: these checks require that the usage list be sorted!
-      bool has_preferred_reg = false;
-      RegAssignment preferred_reg = {0};
-      if (GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V &&
-          !instr->src1.value->IsConstant()) {
-        if (!instr->src1_use->next) {
-          // Pull off preferred register. We will try to reuse this for the
-          // dest.
-          // NOTE: set may be null if this is a store local.
-          if (preferred_reg.set) {
-            has_preferred_reg = true;
-            preferred_reg = instr->src1.value->reg;
-          }
+      uint32_t position = instr->ordinal * 2;
+      uint32_t signature = instr->opcode->signature;
+      if (GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V) {
+        auto value = instr->src1.value;
+        if (!value->IsConstant() && value->def) {
+          ExtendInterval(value, position, block->loop_depth);
         }
       }
-
-      if (GET_OPCODE_SIG_TYPE_DEST(signature) == OPCODE_SIG_TYPE_V) {
-        // Must not have been set already.
-        assert_null(instr->dest->reg.set);
-
-        // Sort the usage list. We depend on this in future uses of this
-        // variable.
-        SortUsageList(instr->dest);
-
-        // If we have a preferred register, use that.
-        // This way we can help along the stupid X86 two opcode instructions.
-        bool allocated;
-        if (has_preferred_reg) {
-          // Allocate with the given preferred register. If the register is in
-          // the wrong set it will not be reused.
-          allocated = TryAllocateRegister(instr->dest, preferred_reg);
-        } else {
-          // Allocate a register. This will either reserve a free one or
-          // spill and reuse an active one.
-          allocated = TryAllocateRegister(instr->dest);
+      if (GET_OPCODE_SIG_TYPE_SRC2(signature) == OPCODE_SIG_TYPE_V) {
+        auto value = instr->src2.value;
+        if (!value->IsConstant() && value->def) {
+          ExtendInterval(value, position, block->loop_depth);
         }
-        if (!allocated) {
-          // Failed to allocate register -- need to spill and try again.
-          // We spill only those registers we aren't using.
-          if (!SpillOneRegister(builder, block, instr->dest->type)) {
-            // Unable to spill anything - this shouldn't happen.
-            PLOGE("Unable to spill any registers");
-            assert_always();
-            return 1;
-          }
-
-          // Demand allocation.
-          if (!TryAllocateRegister(instr->dest)) {
-            // Boned.
-            PLOGE("Register allocation failed");
-            assert_always();
-            return 1;
-          }
+      }
+      if (GET_OPCODE_SIG_TYPE_SRC3(signature) == OPCODE_SIG_TYPE_V) {
+        auto value = instr->src3.value;
+        if (!value->IsConstant() && value->def) {
+          ExtendInterval(value, position, block->loop_depth);
         }
       }
-
+      if (GET_OPCODE_SIG_TYPE_DEST(signature) == OPCODE_SIG_TYPE_V) {
+        // The register is written here even if the value is never read, so
+        // the interval must cover the instruction itself.
+        values_[instr->dest->ordinal] = instr->dest;
+        ExtendInterval(instr->dest, position, block->loop_depth);
+        ExtendInterval(instr->dest, position + 1);
+      }
+      if (IsCall(instr)) {
+        call_positions_.push_back(position);
+      }
       instr = instr->next;
     }
     block = block->next;
   }
 
-  return 0;
-}
+  // Values live across block boundaries. Split values are now only live
+  // between their def and the store, and their reloads are all block local.
+  // Without the liveness from DataFlowAnalysisPass the intervals can't follow
+  // values around loops or into later blocks, so only block local values get
+  // registers then and everything else is split.
+  bool has_liveness = true;
+  block = builder->first_block();
+  while (block) {
+    if (block->instr_head && !block->incoming_values) {
+      has_liveness = false;
+      break;
+    }
+    block = block->next;
+  }
+  block = builder->first_block();
+  while (has_liveness && block) {
+    if (block->instr_head) {
+      uint32_t start_position = block->instr_head->ordinal * 2;
+      uint32_t end_position = block->instr_tail->ordinal * 2 + 1;
+      auto& incoming_values = *block->incoming_values;
+      for (int n = incoming_values.find_first(); n != -1;
+           n = incoming_values.find_next(n)) {
+        if (uint32_t(n) < value_count && values_[n] && !fixed_values_[n]) {
+          ExtendInterval(values_[n], start_position);
+        }
+      }
+      auto& outgoing_values = *block->outgoing_values;
+      for (int n = outgoing_values.find_first(); n != -1;
+           n = outgoing_values.find_next(n)) {
+        if (uint32_t(n) < value_count && values_[n] && !fixed_values_[n]) {
+          ExtendInterval(values_[n], end_position);
+        }
+      }
+    }
+    block = block->next;
+  }
 
-void RegisterAllocationPass::DumpUsage(const char* name) {
-#if 0
-  fprintf(stdout, "\n%s:\n", name);
-  for (size_t i = 0; i < poly::countof(usage_sets_.all_sets); ++i) {
-    auto usage_set = usage_sets_.all_sets[i];
-    if (usage_set) {
-      fprintf(stdout, "set %s:\n", usage_set->set->name);
-      fprintf(stdout, "  avail: %s\n", usage_set->availability.to_string().c_str());
-      fprintf(stdout, "  upcoming uses:\n");
-      for (auto it = usage_set->upcoming_uses.begin();
-           it != usage_set->upcoming_uses.end(); ++it) {
-        fprintf(stdout, "    v%d, used at %d\n",
-                it->value->ordinal,
-                it->use->instr->ordinal);
+  // Calls clobber our registers.
+  for (auto& interval : intervals_) {
+    interval.can_spill = !fixed_values_[interval.value->ordinal];
+    if (interval.can_spill) {
+      auto it = std::upper_bound(call_positions_.begin(),
+                                 call_positions_.end(), interval.start);
+      interval.must_spill = it != call_positions_.end() && *it < interval.end;
+      if (!has_liveness) {
+        auto def_block = interval.value->def->block;
+        for (auto use = interval.value->use_head; use; use = use->next) {
+          if (use->instr->block != def_block) {
+            interval.must_spill = true;
+            break;
+          }
+        }
       }
     }
   }
-  fflush(stdout);
-#endif
 }
 
-void RegisterAllocationPass::PrepareBlockState() {
-  for (size_t i = 0; i < poly::countof(usage_sets_.all_sets); ++i) {
-    auto usage_set = usage_sets_.all_sets[i];
-    if (usage_set) {
-      usage_set->availability.set();
-      usage_set->upcoming_uses.clear();
+RegisterAllocationPass::Interval* RegisterAllocationPass::ExtendInterval(
+    Value* value, uint32_t position, uint32_t loop_depth) {
+  auto& index = interval_map_[value->ordinal];
+  if (!index) {
+    Interval interval;
+    interval.value = value;
+    interval.start = interval.end = position;
+    if (value->type <= INT64_TYPE) {
+      interval.set_index = int_set_index_;
+    } else if (value->type <= FLOAT64_TYPE) {
+      interval.set_index = float_set_index_;
+    } else {
+      interval.set_index = vec_set_index_;
     }
+    interval.loop_depth = loop_depth;
+    interval.reg = -1;
+    interval.can_spill = true;
+    interval.must_spill = false;
+    intervals_.push_back(interval);
+    index = static_cast<uint32_t>(intervals_.size());
+    return &intervals_.back();
   }
-  DumpUsage("PrepareBlockState");
+  auto interval = &intervals_[index - 1];
+  interval->start = std::min(interval->start, position);
+  interval->end = std::max(interval->end, position);
+  interval->loop_depth = std::max(interval->loop_depth, loop_depth);
+  return interval;
 }
 
-void RegisterAllocationPass::AdvanceUses(Instr* instr) {
-  for (size_t i = 0; i < poly::countof(usage_sets_.all_sets); ++i) {
-    auto usage_set = usage_sets_.all_sets[i];
-    if (!usage_set) {
-      break;
-    }
-    auto& upcoming_uses = usage_set->upcoming_uses;
-    for (auto it = upcoming_uses.begin(); it != upcoming_uses.end();) {
-      if (!it->use) {
-        // No uses at all - we can remove right away.
-        // This comes up from instructions where the dest is never used,
-        // like the ATOMIC ops.
-        MarkRegAvailable(it->value->reg);
-        it = upcoming_uses.erase(it);
-        continue;
-      }
-      if (it->use->instr != instr) {
-        // Not yet at this instruction.
-        ++it;
-        continue;
-      }
-      // The use is from this instruction.
-      if (!it->use->next) {
-        // Last use of the value. We can retire it now.
-        MarkRegAvailable(it->value->reg);
-        it = upcoming_uses.erase(it);
+void RegisterAllocationPass::ExpireIntervals(uint32_t position) {
+  // Intervals ending where this one starts are done: the last use reads its
+  // sources before the def writes, so the register can be reused right away.
+  for (uint32_t n = 0; n < set_count_; n++) {
+    auto& usage_set = sets_[n];
+    auto it = usage_set.active.begin();
+    while (it != usage_set.active.end()) {
+      if ((*it)->end <= position) {
+        usage_set.free_mask |= 1u << (*it)->reg;
+        it = usage_set.active.erase(it);
       } else {
-        // Used again. Push back the next use.
-        // Note that we may be used multiple times this instruction, so
-        // eat those.
-        auto next_use = it->use->next;
-        while (next_use->next && next_use->instr == instr) {
-          next_use = next_use->next;
-        }
-        // Remove the iterator.
-        auto value = it->value;
-        it = upcoming_uses.erase(it);
-        assert_true(next_use->instr->block == instr->block);
-        assert_true(value->def->block == instr->block);
-        upcoming_uses.emplace_back(value, next_use);
+        ++it;
       }
     }
   }
-  DumpUsage("AdvanceUses");
 }
 
-bool RegisterAllocationPass::IsRegInUse(const RegAssignment& reg) {
-  RegisterSetUsage* usage_set;
-  if (reg.set == usage_sets_.int_set->set) {
-    usage_set = usage_sets_.int_set;
-  } else if (reg.set == usage_sets_.float_set->set) {
-    usage_set = usage_sets_.float_set;
-  } else {
-    usage_set = usage_sets_.vec_set;
+int32_t RegisterAllocationPass::PreferredRegister(const Interval* interval) {
+  // Reuse the register of src1 if it dies at our def. This helps along the
+  // two operand x86 instructions and makes the move of an ASSIGN go away.
+  auto def = interval->value->def;
+  if (GET_OPCODE_SIG_TYPE_SRC1(def->opcode->signature) != OPCODE_SIG_TYPE_V) {
+    return -1;
   }
-  return !usage_set->availability.test(reg.index);
-}
-
-RegisterAllocationPass::RegisterSetUsage* RegisterAllocationPass::MarkRegUsed(
-    const RegAssignment& reg, Value* value, Value::Use* use) {
-  auto usage_set = RegisterSetForValue(value);
-  usage_set->availability.set(reg.index, false);
-  usage_set->upcoming_uses.emplace_back(value, use);
-  DumpUsage("MarkRegUsed");
-  return usage_set;
-}
-
-RegisterAllocationPass::RegisterSetUsage*
-RegisterAllocationPass::MarkRegAvailable(const hir::RegAssignment& reg) {
-  RegisterSetUsage* usage_set;
-  if (reg.set == usage_sets_.int_set->set) {
-    usage_set = usage_sets_.int_set;
-  } else if (reg.set == usage_sets_.float_set->set) {
-    usage_set = usage_sets_.float_set;
-  } else {
-    usage_set = usage_sets_.vec_set;
+  auto src = def->src1.value;
+  if (src->IsConstant() || !src->def) {
+    return -1;
   }
-  usage_set->availability.set(reg.index, true);
-  return usage_set;
-}
-
-bool RegisterAllocationPass::TryAllocateRegister(
-    Value* value, const RegAssignment& preferred_reg) {
-  // If the preferred register matches type and is available, use it.
-  auto usage_set = RegisterSetForValue(value);
-  if (usage_set->set == preferred_reg.set) {
-    // Check if available.
-    if (!IsRegInUse(preferred_reg)) {
-      // Mark as in-use and return. Best case.
-      MarkRegUsed(preferred_reg, value, value->use_head);
-      value->reg = preferred_reg;
-      return true;
-    }
+  auto src_interval = &intervals_[interval_map_[src->ordinal] - 1];
+  if (src_interval->reg == -1 ||
+      src_interval->set_index != interval->set_index ||
+      src_interval->end != interval->start) {
+    return -1;
   }
-
-  // Otherwise, fallback to allocating like normal.
-  return TryAllocateRegister(value);
-}
-
-bool RegisterAllocationPass::TryAllocateRegister(Value* value) {
-  // Get the set this register is in.
-  RegisterSetUsage* usage_set = RegisterSetForValue(value);
-
-  // Find the first free register, if any.
-  // We have to ensure it's a valid one (in our count).
-  uint32_t first_unused = 0;
-  bool none_used = poly::bit_scan_forward(
-      static_cast<uint32_t>(usage_set->availability.to_ulong()), &first_unused);
-  if (none_used && first_unused < usage_set->count) {
-    // Available! Use it!
-    value->reg.set = usage_set->set;
-    value->reg.index = first_unused;
-    MarkRegUsed(value->reg, value, value->use_head);
-    return true;
+  auto& usage_set = sets_[interval->set_index];
+  if (!(usage_set.free_mask & (1u << src_interval->reg))) {
+    return -1;
   }
-
-  // None available! Spill required.
-  return false;
+  if (def->opcode == &OPCODE_ASSIGN_info) {
+    ++stats_.coalesced_move_count;
+  }
+  return src_interval->reg;
 }
 
-bool RegisterAllocationPass::SpillOneRegister(HIRBuilder* builder, Block* block,
-                                              TypeName required_type) {
-  // Get the set that we will be picking from.
-  RegisterSetUsage* usage_set;
-  if (required_type <= INT64_TYPE) {
-    usage_set = usage_sets_.int_set;
-  } else if (required_type <= FLOAT64_TYPE) {
-    usage_set = usage_sets_.float_set;
-  } else {
-    usage_set = usage_sets_.vec_set;
+int RegisterAllocationPass::AllocateIntervals() {
+  split_list_.clear();
+  stats_.coalesced_move_count = 0;
+  for (uint32_t n = 0; n < set_count_; n++) {
+    auto& usage_set = sets_[n];
+    usage_set.free_mask = usage_set.count == 32
+                              ? 0xFFFFFFFF
+                              : ((1u << usage_set.count) - 1);
+    usage_set.active.clear();
   }
 
-  DumpUsage("SpillOneRegister (pre)");
-  // Pick the one with the furthest next use.
-  assert_true(!usage_set->upcoming_uses.empty());
-  auto furthest_usage = std::max_element(usage_set->upcoming_uses.begin(),
-                                         usage_set->upcoming_uses.end(),
-                                         RegisterUsage::Comparer());
-  assert_true(furthest_usage->value->def->block == block);
-  assert_true(furthest_usage->use->instr->block == block);
-  auto spill_value = furthest_usage->value;
-  Value::Use* prev_use = furthest_usage->use->prev;
-  Value::Use* next_use = furthest_usage->use;
-  assert_not_null(next_use);
-  usage_set->upcoming_uses.erase(furthest_usage);
-  DumpUsage("SpillOneRegister (post)");
-  const auto reg = spill_value->reg;
-
-  // We know the spill_value use list is sorted, so we can cut it right now.
-  // This makes it easier down below.
-  auto new_head_use = next_use;
-
-  // Allocate local.
-  if (spill_value->local_slot) {
-    // Value is already assigned a slot. Since we allocate in order and this is
-    // all SSA we know the stored value will be exactly what we want. Yay,
-    // we can prevent the redundant store!
-    // In fact, we may even want to pin this spilled value so that we always
-    // use the spilled value and prevent the need for more locals.
-  } else {
-    // Allocate a local slot.
-    spill_value->local_slot = builder->AllocLocal(spill_value->type);
-
-    // Add store.
-    builder->StoreLocal(spill_value->local_slot, spill_value);
-    auto spill_store = builder->last_instr();
-    auto spill_store_use = spill_store->src2_use;
-    assert_null(spill_store_use->prev);
-    if (prev_use && prev_use->instr->opcode->flags & OPCODE_FLAG_PAIRED_PREV) {
-      // Instruction is paired. This is bad. We will insert the spill after the
-      // paired instruction.
-      assert_not_null(prev_use->instr->next);
-      spill_store->MoveBefore(prev_use->instr->next);
-
-      // Update last use.
-      spill_value->last_use = spill_store;
-    } else if (prev_use) {
-      // We insert the store immediately before the previous use.
-      // If we were smarter we could then re-run allocation and reuse the
-      // register
-      // once dropped.
-      spill_store->MoveBefore(prev_use->instr);
-
-      // Update last use.
-      spill_value->last_use = prev_use->instr;
-    } else {
-      // This is the first use, so the only thing we have is the define.
-      // Move the store to right after that.
-      spill_store->MoveBefore(spill_value->def->next);
-
-      // Update last use.
-      spill_value->last_use = spill_store;
-    }
+  sorted_intervals_.clear();
+  for (auto& interval : intervals_) {
+    sorted_intervals_.push_back(&interval);
   }
-
-#if ASSERT_NO_CYCLES
-  builder->AssertNoCycles();
-  spill_value->def->block->AssertNoCycles();
-#endif  // ASSERT_NO_CYCLES
-
-  // Add load.
-  // Inserted immediately before the next use. Since by definition the next
-  // use is after the instruction requesting the spill we know we haven't
-  // done allocation for that code yet and can let that be handled
-  // automatically when we get to it.
-  auto new_value = builder->LoadLocal(spill_value->local_slot);
-  auto spill_load = builder->last_instr();
-  spill_load->MoveBefore(next_use->instr);
-// Note: implicit first use added.
-
-#if ASSERT_NO_CYCLES
-  builder->AssertNoCycles();
-  spill_value->def->block->AssertNoCycles();
-#endif  // ASSERT_NO_CYCLES
-
-  // Set the local slot of the new value to our existing one. This way we will
-  // reuse that same memory if needed.
-  new_value->local_slot = spill_value->local_slot;
-
-  // Rename all future uses of the SSA value to the new value as loaded
-  // from the local.
-  // We can quickly do this by walking the use list. Because the list is
-  // already sorted we know we are going to end up with a sorted list.
-  auto walk_use = new_head_use;
-  auto new_use_tail = walk_use;
-  while (walk_use) {
-    auto next_walk_use = walk_use->next;
-    auto instr = walk_use->instr;
-
-    uint32_t signature = instr->opcode->signature;
-    if (GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V) {
-      if (instr->src1.value == spill_value) {
-        instr->set_src1(new_value);
-      }
+  std::sort(sorted_intervals_.begin(), sorted_intervals_.end(),
+            [](const Interval* a, const Interval* b) {
+              return a->start < b->start ||
+                     (a->start == b->start &&
+                      a->value->ordinal < b->value->ordinal);
+            });
+
+  for (auto interval : sorted_intervals_) {
+    ExpireIntervals(interval->start);
+    if (interval->must_spill) {
+      split_list_.push_back(interval->value);
+      continue;
     }
-    if (GET_OPCODE_SIG_TYPE_SRC2(signature) == OPCODE_SIG_TYPE_V) {
-      if (instr->src2.value == spill_value) {
-        instr->set_src2(new_value);
-      }
+    auto& usage_set = sets_[interval->set_index];
+    int32_t reg = PreferredRegister(interval);
+    if (reg == -1 && usage_set.free_mask) {
+      uint32_t index;
+      poly::bit_scan_forward(usage_set.free_mask, &index);
+      reg = index;
     }
-    if (GET_OPCODE_SIG_TYPE_SRC3(signature) == OPCODE_SIG_TYPE_V) {
-      if (instr->src3.value == spill_value) {
-        instr->set_src3(new_value);
+    if (reg == -1) {
+      // Out of registers. Split whatever is used in the fewest loops, then
+      // whatever is live the furthest out. Reloads inside a loop happen on
+      // every iteration.
+      Interval* victim = interval->can_spill ? interval : nullptr;
+      for (auto active : usage_set.active) {
+        if (!active->can_spill) {
+          continue;
+        }
+        if (!victim || active->loop_depth < victim->loop_depth ||
+            (active->loop_depth == victim->loop_depth &&
+             active->end > victim->end)) {
+          victim = active;
+        }
       }
+      if (!victim) {
+        return 1;
+      }
+      split_list_.push_back(victim->value);
+      if (victim == interval) {
+        continue;
+      }
+      reg = victim->reg;
+      victim->reg = -1;
+      usage_set.active.erase(
+          std::find(usage_set.active.begin(), usage_set.active.end(), victim));
     }
-
-    walk_use = next_walk_use;
-    if (walk_use) {
-      new_use_tail = walk_use;
-    }
+    interval->reg = reg;
+    usage_set.free_mask &= ~(1u << reg);
+    usage_set.active.push_back(interval);
   }
-  new_value->last_use = new_use_tail->instr;
-
-  // Update tracking.
-  MarkRegAvailable(reg);
-
-  return true;
+  return 0;
 }
 
-RegisterAllocationPass::RegisterSetUsage*
-RegisterAllocationPass::RegisterSetForValue(const Value* value) {
-  if (value->type <= INT64_TYPE) {
-    return usage_sets_.int_set;
-  } else if (value->type <= FLOAT64_TYPE) {
-    return usage_sets_.float_set;
+void RegisterAllocationPass::SplitValue(HIRBuilder* builder, Value* value) {
+  ++stats_.spill_count;
+  fixed_values_[value->ordinal] = true;
+
+  // Store once, right after the def and anything paired with it.
+  auto def = value->def;
+  if (!value->local_slot) {
+    value->local_slot = builder->AllocLocal(value->type);
+  }
+  builder->StoreLocal(value->local_slot, value);
+  auto store = builder->last_instr();
+  ++stats_.spill_store_count;
+  auto insert_point = def;
+  while (insert_point->next &&
+         insert_point->next->opcode->flags & OPCODE_FLAG_PAIRED_PREV) {
+    insert_point = insert_point->next;
+  }
+  if (insert_point->next) {
+    store->MoveBefore(insert_point->next);
   } else {
-    return usage_sets_.vec_set;
+    // Tail of the block. Go before it and then swap the two.
+    store->MoveBefore(insert_point);
+    insert_point->MoveBefore(store);
   }
-}
 
-namespace {
-int CompareValueUse(const Value::Use* a, const Value::Use* b) {
-  return a->instr->ordinal - b->instr->ordinal;
-}
-}  // namespace
-void RegisterAllocationPass::SortUsageList(Value* value) {
-  // Modified in-place linked list sort from:
-  // http://www.chiark.greenend.org.uk/~sgtatham/algorithms/listsort.c
-  if (!value->use_head) {
-    return;
-  }
-  Value::Use* head = value->use_head;
-  Value::Use* tail = nullptr;
-  int insize = 1;
-  while (true) {
-    auto p = head;
-    head = nullptr;
-    tail = nullptr;
-    // count number of merges we do in this pass
-    int nmerges = 0;
-    while (p) {
-      // there exists a merge to be done
-      nmerges++;
-      // step 'insize' places along from p
-      auto q = p;
-      int psize = 0;
-      for (int i = 0; i < insize; i++) {
-        psize++;
-        q = q->next;
-        if (!q) break;
-      }
-      // if q hasn't fallen off end, we have two lists to merge
-      int qsize = insize;
-      // now we have two lists; merge them
-      while (psize > 0 || (qsize > 0 && q)) {
-        // decide whether next element of merge comes from p or q
-        Value::Use* e = nullptr;
-        if (psize == 0) {
-          // p is empty; e must come from q
-          e = q;
-          q = q->next;
-          qsize--;
-        } else if (qsize == 0 || !q) {
-          // q is empty; e must come from p
-          e = p;
-          p = p->next;
-          psize--;
-        } else if (CompareValueUse(p, q) <= 0) {
-          // First element of p is lower (or same); e must come from p
-          e = p;
-          p = p->next;
-          psize--;
-        } else {
-          // First element of q is lower; e must come from q
-          e = q;
-          q = q->next;
-          qsize--;
-        }
-        // add the next element to the merged list
-        if (tail) {
-          tail->next = e;
-        } else {
-          head = e;
-        }
-        // Maintain reverse pointers in a doubly linked list.
-        e->prev = tail;
-        tail = e;
-      }
-      // now p has stepped 'insize' places along, and q has too
-      p = q;
+  // Reload before every later use, ahead of anything the use is paired with.
+  auto use = value->use_head;
+  while (use) {
+    auto next_use = use->next;
+    auto instr = use->instr;
+    bool is_before_store = instr == store;
+    for (auto i = def->next; i != store && !is_before_store; i = i->next) {
+      is_before_store = i == instr;
     }
-    if (tail) {
-      tail->next = nullptr;
+    // Uses already renamed (the same value in several sources) are skipped.
+    uint32_t signature = instr->opcode->signature;
+    bool is_src1 = GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V &&
+                   instr->src1.value == value;
+    bool is_src2 = GET_OPCODE_SIG_TYPE_SRC2(signature) == OPCODE_SIG_TYPE_V &&
+                   instr->src2.value == value;
+    bool is_src3 = GET_OPCODE_SIG_TYPE_SRC3(signature) == OPCODE_SIG_TYPE_V &&
+                   instr->src3.value == value;
+    if (is_before_store || !(is_src1 || is_src2 || is_src3)) {
+      use = next_use;
+      continue;
     }
-    // If we have done only one merge, we're finished
-    if (nmerges <= 1) {
-      // allow for nmerges==0, the empty list case
-      break;
+
+    auto reload_point = instr;
+    while (reload_point->opcode->flags & OPCODE_FLAG_PAIRED_PREV &&
+           reload_point->prev) {
+      reload_point = reload_point->prev;
     }
-    // Otherwise repeat, merging lists twice the size
-    insize *= 2;
-  }
+    auto new_value = builder->LoadLocal(value->local_slot);
+    builder->last_instr()->MoveBefore(reload_point);
+    new_value->local_slot = value->local_slot;
+    if (new_value->ordinal >= fixed_values_.size()) {
+      fixed_values_.resize(new_value->ordinal + 1, false);
+    }
+    fixed_values_[new_value->ordinal] = true;
+    ++stats_.spill_load_count;
 
-  value->use_head = head;
-  value->last_use = tail->instr;
+    if (is_src1) {
+      instr->set_src1(new_value);
+    }
+    if (is_src2) {
+      instr->set_src2(new_value);
+    }
+    if (is_src3) {
+      instr->set_src3(new_value);
+    }
+    use = next_use;
+  }
 }
 
 }  // namespace passes
@@ -10,8 +10,6 @@
 #ifndef ALLOY_COMPILER_PASSES_REGISTER_ALLOCATION_PASS_H_
 #define ALLOY_COMPILER_PASSES_REGISTER_ALLOCATION_PASS_H_
 
-#include <algorithm>
-#include <bitset>
 #include <vector>
 
 #include <alloy/backend/machine_info.h>
@@ -21,61 +19,83 @@ namespace alloy {
 namespace compiler {
 namespace passes {
 
+// Global linear scan register allocator.
+// Each value gets one live interval over the linearized instructions of the
+// whole function, using the block liveness from DataFlowAnalysisPass to
+// extend it across blocks (and around loops); without it only block local
+// values are kept in registers. Values that don't fit are split: stored to a
+// local once after their def and reloaded into short lived values before each
+// later use, after which allocation is redone.
+// Values live across calls are always split, as guest code does not preserve
+// the allocatable registers. When out of registers, values used in the most
+// deeply nested loop (Block::loop_depth) are the last to be split.
 class RegisterAllocationPass : public CompilerPass {
  public:
+  struct Stats {
+    uint32_t instr_count_before;
+    uint32_t instr_count_after;
+    uint32_t spill_count;
+    uint32_t spill_store_count;
+    uint32_t spill_load_count;
+    uint32_t coalesced_move_count;
+  };
+
   RegisterAllocationPass(const backend::MachineInfo* machine_info);
   ~RegisterAllocationPass() override;
 
+  const char* name() const override { return "register_allocation"; }
   int Run(hir::HIRBuilder* builder) override;
 
+  // Stats from the last run.
+  const Stats& stats() const { return stats_; }
+
  private:
-  // TODO(benvanik): rewrite all this set shit -- too much indirection, the
-  // complexity is not needed.
-  struct RegisterUsage {
+  struct Interval {
     hir::Value* value;
-    hir::Value::Use* use;
-    RegisterUsage() : value(nullptr), use(nullptr) {}
-    RegisterUsage(hir::Value* value_, hir::Value::Use* use_)
-        : value(value_), use(use_) {}
-    struct Comparer : std::binary_function<RegisterUsage, RegisterUsage, bool> {
-      bool operator()(const RegisterUsage& a, const RegisterUsage& b) const {
-        return a.use->instr->ordinal < b.use->instr->ordinal;
-      }
-    };
+    // Positions are 2x the instruction ordinal; odd positions are block ends.
+    uint32_t start;
+    uint32_t end;
+    uint32_t set_index;
+    // Deepest loop nesting of any def or use.
+    uint32_t loop_depth;
+    int32_t reg;
+    bool can_spill;
+    bool must_spill;
   };
   struct RegisterSetUsage {
-    const backend::MachineInfo::RegisterSet* set = nullptr;
-    uint32_t count = 0;
-    std::bitset<32> availability = 0;
-    // TODO(benvanik): another data type.
-    std::vector<RegisterUsage> upcoming_uses;
+    const backend::MachineInfo::RegisterSet* set;
+    uint32_t count;
+    uint32_t free_mask;
+    std::vector<Interval*> active;
   };
 
-  void DumpUsage(const char* name);
-  void PrepareBlockState();
-  void AdvanceUses(hir::Instr* instr);
-  bool IsRegInUse(const hir::RegAssignment& reg);
-  RegisterSetUsage* MarkRegUsed(const hir::RegAssignment& reg,
-                                hir::Value* value, hir::Value::Use* use);
-  RegisterSetUsage* MarkRegAvailable(const hir::RegAssignment& reg);
+  uint32_t NumberInstructions(hir::HIRBuilder* builder);
+  void BuildIntervals(hir::HIRBuilder* builder);
+  Interval* ExtendInterval(hir::Value* value, uint32_t position,
+                           uint32_t loop_depth = 0);
+  void ExpireIntervals(uint32_t position);
+  int AllocateIntervals();
+  int32_t PreferredRegister(const Interval* interval);
+  void SplitValue(hir::HIRBuilder* builder, hir::Value* value);
 
-  bool TryAllocateRegister(hir::Value* value,
-                           const hir::RegAssignment& preferred_reg);
-  bool TryAllocateRegister(hir::Value* value);
-  bool SpillOneRegister(hir::HIRBuilder* builder, hir::Block* block,
-                        hir::TypeName required_type);
+  RegisterSetUsage sets_[8];
+  uint32_t set_count_;
+  // Register set index for int/float/vec values.
+  uint32_t int_set_index_;
+  uint32_t float_set_index_;
+  uint32_t vec_set_index_;
 
-  RegisterSetUsage* RegisterSetForValue(const hir::Value* value);
+  std::vector<Interval> intervals_;
+  std::vector<Interval*> sorted_intervals_;
+  // Value ordinal -> index into intervals_ + 1, 0 if none.
+  std::vector<uint32_t> interval_map_;
+  std::vector<hir::Value*> values_;
+  // Split values and their reloads, which must not be split again.
+  std::vector<bool> fixed_values_;
+  std::vector<uint32_t> call_positions_;
+  std::vector<hir::Value*> split_list_;
 
-  void SortUsageList(hir::Value* value);
-
- private:
-  struct {
-    RegisterSetUsage* int_set = nullptr;
-    RegisterSetUsage* float_set = nullptr;
-    RegisterSetUsage* vec_set = nullptr;
-    RegisterSetUsage* all_sets[3];
-  } usage_sets_;
+  Stats stats_;
 };
 
 }  // namespace passes
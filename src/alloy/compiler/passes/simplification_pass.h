@@ -21,6 +21,7 @@ class SimplificationPass : public CompilerPass {
   SimplificationPass();
   ~SimplificationPass() override;
 
+  const char* name() const override { return "simplification"; }
   int Run(hir::HIRBuilder* builder) override;
 
  private:
@@ -21,6 +21,7 @@ class ValidationPass : public CompilerPass {
   ValidationPass();
   ~ValidationPass() override;
 
+  const char* name() const override { return "validation"; }
   int Run(hir::HIRBuilder* builder) override;
 
  private:
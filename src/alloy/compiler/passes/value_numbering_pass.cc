@@ -0,0 +1,261 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/compiler/passes/value_numbering_pass.h>
+
+#include <cstring>
+
+#include <xenia/profiling.h>
+
+namespace alloy {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace alloy::hir;
+
+using alloy::hir::Block;
+using alloy::hir::HIRBuilder;
+using alloy::hir::Instr;
+using alloy::hir::Value;
+
+namespace {
+
+inline uint64_t HashCombine(uint64_t hash, uint64_t value) {
+  return (hash ^ value) * 0x100000001B3ull;
+}
+
+// Looks through assigns, including those made for earlier replacements.
+const Value* Resolve(const Value* value) {
+  while (value->def && value->def->opcode == &OPCODE_ASSIGN_info) {
+    value = value->def->src1.value;
+  }
+  return value;
+}
+
+uint64_t HashValue(const Value* value) {
+  value = Resolve(value);
+  if (!value->IsConstant()) {
+    return reinterpret_cast<uintptr_t>(value);
+  }
+  // Each LoadConstant makes a new value, so constants hash by contents.
+  uint64_t hash = HashCombine(0xCBF29CE484222325ull, value->type);
+  auto bytes = reinterpret_cast<const uint8_t*>(&value->constant);
+  for (size_t n = 0; n < GetTypeSize(value->type); ++n) {
+    hash = HashCombine(hash, bytes[n]);
+  }
+  return hash;
+}
+
+bool ValuesEqual(const Value* a, const Value* b) {
+  a = Resolve(a);
+  b = Resolve(b);
+  if (a == b) {
+    return true;
+  }
+  return a->IsConstant() && b->IsConstant() && a->type == b->type &&
+         !std::memcmp(&a->constant, &b->constant, GetTypeSize(a->type));
+}
+
+uint64_t HashOp(OpcodeSignatureType sig_type, const Instr::Op& op) {
+  switch (sig_type) {
+    case OPCODE_SIG_TYPE_V:
+      return HashValue(op.value);
+    case OPCODE_SIG_TYPE_O:
+      return op.offset;
+    default:
+      return 0;
+  }
+}
+
+bool OpsEqual(OpcodeSignatureType sig_type, const Instr::Op& a,
+              const Instr::Op& b) {
+  switch (sig_type) {
+    case OPCODE_SIG_TYPE_V:
+      return ValuesEqual(a.value, b.value);
+    case OPCODE_SIG_TYPE_O:
+      return a.offset == b.offset;
+    default:
+      return true;
+  }
+}
+
+}  // namespace
+
+ValueNumberingPass::ValueNumberingPass()
+    : CompilerPass(), replaced_count_(0) {}
+
+ValueNumberingPass::~ValueNumberingPass() {}
+
+int ValueNumberingPass::Run(HIRBuilder* builder) {
+  SCOPE_profile_cpu_f("alloy");
+
+  // Walk the dominator tree keeping a table of the instructions available
+  // at each point: those in the current block so far and in all blocks that
+  // dominate it. Anything computed again is replaced by an assign:
+  //   v1.i32 = and v0.i32, 0xFFFF       (block A)
+  //   branch_true v2.i8, label0
+  //   ...
+  // label0:                             (dominated by A)
+  //   v3.i32 = and v0.i32, 0xFFFF  -->  v3.i32 = v1.i32
+  replaced_count_ = 0;
+  if (!dom_tree_.Compute(builder)) {
+    return 0;
+  }
+
+  // Each entry is visited twice: first to number the block and queue its
+  // dominator tree children, then once they are all done to drop what the
+  // block made available.
+  const size_t kNotVisited = SIZE_MAX;
+  std::vector<std::pair<uint32_t, size_t>> stack;
+  stack.emplace_back(0, kNotVisited);
+  while (!stack.empty()) {
+    uint32_t ordinal = stack.back().first;
+    if (stack.back().second == kNotVisited) {
+      stack.back().second = undo_log_.size();
+      NumberBlock(dom_tree_.block(ordinal));
+      for (uint32_t child : dom_tree_.children(ordinal)) {
+        stack.emplace_back(child, kNotVisited);
+      }
+      continue;
+    }
+    size_t undo_mark = stack.back().second;
+    stack.pop_back();
+    while (undo_log_.size() > undo_mark) {
+      auto& entry = undo_log_.back();
+      auto range = available_.equal_range(entry.first);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == entry.second) {
+          available_.erase(it);
+          break;
+        }
+      }
+      undo_log_.pop_back();
+    }
+  }
+  assert_true(available_.empty());
+
+  return 0;
+}
+
+void ValueNumberingPass::NumberBlock(Block* block) {
+  available_loads_.clear();
+  auto i = block->instr_head;
+  while (i) {
+    if (WritesMemory(i)) {
+      available_loads_.clear();
+    } else if (IsCandidate(i)) {
+      uint64_t hash = HashInstr(i);
+      bool is_load = ReadsMemory(i);
+      auto& table = is_load ? available_loads_ : available_;
+      Instr* leader = nullptr;
+      auto range = table.equal_range(hash);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (IsEquivalent(it->second, i)) {
+          leader = it->second;
+          break;
+        }
+      }
+      if (leader) {
+        i->Replace(&OPCODE_ASSIGN_info, 0);
+        i->set_src1(leader->dest);
+        ++replaced_count_;
+      } else {
+        table.emplace(hash, i);
+        if (!is_load) {
+          undo_log_.emplace_back(hash, i);
+        }
+      }
+    }
+    i = i->next;
+  }
+}
+
+bool ValueNumberingPass::IsCandidate(const Instr* i) {
+  auto opcode = i->opcode;
+  if (GET_OPCODE_SIG_TYPE_DEST(opcode->signature) != OPCODE_SIG_TYPE_V) {
+    return false;
+  }
+  if (opcode->flags & (OPCODE_FLAG_VOLATILE | OPCODE_FLAG_BRANCH |
+                       OPCODE_FLAG_PAIRED_PREV)) {
+    return false;
+  }
+  // did_carry/etc read the host flags of the instruction before them.
+  if (i->next && i->next->opcode->flags & OPCODE_FLAG_PAIRED_PREV) {
+    return false;
+  }
+  if (opcode == &OPCODE_ASSIGN_info || opcode == &OPCODE_LOAD_CLOCK_info ||
+      opcode == &OPCODE_ATOMIC_ADD_info || opcode == &OPCODE_ATOMIC_SUB_info) {
+    return false;
+  }
+  if (opcode == &OPCODE_LOAD_info && i->flags & LOAD_VOLATILE) {
+    return false;
+  }
+  return true;
+}
+
+bool ValueNumberingPass::ReadsMemory(const Instr* i) {
+  return i->opcode == &OPCODE_LOAD_info ||
+         i->opcode == &OPCODE_LOAD_CONTEXT_info ||
+         i->opcode == &OPCODE_LOAD_LOCAL_info;
+}
+
+bool ValueNumberingPass::WritesMemory(const Instr* i) {
+  // Calls, atomics, etc are all volatile.
+  return i->opcode == &OPCODE_STORE_info ||
+         i->opcode == &OPCODE_STORE_CONTEXT_info ||
+         i->opcode == &OPCODE_STORE_LOCAL_info ||
+         i->opcode == &OPCODE_ATOMIC_ADD_info ||
+         i->opcode == &OPCODE_ATOMIC_SUB_info ||
+         i->opcode->flags & OPCODE_FLAG_VOLATILE;
+}
+
+uint64_t ValueNumberingPass::HashInstr(const Instr* i) {
+  uint32_t signature = i->opcode->signature;
+  uint64_t hash = reinterpret_cast<uintptr_t>(i->opcode);
+  hash = HashCombine(hash, i->flags);
+  hash = HashCombine(hash, i->dest->type);
+  uint64_t src1_hash = HashOp(GET_OPCODE_SIG_TYPE_SRC1(signature), i->src1);
+  uint64_t src2_hash = HashOp(GET_OPCODE_SIG_TYPE_SRC2(signature), i->src2);
+  if (i->opcode->flags & OPCODE_FLAG_COMMUNATIVE) {
+    // Order independent.
+    hash = HashCombine(hash, src1_hash + src2_hash);
+  } else {
+    hash = HashCombine(hash, src1_hash);
+    hash = HashCombine(hash, src2_hash);
+  }
+  hash = HashCombine(hash,
+                     HashOp(GET_OPCODE_SIG_TYPE_SRC3(signature), i->src3));
+  return hash;
+}
+
+bool ValueNumberingPass::IsEquivalent(const Instr* a, const Instr* b) {
+  if (a->opcode != b->opcode || a->flags != b->flags ||
+      a->dest->type != b->dest->type) {
+    return false;
+  }
+  uint32_t signature = a->opcode->signature;
+  auto src1_type = GET_OPCODE_SIG_TYPE_SRC1(signature);
+  auto src2_type = GET_OPCODE_SIG_TYPE_SRC2(signature);
+  auto src3_type = GET_OPCODE_SIG_TYPE_SRC3(signature);
+  if (!OpsEqual(src3_type, a->src3, b->src3)) {
+    return false;
+  }
+  if (OpsEqual(src1_type, a->src1, b->src1) &&
+      OpsEqual(src2_type, a->src2, b->src2)) {
+    return true;
+  }
+  return a->opcode->flags & OPCODE_FLAG_COMMUNATIVE &&
+         OpsEqual(src1_type, a->src1, b->src2) &&
+         OpsEqual(src2_type, a->src2, b->src1);
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace alloy
@@ -0,0 +1,70 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef ALLOY_COMPILER_PASSES_VALUE_NUMBERING_PASS_H_
+#define ALLOY_COMPILER_PASSES_VALUE_NUMBERING_PASS_H_
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <alloy/compiler/compiler_pass.h>
+#include <alloy/compiler/dominator_tree.h>
+
+namespace alloy {
+namespace compiler {
+namespace passes {
+
+// Dominator based global value numbering/common subexpression elimination.
+// Instructions computing the same opcode/flags/type on the same operands as
+// one in a dominating block (or earlier in the same block) are turned into
+// assigns of its result, which SimplificationPass and DCE then clean up:
+//   v1 = add v0, 4          v1 = add v0, 4
+//   ...               -->   ...
+//   v2 = add v0, 4          v2 = v1
+// Constant operands match by value. Loads only match within a block with no
+// store, call or other volatile instruction between them.
+// Requires the CFG from ControlFlowAnalysisPass. It may be stale from later
+// simplifications, but only by having extra edges, which is safe.
+class ValueNumberingPass : public CompilerPass {
+ public:
+  ValueNumberingPass();
+  ~ValueNumberingPass() override;
+
+  const char* name() const override { return "value_numbering"; }
+  int Run(hir::HIRBuilder* builder) override;
+
+  // Instructions replaced in the last run.
+  uint32_t replaced_count() const { return replaced_count_; }
+
+ private:
+  void NumberBlock(hir::Block* block);
+  bool IsCandidate(const hir::Instr* i);
+  bool ReadsMemory(const hir::Instr* i);
+  bool WritesMemory(const hir::Instr* i);
+  uint64_t HashInstr(const hir::Instr* i);
+  bool IsEquivalent(const hir::Instr* a, const hir::Instr* b);
+
+  DominatorTree dom_tree_;
+
+  // Available instructions by hash. Entries added while numbering a block are
+  // undone once its dominator subtree is done.
+  std::unordered_multimap<uint64_t, hir::Instr*> available_;
+  std::vector<std::pair<uint64_t, hir::Instr*>> undo_log_;
+  // Loads available in the current block, cleared by every write.
+  std::unordered_multimap<uint64_t, hir::Instr*> available_loads_;
+
+  uint32_t replaced_count_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace alloy
+
+#endif  // ALLOY_COMPILER_PASSES_VALUE_NUMBERING_PASS_H_
@@ -21,6 +21,7 @@ class ValueReductionPass : public CompilerPass {
   ValueReductionPass();
   ~ValueReductionPass() override;
 
+  const char* name() const override { return "value_reduction"; }
   int Run(hir::HIRBuilder* builder) override;
 
  private:
@@ -18,6 +18,9 @@
 #include <alloy/runtime/symbol_info.h>
 
 namespace alloy {
+namespace backend {
+class Backend;
+}  // namespace backend
 namespace runtime {
 class Runtime;
 }  // namespace runtime
@@ -41,6 +44,15 @@ class Frontend {
   virtual int DefineFunction(runtime::FunctionInfo* symbol_info,
                              uint32_t debug_info_flags, uint32_t trace_flags,
                              runtime::Function** out_function) = 0;
+  // Quick translation for the first tier of --runtime_tiered, executed by the
+  // given backend. Fails if the frontend doesn't have one.
+  virtual int DefineTier0Function(runtime::FunctionInfo* symbol_info,
+                                  backend::Backend* tier0_backend,
+                                  uint32_t debug_info_flags,
+                                  uint32_t trace_flags,
+                                  runtime::Function** out_function) {
+    return 1;
+  }
 
  protected:
   runtime::Runtime* runtime_;
@@ -170,9 +170,15 @@ typedef struct alignas(64) PPCContext_s {
   // Thread ID assigned to this context.
   uint32_t thread_id;
 
-  // Reserve address for load acquire/store release. Shared.
-  uint64_t* reserve_address;
-  uint64_t* reserve_value;
+  // Reservation taken by load acquire (lwarx/ldarx) and checked by store
+  // release (stwcx/stdcx). Per thread; ~0 when there is none.
+  uint64_t reserve_address;
+  uint64_t reserve_value;
+
+  // Owner word of the global lock taken with mtmsr (see PPCGlobalLock) and
+  // whether this thread holds it. The owner word is shared.
+  volatile uint32_t* global_lock_owner;
+  uint8_t global_lock_held;
 
   // Used to shuttle data into externs. Contents volatile.
   uint64_t scratch;
@@ -27,6 +27,22 @@ int InstrEmit_branch(PPCHIRBuilder& f, const char* src, uint64_t cia,
                      bool expect_true = true, bool nia_is_lr = false) {
   uint32_t call_flags = 0;
 
+  // Returning from a callee that has been inlined into its caller just jumps
+  // back to the instruction after the call.
+  Label* return_label = f.inline_return_label();
+  if (!lk && nia_is_lr && return_label) {
+    if (cond) {
+      if (expect_true) {
+        f.BranchTrue(cond, return_label);
+      } else {
+        f.BranchFalse(cond, return_label);
+      }
+    } else {
+      f.Branch(return_label);
+    }
+    return 0;
+  }
+
   // TODO(benvanik): this may be wrong and overwrite LRs when not desired!
   // The docs say always, though...
   // Note that we do the update before we branch/call as we need it to
@@ -71,6 +87,9 @@ int InstrEmit_branch(PPCHIRBuilder& f, const char* src, uint64_t cia,
     } else {
       // Call function.
       auto symbol_info = f.LookupFunction(nia_value);
+      if (!cond && f.EmitInlineCall(symbol_info, lk)) {
+        return 0;
+      }
       if (cond) {
         if (!expect_true) {
           cond = f.IsFalse(cond);
@@ -610,7 +629,8 @@ XEEMITTER(mtspr, 0x7C0003A6, XFX)(PPCHIRBuilder& f, InstrData& i) {
 // MSR is used for toggling interrupts (among other things).
 // We track it here for taking a global processor lock, as lots of lockfree
 // code requires it. Sequences of mtmsr/lwar/stcw/mtmsr come up a lot, and
-// without the lock here threads can livelock.
+// without the lock here threads can livelock. The uncontended lock/unlock is
+// inline; see PPCGlobalLock.
 
 XEEMITTER(mfmsr, 0x7C0000A6, X)(PPCHIRBuilder& f, InstrData& i) {
   f.StoreGPR(i.X.RT, f.LoadMSR());
@@ -620,7 +640,7 @@ XEEMITTER(mfmsr, 0x7C0000A6, X)(PPCHIRBuilder& f, InstrData& i) {
 XEEMITTER(mtmsr, 0x7C000124, X)(PPCHIRBuilder& f, InstrData& i) {
   if (i.X.RA & 0x01) {
     // L = 1
-    f.StoreMSR(f.ZeroExtend(f.LoadGPR(i.X.RT), INT64_TYPE));
+    f.StoreMSR(f.ZeroExtend(f.LoadGPR(i.X.RT), INT64_TYPE), i.address);
     return 0;
   } else {
     // L = 0
@@ -632,7 +652,7 @@ XEEMITTER(mtmsr, 0x7C000124, X)(PPCHIRBuilder& f, InstrData& i) {
 XEEMITTER(mtmsrd, 0x7C000164, X)(PPCHIRBuilder& f, InstrData& i) {
   if (i.X.RA & 0x01) {
     // L = 1
-    f.StoreMSR(f.LoadGPR(i.X.RT));
+    f.StoreMSR(f.LoadGPR(i.X.RT), i.address);
     return 0;
   } else {
     // L = 0
@@ -59,20 +59,14 @@ PPCFrontend::~PPCFrontend() {
   translator_pool_.Reset();
 }
 
-void CheckGlobalLock(PPCContext* ppc_state, void* arg0, void* arg1) {
-  ppc_state->scratch = 0x8000;
+void EnterGlobalLock(PPCContext* ppc_state, void* arg0, void* arg1) {
+  auto global_lock = reinterpret_cast<PPCGlobalLock*>(arg0);
+  global_lock->Acquire(static_cast<uint32_t>(ppc_state->r[13]),
+                       static_cast<uint32_t>(ppc_state->scratch));
 }
-void HandleGlobalLock(PPCContext* ppc_state, void* arg0, void* arg1) {
-  std::mutex* global_lock = reinterpret_cast<std::mutex*>(arg0);
-  volatile bool* global_lock_taken = reinterpret_cast<bool*>(arg1);
-  uint64_t value = ppc_state->scratch;
-  if (value == 0x8000) {
-    global_lock->unlock();
-    *global_lock_taken = false;
-  } else if (value == ppc_state->r[13]) {
-    global_lock->lock();
-    *global_lock_taken = true;
-  }
+void LeaveGlobalLock(PPCContext* ppc_state, void* arg0, void* arg1) {
+  auto global_lock = reinterpret_cast<PPCGlobalLock*>(arg0);
+  global_lock->Release(static_cast<uint32_t>(ppc_state->r[13]));
 }
 
 int PPCFrontend::Initialize() {
@@ -82,13 +76,12 @@ int PPCFrontend::Initialize() {
   }
 
   void* arg0 = reinterpret_cast<void*>(&builtins_.global_lock);
-  void* arg1 = reinterpret_cast<void*>(&builtins_.global_lock_taken);
-  builtins_.check_global_lock = runtime_->DefineBuiltin(
-      "CheckGlobalLock", (FunctionInfo::ExternHandler)CheckGlobalLock, arg0,
-      arg1);
-  builtins_.handle_global_lock = runtime_->DefineBuiltin(
-      "HandleGlobalLock", (FunctionInfo::ExternHandler)HandleGlobalLock, arg0,
-      arg1);
+  builtins_.enter_global_lock = runtime_->DefineBuiltin(
+      "EnterGlobalLock", (FunctionInfo::ExternHandler)EnterGlobalLock, arg0,
+      nullptr);
+  builtins_.leave_global_lock = runtime_->DefineBuiltin(
+      "LeaveGlobalLock", (FunctionInfo::ExternHandler)LeaveGlobalLock, arg0,
+      nullptr);
 
   return result;
 }
@@ -106,13 +99,27 @@ int PPCFrontend::DefineFunction(FunctionInfo* symbol_info,
                                 uint32_t debug_info_flags,
                                 uint32_t trace_flags,
                                 Function** out_function) {
-  PPCTranslator* translator = translator_pool_.Allocate(this);
+  PPCTranslator* translator =
+      translator_pool_.Allocate(this, runtime_->backend());
   int result =
       translator->Translate(symbol_info, debug_info_flags, trace_flags, out_function);
   translator_pool_.Release(translator);
   return result;
 }
 
+int PPCFrontend::DefineTier0Function(FunctionInfo* symbol_info,
+                                     backend::Backend* tier0_backend,
+                                     uint32_t debug_info_flags,
+                                     uint32_t trace_flags,
+                                     Function** out_function) {
+  PPCTranslator* translator =
+      tier0_translator_pool_.Allocate(this, tier0_backend);
+  int result = translator->Translate(symbol_info, debug_info_flags,
+                                     trace_flags, out_function);
+  tier0_translator_pool_.Release(translator);
+  return result;
+}
+
 }  // namespace ppc
 }  // namespace frontend
 }  // namespace alloy
@@ -10,9 +10,8 @@
 #ifndef ALLOY_FRONTEND_PPC_PPC_FRONTEND_H_
 #define ALLOY_FRONTEND_PPC_PPC_FRONTEND_H_
 
-#include <mutex>
-
 #include <alloy/frontend/frontend.h>
+#include <alloy/frontend/ppc/ppc_global_lock.h>
 #include <alloy/type_pool.h>
 
 namespace alloy {
@@ -22,10 +21,10 @@ namespace ppc {
 class PPCTranslator;
 
 struct PPCBuiltins {
-  std::mutex global_lock;
-  bool global_lock_taken;
-  runtime::FunctionInfo* check_global_lock;
-  runtime::FunctionInfo* handle_global_lock;
+  PPCGlobalLock global_lock;
+  // Slow paths of taking/releasing the global lock.
+  runtime::FunctionInfo* enter_global_lock;
+  runtime::FunctionInfo* leave_global_lock;
 };
 
 class PPCFrontend : public Frontend {
@@ -41,9 +40,15 @@ class PPCFrontend : public Frontend {
   int DefineFunction(runtime::FunctionInfo* symbol_info,
                      uint32_t debug_info_flags, uint32_t trace_flags,
                      runtime::Function** out_function) override;
+  int DefineTier0Function(runtime::FunctionInfo* symbol_info,
+                          backend::Backend* tier0_backend,
+                          uint32_t debug_info_flags, uint32_t trace_flags,
+                          runtime::Function** out_function) override;
 
  private:
-  TypePool<PPCTranslator, PPCFrontend*> translator_pool_;
+  TypePool<PPCTranslator, PPCFrontend*, backend::Backend*> translator_pool_;
+  TypePool<PPCTranslator, PPCFrontend*, backend::Backend*>
+      tier0_translator_pool_;
   PPCBuiltins builtins_;
 };
 
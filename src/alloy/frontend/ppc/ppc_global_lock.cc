@@ -0,0 +1,142 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/frontend/ppc/ppc_global_lock.h>
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <alloy/alloy-private.h>
+#include <poly/poly.h>
+
+namespace alloy {
+namespace frontend {
+namespace ppc {
+
+namespace {
+
+// Tries before parking. Critical sections are usually a handful of guest
+// instructions, so most waits end well within this.
+const uint32_t kSpinCount = 4000;
+
+uint64_t ElapsedNs(std::chrono::steady_clock::time_point start_time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start_time).count();
+}
+
+}  // namespace
+
+PPCGlobalLock::PPCGlobalLock()
+    : owner_(0),
+      waiter_count_(0),
+      stats_enabled_(FLAGS_ppc_global_lock_stats),
+      hold_call_site_(0) {}
+
+PPCGlobalLock::~PPCGlobalLock() {
+  if (stats_enabled_) {
+    DumpStats();
+  }
+}
+
+void PPCGlobalLock::Acquire(uint32_t owner, uint32_t call_site) {
+  assert_zero(owner & kContendedBit);
+  std::chrono::steady_clock::time_point start_time;
+  if (stats_enabled_) {
+    start_time = std::chrono::steady_clock::now();
+  }
+
+  bool acquired = false;
+  bool contended = false;
+  for (uint32_t n = 0; n < kSpinCount; ++n) {
+    if (!owner_ && poly::atomic_cas(0u, owner, &owner_)) {
+      acquired = true;
+      break;
+    }
+    contended = true;
+    _mm_pause();
+  }
+  if (!acquired) {
+    // Park until the owner goes away. Whoever gets the lock from here on keeps
+    // the contended bit set so that its release wakes the next waiter.
+    poly::atomic_inc(&waiter_count_);
+    while (true) {
+      uint32_t value = owner_;
+      if (!value) {
+        if (poly::atomic_cas(0u, owner | kContendedBit, &owner_)) {
+          break;
+        }
+        continue;
+      }
+      if (!(value & kContendedBit)) {
+        if (!poly::atomic_cas(value, value | kContendedBit, &owner_)) {
+          continue;
+        }
+        value |= kContendedBit;
+      }
+      poly::threading::WaitOnAddress(&owner_, value);
+    }
+    poly::atomic_dec(&waiter_count_);
+  }
+
+  if (stats_enabled_) {
+    uint64_t wait_ns = ElapsedNs(start_time);
+    hold_call_site_ = call_site;
+    hold_start_time_ = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> guard(stats_lock_);
+    auto& stats = stats_[call_site];
+    ++stats.acquire_count;
+    stats.contended_count += contended ? 1 : 0;
+    stats.wait_ns += wait_ns;
+  }
+}
+
+void PPCGlobalLock::Release(uint32_t owner) {
+  if (stats_enabled_) {
+    uint64_t hold_ns = ElapsedNs(hold_start_time_);
+    std::lock_guard<std::mutex> guard(stats_lock_);
+    auto& stats = stats_[hold_call_site_];
+    stats.hold_ns += hold_ns;
+    stats.max_hold_ns = std::max(stats.max_hold_ns, hold_ns);
+  }
+
+  uint32_t value = poly::atomic_exchange(0u, &owner_);
+  assert_true((value & ~kContendedBit) == owner);
+  if (waiter_count_) {
+    poly::threading::WakeAddressSingle(&owner_);
+  }
+}
+
+void PPCGlobalLock::DumpStats() {
+  std::lock_guard<std::mutex> guard(stats_lock_);
+  std::vector<std::pair<uint32_t, CallSiteStats>> sites(stats_.begin(),
+                                                        stats_.end());
+  std::sort(sites.begin(), sites.end(),
+            [](const std::pair<uint32_t, CallSiteStats>& a,
+               const std::pair<uint32_t, CallSiteStats>& b) {
+    return a.second.hold_ns + a.second.wait_ns >
+           b.second.hold_ns + b.second.wait_ns;
+  });
+  PLOGI("Global lock call sites (%d), by time held + waited:",
+        static_cast<int>(sites.size()));
+  for (size_t i = 0; i < std::min(sites.size(), static_cast<size_t>(64)); ++i) {
+    auto& stats = sites[i].second;
+    PLOGI("  %.8X: %10lld acquires, %5.1f%% contended, %10.3fms held "
+          "(max %.3fms), %10.3fms waited",
+          sites[i].first, stats.acquire_count,
+          100.0 * stats.contended_count / stats.acquire_count,
+          stats.hold_ns / 1000000.0, stats.max_hold_ns / 1000000.0,
+          stats.wait_ns / 1000000.0);
+  }
+}
+
+}  // namespace ppc
+}  // namespace frontend
+}  // namespace alloy
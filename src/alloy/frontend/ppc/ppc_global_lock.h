@@ -0,0 +1,76 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef ALLOY_FRONTEND_PPC_PPC_GLOBAL_LOCK_H_
+#define ALLOY_FRONTEND_PPC_PPC_GLOBAL_LOCK_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace alloy {
+namespace frontend {
+namespace ppc {
+
+// Processor-wide lock guest code takes by disabling interrupts with mtmsr.
+//
+// The lock is a single owner word: 0 when free, otherwise the r13 of the
+// owning thread (unique per thread and 4b aligned), with kContendedBit set
+// once anybody may be waiting for it. Translated code takes and releases an
+// uncontended lock inline with a compare-exchange on the word and tracks
+// whether the thread holds it in PPCContext::global_lock_held, so taking it
+// again on the owning thread is free and only contention gets here.
+//
+// Waiters spin for a while before parking on the owner word. With
+// --ppc_global_lock_stats every acquire/release comes through here instead and
+// hold/wait times are tracked per mtmsr call site, logged on shutdown.
+class PPCGlobalLock {
+ public:
+  static const uint32_t kContendedBit = 1;
+
+  PPCGlobalLock();
+  ~PPCGlobalLock();
+
+  volatile uint32_t* owner_ptr() { return &owner_; }
+  bool stats_enabled() const { return stats_enabled_; }
+
+  // Blocks until the lock is taken by owner. call_site is the guest address
+  // of the mtmsr, for stats.
+  void Acquire(uint32_t owner, uint32_t call_site);
+  // Releases the lock held by owner and wakes a waiter, if there are any.
+  void Release(uint32_t owner);
+
+ private:
+  struct CallSiteStats {
+    uint64_t acquire_count;
+    uint64_t contended_count;
+    uint64_t wait_ns;
+    uint64_t hold_ns;
+    uint64_t max_hold_ns;
+  };
+
+  void DumpStats();
+
+  volatile uint32_t owner_;
+  volatile uint32_t waiter_count_;
+
+  bool stats_enabled_;
+  std::mutex stats_lock_;
+  std::unordered_map<uint32_t, CallSiteStats> stats_;
+  // Only touched by the owner.
+  uint32_t hold_call_site_;
+  std::chrono::steady_clock::time_point hold_start_time_;
+};
+
+}  // namespace ppc
+}  // namespace frontend
+}  // namespace alloy
+
+#endif  // ALLOY_FRONTEND_PPC_PPC_GLOBAL_LOCK_H_
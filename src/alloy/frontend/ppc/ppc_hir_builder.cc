@@ -37,6 +37,10 @@ PPCHIRBuilder::PPCHIRBuilder(PPCFrontend* frontend)
 PPCHIRBuilder::~PPCHIRBuilder() = default;
 
 void PPCHIRBuilder::Reset() {
+  emit_flags_ = 0;
+  inline_depth_ = 0;
+  inlined_instr_count_ = 0;
+  inline_return_label_ = NULL;
   start_address_ = 0;
   instr_offset_list_ = NULL;
   label_list_ = NULL;
@@ -47,20 +51,30 @@ void PPCHIRBuilder::Reset() {
 int PPCHIRBuilder::Emit(FunctionInfo* symbol_info, uint32_t flags) {
   SCOPE_profile_cpu_f("alloy");
 
-  Memory* memory = frontend_->memory();
-  const uint8_t* p = memory->membase();
-
-  symbol_info_ = symbol_info;
-  start_address_ = symbol_info->address();
-  instr_count_ = (symbol_info->end_address() - symbol_info->address()) / 4 + 1;
-
+  emit_flags_ = flags;
   with_debug_info_ = (flags & EMIT_DEBUG_COMMENTS) == EMIT_DEBUG_COMMENTS;
+  inline_depth_ = 0;
+  inlined_instr_count_ = 0;
+  inline_return_label_ = NULL;
   if (with_debug_info_) {
     Comment("%s fn %.8X-%.8X %s", symbol_info->module()->name().c_str(),
             symbol_info->address(), symbol_info->end_address(),
             symbol_info->name().c_str());
   }
 
+  EmitInstrs(symbol_info);
+
+  return Finalize();
+}
+
+void PPCHIRBuilder::EmitInstrs(FunctionInfo* symbol_info) {
+  Memory* memory = frontend_->memory();
+  const uint8_t* p = memory->membase();
+
+  symbol_info_ = symbol_info;
+  start_address_ = symbol_info->address();
+  instr_count_ = (symbol_info->end_address() - symbol_info->address()) / 4 + 1;
+
   // Allocate offset list.
   // This is used to quickly map labels to instructions.
   // The list is built as the instructions are traversed, with the values
@@ -139,8 +153,8 @@ int PPCHIRBuilder::Emit(FunctionInfo* symbol_info, uint32_t flags) {
       // TraceInvalidInstruction(i);
     }
 
-    if (flags & EMIT_TRACE_SOURCE) {
-      if (flags & EMIT_TRACE_SOURCE_VALUES) {
+    if (emit_flags_ & EMIT_TRACE_SOURCE) {
+      if (emit_flags_ & EMIT_TRACE_SOURCE_VALUES) {
         switch (trace_info_.dest_count) {
           case 0:
             TraceSource(i.address);
@@ -163,11 +177,146 @@ int PPCHIRBuilder::Emit(FunctionInfo* symbol_info, uint32_t flags) {
       }
     }
   }
+}
 
-  return Finalize();
+bool PPCHIRBuilder::EmitInlineCall(FunctionInfo* callee, bool returns) {
+  if (!CanInline(callee, returns)) {
+    return false;
+  }
+  if (with_debug_info_) {
+    Comment("inlined %s fn %.8X-%.8X", callee->name().c_str(),
+            callee->address(), callee->end_address());
+  }
+  inlined_instr_count_ += (callee->end_address() - callee->address()) / 4 + 1;
+  AddInlinedRange(callee->address(), callee->end_address());
+
+  // The lists are arena allocated, so the callee just gets new ones and ours
+  // are put back after.
+  auto caller_symbol_info = symbol_info_;
+  auto caller_start_address = start_address_;
+  auto caller_instr_count = instr_count_;
+  auto caller_instr_offset_list = instr_offset_list_;
+  auto caller_label_list = label_list_;
+  auto caller_return_label = inline_return_label_;
+  auto caller_trace_info = trace_info_;
+
+  Label* return_label = returns ? NewLabel() : NULL;
+  inline_return_label_ = return_label;
+  ++inline_depth_;
+  EmitInstrs(callee);
+  --inline_depth_;
+
+  symbol_info_ = caller_symbol_info;
+  start_address_ = caller_start_address;
+  instr_count_ = caller_instr_count;
+  instr_offset_list_ = caller_instr_offset_list;
+  label_list_ = caller_label_list;
+  inline_return_label_ = caller_return_label;
+  trace_info_ = caller_trace_info;
+
+  if (return_label) {
+    MarkLabel(return_label);
+  }
+  return true;
+}
+
+bool PPCHIRBuilder::CanInline(FunctionInfo* callee, bool returns) {
+  // Leaves have no calls, so this only stops a helper tail calling another.
+  const uint32_t kMaxInlineDepth = 1;
+  // Total for the function, so that one with many call sites doesn't blow up.
+  const uint64_t kMaxInlinedInstrs = 1024;
+
+  // Callees that haven't been scanned yet are left as calls.
+  if (!callee || inline_depth_ >= kMaxInlineDepth ||
+      !callee->has_end_address() || callee == symbol_info_) {
+    return false;
+  }
+  uint64_t instr_count = (callee->end_address() - callee->address()) / 4 + 1;
+  if (inlined_instr_count_ + instr_count > kMaxInlinedInstrs) {
+    return false;
+  }
+  switch (callee->behavior()) {
+    case FunctionInfo::BEHAVIOR_PROLOG:
+    case FunctionInfo::BEHAVIOR_EPILOG:
+    case FunctionInfo::BEHAVIOR_EPILOG_RETURN:
+      // Found by XexModule::FindSaveRest from their exact code, so their
+      // size is known and they're always worth it.
+      if (!FLAGS_ppc_inline_save_restore) {
+        return false;
+      }
+      break;
+    case FunctionInfo::BEHAVIOR_DEFAULT:
+      if (FLAGS_ppc_inline_max_instrs <= 0 ||
+          instr_count > static_cast<uint64_t>(FLAGS_ppc_inline_max_instrs)) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+  }
+
+  // Only straight-line code and branches within the callee. Calls out of it
+  // would need their own return addresses, and if it sets LR its blr isn't
+  // a return to us.
+  const uint8_t* p = frontend_->memory()->membase();
+  uint64_t start_address = callee->address();
+  uint64_t end_address = callee->end_address();
+  InstrData i;
+  for (uint64_t address = start_address; address <= end_address;
+       address += 4) {
+    i.address = address;
+    i.code = poly::load_and_swap<uint32_t>(p + address);
+    i.type = GetInstrType(i.code);
+    if (!i.type) {
+      return false;
+    }
+    uint64_t target;
+    switch (i.type->opcode) {
+      case 0x48000000:  // bx
+        if (i.I.LK) {
+          return false;
+        }
+        target = i.I.AA ? (uint32_t)XEEXTS26(i.I.LI << 2)
+                        : (uint32_t)(address + XEEXTS26(i.I.LI << 2));
+        if (target < start_address || target > end_address) {
+          return false;
+        }
+        break;
+      case 0x40000000:  // bcx
+        if (i.B.LK) {
+          return false;
+        }
+        target = i.B.AA ? (uint32_t)XEEXTS16(i.B.BD << 2)
+                        : (uint32_t)(address + XEEXTS16(i.B.BD << 2));
+        if (target < start_address || target > end_address) {
+          return false;
+        }
+        break;
+      case 0x4C000020:  // bclrx
+        if (i.XL.LK) {
+          return false;
+        }
+        break;
+      case 0x4C000420:  // bcctrx
+      case 0x44000002:  // sc
+        return false;
+      case 0x7C0003A6:  // mtspr
+        if (returns &&
+            (((i.XFX.spr & 0x1F) << 5) | ((i.XFX.spr >> 5) & 0x1F)) == 8) {
+          return false;
+        }
+        break;
+    }
+  }
+  return true;
 }
 
 void PPCHIRBuilder::AnnotateLabel(uint64_t address, Label* label) {
+  // The same callee may be inlined more than once, so its labels can't be
+  // named after their addresses.
+  if (inline_depth_) {
+    return;
+  }
   char name_buffer[13];
   snprintf(name_buffer, poly::countof(name_buffer), "loc_%.8X",
            (uint32_t)address);
@@ -314,14 +463,62 @@ Value* PPCHIRBuilder::LoadMSR() {
   // bit 48 = EE; interrupt enabled
   // bit 62 = RI; recoverable interrupt
   // return 8000h if unlocked, else 0
-  CallExtern(frontend_->builtins()->check_global_lock);
-  return LoadContext(offsetof(PPCContext, scratch), INT64_TYPE);
-}
+  Value* held = LoadContext(offsetof(PPCContext, global_lock_held), INT8_TYPE);
+  return Select(IsTrue(held), LoadZero(INT64_TYPE),
+                LoadConstant(uint64_t(0x8000)));
+}
+
+void PPCHIRBuilder::StoreMSR(Value* value, uint64_t call_site) {
+  EmitStoreMSR(*this, frontend_->builtins(), value, call_site);
+}
+
+void EmitStoreMSR(hir::HIRBuilder& b, PPCBuiltins* builtins, hir::Value* value,
+                  uint64_t call_site) {
+  // if == r13, lock, else if == 8000h, unlock
+  // Like interrupts the lock doesn't nest: taking it again on the thread
+  // that holds it does nothing, and code that nests restores the 0 it got
+  // from mfmsr on the inside. Only the owner word is shared, and the slow
+  // path is only called when the inline compare-exchange on it fails.
+  bool inline_fast_path = !builtins->global_lock.stats_enabled();
+  auto r13 = b.LoadContext(offsetof(PPCContext, r) + 13 * 8, INT64_TYPE);
+  auto owner = b.Truncate(r13, INT32_TYPE);
+  auto held =
+      b.LoadContext(offsetof(PPCContext, global_lock_held), INT8_TYPE);
+  auto lock_label = b.NewLabel();
+  auto end_label = b.NewLabel();
+  b.BranchTrue(b.CompareEQ(value, r13), lock_label);
+  b.BranchFalse(b.CompareEQ(value, b.LoadConstant(uint64_t(0x8000))),
+                end_label);
+
+  // Unlock. Ignored if this thread doesn't hold the lock.
+  b.BranchFalse(b.IsTrue(held), end_label);
+  b.StoreContext(offsetof(PPCContext, global_lock_held),
+                 b.LoadZero(INT8_TYPE));
+  if (inline_fast_path) {
+    // Fails if the contended bit is set; somebody has to be woken.
+    auto old_owner = b.CompareExchange(
+        b.LoadContext(offsetof(PPCContext, global_lock_owner), INT64_TYPE),
+        owner, b.LoadZero(INT32_TYPE));
+    b.BranchTrue(b.CompareEQ(old_owner, owner), end_label, BRANCH_LIKELY);
+  }
+  b.CallExtern(builtins->leave_global_lock);
+  b.Branch(end_label);
+
+  // Lock.
+  b.MarkLabel(lock_label);
+  b.BranchTrue(b.IsTrue(held), end_label);
+  b.StoreContext(offsetof(PPCContext, global_lock_held),
+                 b.LoadConstant(uint8_t(1)));
+  if (inline_fast_path) {
+    auto old_owner = b.CompareExchange(
+        b.LoadContext(offsetof(PPCContext, global_lock_owner), INT64_TYPE),
+        b.LoadZero(INT32_TYPE), owner);
+    b.BranchTrue(b.IsFalse(old_owner), end_label, BRANCH_LIKELY);
+  }
+  b.StoreContext(offsetof(PPCContext, scratch), b.LoadConstant(call_site));
+  b.CallExtern(builtins->enter_global_lock);
 
-void PPCHIRBuilder::StoreMSR(Value* value) {
-  // if & 0x8000 == 0, lock, else unlock
-  StoreContext(offsetof(PPCContext, scratch), ZeroExtend(value, INT64_TYPE));
-  CallExtern(frontend_->builtins()->handle_global_lock);
+  b.MarkLabel(end_label);
 }
 
 Value* PPCHIRBuilder::LoadFPSCR() {
@@ -411,36 +608,45 @@ void PPCHIRBuilder::StoreVR(uint32_t reg, Value* value) {
 
 Value* PPCHIRBuilder::LoadAcquire(Value* address, TypeName type,
                                   uint32_t load_flags) {
-  AtomicExchange(LoadContext(offsetof(PPCContext, reserve_address), INT64_TYPE),
-                 Truncate(address, INT32_TYPE));
+  // The reservation lives in the context, so each thread has its own and
+  // taking one never touches shared state.
+  StoreContext(offsetof(PPCContext, reserve_address),
+               ZeroExtend(Truncate(address, INT32_TYPE), INT64_TYPE));
   Value* value = Load(address, type, load_flags);
   // Save the value so that we can compare it later in StoreRelease.
-  AtomicExchange(
-      LoadContext(offsetof(PPCContext, reserve_value), INT64_TYPE),
-      value);
+  StoreContext(offsetof(PPCContext, reserve_value), value);
   return value;
 }
 
-Value* PPCHIRBuilder::StoreRelease(Value* address, Value* value,
-                                   uint32_t store_flags) {
-  Value* old_address = AtomicExchange(
-      LoadContext(offsetof(PPCContext, reserve_address), INT64_TYPE),
-      LoadZero(INT32_TYPE));
-  // HACK: ensure the reservation addresses match AND the value hasn't changed.
-  Value* old_value = AtomicExchange(
-      LoadContext(offsetof(PPCContext, reserve_value), INT64_TYPE),
-      LoadZero(value->type));
-  Value* current_value = Load(address, value->type);
-  Value* eq = And(CompareEQ(Truncate(address, INT32_TYPE), old_address),
-                  CompareEQ(current_value, old_value));
-  StoreContext(offsetof(PPCContext, cr0.cr0_eq), eq);
+void PPCHIRBuilder::StoreRelease(Value* address, Value* value,
+                                 uint32_t store_flags) {
+  // The store only happens if the reservation is for this address and the
+  // memory still holds the value that was loaded, checked and stored in one
+  // host compare-exchange. Another thread storing the same value in between
+  // (ABA) goes unnoticed, which the lock/counter idioms built on lwarx/stwcx
+  // tolerate.
+  // store_flags are only alias/alignment hints, which don't change how the
+  // exchange is done. Callers byte swap the value themselves.
+  Value* guest_address = ZeroExtend(Truncate(address, INT32_TYPE), INT64_TYPE);
+  Value* reserved_address =
+      LoadContext(offsetof(PPCContext, reserve_address), INT64_TYPE);
+  // Any stwcx clears the reservation, whether it succeeds or not.
+  StoreContext(offsetof(PPCContext, reserve_address),
+               LoadConstant(UINT64_MAX));
+  StoreContext(offsetof(PPCContext, cr0.cr0_eq), LoadZero(INT8_TYPE));
   StoreContext(offsetof(PPCContext, cr0.cr0_lt), LoadZero(INT8_TYPE));
   StoreContext(offsetof(PPCContext, cr0.cr0_gt), LoadZero(INT8_TYPE));
   auto skip_label = NewLabel();
-  BranchFalse(eq, skip_label, BRANCH_UNLIKELY);
-  Store(address, value, store_flags);
+  BranchFalse(CompareEQ(guest_address, reserved_address), skip_label,
+              BRANCH_UNLIKELY);
+  Value* reserved_value =
+      LoadContext(offsetof(PPCContext, reserve_value), value->type);
+  Value* host_address = Add(
+      LoadContext(offsetof(PPCContext, membase), INT64_TYPE), guest_address);
+  Value* old_value = CompareExchange(host_address, reserved_value, value);
+  StoreContext(offsetof(PPCContext, cr0.cr0_eq),
+               CompareEQ(old_value, reserved_value));
   MarkLabel(skip_label);
-  return eq;
 }
 
 }  // namespace ppc
@@ -20,6 +20,12 @@ namespace frontend {
 namespace ppc {
 
 class PPCFrontend;
+struct PPCBuiltins;
+
+// Emits the mtmsr global lock sequence: takes the lock if value is r13,
+// releases it if value is 8000h and does nothing otherwise.
+void EmitStoreMSR(hir::HIRBuilder& b, PPCBuiltins* builtins, hir::Value* value,
+                  uint64_t call_site);
 
 class PPCHIRBuilder : public hir::HIRBuilder {
   using Instr = alloy::hir::Instr;
@@ -46,6 +52,14 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   runtime::FunctionInfo* LookupFunction(uint64_t address);
   Label* LookupLabel(uint64_t address);
 
+  // Emits the body of a direct call target in place of the call, if it is
+  // one of the save/restore helpers or a small enough leaf. If it returns,
+  // its blr branches to just after the call. Otherwise (a tail call) its blr
+  // returns from this function, as it would have from the callee.
+  bool EmitInlineCall(runtime::FunctionInfo* callee, bool returns);
+  // Where blr goes while emitting an inlined callee that returns.
+  Label* inline_return_label() const { return inline_return_label_; }
+
   Value* LoadLR();
   void StoreLR(Value* value);
   Value* LoadCTR();
@@ -58,7 +72,7 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   void UpdateCR(uint32_t n, Value* lhs, Value* rhs, bool is_signed = true);
   void UpdateCR6(Value* src_value);
   Value* LoadMSR();
-  void StoreMSR(Value* value);
+  void StoreMSR(Value* value, uint64_t call_site);
   Value* LoadFPSCR();
   void StoreFPSCR(Value* value);
   Value* LoadXER();
@@ -80,9 +94,11 @@ class PPCHIRBuilder : public hir::HIRBuilder {
 
   Value* LoadAcquire(Value* address, hir::TypeName type,
                      uint32_t load_flags = 0);
-  Value* StoreRelease(Value* address, Value* value, uint32_t store_flags = 0);
+  void StoreRelease(Value* address, Value* value, uint32_t store_flags = 0);
 
  private:
+  void EmitInstrs(runtime::FunctionInfo* symbol_info);
+  bool CanInline(runtime::FunctionInfo* callee, bool returns);
   void AnnotateLabel(uint64_t address, Label* label);
 
  private:
@@ -92,7 +108,13 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   StringBuffer comment_buffer_;
 
   // Reset each Emit:
+  uint32_t emit_flags_;
   bool with_debug_info_;
+  uint32_t inline_depth_;
+  uint64_t inlined_instr_count_;
+  Label* inline_return_label_;
+
+  // Swapped out while emitting an inlined callee:
   runtime::FunctionInfo* symbol_info_;
   uint64_t start_address_;
   uint64_t instr_count_;
@@ -33,9 +33,29 @@ using alloy::runtime::Function;
 using alloy::runtime::FunctionInfo;
 namespace passes = alloy::compiler::passes;
 
-PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
-  Backend* backend = frontend->runtime()->backend();
+namespace {
+
+uint32_t CountInstrs(hir::HIRBuilder* builder) {
+  uint32_t count = 0;
+  auto block = builder->first_block();
+  while (block) {
+    auto instr = block->instr_head;
+    while (instr) {
+      ++count;
+      instr = instr->next;
+    }
+    block = block->next;
+  }
+  return count;
+}
 
+}  // namespace
+
+PPCTranslator::PPCTranslator(PPCFrontend* frontend, Backend* backend)
+    : frontend_(frontend),
+      backend_(backend),
+      global_context_promotion_pass_(nullptr),
+      register_allocation_pass_(nullptr) {
   scanner_.reset(new PPCScanner(frontend));
   builder_.reset(new PPCHIRBuilder(frontend));
   compiler_.reset(new Compiler(frontend->runtime()));
@@ -44,6 +64,15 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
 
   bool validate = FLAGS_validate_hir;
 
+  if (backend != frontend->runtime()->backend()) {
+    // First tier of --runtime_tiered. Most functions never run enough to be
+    // worth optimizing, so get them running as soon as possible; hot ones are
+    // translated again for the main backend.
+    if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+    compiler_->AddPass(std::make_unique<passes::FinalizationPass>());
+    return;
+  }
+
   // Merge blocks early. This will let us use more context in other passes.
   // The CFG is required for simplification and dirtied by it.
   compiler_->AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
@@ -55,17 +84,34 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   compiler_->AddPass(std::make_unique<passes::ContextPromotionPass>());
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  // Picks up what the block local promotion above can't see across branches.
+  auto global_context_promotion_pass =
+      std::make_unique<passes::GlobalContextPromotionPass>();
+  global_context_promotion_pass_ = global_context_promotion_pass.get();
+  compiler_->AddPass(std::move(global_context_promotion_pass));
+  if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   compiler_->AddPass(std::make_unique<passes::ConstantPropagationPass>());
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
-  // compiler_->AddPass(std::make_unique<passes::DeadStoreEliminationPass>());
-  // if (validate)
-  // compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  // Leaves assigns behind for simplification to fold.
+  compiler_->AddPass(std::make_unique<passes::ValueNumberingPass>());
+  if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
+  if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  // May add preheader blocks, so the CFG must be rebuilt after.
+  compiler_->AddPass(std::make_unique<passes::LoopInvariantCodeMotionPass>());
+  if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  compiler_->AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
+  compiler_->AddPass(std::make_unique<passes::DeadStoreEliminationPass>());
+  if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   compiler_->AddPass(std::make_unique<passes::DeadCodeEliminationPass>());
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  // Puts branch conditions next to their branches for the backend to fuse.
+  compiler_->AddPass(std::make_unique<passes::CompareSinkingPass>());
+  if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
 
   //// Removes all unneeded variables. Try not to add new ones after this.
   // compiler_->AddPass(new passes::ValueReductionPass());
@@ -75,8 +121,14 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
   // Will modify the HIR to add loads/stores.
   // This should be the last pass before finalization, as after this all
   // registers are assigned and ready to be emitted.
-  compiler_->AddPass(std::make_unique<passes::RegisterAllocationPass>(
-      backend->machine_info()));
+  // Allocation is global, so it needs fresh block liveness.
+  compiler_->AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
+  compiler_->AddPass(std::make_unique<passes::DataFlowAnalysisPass>());
+  auto register_allocation_pass =
+      std::make_unique<passes::RegisterAllocationPass>(
+          backend->machine_info());
+  register_allocation_pass_ = register_allocation_pass.get();
+  compiler_->AddPass(std::move(register_allocation_pass));
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
 
   // Must come last. The HIR is not really HIR after this.
@@ -90,28 +142,46 @@ int PPCTranslator::Translate(FunctionInfo* symbol_info,
                              Function** out_function) {
   SCOPE_profile_cpu_f("alloy");
 
+  TranslationProfiler::ScopedFunction profile_scope(
+      frontend_->runtime()->translation_profiler(), symbol_info,
+      backend_ == frontend_->runtime()->backend() ? 1 : 0);
+
   // Reset() all caching when we leave.
   make_reset_scope(builder_);
   make_reset_scope(compiler_);
   make_reset_scope(assembler_);
   make_reset_scope(&string_buffer_);
 
+  // NOTE: we only want to do this when required, as it's expensive to build.
+  if (FLAGS_always_disasm) {
+    debug_info_flags |= DEBUG_INFO_ALL_DISASM;
+  }
+
+  // Reuse a translation from a previous run if the backend has one. Those
+  // carry no debug info or tracing, so only plain functions can use them.
+  if (!debug_info_flags && !trace_flags) {
+    if (!backend_->LoadCachedFunction(symbol_info, out_function)) {
+      if (TranslationProfiler::current()) {
+        TranslationProfiler::current()->was_cached = true;
+      }
+      return 0;
+    }
+  }
+
   // Scan the function to find its extents. We only need to do this if we
   // haven't already been provided with them from some other source.
   if (!symbol_info->has_end_address()) {
     // TODO(benvanik): find a way to remove the need for the scan. A fixup
     //     scheme acting on branches could go back and modify calls to branches
     //     if they are within the extents.
+    TranslationProfiler::ScopedPhase profile_phase(
+        TranslationProfiler::PHASE_FIND_EXTENTS);
     int result = scanner_->FindExtents(symbol_info);
     if (result) {
       return result;
     }
   }
 
-  // NOTE: we only want to do this when required, as it's expensive to build.
-  if (FLAGS_always_disasm) {
-    debug_info_flags |= DEBUG_INFO_ALL_DISASM;
-  }
   std::unique_ptr<DebugInfo> debug_info;
   if (debug_info_flags) {
     debug_info.reset(new DebugInfo());
@@ -134,7 +204,12 @@ int PPCTranslator::Translate(FunctionInfo* symbol_info,
   } else if (trace_flags & TRACE_SOURCE) {
     emit_flags |= PPCHIRBuilder::EMIT_TRACE_SOURCE;
   }
-  int result = builder_->Emit(symbol_info, emit_flags);
+  int result;
+  {
+    TranslationProfiler::ScopedPhase profile_phase(
+        TranslationProfiler::PHASE_EMIT_HIR);
+    result = builder_->Emit(symbol_info, emit_flags);
+  }
   if (result) {
     return result;
   }
@@ -147,10 +222,36 @@ int PPCTranslator::Translate(FunctionInfo* symbol_info,
   }
 
   // Compile/optimize/etc.
-  result = compiler_->Compile(builder_.get());
+  auto profile_record = TranslationProfiler::current();
+  if (profile_record) {
+    profile_record->hir_instr_count_before = CountInstrs(builder_.get());
+  }
+  {
+    TranslationProfiler::ScopedPhase profile_phase(
+        TranslationProfiler::PHASE_COMPILE);
+    result = compiler_->Compile(builder_.get());
+  }
   if (result) {
     return result;
   }
+  if (profile_record) {
+    profile_record->hir_instr_count_after = CountInstrs(builder_.get());
+  }
+  if (FLAGS_trace_context_promotion && global_context_promotion_pass_) {
+    auto& stats = global_context_promotion_pass_->stats();
+    PLOGI("ctxpromo %.8X %s: %u context loads, %u promoted across blocks",
+          symbol_info->address(), symbol_info->name().c_str(),
+          stats.load_count, stats.promoted_count);
+  }
+  if (FLAGS_trace_register_allocation && register_allocation_pass_) {
+    auto& stats = register_allocation_pass_->stats();
+    PLOGI("regalloc %.8X %s: %u -> %u instrs, %u split, %u stores, "
+          "%u loads, %u moves coalesced",
+          symbol_info->address(), symbol_info->name().c_str(),
+          stats.instr_count_before, stats.instr_count_after, stats.spill_count,
+          stats.spill_store_count, stats.spill_load_count,
+          stats.coalesced_move_count);
+  }
 
   // Stash optimized HIR.
   if (debug_info_flags & DEBUG_INFO_HIR_DISASM) {
@@ -160,9 +261,13 @@ int PPCTranslator::Translate(FunctionInfo* symbol_info,
   }
 
   // Assemble to backend machine code.
-  result =
-      assembler_->Assemble(symbol_info, builder_.get(), debug_info_flags,
-                           std::move(debug_info), trace_flags, out_function);
+  {
+    TranslationProfiler::ScopedPhase profile_phase(
+        TranslationProfiler::PHASE_ASSEMBLE);
+    result =
+        assembler_->Assemble(symbol_info, builder_.get(), debug_info_flags,
+                             std::move(debug_info), trace_flags, out_function);
+  }
   if (result) {
     return result;
   }
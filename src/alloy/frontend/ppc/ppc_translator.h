@@ -17,6 +17,15 @@
 #include <alloy/runtime/symbol_info.h>
 #include <alloy/string_buffer.h>
 
+namespace alloy {
+namespace compiler {
+namespace passes {
+class GlobalContextPromotionPass;
+class RegisterAllocationPass;
+}  // namespace passes
+}  // namespace compiler
+}  // namespace alloy
+
 namespace alloy {
 namespace frontend {
 namespace ppc {
@@ -27,7 +36,9 @@ class PPCScanner;
 
 class PPCTranslator {
  public:
-  PPCTranslator(PPCFrontend* frontend);
+  // Translates for the given backend. Any but the runtime's own gets the
+  // cheap first tier pipeline.
+  PPCTranslator(PPCFrontend* frontend, backend::Backend* backend);
   ~PPCTranslator();
 
   int Translate(runtime::FunctionInfo* symbol_info, uint32_t debug_info_flags,
@@ -39,10 +50,14 @@ class PPCTranslator {
 
  private:
   PPCFrontend* frontend_;
+  backend::Backend* backend_;
   std::unique_ptr<PPCScanner> scanner_;
   std::unique_ptr<PPCHIRBuilder> builder_;
   std::unique_ptr<compiler::Compiler> compiler_;
   std::unique_ptr<backend::Assembler> assembler_;
+  // Owned by compiler_; kept for its stats. Null for the first tier.
+  compiler::passes::GlobalContextPromotionPass* global_context_promotion_pass_;
+  compiler::passes::RegisterAllocationPass* register_allocation_pass_;
 
   StringBuffer string_buffer_;
 };
@@ -51,8 +51,11 @@ class ThreadState : public alloy::runtime::ThreadState {
     assert_true((reinterpret_cast<uint64_t>(context_) & 0xF) == 0);
 
     // Stash pointers to common structures that callbacks may need.
-    context_->reserve_address = memory_->reserve_address();
-    context_->reserve_value = memory_->reserve_value();
+    context_->reserve_address = UINT64_MAX;
+    context_->global_lock_owner =
+        static_cast<alloy::frontend::ppc::PPCFrontend*>(runtime->frontend())
+            ->builtins()
+            ->global_lock.owner_ptr();
     context_->membase = memory_->membase();
     context_->runtime = runtime;
     context_->thread_state = this;
@@ -261,17 +264,14 @@ class TestRunner {
     }
 
     // Execute test.
-    alloy::runtime::Function* fn;
-    runtime->ResolveFunction(test_case.address, &fn);
-    if (!fn) {
+    auto ctx = thread_state->context();
+    ctx->lr = 0xBEBEBEBE;
+    if (runtime->CallFunction(thread_state.get(), test_case.address,
+                              ctx->lr)) {
       PLOGE("Entry function not found");
       return false;
     }
 
-    auto ctx = thread_state->context();
-    ctx->lr = 0xBEBEBEBE;
-    fn->Call(thread_state.get(), ctx->lr);
-
     // Assert test state expectations.
     bool result = CheckTestResults(test_case);
 
@@ -52,7 +52,10 @@ class Block {
 
   Edge* incoming_edge_head;
   Edge* outgoing_edge_head;
+  // Values live on entry to/exit from the block, by value ordinal.
+  // Only valid after DataFlowAnalysisPass and until the HIR is changed.
   llvm::BitVector* incoming_values;
+  llvm::BitVector* outgoing_values;
 
   Label* label_head;
   Label* label_tail;
@@ -61,6 +64,9 @@ class Block {
   Instr* instr_tail;
 
   uint16_t ordinal;
+  // Number of loops containing the block, 0 if none. Only set by
+  // LoopInvariantCodeMotionPass; later passes use it to weigh spills.
+  uint16_t loop_depth;
 
   void AssertNoCycles();
 };
@@ -43,6 +43,7 @@ void HIRBuilder::Reset() {
   next_label_id_ = 0;
   next_value_ordinal_ = 0;
   locals_.clear();
+  inlined_ranges_.clear();
   block_head_ = block_tail_ = NULL;
   current_block_ = NULL;
 #if XE_DEBUG
@@ -386,6 +387,8 @@ void HIRBuilder::InsertLabel(Label* label, Instr* prev_instr) {
   }
   new_block->label_head = new_block->label_tail = label;
   new_block->incoming_edge_head = new_block->outgoing_edge_head = NULL;
+  new_block->incoming_values = new_block->outgoing_values = NULL;
+  new_block->loop_depth = prev_block ? prev_block->loop_depth : 0;
   label->block = new_block;
   label->prev = label->next = NULL;
 
@@ -411,6 +414,15 @@ void HIRBuilder::InsertLabel(Label* label, Instr* prev_instr) {
   }
 }
 
+void HIRBuilder::AddInlinedRange(uint64_t address, uint64_t end_address) {
+  for (auto& range : inlined_ranges_) {
+    if (range.address == address && range.end_address == end_address) {
+      return;
+    }
+  }
+  inlined_ranges_.push_back({address, end_address});
+}
+
 void HIRBuilder::ResetLabelTags() {
   // TODO(benvanik): make this faster?
   auto block = block_head_;
@@ -534,7 +546,29 @@ Block* HIRBuilder::AppendBlock() {
   current_block_ = block;
   block->label_head = block->label_tail = NULL;
   block->incoming_edge_head = block->outgoing_edge_head = NULL;
+  block->incoming_values = block->outgoing_values = NULL;
+  block->instr_head = block->instr_tail = NULL;
+  block->loop_depth = 0;
+  return block;
+}
+
+Block* HIRBuilder::InsertBlockBefore(Block* next_block) {
+  Block* block = arena_->Alloc<Block>();
+  block->arena = arena_;
+  block->next = next_block;
+  block->prev = next_block->prev;
+  if (block->prev) {
+    block->prev->next = block;
+  } else {
+    block_head_ = block;
+  }
+  next_block->prev = block;
+  block->label_head = block->label_tail = NULL;
+  block->incoming_edge_head = block->outgoing_edge_head = NULL;
+  block->incoming_values = block->outgoing_values = NULL;
   block->instr_head = block->instr_tail = NULL;
+  block->ordinal = 0;
+  block->loop_depth = 0;
   return block;
 }
 
@@ -47,6 +47,18 @@ class HIRBuilder {
 
   std::vector<Value*>& locals() { return locals_; }
 
+  // Guest code of other functions built into this one by inlining, which the
+  // result depends on as much as on its own. end_address is the address of
+  // the last instruction.
+  struct GuestRange {
+    uint64_t address;
+    uint64_t end_address;
+  };
+  const std::vector<GuestRange>& inlined_ranges() const {
+    return inlined_ranges_;
+  }
+  void AddInlinedRange(uint64_t address, uint64_t end_address);
+
   uint32_t max_value_ordinal() const { return next_value_ordinal_; }
 
   Block* first_block() const { return block_head_; }
@@ -61,6 +73,8 @@ class HIRBuilder {
 
   void AddEdge(Block* src, Block* dest, uint32_t flags);
   void MergeAdjacentBlocks(Block* left, Block* right);
+  // Empty block placed right before the given one, so it falls through.
+  Block* InsertBlockBefore(Block* next_block);
 
   // static allocations:
   // Value* AllocStatic(size_t length);
@@ -251,6 +265,7 @@ class HIRBuilder {
   uint32_t next_value_ordinal_;
 
   std::vector<Value*> locals_;
+  std::vector<GuestRange> inlined_ranges_;
 
   Block* block_head_;
   Block* block_tail_;
@@ -77,6 +77,35 @@ void Instr::MoveBefore(Instr* other) {
   }
 }
 
+void Instr::MoveToEnd(Block* new_block) {
+  if (block == new_block && !next) {
+    return;
+  }
+
+  // Remove from current location.
+  if (prev) {
+    prev->next = next;
+  } else {
+    block->instr_head = next;
+  }
+  if (next) {
+    next->prev = prev;
+  } else {
+    block->instr_tail = prev;
+  }
+
+  // Append to the new block.
+  block = new_block;
+  next = NULL;
+  prev = block->instr_tail;
+  if (prev) {
+    prev->next = this;
+  } else {
+    block->instr_head = this;
+  }
+  block->instr_tail = this;
+}
+
 void Instr::Replace(const OpcodeInfo* opcode, uint16_t flags) {
   this->opcode = opcode;
   this->flags = flags;
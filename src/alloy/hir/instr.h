@@ -56,6 +56,7 @@ class Instr {
   void set_src3(Value* value);
 
   void MoveBefore(Instr* other);
+  void MoveToEnd(Block* new_block);
   void Replace(const OpcodeInfo* opcode, uint16_t flags);
   void Remove();
 };
@@ -24,11 +24,6 @@ class Memory {
   inline uint8_t* Translate(uint64_t guest_address) const {
     return membase_ + guest_address;
   };
-  inline uint64_t* reserve_address() { return &reserve_address_; }
-  inline uint64_t* reserve_value() { return &reserve_value_; }
-
-  // TODO(benvanik): remove with GPU refactor.
-  virtual uint64_t page_table() const = 0;
 
   uint64_t trace_base() const { return trace_base_; }
   void set_trace_base(uint64_t value) { trace_base_ = value; }
@@ -56,8 +51,6 @@ class Memory {
  protected:
   size_t system_page_size_;
   uint8_t* membase_;
-  uint64_t reserve_address_;
-  uint64_t reserve_value_;
   uint64_t trace_base_;
 };
 
@@ -66,8 +59,6 @@ class SimpleMemory : public Memory {
   SimpleMemory(size_t capacity);
   ~SimpleMemory() override;
 
-  uint64_t page_table() const override { return 0; }
-
   // TODO(benvanik): remove with IVM.
   uint8_t LoadI8(uint64_t address) override;
   uint16_t LoadI16(uint64_t address) override;
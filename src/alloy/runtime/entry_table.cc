@@ -9,28 +9,109 @@
 
 #include <alloy/runtime/entry_table.h>
 
+#include <algorithm>
+
 #include <poly/poly.h>
 #include <xenia/profiling.h>
 
+#if !XE_LIKE_WIN32
+#include <sys/mman.h>
+#endif  // !XE_LIKE_WIN32
+
 namespace alloy {
 namespace runtime {
 
-EntryTable::EntryTable() = default;
+namespace {
+const size_t kSlotTableSize = EntryTable::kSlotCount * sizeof(Entry*);
+const size_t kSlotPageSize = 4096;
+const size_t kSlotPageCount = kSlotTableSize / kSlotPageSize;
+}  // namespace
+
+EntryTable::EntryTable()
+    : slots_(nullptr),
+      committed_pages_(new std::atomic<uint8_t>[kSlotPageCount]),
+      entry_head_(nullptr) {
+  // The table is large but sparse, so only reserve it here. Pages are
+  // committed as slots on them are claimed (and read as zero (null) then).
+#if XE_LIKE_WIN32
+  void* p = VirtualAlloc(nullptr, kSlotTableSize, MEM_RESERVE, PAGE_NOACCESS);
+#else
+  void* p = mmap(nullptr, kSlotTableSize, PROT_NONE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) {
+    p = nullptr;
+  }
+#endif  // XE_LIKE_WIN32
+  assert_not_null(p);
+  slots_ = reinterpret_cast<std::atomic<Entry*>*>(p);
+  for (size_t n = 0; n < kSlotPageCount; n++) {
+    committed_pages_[n].store(0, std::memory_order_relaxed);
+  }
+  for (auto& bucket : wait_buckets_) {
+    bucket.waiter_count.store(0, std::memory_order_relaxed);
+  }
+}
 
 EntryTable::~EntryTable() {
   std::lock_guard<std::mutex> guard(lock_);
-  for (auto it : map_) {
-    Entry* entry = it.second;
+  Entry* entry = entry_head_.exchange(nullptr);
+  while (entry) {
+    Entry* next = entry->next;
     delete entry;
+    entry = next;
+  }
+  map_.clear();
+  if (slots_) {
+#if XE_LIKE_WIN32
+    VirtualFree(slots_, 0, MEM_RELEASE);
+#else
+    munmap(slots_, kSlotTableSize);
+#endif  // XE_LIKE_WIN32
+    slots_ = nullptr;
   }
 }
 
-Entry* EntryTable::Get(uint64_t address) {
+bool EntryTable::IsSlotCommitted(const std::atomic<Entry*>* slot) const {
+  size_t page = (slot - slots_) * sizeof(Entry*) / kSlotPageSize;
+  return committed_pages_[page].load(std::memory_order_acquire) != 0;
+}
+
+bool EntryTable::CommitSlot(const std::atomic<Entry*>* slot) {
+  if (IsSlotCommitted(slot)) {
+    return true;
+  }
+  size_t page = (slot - slots_) * sizeof(Entry*) / kSlotPageSize;
+  std::lock_guard<std::mutex> guard(lock_);
+  if (committed_pages_[page].load(std::memory_order_relaxed)) {
+    return true;
+  }
+  uint8_t* p = reinterpret_cast<uint8_t*>(slots_) + page * kSlotPageSize;
+#if XE_LIKE_WIN32
+  bool result =
+      VirtualAlloc(p, kSlotPageSize, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+  bool result = !mprotect(p, kSlotPageSize, PROT_READ | PROT_WRITE);
+#endif  // XE_LIKE_WIN32
+  if (result) {
+    committed_pages_[page].store(1, std::memory_order_release);
+  }
+  return result;
+}
+
+Entry* EntryTable::Lookup(uint64_t address) {
+  auto slot = LookupSlot(address);
+  if (slot) {
+    return IsSlotCommitted(slot) ? slot->load(std::memory_order_acquire)
+                                 : nullptr;
+  }
   std::lock_guard<std::mutex> guard(lock_);
   const auto& it = map_.find(address);
-  Entry* entry = it != map_.end() ? it->second : nullptr;
+  return it != map_.end() ? it->second : nullptr;
+}
+
+Entry* EntryTable::Get(uint64_t address) {
+  Entry* entry = Lookup(address);
   if (entry) {
-    // TODO(benvanik): wait if needed?
     if (entry->status != Entry::STATUS_READY) {
       entry = nullptr;
     }
@@ -38,44 +119,116 @@ Entry* EntryTable::Get(uint64_t address) {
   return entry;
 }
 
+bool EntryTable::Contains(uint64_t address) {
+  return Lookup(address) != nullptr;
+}
+
 Entry::Status EntryTable::GetOrCreate(uint64_t address, Entry** out_entry) {
-  lock_.lock();
-  const auto& it = map_.find(address);
-  Entry* entry = it != map_.end() ? it->second : nullptr;
-  Entry::Status status;
-  if (entry) {
-    // If we aren't ready yet spin and wait.
-    if (entry->status == Entry::STATUS_COMPILING) {
-      // Still compiling, so spin.
-      do {
-        lock_.unlock();
-        // TODO(benvanik): sleep for less time?
-        poly::threading::Sleep(std::chrono::microseconds(100));
-        lock_.lock();
-      } while (entry->status == Entry::STATUS_COMPILING);
-    }
-    status = entry->status;
+  auto slot = LookupSlot(address);
+
+  if (slot && !CommitSlot(slot)) {
+    assert_always("Unable to commit entry table page");
+    *out_entry = nullptr;
+    return Entry::STATUS_FAILED;
+  }
+
+  // Fast path: the entry already exists.
+  Entry* entry = nullptr;
+  if (slot) {
+    entry = slot->load(std::memory_order_acquire);
   } else {
-    // Create and return for initialization.
-    entry = new Entry();
-    entry->address = address;
-    entry->end_address = 0;
-    entry->status = Entry::STATUS_COMPILING;
-    entry->function = 0;
-    map_[address] = entry;
-    status = Entry::STATUS_NEW;
-  }
-  lock_.unlock();
+    std::lock_guard<std::mutex> guard(lock_);
+    const auto& it = map_.find(address);
+    entry = it != map_.end() ? it->second : nullptr;
+  }
+
+  if (!entry) {
+    // Try to claim the entry. Whoever wins the race owns compilation.
+    Entry* new_entry = new Entry();
+    new_entry->address = address;
+    new_entry->end_address = 0;
+    new_entry->status = Entry::STATUS_COMPILING;
+    new_entry->function = nullptr;
+    new_entry->demand_order = 0;
+    new_entry->next = nullptr;
+    bool claimed;
+    if (slot) {
+      claimed = slot->compare_exchange_strong(entry, new_entry,
+                                              std::memory_order_acq_rel);
+    } else {
+      std::lock_guard<std::mutex> guard(lock_);
+      auto result = map_.emplace(address, new_entry);
+      claimed = result.second;
+      entry = result.first->second;
+    }
+    if (claimed) {
+      Link(new_entry);
+      *out_entry = new_entry;
+      return Entry::STATUS_NEW;
+    }
+    // Lost the race; entry now holds the winner.
+    delete new_entry;
+  }
+
+  // Whoever moves an invalidated entry back to compiling regenerates it.
+  if (entry->status == Entry::STATUS_INVALIDATED) {
+    auto expected = Entry::STATUS_INVALIDATED;
+    if (entry->status.compare_exchange_strong(expected,
+                                              Entry::STATUS_COMPILING)) {
+      *out_entry = entry;
+      return Entry::STATUS_NEW;
+    }
+  }
+
+  if (entry->status == Entry::STATUS_COMPILING) {
+    WaitWhileCompiling(entry);
+  }
   *out_entry = entry;
-  return status;
+  return entry->status;
+}
+
+void EntryTable::Link(Entry* entry) {
+  Entry* head = entry_head_.load(std::memory_order_relaxed);
+  do {
+    entry->next = head;
+  } while (!entry_head_.compare_exchange_weak(
+      head, entry, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void EntryTable::WaitWhileCompiling(Entry* entry) {
+  // Small functions are done quickly, so spin a bit before going to sleep.
+  for (int spin_count = 0; spin_count < 64; ++spin_count) {
+    if (entry->status != Entry::STATUS_COMPILING) {
+      return;
+    }
+    poly::threading::Yield();
+  }
+  // Only the compiling thread is able to change the status, and it checks
+  // for waiters after doing so. Either it sees the count or we see the new
+  // status.
+  auto& bucket = wait_buckets_[(entry->address >> 2) % kWaitBucketCount];
+  std::unique_lock<std::mutex> lock(bucket.lock);
+  ++bucket.waiter_count;
+  bucket.cond.wait(
+      lock, [entry] { return entry->status != Entry::STATUS_COMPILING; });
+  --bucket.waiter_count;
+}
+
+void EntryTable::SetStatus(Entry* entry, Entry::Status status) {
+  entry->status = status;
+  auto& bucket = wait_buckets_[(entry->address >> 2) % kWaitBucketCount];
+  if (bucket.waiter_count) {
+    // Taking the lock orders this with a waiter that is about to sleep.
+    { std::lock_guard<std::mutex> guard(bucket.lock); }
+    bucket.cond.notify_all();
+  }
 }
 
 std::vector<Function*> EntryTable::FindWithAddress(uint64_t address) {
   SCOPE_profile_cpu_f("alloy");
-  std::lock_guard<std::mutex> guard(lock_);
   std::vector<Function*> fns;
-  for (auto& it : map_) {
-    Entry* entry = it.second;
+  auto entry = entry_head_.load(std::memory_order_acquire);
+  for (; entry; entry = entry->next) {
     if (address >= entry->address && address <= entry->end_address) {
       if (entry->status == Entry::STATUS_READY) {
         fns.push_back(entry->function);
@@ -85,5 +238,23 @@ std::vector<Function*> EntryTable::FindWithAddress(uint64_t address) {
   return fns;
 }
 
+std::vector<uint64_t> EntryTable::FindDemanded() {
+  std::vector<std::pair<uint32_t, uint64_t>> demanded;
+  auto entry = entry_head_.load(std::memory_order_acquire);
+  for (; entry; entry = entry->next) {
+    uint32_t order = entry->demand_order;
+    if (order) {
+      demanded.emplace_back(order, entry->address);
+    }
+  }
+  std::sort(demanded.begin(), demanded.end());
+  std::vector<uint64_t> addresses;
+  addresses.reserve(demanded.size());
+  for (auto& it : demanded) {
+    addresses.push_back(it.second);
+  }
+  return addresses;
+}
+
 }  // namespace runtime
 }  // namespace alloy
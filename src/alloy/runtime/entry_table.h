@@ -10,6 +10,9 @@
 #ifndef ALLOY_RUNTIME_ENTRY_TABLE_H_
 #define ALLOY_RUNTIME_ENTRY_TABLE_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -25,28 +28,95 @@ typedef struct Entry_t {
     STATUS_COMPILING,
     STATUS_READY,
     STATUS_FAILED,
+    // Function was thrown away and must be generated again.
+    STATUS_INVALIDATED,
   } Status;
 
   uint64_t address;
   uint64_t end_address;
-  Status status;
-  Function* function;
+  std::atomic<Status> status;
+  // Swapped in place when a function is promoted to a higher tier.
+  std::atomic<Function*> function;
+  // Order in which guest threads had to translate it themselves, from 1, or
+  // 0 if they never did. Only the thread compiling the entry sets it.
+  std::atomic<uint32_t> demand_order;
+  // Next in the list of all entries, newest first.
+  Entry_t* next;
 } Entry;
 
+// Maps guest function addresses to their entries.
+// Addresses within the guest code range are resolved through a flat table with
+// one slot per 4b instruction. Slots are only ever written once (null -> entry)
+// with a compare-exchange, so lookups never take a lock and generated code can
+// fetch an entry with a single load. The thread that wins the exchange owns
+// compilation of the entry; everyone else waits on its status.
+// The table is only reserved up front. Each page of slots is committed the
+// first time an entry is added to it, and lookups treat slots on pages that
+// haven't been committed as empty.
+// Addresses outside of the code range (builtins, test modules, etc) fall back
+// to a locked map.
+// Every entry is also pushed onto a lock-free list for teardown and address
+// range searches.
+// Invalidated entries are reclaimed for compilation the same way, so an
+// entry's function may change over time but the entry itself never does.
 class EntryTable {
  public:
+  // Guest range covered by the flat table. All XEX code lives in here.
+  static const uint64_t kCodeBase = 0x80000000ull;
+  static const uint64_t kCodeSize = 0x10000000ull;
+  static const size_t kSlotCount = kCodeSize >> 2;
+
   EntryTable();
   ~EntryTable();
 
   Entry* Get(uint64_t address);
   Entry::Status GetOrCreate(uint64_t address, Entry** out_entry);
+  // Whether there is an entry for the address in any state. Never waits.
+  bool Contains(uint64_t address);
+
+  // Moves an entry the caller is compiling to its new status and wakes any
+  // threads blocked on it in GetOrCreate.
+  void SetStatus(Entry* entry, Entry::Status status);
 
   std::vector<Function*> FindWithAddress(uint64_t address);
+  // Addresses of entries with a demand order, in that order.
+  std::vector<uint64_t> FindDemanded();
 
  private:
-  // TODO(benvanik): replace with a better data structure.
+  std::atomic<Entry*>* LookupSlot(uint64_t address) const {
+    uint64_t offset = address - kCodeBase;
+    if (offset >= kCodeSize || (address & 0x3)) {
+      return nullptr;
+    }
+    return &slots_[offset >> 2];
+  }
+  Entry* Lookup(uint64_t address);
+  void Link(Entry* entry);
+  void WaitWhileCompiling(Entry* entry);
+  bool IsSlotCommitted(const std::atomic<Entry*>* slot) const;
+  // Takes the lock if the page isn't committed yet.
+  bool CommitSlot(const std::atomic<Entry*>* slot);
+
+  std::atomic<Entry*>* slots_;
+  // One flag per page of slots, set once the page is committed.
+  std::unique_ptr<std::atomic<uint8_t>[]> committed_pages_;
+
+  // Threads waiting for an entry to finish compiling block on the bucket
+  // picked by its address. The count lets SetStatus skip the lock when
+  // nobody is waiting.
+  struct WaitBucket {
+    std::mutex lock;
+    std::condition_variable cond;
+    std::atomic<uint32_t> waiter_count;
+  };
+  static const size_t kWaitBucketCount = 64;
+  WaitBucket wait_buckets_[kWaitBucketCount];
+
+  // Guards the fallback map and slot page commits.
   std::mutex lock_;
   std::unordered_map<uint64_t, Entry*> map_;
+  // Head of the list of all entries. Entries are only ever added.
+  std::atomic<Entry*> entry_head_;
 };
 
 }  // namespace runtime
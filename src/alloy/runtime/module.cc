@@ -149,6 +149,14 @@ SymbolInfo::Status Module::DefineVariable(VariableInfo* symbol_info) {
   return DefineSymbol((SymbolInfo*)symbol_info);
 }
 
+void Module::UndefineFunction(FunctionInfo* symbol_info) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (symbol_info->status() == SymbolInfo::STATUS_DEFINED) {
+    // The old function is left in place until the new one replaces it.
+    symbol_info->set_status(SymbolInfo::STATUS_DECLARED);
+  }
+}
+
 void Module::ForEachFunction(std::function<void(FunctionInfo*)> callback) {
   SCOPE_profile_cpu_f("alloy");
   std::lock_guard<std::mutex> guard(lock_);
@@ -33,6 +33,9 @@ class Module {
   Memory* memory() const { return memory_; }
 
   virtual const std::string& name() const = 0;
+  // Identifies the module contents across runs (such as a digest of the
+  // image), or 0 if the module can't tell.
+  virtual uint64_t content_hash() const { return 0; }
 
   virtual bool ContainsAddress(uint64_t address);
 
@@ -44,6 +47,8 @@ class Module {
 
   SymbolInfo::Status DefineFunction(FunctionInfo* symbol_info);
   SymbolInfo::Status DefineVariable(VariableInfo* symbol_info);
+  // Returns a defined function to the declared state, to be defined again.
+  void UndefineFunction(FunctionInfo* symbol_info);
 
   void ForEachFunction(std::function<void(FunctionInfo*)> callback);
   void ForEachFunction(size_t since, size_t& version,
@@ -11,6 +11,7 @@
 
 #include <gflags/gflags.h>
 
+#include <alloy/alloy-private.h>
 #include <alloy/runtime/module.h>
 #include <poly/poly.h>
 #include <xdb/protocol.h>
@@ -28,6 +29,13 @@ namespace runtime {
 using alloy::backend::Backend;
 using alloy::frontend::Frontend;
 
+namespace {
+
+// Set on precompile workers so their translations aren't counted as stalls.
+thread_local bool is_precompile_thread = false;
+
+}  // namespace
+
 class BuiltinModule : public Module {
  public:
   BuiltinModule(Runtime* runtime) : Module(runtime), name_("builtin") {}
@@ -46,9 +54,19 @@ Runtime::Runtime(Memory* memory, uint32_t debug_info_flags,
       debug_info_flags_(debug_info_flags),
       trace_flags_(trace_flags),
       builtin_module_(nullptr),
-      next_builtin_address_(0x100000000ull) {}
+      next_builtin_address_(0x100000000ull),
+      has_marked_first_frame_(false),
+      precompile_next_(0),
+      precompile_running_(false),
+      precompile_active_count_(0),
+      precompile_count_(0),
+      demand_count_(0),
+      demand_time_us_(0) {}
 
 Runtime::~Runtime() {
+  // Workers call into the frontend/backend, so they must go first.
+  EndPrecompile();
+
   {
     std::lock_guard<std::mutex> guard(modules_lock_);
     modules_.clear();
@@ -57,6 +75,10 @@ Runtime::~Runtime() {
   debugger_.reset();
   frontend_.reset();
   backend_.reset();
+  tier0_backend_.reset();
+
+  // Writes out the profile.
+  translation_profiler_.reset();
 }
 
 int Runtime::Initialize(std::unique_ptr<Frontend> frontend,
@@ -64,6 +86,13 @@ int Runtime::Initialize(std::unique_ptr<Frontend> frontend,
   // Must be initialized by subclass before calling into this.
   assert_not_null(memory_);
 
+  start_time_ = std::chrono::steady_clock::now();
+
+  if (!FLAGS_translation_profile_path.empty()) {
+    translation_profiler_.reset(
+        new TranslationProfiler(FLAGS_translation_profile_path));
+  }
+
   // Create debugger first. Other types hook up to it.
   debugger_.reset(new Debugger(this));
 
@@ -117,6 +146,22 @@ int Runtime::Initialize(std::unique_ptr<Frontend> frontend,
   backend_ = std::move(backend);
   frontend_ = std::move(frontend);
 
+  if (FLAGS_runtime_tiered) {
+#if defined(ALLOY_HAS_IVM_BACKEND) && ALLOY_HAS_IVM_BACKEND
+    if (!dynamic_cast<alloy::backend::ivm::IVMBackend*>(backend_.get())) {
+      std::unique_ptr<Backend> tier0_backend(
+          new alloy::backend::ivm::IVMBackend(this));
+      if (!tier0_backend->Initialize()) {
+        tier0_backend_ = std::move(tier0_backend);
+      }
+    }
+#endif  // ALLOY_HAS_IVM_BACKEND
+    if (!tier0_backend_) {
+      PLOGW("Tiered execution unavailable with this backend; ignoring "
+            "--runtime_tiered");
+    }
+  }
+
   return 0;
 }
 
@@ -173,21 +218,39 @@ int Runtime::ResolveFunction(uint64_t address, Function** out_function) {
   Entry::Status status = entry_table_.GetOrCreate(address, &entry);
   if (status == Entry::STATUS_NEW) {
     // Needs to be generated. We have the 'lock' on it and must do so now.
+    auto start_time = std::chrono::steady_clock::now();
 
     // Grab symbol declaration.
     FunctionInfo* symbol_info;
     int result = LookupFunctionInfo(address, &symbol_info);
     if (result) {
+      entry_table_.SetStatus(entry, Entry::STATUS_FAILED);
       return result;
     }
 
-    result = DemandFunction(symbol_info, &entry->function);
+    // Readers of an invalidated entry may still be looking at the previous
+    // function, so only replace it once there's a new one.
+    Function* function;
+    result = DemandFunction(symbol_info, &function);
     if (result) {
-      entry->status = Entry::STATUS_FAILED;
+      entry_table_.SetStatus(entry, Entry::STATUS_FAILED);
       return result;
     }
+    entry->function = function;
+
+    if (!is_precompile_thread) {
+      // A guest thread had to stop and wait for this translation.
+      auto elapsed = std::chrono::steady_clock::now() - start_time;
+      demand_time_us_ +=
+          std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+              .count();
+      if (!entry->demand_order) {
+        entry->demand_order = ++demand_count_;
+      }
+    }
     entry->end_address = symbol_info->end_address();
-    status = entry->status = Entry::STATUS_READY;
+    entry_table_.SetStatus(entry, Entry::STATUS_READY);
+    status = Entry::STATUS_READY;
   }
   if (status == Entry::STATUS_READY) {
     // Ready to use.
@@ -199,6 +262,79 @@ int Runtime::ResolveFunction(uint64_t address, Function** out_function) {
   }
 }
 
+int Runtime::CallFunction(ThreadState* thread_state, uint64_t address,
+                          uint64_t return_address) {
+  backend_->EnterGuest(thread_state->backend_data(), &thread_state);
+  Function* fn;
+  int result = ResolveFunction(address, &fn);
+  if (!result) {
+    fn->Call(thread_state, return_address);
+  }
+  backend_->LeaveGuest(thread_state->backend_data());
+  return result;
+}
+
+int Runtime::InvalidateFunction(Function* function) {
+  SCOPE_profile_cpu_f("alloy");
+
+  FunctionInfo* symbol_info = function->symbol_info();
+  Entry* entry = entry_table_.Get(symbol_info->address());
+  if (!entry || entry->function != function) {
+    return 1;
+  }
+
+  // Anyone resolving it waits while it's in the compiling state, until the
+  // symbol is ready to be defined again.
+  auto expected = Entry::STATUS_READY;
+  if (!entry->status.compare_exchange_strong(expected,
+                                             Entry::STATUS_COMPILING)) {
+    return 1;
+  }
+  symbol_info->module()->UndefineFunction(symbol_info);
+  if (symbol_info->function() == function) {
+    // Callers going through the symbol resolve it again instead.
+    symbol_info->set_function(nullptr);
+  }
+  entry_table_.SetStatus(entry, Entry::STATUS_INVALIDATED);
+  return 0;
+}
+
+int Runtime::PromoteFunction(Function* function, Function** out_function) {
+  SCOPE_profile_cpu_f("alloy");
+
+  *out_function = nullptr;
+
+  FunctionInfo* symbol_info = function->symbol_info();
+  Entry* entry = entry_table_.Get(symbol_info->address());
+  if (!entry || entry->function != function) {
+    return 1;
+  }
+
+  // Resolvers wait until we're done, but everything linked to the old
+  // function keeps running it in the meantime. This also keeps it from being
+  // invalidated under us.
+  auto expected = Entry::STATUS_READY;
+  if (!entry->status.compare_exchange_strong(expected,
+                                             Entry::STATUS_COMPILING)) {
+    return 1;
+  }
+  Function* new_function;
+  int result = frontend_->DefineFunction(symbol_info, debug_info_flags_,
+                                         trace_flags_, &new_function);
+  if (result) {
+    // Not fatal; it just stays on the first tier.
+    entry_table_.SetStatus(entry, Entry::STATUS_READY);
+    return result;
+  }
+  symbol_info->set_function(new_function);
+  debugger_->OnFunctionDefined(symbol_info, new_function);
+  entry->function = new_function;
+  entry_table_.SetStatus(entry, Entry::STATUS_READY);
+
+  *out_function = new_function;
+  return 0;
+}
+
 int Runtime::LookupFunctionInfo(uint64_t address,
                                 FunctionInfo** out_symbol_info) {
   SCOPE_profile_cpu_f("alloy");
@@ -263,9 +399,17 @@ int Runtime::DemandFunction(FunctionInfo* symbol_info,
   SymbolInfo::Status symbol_status = module->DefineFunction(symbol_info);
   if (symbol_status == SymbolInfo::STATUS_NEW) {
     // Symbol is undefined, so define now.
+    // Precompile workers aren't holding anyone up, so they may as well do
+    // the full translation.
     Function* function = nullptr;
-    int result = frontend_->DefineFunction(symbol_info, debug_info_flags_,
-                                           trace_flags_, &function);
+    int result = 1;
+    if (tier0_backend_ && !is_precompile_thread) {
+      result = DefineTier0Function(symbol_info, &function);
+    }
+    if (result) {
+      result = frontend_->DefineFunction(symbol_info, debug_info_flags_,
+                                         trace_flags_, &function);
+    }
     if (result) {
       symbol_info->set_status(SymbolInfo::STATUS_FAILED);
       return result;
@@ -299,5 +443,124 @@ int Runtime::DemandFunction(FunctionInfo* symbol_info,
   return 0;
 }
 
+int Runtime::DefineTier0Function(FunctionInfo* symbol_info,
+                                 Function** out_function) {
+  Function* tier0_function;
+  int result = frontend_->DefineTier0Function(
+      symbol_info, tier0_backend_.get(), debug_info_flags_, trace_flags_,
+      &tier0_function);
+  if (result) {
+    return result;
+  }
+  // The main backend wraps it so that its code can call it like any other
+  // and counts entries to decide when to promote it.
+  result = backend_->WrapTier0Function(tier0_function, out_function);
+  if (result) {
+    delete tier0_function;
+    return result;
+  }
+  return 0;
+}
+
+int Runtime::BeginPrecompile(std::vector<uint64_t> addresses,
+                             uint32_t thread_count) {
+  if (!thread_count) {
+    return 1;
+  }
+
+  std::lock_guard<std::mutex> guard(precompile_lock_);
+  precompile_queue_.insert(precompile_queue_.end(), addresses.begin(),
+                           addresses.end());
+  PLOGI("Precompiling %u functions (%u queued)",
+        static_cast<uint32_t>(addresses.size()),
+        static_cast<uint32_t>(precompile_queue_.size() - precompile_next_));
+  if (precompile_active_count_) {
+    // The running workers pick them up when they get to them.
+    return 0;
+  }
+
+  // Previous workers (if any) ran out of work and are exiting.
+  for (auto& thread : precompile_threads_) {
+    thread.join();
+  }
+  precompile_threads_.clear();
+  precompile_running_ = true;
+  precompile_active_count_ = thread_count;
+  for (uint32_t n = 0; n < thread_count; ++n) {
+    precompile_threads_.emplace_back(&Runtime::PrecompileThread, this);
+  }
+  return 0;
+}
+
+void Runtime::EndPrecompile() {
+  precompile_running_ = false;
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> guard(precompile_lock_);
+    threads = std::move(precompile_threads_);
+    precompile_threads_.clear();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void Runtime::PrecompileThread() {
+  poly::threading::set_name("Alloy Precompile");
+  is_precompile_thread = true;
+
+  // Each worker pulls from the shared queue so the hottest functions go
+  // first. Translation itself draws translators from the frontend pool.
+  bool is_last = false;
+  while (true) {
+    uint64_t address;
+    {
+      std::lock_guard<std::mutex> guard(precompile_lock_);
+      if (!precompile_running_ ||
+          precompile_next_ >= precompile_queue_.size()) {
+        is_last = !--precompile_active_count_;
+        break;
+      }
+      address = precompile_queue_[precompile_next_++];
+    }
+    if (entry_table_.Contains(address)) {
+      // Already translated (or being translated) by someone else. Resolving
+      // it would only wait on them.
+      continue;
+    }
+    Function* fn;
+    if (!ResolveFunction(address, &fn)) {
+      ++precompile_count_;
+    }
+  }
+
+  if (is_last && precompile_running_) {
+    DumpTranslationStats("Precompile finished");
+  }
+}
+
+std::vector<uint64_t> Runtime::demanded_addresses() {
+  return entry_table_.FindDemanded();
+}
+
+void Runtime::MarkFirstFrame() {
+  if (has_marked_first_frame_.exchange(true)) {
+    return;
+  }
+  DumpTranslationStats("First frame");
+}
+
+void Runtime::DumpTranslationStats(const char* reason) {
+  auto elapsed = std::chrono::steady_clock::now() - start_time_;
+  auto elapsed_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+  PLOGI(
+      "%s at %lldms: %u functions precompiled, %u translated on guest threads "
+      "(%.3fms stalled)",
+      reason, static_cast<long long>(elapsed_ms),
+      static_cast<uint32_t>(precompile_count_),
+      static_cast<uint32_t>(demand_count_), demand_time_us_ / 1000.0);
+}
+
 }  // namespace runtime
 }  // namespace alloy
@@ -10,8 +10,11 @@
 #ifndef ALLOY_RUNTIME_RUNTIME_H_
 #define ALLOY_RUNTIME_RUNTIME_H_
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 #include <alloy/backend/backend.h>
@@ -22,6 +25,7 @@
 #include <alloy/runtime/module.h>
 #include <alloy/runtime/symbol_info.h>
 #include <alloy/runtime/thread_state.h>
+#include <alloy/runtime/translation_profiler.h>
 
 namespace alloy {
 namespace runtime {
@@ -36,6 +40,12 @@ class Runtime {
   Debugger* debugger() const { return debugger_.get(); }
   frontend::Frontend* frontend() const { return frontend_.get(); }
   backend::Backend* backend() const { return backend_.get(); }
+  // Backend running the first tier of --runtime_tiered, null if not tiered.
+  backend::Backend* tier0_backend() const { return tier0_backend_.get(); }
+  // Null unless --translation_profile_path is set.
+  TranslationProfiler* translation_profiler() const {
+    return translation_profiler_.get();
+  }
 
   int Initialize(std::unique_ptr<frontend::Frontend> frontend,
                  std::unique_ptr<backend::Backend> backend = 0);
@@ -56,11 +66,41 @@ class Runtime {
   int LookupFunctionInfo(Module* module, uint64_t address,
                          FunctionInfo** out_symbol_info);
   int ResolveFunction(uint64_t address, Function** out_function);
+  // Resolves and calls the function at the address from host code. Unlike
+  // resolving and calling separately, the function can't be evicted (and
+  // freed) in between. Returns nonzero if it can't be resolved.
+  int CallFunction(ThreadState* thread_state, uint64_t address,
+                   uint64_t return_address);
+  // Forgets the given function, so that the next resolve of its address
+  // generates it again. The backend owns the function object from then on
+  // and frees it once no caller can still hold it. Fails if it is not the
+  // current function for its address.
+  int InvalidateFunction(Function* function);
+  // Translates a hot first tier function again with the full pipeline and
+  // atomically replaces it for its address. It is up to the backend to unlink
+  // the old function from generated code and free it.
+  int PromoteFunction(Function* function, Function** out_function);
+
+  // Translates the given functions on background threads, in order.
+  // Guest threads only block on functions the workers have not finished yet
+  // and translate anything else they need themselves. Calling it again (for
+  // another module) queues behind whatever is still pending, starting new
+  // workers if the previous ones have finished.
+  int BeginPrecompile(std::vector<uint64_t> addresses, uint32_t thread_count);
+  void EndPrecompile();
+
+  // Addresses translated on demand by guest threads, in first-use order.
+  std::vector<uint64_t> demanded_addresses();
+  // Logs startup time and translation stalls the first time it is called.
+  void MarkFirstFrame();
 
   // uint32_t CreateCallback(void (*callback)(void* data), void* data);
 
  private:
   int DemandFunction(FunctionInfo* symbol_info, Function** out_function);
+  int DefineTier0Function(FunctionInfo* symbol_info, Function** out_function);
+  void PrecompileThread();
+  void DumpTranslationStats(const char* reason);
 
  protected:
   Memory* memory_;
@@ -72,12 +112,32 @@ class Runtime {
 
   std::unique_ptr<frontend::Frontend> frontend_;
   std::unique_ptr<backend::Backend> backend_;
+  std::unique_ptr<backend::Backend> tier0_backend_;
+  std::unique_ptr<TranslationProfiler> translation_profiler_;
 
   EntryTable entry_table_;
   std::mutex modules_lock_;
   std::vector<std::unique_ptr<Module>> modules_;
   Module* builtin_module_;
   uint64_t next_builtin_address_;
+
+  std::chrono::steady_clock::time_point start_time_;
+  std::atomic<bool> has_marked_first_frame_;
+
+  // Queue and workers are guarded by precompile_lock_.
+  std::mutex precompile_lock_;
+  std::vector<uint64_t> precompile_queue_;
+  size_t precompile_next_;
+  std::atomic<bool> precompile_running_;
+  std::vector<std::thread> precompile_threads_;
+  // Workers still pulling from the queue.
+  uint32_t precompile_active_count_;
+  std::atomic<uint32_t> precompile_count_;
+
+  // Functions translated by guest threads (hitches, if precompiling). Which
+  // ones is recorded on their entries (see Entry::demand_order).
+  std::atomic<uint32_t> demand_count_;
+  std::atomic<uint64_t> demand_time_us_;
 };
 
 }  // namespace runtime
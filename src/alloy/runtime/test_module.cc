@@ -27,7 +27,8 @@ namespace passes = alloy::compiler::passes;
 
 TestModule::TestModule(Runtime* runtime, const std::string& name,
                        std::function<bool(uint64_t)> contains_address,
-                       std::function<bool(hir::HIRBuilder&)> generate)
+                       std::function<bool(hir::HIRBuilder&)> generate,
+                       std::function<void(compiler::Compiler*)> add_passes)
     : Module(runtime),
       name_(name),
       contains_address_(contains_address),
@@ -49,8 +50,17 @@ TestModule::TestModule(Runtime* runtime, const std::string& name,
   compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
   compiler_->AddPass(std::make_unique<passes::ConstantPropagationPass>());
   compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
+  if (add_passes) {
+    // Passes under test may need the CFG and may leave it stale, as the
+    // translator's own loop and promotion passes do.
+    compiler_->AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
+    add_passes(compiler_.get());
+    compiler_->AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
+    compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
+  }
   // compiler_->AddPass(std::make_unique<passes::DeadStoreEliminationPass>());
   compiler_->AddPass(std::make_unique<passes::DeadCodeEliminationPass>());
+  compiler_->AddPass(std::make_unique<passes::CompareSinkingPass>());
 
   //// Removes all unneeded variables. Try not to add new ones after this.
   // compiler_->AddPass(new passes::ValueReductionPass());
@@ -59,6 +69,9 @@ TestModule::TestModule(Runtime* runtime, const std::string& name,
   // Will modify the HIR to add loads/stores.
   // This should be the last pass before finalization, as after this all
   // registers are assigned and ready to be emitted.
+  // Allocation is global, so it needs fresh block liveness.
+  compiler_->AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
+  compiler_->AddPass(std::make_unique<passes::DataFlowAnalysisPass>());
   compiler_->AddPass(std::make_unique<passes::RegisterAllocationPass>(
       runtime->backend()->machine_info()));
 
@@ -24,9 +24,12 @@ namespace runtime {
 
 class TestModule : public Module {
  public:
+  // add_passes, if set, adds the passes under test to the middle of the
+  // usual pipeline, between a fresh CFG and the cleanup passes.
   TestModule(Runtime* runtime, const std::string& name,
              std::function<bool(uint64_t)> contains_address,
-             std::function<bool(hir::HIRBuilder&)> generate);
+             std::function<bool(hir::HIRBuilder&)> generate,
+             std::function<void(compiler::Compiler*)> add_passes = nullptr);
   ~TestModule() override;
 
   const std::string& name() const override { return name_; }
@@ -23,6 +23,7 @@ ThreadState::ThreadState(Runtime* runtime, uint32_t thread_id)
       thread_id_(thread_id),
       name_(""),
       backend_data_(0),
+      tier0_backend_data_(0),
       raw_context_(0) {
   if (thread_id_ == UINT_MAX) {
     // System thread. Assign the system thread ID with a high bit
@@ -31,12 +32,18 @@ ThreadState::ThreadState(Runtime* runtime, uint32_t thread_id)
     thread_id_ = 0x80000000 | system_thread_handle;
   }
   backend_data_ = runtime->backend()->AllocThreadData();
+  if (runtime->tier0_backend()) {
+    tier0_backend_data_ = runtime->tier0_backend()->AllocThreadData();
+  }
 }
 
 ThreadState::~ThreadState() {
   if (backend_data_) {
     runtime_->backend()->FreeThreadData(backend_data_);
   }
+  if (tier0_backend_data_) {
+    runtime_->tier0_backend()->FreeThreadData(tier0_backend_data_);
+  }
   if (thread_state_ == this) {
     thread_state_ = nullptr;
   }
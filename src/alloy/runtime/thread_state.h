@@ -30,6 +30,8 @@ class ThreadState {
   const std::string& name() const { return name_; }
   void set_name(const std::string& value) { name_ = value; }
   void* backend_data() const { return backend_data_; }
+  // Data for Runtime::tier0_backend(), if tiered.
+  void* tier0_backend_data() const { return tier0_backend_data_; }
   void* raw_context() const { return raw_context_; }
 
   int Suspend() { return Suspend(~0); }
@@ -46,6 +48,7 @@ class ThreadState {
   uint32_t thread_id_;
   std::string name_;
   void* backend_data_;
+  void* tier0_backend_data_;
   void* raw_context_;
 };
 
@@ -0,0 +1,164 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/runtime/translation_profiler.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+
+#include <alloy/runtime/module.h>
+#include <alloy/runtime/symbol_info.h>
+#include <poly/poly.h>
+
+namespace alloy {
+namespace runtime {
+
+namespace {
+
+thread_local TranslationProfiler::Record* current_record_ = nullptr;
+
+const char* kPhaseNames[TranslationProfiler::PHASE_COUNT] = {
+    "find_extents", "emit_hir", "compile", "assemble", "place_code",
+};
+
+double ToUs(uint64_t ns) { return ns / 1000.0; }
+
+}  // namespace
+
+TranslationProfiler::ScopedFunction::ScopedFunction(
+    TranslationProfiler* profiler, FunctionInfo* symbol_info, uint32_t tier)
+    : profiler_(profiler) {
+  if (!profiler_) {
+    return;
+  }
+  record_.reset(new Record());
+  record_->address = symbol_info->address();
+  record_->module_name = symbol_info->module()->name();
+  record_->name = symbol_info->name();
+  record_->tier = tier;
+  record_->was_cached = false;
+  record_->hir_instr_count_before = 0;
+  record_->hir_instr_count_after = 0;
+  record_->code_size = 0;
+  record_->total_ns = 0;
+  std::fill(record_->phase_ns, record_->phase_ns + PHASE_COUNT, 0);
+  assert_null(current_record_);
+  current_record_ = record_.get();
+  start_time_ = std::chrono::steady_clock::now();
+}
+
+TranslationProfiler::ScopedFunction::~ScopedFunction() {
+  if (!profiler_) {
+    return;
+  }
+  record_->total_ns = ElapsedNs(start_time_);
+  current_record_ = nullptr;
+  std::lock_guard<std::mutex> guard(profiler_->lock_);
+  profiler_->records_.push_back(std::move(record_));
+}
+
+TranslationProfiler::TranslationProfiler(const std::string& path)
+    : path_(path) {}
+
+TranslationProfiler::~TranslationProfiler() { Dump(); }
+
+TranslationProfiler::Record* TranslationProfiler::current() {
+  return current_record_;
+}
+
+void TranslationProfiler::Dump() {
+  std::lock_guard<std::mutex> guard(lock_);
+
+  // Each tier runs its own pipeline, so pass columns are keyed by name, in
+  // the order they were first seen. Passes that run more than once in a
+  // pipeline get a column per run.
+  std::vector<std::string> pass_columns;
+  std::unordered_map<std::string, size_t> pass_column_map;
+  std::vector<std::vector<size_t>> record_pass_columns(records_.size());
+  for (size_t i = 0; i < records_.size(); ++i) {
+    std::unordered_map<std::string, uint32_t> run_counts;
+    for (auto& pass : records_[i]->pass_ns) {
+      std::string key = pass.first;
+      uint32_t run = ++run_counts[key];
+      if (run > 1) {
+        key += "_" + std::to_string(run);
+      }
+      auto it = pass_column_map.find(key);
+      if (it == pass_column_map.end()) {
+        it = pass_column_map.emplace(key, pass_columns.size()).first;
+        pass_columns.push_back(key);
+      }
+      record_pass_columns[i].push_back(it->second);
+    }
+  }
+  size_t pass_count = pass_columns.size();
+
+  FILE* file = fopen(path_.c_str(), "w");
+  if (!file) {
+    PLOGE("Unable to open translation profile %s", path_.c_str());
+    return;
+  }
+  fprintf(file,
+          "module,address,name,tier,cached,hir_instrs_before,hir_instrs_after,"
+          "code_size,total_us");
+  for (size_t n = 0; n < PHASE_COUNT; ++n) {
+    fprintf(file, ",%s_us", kPhaseNames[n]);
+  }
+  for (size_t n = 0; n < pass_count; ++n) {
+    fprintf(file, ",%s_us", pass_columns[n].c_str());
+  }
+  fprintf(file, "\n");
+
+  uint64_t total_ns = 0;
+  uint32_t tier_counts[2] = {0};
+  uint64_t phase_totals[PHASE_COUNT] = {0};
+  std::vector<uint64_t> pass_totals(pass_count);
+  std::vector<uint64_t> pass_ns(pass_count);
+  for (size_t i = 0; i < records_.size(); ++i) {
+    auto& record = records_[i];
+    fprintf(file, "%s,%.8llX,\"%s\",%u,%d,%u,%u,%u,%.3f",
+            record->module_name.c_str(),
+            static_cast<unsigned long long>(record->address),
+            record->name.c_str(), record->tier, record->was_cached ? 1 : 0,
+            record->hir_instr_count_before, record->hir_instr_count_after,
+            static_cast<uint32_t>(record->code_size), ToUs(record->total_ns));
+    total_ns += record->total_ns;
+    ++tier_counts[std::min(record->tier, 1u)];
+    for (size_t n = 0; n < PHASE_COUNT; ++n) {
+      fprintf(file, ",%.3f", ToUs(record->phase_ns[n]));
+      phase_totals[n] += record->phase_ns[n];
+    }
+    std::fill(pass_ns.begin(), pass_ns.end(), 0);
+    for (size_t n = 0; n < record->pass_ns.size(); ++n) {
+      pass_ns[record_pass_columns[i][n]] = record->pass_ns[n].second;
+    }
+    for (size_t n = 0; n < pass_count; ++n) {
+      fprintf(file, ",%.3f", ToUs(pass_ns[n]));
+      pass_totals[n] += pass_ns[n];
+    }
+    fprintf(file, "\n");
+  }
+  fclose(file);
+
+  PLOGI(
+      "Translation profile: %u functions (%u tier 0) in %.3fms, written to %s",
+      static_cast<uint32_t>(records_.size()), tier_counts[0],
+      total_ns / 1000000.0, path_.c_str());
+  for (size_t n = 0; n < PHASE_COUNT; ++n) {
+    PLOGI("  %-28s %10.3fms", kPhaseNames[n], phase_totals[n] / 1000000.0);
+  }
+  for (size_t n = 0; n < pass_count; ++n) {
+    PLOGI("  pass %-23s %10.3fms", pass_columns[n].c_str(),
+          pass_totals[n] / 1000000.0);
+  }
+}
+
+}  // namespace runtime
+}  // namespace alloy
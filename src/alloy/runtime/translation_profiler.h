@@ -0,0 +1,114 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef ALLOY_RUNTIME_TRANSLATION_PROFILER_H_
+#define ALLOY_RUNTIME_TRANSLATION_PROFILER_H_
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace alloy {
+namespace runtime {
+
+class FunctionInfo;
+
+// Per-function timings of translation, enabled with
+// --translation_profile_path. Works regardless of the platform profiler.
+//
+// A translation is bracketed with a ScopedFunction on the translating thread;
+// anything along the way (compiler, assembler, code cache) finds the record
+// through current() and adds its time to it. Everything is written out as CSV
+// when the profiler is destroyed, one row per translation, and a summary of
+// total time per phase/pass is logged.
+class TranslationProfiler {
+ public:
+  enum Phase {
+    PHASE_FIND_EXTENTS,
+    PHASE_EMIT_HIR,
+    PHASE_COMPILE,
+    PHASE_ASSEMBLE,
+    PHASE_PLACE_CODE,
+    PHASE_COUNT,
+  };
+
+  struct Record {
+    uint64_t address;
+    std::string module_name;
+    std::string name;
+    // 0 for the first tier of --runtime_tiered, 1 for full translations.
+    uint32_t tier;
+    // Loaded from the persistent code cache instead of translated.
+    bool was_cached;
+    uint32_t hir_instr_count_before;
+    uint32_t hir_instr_count_after;
+    size_t code_size;
+    uint64_t total_ns;
+    uint64_t phase_ns[PHASE_COUNT];
+    // Compiler passes in the order they ran. Tiers run different pipelines.
+    std::vector<std::pair<const char*, uint64_t>> pass_ns;
+  };
+
+  class ScopedFunction {
+   public:
+    ScopedFunction(TranslationProfiler* profiler, FunctionInfo* symbol_info,
+                   uint32_t tier);
+    ~ScopedFunction();
+
+   private:
+    TranslationProfiler* profiler_;
+    std::unique_ptr<Record> record_;
+    std::chrono::steady_clock::time_point start_time_;
+  };
+
+  class ScopedPhase {
+   public:
+    ScopedPhase(Phase phase) : record_(current()), phase_(phase) {
+      if (record_) {
+        start_time_ = std::chrono::steady_clock::now();
+      }
+    }
+    ~ScopedPhase() {
+      if (record_) {
+        record_->phase_ns[phase_] += ElapsedNs(start_time_);
+      }
+    }
+
+   private:
+    Record* record_;
+    Phase phase_;
+    std::chrono::steady_clock::time_point start_time_;
+  };
+
+  TranslationProfiler(const std::string& path);
+  ~TranslationProfiler();
+
+  // Record of the translation in progress on the calling thread, if any.
+  static Record* current();
+
+  static uint64_t ElapsedNs(std::chrono::steady_clock::time_point start_time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start_time).count();
+  }
+
+ private:
+  void Dump();
+
+  std::string path_;
+  std::mutex lock_;
+  std::vector<std::unique_ptr<Record>> records_;
+};
+
+}  // namespace runtime
+}  // namespace alloy
+
+#endif  // ALLOY_RUNTIME_TRANSLATION_PROFILER_H_
@@ -39,7 +39,11 @@ class ThreadState : public alloy::runtime::ThreadState {
     assert_true((reinterpret_cast<uint64_t>(context_) & 0xF) == 0);
 
     // Stash pointers to common structures that callbacks may need.
-    context_->reserve_address = memory_->reserve_address();
+    context_->reserve_address = UINT64_MAX;
+    context_->global_lock_owner =
+        static_cast<alloy::frontend::ppc::PPCFrontend*>(runtime->frontend())
+            ->builtins()
+            ->global_lock.owner_ptr();
     context_->membase = memory_->membase();
     context_->runtime = runtime;
     context_->thread_state = this;
@@ -104,13 +108,11 @@ int main(std::vector<std::wstring>& args) {
     auto thread_state = std::make_unique<ThreadState>(
         runtime.get(), 100, stack_address, stack_size, thread_state_address);
 
-    alloy::runtime::Function* fn;
-    runtime->ResolveFunction(0x1000, &fn);
     auto ctx = thread_state->context();
     ctx->lr = 0xBEBEBEBE;
     ctx->r[5] = 10;
     ctx->r[25] = 25;
-    fn->Call(thread_state.get(), ctx->lr);
+    runtime->CallFunction(thread_state.get(), 0x1000, ctx->lr);
     auto result = ctx->r[11];
     printf("%llu", result);
   }
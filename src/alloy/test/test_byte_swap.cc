@@ -8,6 +8,7 @@
  */
 
 #include <alloy/test/util.h>
+#include <xenia/cpu/mmio_handler.h>
 
 using namespace alloy;
 using namespace alloy::hir;
@@ -15,6 +16,58 @@ using namespace alloy::runtime;
 using namespace alloy::test;
 using alloy::frontend::ppc::PPCContext;
 
+namespace {
+
+// Registers of a faulting thread, in x64 encoding order.
+struct FaultState {
+  uint64_t rip;
+  uint64_t regs[16];
+};
+
+// Feeds hand made faults to the handler rather than taking real ones.
+class FaultTestMMIOHandler : public xe::cpu::MMIOHandler {
+ public:
+  FaultTestMMIOHandler() : MMIOHandler(nullptr) { global_handler_ = this; }
+
+  bool Initialize() override { return true; }
+  bool ProtectRange(uint8_t* host_address, size_t length,
+                    bool read_only) override {
+    return true;
+  }
+  bool IsPageWritable(uint8_t* host_address) override { return false; }
+  uint64_t GetThreadStateRip(void* thread_state_ptr) override {
+    return static_cast<FaultState*>(thread_state_ptr)->rip;
+  }
+  void SetThreadStateRip(void* thread_state_ptr, uint64_t rip) override {
+    static_cast<FaultState*>(thread_state_ptr)->rip = rip;
+  }
+  uint64_t* GetThreadStateRegPtr(void* thread_state_ptr,
+                                 int32_t be_reg_index) override {
+    return &static_cast<FaultState*>(thread_state_ptr)->regs[be_reg_index];
+  }
+};
+
+const uint64_t kMMIOAddress = 0x7FC80000;
+uint64_t mmio_written_value_ = 0;
+
+uint64_t ReadMMIO(void* context, uint64_t address) {
+  // What the guest reads, in guest order.
+  return 0x1122334455667788ull;
+}
+void WriteMMIO(void* context, uint64_t address, uint64_t value) {
+  mmio_written_value_ = value;
+}
+
+// Runs the fault handler over the given instruction, as if it had faulted.
+void HandleFault(FaultTestMMIOHandler& handler, FaultState* state,
+                 bool is_write, const std::vector<uint8_t>& code) {
+  state->rip = reinterpret_cast<uint64_t>(code.data());
+  REQUIRE(handler.HandleAccessFault(state, kMMIOAddress, is_write));
+  REQUIRE(state->rip == reinterpret_cast<uint64_t>(code.data() + code.size()));
+}
+
+}  // namespace
+
 TEST_CASE("BYTE_SWAP_V128", "[instr]") {
   TestFunction([](hir::HIRBuilder& b) {
                  StoreVR(b, 3, b.ByteSwap(LoadVR(b, 4)));
@@ -40,3 +93,87 @@ TEST_CASE("BYTE_SWAP_V128", "[instr]") {
                         REQUIRE(result == vec128i(0x0F10130C, 0x0B0C0D0E, 0x0000000A, 0x00000000));
                       });
 }
+
+TEST_CASE("BYTE_SWAP_LOAD", "[instr]") {
+  TestFunction([](hir::HIRBuilder& b) {
+                 StoreGPR(b, 3, b.ZeroExtend(b.ByteSwap(b.Load(
+                                                 LoadGPR(b, 4), INT16_TYPE)),
+                                             INT64_TYPE));
+                 StoreGPR(b, 5, b.ZeroExtend(b.ByteSwap(b.Load(
+                                                 LoadGPR(b, 6), INT32_TYPE)),
+                                             INT64_TYPE));
+                 StoreGPR(b, 7, b.ByteSwap(b.Load(LoadGPR(b, 8), INT64_TYPE)));
+                 b.Return();
+               }).Run([](PPCContext* ctx) {
+                        ctx->r[4] = 0x100;
+                        ctx->r[6] = 0x200;
+                        ctx->r[8] = 0x300;
+                        *reinterpret_cast<uint16_t*>(ctx->membase + 0x100) =
+                            0x2211;
+                        *reinterpret_cast<uint32_t*>(ctx->membase + 0x200) =
+                            0x44332211;
+                        *reinterpret_cast<uint64_t*>(ctx->membase + 0x300) =
+                            0x8877665544332211ull;
+                      },
+                      [](PPCContext* ctx) {
+                        REQUIRE(ctx->r[3] == 0x1122);
+                        REQUIRE(ctx->r[5] == 0x11223344);
+                        REQUIRE(ctx->r[7] == 0x1122334455667788ull);
+                      });
+}
+
+TEST_CASE("BYTE_SWAP_STORE", "[instr]") {
+  TestFunction([](hir::HIRBuilder& b) {
+                 b.Store(LoadGPR(b, 4),
+                         b.ByteSwap(b.Truncate(LoadGPR(b, 3), INT16_TYPE)));
+                 b.Store(LoadGPR(b, 5),
+                         b.ByteSwap(b.Truncate(LoadGPR(b, 3), INT32_TYPE)));
+                 b.Store(LoadGPR(b, 6), b.ByteSwap(LoadGPR(b, 3)));
+                 b.Return();
+               }).Run([](PPCContext* ctx) {
+                        ctx->r[3] = 0x1122334455667788ull;
+                        ctx->r[4] = 0x100;
+                        ctx->r[5] = 0x200;
+                        ctx->r[6] = 0x300;
+                      },
+                      [](PPCContext* ctx) {
+                        REQUIRE(*reinterpret_cast<uint16_t*>(ctx->membase +
+                                                             0x100) == 0x8877);
+                        REQUIRE(*reinterpret_cast<uint32_t*>(ctx->membase +
+                                                             0x200) ==
+                                0x88776655);
+                        REQUIRE(*reinterpret_cast<uint64_t*>(ctx->membase +
+                                                             0x300) ==
+                                0x8877665544332211ull);
+                      });
+}
+
+TEST_CASE("BYTE_SWAP_MMIO_FAULT", "[instr]") {
+  FaultTestMMIOHandler handler;
+  handler.RegisterRange(kMMIOAddress, 0xFFFF0000, 0xFFFF, nullptr, ReadMMIO,
+                        WriteMMIO);
+  FaultState state = {0};
+
+  // mov eax, [rcx]; generated code swaps it after.
+  HandleFault(handler, &state, false, {0x8B, 0x01});
+  REQUIRE(state.regs[0] == 0x88776655);
+
+  // movbe eax, [rcx]
+  HandleFault(handler, &state, false, {0x0F, 0x38, 0xF0, 0x01});
+  REQUIRE(state.regs[0] == 0x55667788);
+  // movbe r9, [rdx + 8]
+  HandleFault(handler, &state, false, {0x4C, 0x0F, 0x38, 0xF0, 0x4A, 0x08});
+  REQUIRE(state.regs[9] == 0x1122334455667788ull);
+  // movbe dx, [rcx + rax * 2 + 0x100]
+  HandleFault(handler, &state, false,
+              {0x66, 0x0F, 0x38, 0xF0, 0x94, 0x41, 0x00, 0x01, 0x00, 0x00});
+  REQUIRE(state.regs[2] == 0x7788);
+
+  // movbe [rcx], r10d
+  state.regs[10] = 0xAABBCCDD11223344ull;
+  HandleFault(handler, &state, true, {0x44, 0x0F, 0x38, 0xF1, 0x11});
+  REQUIRE(mmio_written_value_ == 0x11223344);
+  // movbe [rcx], r10
+  HandleFault(handler, &state, true, {0x4C, 0x0F, 0x38, 0xF1, 0x11});
+  REQUIRE(mmio_written_value_ == 0xAABBCCDD11223344ull);
+}
@@ -0,0 +1,186 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <chrono>
+
+#include <alloy/test/util.h>
+
+using namespace alloy;
+using namespace alloy::hir;
+using namespace alloy::runtime;
+using namespace alloy::test;
+using alloy::frontend::ppc::PPCContext;
+
+namespace {
+
+const uint32_t kThreadCount = 8;
+const uint32_t kIterationCount = 100000;
+
+Value* HostAddress(hir::HIRBuilder& b, Value* guest_address) {
+  return b.Add(b.LoadContext(offsetof(PPCContext, membase), INT64_TYPE),
+               guest_address);
+}
+
+// The shape stwcx lowers to: increment the value at r4 with a compare-exchange
+// against what was loaded, retrying until it goes through, r5 times.
+void EmitAtomicIncrementLoop(hir::HIRBuilder& b, TypeName type) {
+  auto loop_label = b.NewLabel();
+  b.MarkLabel(loop_label);
+  auto old_value = b.Load(LoadGPR(b, 4), type);
+  auto one = type == INT32_TYPE ? b.LoadConstant(uint32_t(1))
+                                : b.LoadConstant(uint64_t(1));
+  auto new_value = b.Add(old_value, one);
+  auto prev_value =
+      b.CompareExchange(HostAddress(b, LoadGPR(b, 4)), old_value, new_value);
+  b.BranchTrue(b.CompareNE(prev_value, old_value), loop_label);
+  auto count = b.Sub(LoadGPR(b, 5), b.LoadConstant(uint64_t(1)));
+  StoreGPR(b, 5, count);
+  b.BranchTrue(b.CompareNE(count, b.LoadZero(INT64_TYPE)), loop_label);
+  b.Return();
+}
+
+// The same increment done under a spin lock on the word at r8, which is what
+// serializing every stwcx through shared state amounts to.
+void EmitLockedIncrementLoop(hir::HIRBuilder& b) {
+  auto loop_label = b.NewLabel();
+  b.MarkLabel(loop_label);
+  auto lock_address = HostAddress(b, LoadGPR(b, 8));
+  auto old_lock = b.CompareExchange(lock_address, b.LoadZero(INT32_TYPE),
+                                    b.LoadConstant(uint32_t(1)));
+  b.BranchTrue(b.IsTrue(old_lock), loop_label);
+  auto value = b.Load(LoadGPR(b, 4), INT32_TYPE);
+  b.Store(LoadGPR(b, 4), b.Add(value, b.LoadConstant(uint32_t(1))));
+  b.AtomicExchange(HostAddress(b, LoadGPR(b, 8)), b.LoadZero(INT32_TYPE));
+  auto count = b.Sub(LoadGPR(b, 5), b.LoadConstant(uint64_t(1)));
+  StoreGPR(b, 5, count);
+  b.BranchTrue(b.CompareNE(count, b.LoadZero(INT64_TYPE)), loop_label);
+  b.Return();
+}
+
+// Runs the contended increment and returns how long it took on all
+// backends, in milliseconds.
+double TimeIncrementLoop(std::function<void(hir::HIRBuilder& b)> generator) {
+  TestFunction test(generator);
+  auto start_time = std::chrono::high_resolution_clock::now();
+  test.RunThreaded(kThreadCount,
+                   [](PPCContext* ctx) {
+                     ctx->r[4] = 0x100;
+                     ctx->r[5] = kIterationCount;
+                     ctx->r[8] = 0x200;
+                   },
+                   [](Memory* memory) {
+                     REQUIRE(memory->LoadI32(0x100) ==
+                             kThreadCount * kIterationCount);
+                   });
+  auto end_time = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end_time - start_time)
+      .count();
+}
+
+}  // namespace
+
+TEST_CASE("COMPARE_EXCHANGE_I32", "[instr]") {
+  TestFunction test([](hir::HIRBuilder& b) {
+    StoreGPR(b, 3,
+             b.ZeroExtend(b.CompareExchange(HostAddress(b, LoadGPR(b, 4)),
+                                            b.Truncate(LoadGPR(b, 5),
+                                                       INT32_TYPE),
+                                            b.Truncate(LoadGPR(b, 6),
+                                                       INT32_TYPE)),
+                          INT64_TYPE));
+    StoreGPR(b, 7, b.ZeroExtend(b.Load(LoadGPR(b, 4), INT32_TYPE),
+                                INT64_TYPE));
+    b.Return();
+  });
+  test.Run([](PPCContext* ctx) {
+             ctx->r[4] = 0x100;
+             ctx->r[5] = 0x11223344;
+             ctx->r[6] = 0x55667788;
+             *reinterpret_cast<uint32_t*>(ctx->membase + 0x100) = 0x11223344;
+           },
+           [](PPCContext* ctx) {
+             REQUIRE(ctx->r[3] == 0x11223344);
+             REQUIRE(ctx->r[7] == 0x55667788);
+           });
+  test.Run([](PPCContext* ctx) {
+             ctx->r[4] = 0x100;
+             ctx->r[5] = 0x11223344;
+             ctx->r[6] = 0x55667788;
+             *reinterpret_cast<uint32_t*>(ctx->membase + 0x100) = 0x99AABBCC;
+           },
+           [](PPCContext* ctx) {
+             REQUIRE(ctx->r[3] == 0x99AABBCC);
+             REQUIRE(ctx->r[7] == 0x99AABBCC);
+           });
+}
+
+TEST_CASE("COMPARE_EXCHANGE_I64", "[instr]") {
+  TestFunction test([](hir::HIRBuilder& b) {
+    StoreGPR(b, 3, b.CompareExchange(HostAddress(b, LoadGPR(b, 4)),
+                                     LoadGPR(b, 5), LoadGPR(b, 6)));
+    StoreGPR(b, 7, b.Load(LoadGPR(b, 4), INT64_TYPE));
+    b.Return();
+  });
+  test.Run([](PPCContext* ctx) {
+             ctx->r[4] = 0x100;
+             ctx->r[5] = 0x1122334455667788ull;
+             ctx->r[6] = 0x99AABBCCDDEEFF00ull;
+             *reinterpret_cast<uint64_t*>(ctx->membase + 0x100) =
+                 0x1122334455667788ull;
+           },
+           [](PPCContext* ctx) {
+             REQUIRE(ctx->r[3] == 0x1122334455667788ull);
+             REQUIRE(ctx->r[7] == 0x99AABBCCDDEEFF00ull);
+           });
+  test.Run([](PPCContext* ctx) {
+             ctx->r[4] = 0x100;
+             ctx->r[5] = 0x1122334455667788ull;
+             ctx->r[6] = 0x99AABBCCDDEEFF00ull;
+             *reinterpret_cast<uint64_t*>(ctx->membase + 0x100) = 1;
+           },
+           [](PPCContext* ctx) {
+             REQUIRE(ctx->r[3] == 1);
+             REQUIRE(ctx->r[7] == 1);
+           });
+}
+
+TEST_CASE("COMPARE_EXCHANGE_CONTENDED", "[instr]") {
+  TestFunction([](hir::HIRBuilder& b) {
+                 EmitAtomicIncrementLoop(b, INT32_TYPE);
+               }).RunThreaded(kThreadCount,
+                              [](PPCContext* ctx) {
+                                ctx->r[4] = 0x100;
+                                ctx->r[5] = kIterationCount;
+                              },
+                              [](Memory* memory) {
+                                REQUIRE(memory->LoadI32(0x100) ==
+                                        kThreadCount * kIterationCount);
+                              });
+  TestFunction([](hir::HIRBuilder& b) {
+                 EmitAtomicIncrementLoop(b, INT64_TYPE);
+               }).RunThreaded(kThreadCount,
+                              [](PPCContext* ctx) {
+                                ctx->r[4] = 0x100;
+                                ctx->r[5] = kIterationCount;
+                              },
+                              [](Memory* memory) {
+                                REQUIRE(memory->LoadI64(0x100) ==
+                                        kThreadCount * kIterationCount);
+                              });
+}
+
+TEST_CASE("COMPARE_EXCHANGE_SPEEDUP", "[instr]") {
+  // Only reported, as the ratio depends on the host.
+  double locked_ms = TimeIncrementLoop(EmitLockedIncrementLoop);
+  double exchange_ms = TimeIncrementLoop([](hir::HIRBuilder& b) {
+    EmitAtomicIncrementLoop(b, INT32_TYPE);
+  });
+  PLOGI("Contended increment: %.1fms locked, %.1fms compare-exchange (%.2fx)",
+        locked_ms, exchange_ms, locked_ms / exchange_ms);
+}
@@ -0,0 +1,141 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/test/util.h>
+
+using namespace alloy;
+using namespace alloy::hir;
+using namespace alloy::runtime;
+using namespace alloy::test;
+using alloy::frontend::ppc::PPCContext;
+
+namespace {
+
+const uint32_t kCR0 = offsetof(PPCContext, cr0);
+
+// Sets cr0 from r4 and r5 as cmpd does, then branches on one of its bits.
+void EmitCompareAndBranch(hir::HIRBuilder& b, bool branch_on_true) {
+  auto skip_label = b.NewLabel();
+  auto lhs = LoadGPR(b, 4);
+  auto rhs = LoadGPR(b, 5);
+  auto lt = b.CompareSLT(lhs, rhs);
+  auto gt = b.CompareSGT(lhs, rhs);
+  auto eq = b.CompareEQ(lhs, rhs);
+  b.StoreContext(kCR0 + 0, lt);
+  b.StoreContext(kCR0 + 1, gt);
+  b.StoreContext(kCR0 + 2, eq);
+  StoreGPR(b, 3, b.LoadConstant(uint64_t(1)));
+  if (branch_on_true) {
+    b.BranchTrue(gt, skip_label);
+  } else {
+    b.BranchFalse(gt, skip_label);
+  }
+  StoreGPR(b, 3, b.LoadConstant(uint64_t(2)));
+  b.MarkLabel(skip_label);
+  b.Return();
+}
+
+}  // namespace
+
+TEST_CASE("COMPARE_SINKING_CR", "[pass]") {
+  // The gt compare and its cr0 store move down to the branch.
+  auto generator = [](hir::HIRBuilder& b) { EmitCompareAndBranch(b, true); };
+  REQUIRE(CompileAndCount(generator, nullptr, IsFusedBranch) == 0);
+  REQUIRE(CompileAndCount(generator,
+                          std::make_unique<passes::CompareSinkingPass>(),
+                          IsFusedBranch) == 1);
+}
+
+TEST_CASE("COMPARE_SINKING_OTHER_BLOCK", "[pass]") {
+  // A use of the compare past the branch doesn't keep it from sinking.
+  auto generator = [](hir::HIRBuilder& b) {
+    auto skip_label = b.NewLabel();
+    auto lhs = LoadGPR(b, 4);
+    auto rhs = LoadGPR(b, 5);
+    auto gt = b.CompareSGT(lhs, rhs);
+    StoreGPR(b, 3, b.LoadConstant(uint64_t(1)));
+    b.BranchTrue(gt, skip_label);
+    StoreGPR(b, 3, b.LoadConstant(uint64_t(2)));
+    b.MarkLabel(skip_label);
+    StoreGPR(b, 6, b.ZeroExtend(gt, INT64_TYPE));
+    b.Return();
+  };
+  REQUIRE(CompileAndCount(generator, nullptr, IsFusedBranch) == 0);
+  REQUIRE(CompileAndCount(generator,
+                          std::make_unique<passes::CompareSinkingPass>(),
+                          IsFusedBranch) == 1);
+  TestFunction test(generator);
+  test.Run([](PPCContext* ctx) {
+             ctx->r[4] = 5;
+             ctx->r[5] = 4;
+           },
+           [](PPCContext* ctx) {
+             REQUIRE(ctx->r[3] == 1);
+             REQUIRE(ctx->r[6] == 1);
+           });
+  test.Run([](PPCContext* ctx) {
+             ctx->r[4] = 4;
+             ctx->r[5] = 5;
+           },
+           [](PPCContext* ctx) {
+             REQUIRE(ctx->r[3] == 2);
+             REQUIRE(ctx->r[6] == 0);
+           });
+}
+
+TEST_CASE("COMPARE_SINKING_BRANCH", "[pass]") {
+  // Both bits of cr0 still have to be written whichever way it branches.
+  for (bool branch_on_true : {true, false}) {
+    TestFunction test([branch_on_true](hir::HIRBuilder& b) {
+      EmitCompareAndBranch(b, branch_on_true);
+    });
+    uint64_t taken = branch_on_true ? 1 : 2;
+    uint64_t not_taken = branch_on_true ? 2 : 1;
+    test.Run([](PPCContext* ctx) {
+               ctx->r[4] = 5;
+               ctx->r[5] = uint64_t(-5);
+             },
+             [taken](PPCContext* ctx) {
+               REQUIRE(ctx->r[3] == taken);
+               REQUIRE(ctx->cr0.cr0_lt == 0);
+               REQUIRE(ctx->cr0.cr0_gt == 1);
+               REQUIRE(ctx->cr0.cr0_eq == 0);
+             });
+    test.Run([](PPCContext* ctx) {
+               ctx->r[4] = 5;
+               ctx->r[5] = 5;
+             },
+             [not_taken](PPCContext* ctx) {
+               REQUIRE(ctx->r[3] == not_taken);
+               REQUIRE(ctx->cr0.cr0_lt == 0);
+               REQUIRE(ctx->cr0.cr0_gt == 0);
+               REQUIRE(ctx->cr0.cr0_eq == 1);
+             });
+  }
+}
+
+TEST_CASE("COMPARE_BRANCH_CONSTANT", "[pass]") {
+  // With the constant first the operands have to be swapped for cmp.
+  TestFunction test([](hir::HIRBuilder& b) {
+    auto skip_label = b.NewLabel();
+    StoreGPR(b, 3, b.LoadConstant(uint64_t(1)));
+    auto value = b.Truncate(LoadGPR(b, 4), INT32_TYPE);
+    b.BranchTrue(b.CompareULT(b.LoadConstant(uint32_t(10)), value),
+                 skip_label);
+    StoreGPR(b, 3, b.LoadConstant(uint64_t(2)));
+    b.MarkLabel(skip_label);
+    b.Return();
+  });
+  test.Run([](PPCContext* ctx) { ctx->r[4] = 11; },
+           [](PPCContext* ctx) { REQUIRE(ctx->r[3] == 1); });
+  test.Run([](PPCContext* ctx) { ctx->r[4] = 10; },
+           [](PPCContext* ctx) { REQUIRE(ctx->r[3] == 2); });
+  test.Run([](PPCContext* ctx) { ctx->r[4] = 0xFFFFFFFF; },
+           [](PPCContext* ctx) { REQUIRE(ctx->r[3] == 1); });
+}
@@ -0,0 +1,163 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/test/util.h>
+
+using namespace alloy;
+using namespace alloy::hir;
+using namespace alloy::runtime;
+using namespace alloy::test;
+using alloy::frontend::ppc::PPCContext;
+
+TEST_CASE("GLOBAL_CONTEXT_PROMOTION_DIAMOND", "[pass]") {
+  // r4 is loaded once in the entry block and known in both arms and after
+  // they join.
+  auto generator = [](hir::HIRBuilder& b) {
+    auto skip_label = b.NewLabel();
+    auto end_label = b.NewLabel();
+    StoreGPR(b, 7, LoadGPR(b, 4));
+    b.BranchTrue(b.IsTrue(LoadGPR(b, 5)), skip_label);
+    StoreGPR(b, 6, b.Add(LoadGPR(b, 4), b.LoadConstant(uint64_t(1))));
+    b.Branch(end_label);
+    b.MarkLabel(skip_label);
+    StoreGPR(b, 6, b.Sub(LoadGPR(b, 4), b.LoadConstant(uint64_t(1))));
+    b.MarkLabel(end_label);
+    StoreGPR(b, 3, b.Add(LoadGPR(b, 4), LoadGPR(b, 6)));
+    b.Return();
+  };
+  REQUIRE(CompileAndCount(
+              generator,
+              std::make_unique<passes::GlobalContextPromotionPass>(),
+              HasOpcode(&OPCODE_LOAD_CONTEXT_info)) == 3);
+  REQUIRE(CompileAndCount(generator, nullptr,
+                          HasOpcode(&OPCODE_LOAD_CONTEXT_info)) == 6);
+  RunWithPass<passes::GlobalContextPromotionPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 10;
+        ctx->r[5] = 0;
+      },
+      [](PPCContext* ctx) {
+        REQUIRE(ctx->r[3] == 21);
+        REQUIRE(ctx->r[6] == 11);
+        REQUIRE(ctx->r[7] == 10);
+      });
+  RunWithPass<passes::GlobalContextPromotionPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 10;
+        ctx->r[5] = 1;
+      },
+      [](PPCContext* ctx) {
+        REQUIRE(ctx->r[3] == 19);
+        REQUIRE(ctx->r[6] == 9);
+        REQUIRE(ctx->r[7] == 10);
+      });
+}
+
+TEST_CASE("GLOBAL_CONTEXT_PROMOTION_LOOP", "[pass]") {
+  // r4 is known going into the loop and never changes in it, but r3 is
+  // stored on every iteration so its load stays.
+  auto generator = [](hir::HIRBuilder& b) {
+    auto loop_label = b.NewLabel();
+    StoreGPR(b, 3, LoadGPR(b, 4));
+    b.MarkLabel(loop_label);
+    StoreGPR(b, 3, b.Add(LoadGPR(b, 3), LoadGPR(b, 4)));
+    auto count = b.Sub(LoadGPR(b, 5), b.LoadConstant(uint64_t(1)));
+    StoreGPR(b, 5, count);
+    b.BranchTrue(b.IsTrue(count), loop_label);
+    b.Return();
+  };
+  REQUIRE(CompileAndCount(
+              generator,
+              std::make_unique<passes::GlobalContextPromotionPass>(),
+              HasOpcode(&OPCODE_LOAD_CONTEXT_info)) ==
+          CompileAndCount(generator, nullptr,
+                          HasOpcode(&OPCODE_LOAD_CONTEXT_info)) - 1);
+  RunWithPass<passes::GlobalContextPromotionPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 3;
+        ctx->r[5] = 4;
+      },
+      [](PPCContext* ctx) { REQUIRE(ctx->r[3] == 15); });
+}
+
+TEST_CASE("GLOBAL_CONTEXT_PROMOTION_BACK_EDGE", "[pass]") {
+  // r4 is a constant on the way into the loop, but the block on the back
+  // edge stores a new value to it, so the header has to keep loading it.
+  // Only the load in the back edge block, where the header's value is still
+  // known, goes.
+  auto generator = [](hir::HIRBuilder& b) {
+    auto loop_label = b.NewLabel();
+    auto end_label = b.NewLabel();
+    StoreGPR(b, 3, b.LoadConstant(uint64_t(0)));
+    StoreGPR(b, 4, b.LoadConstant(uint64_t(1)));
+    b.MarkLabel(loop_label);
+    StoreGPR(b, 3, b.Add(LoadGPR(b, 3), LoadGPR(b, 4)));
+    auto count = b.Sub(LoadGPR(b, 5), b.LoadConstant(uint64_t(1)));
+    StoreGPR(b, 5, count);
+    b.BranchFalse(b.IsTrue(count), end_label);
+    StoreGPR(b, 4, b.Shl(LoadGPR(b, 4), b.LoadConstant(int8_t(1))));
+    b.Branch(loop_label);
+    b.MarkLabel(end_label);
+    b.Return();
+  };
+  REQUIRE(CompileAndCount(
+              generator,
+              std::make_unique<passes::GlobalContextPromotionPass>(),
+              HasOpcode(&OPCODE_LOAD_CONTEXT_info)) ==
+          CompileAndCount(generator, nullptr,
+                          HasOpcode(&OPCODE_LOAD_CONTEXT_info)) - 1);
+  RunWithPass<passes::GlobalContextPromotionPass>(
+      generator, [](PPCContext* ctx) { ctx->r[5] = 4; },
+      [](PPCContext* ctx) {
+        REQUIRE(ctx->r[3] == 15);
+        REQUIRE(ctx->r[4] == 8);
+      });
+}
+
+TEST_CASE("GLOBAL_CONTEXT_PROMOTION_CALL", "[pass]") {
+  // Calls itself (through r8) while r5 is non-zero, and each call adds 1 to
+  // r4 on the way out. The r4 loaded in the entry block is still known where
+  // the branch skips the call, but not after the call returns.
+  auto generator = [](hir::HIRBuilder& b) {
+    auto skip_label = b.NewLabel();
+    auto after_label = b.NewLabel();
+    StoreGPR(b, 6, LoadGPR(b, 4));
+    b.BranchFalse(b.IsTrue(LoadGPR(b, 5)), skip_label);
+    StoreGPR(b, 5, b.Sub(LoadGPR(b, 5), b.LoadConstant(uint64_t(1))));
+    b.CallIndirect(LoadGPR(b, 8));
+    b.MarkLabel(after_label);
+    StoreGPR(b, 4, b.Add(LoadGPR(b, 4), b.LoadConstant(uint64_t(1))));
+    b.Return();
+    b.MarkLabel(skip_label);
+    StoreGPR(b, 4, b.Add(LoadGPR(b, 4), b.LoadConstant(uint64_t(1))));
+    b.Return();
+  };
+  // The loads of r5 after the branch and of r4 where the call is skipped go.
+  REQUIRE(CompileAndCount(
+              generator,
+              std::make_unique<passes::GlobalContextPromotionPass>(),
+              HasOpcode(&OPCODE_LOAD_CONTEXT_info)) ==
+          CompileAndCount(generator, nullptr,
+                          HasOpcode(&OPCODE_LOAD_CONTEXT_info)) - 2);
+  RunWithPass<passes::GlobalContextPromotionPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 5;
+        ctx->r[5] = 2;
+        ctx->r[8] = 0x1000;
+      },
+      [](PPCContext* ctx) {
+        REQUIRE(ctx->r[4] == 8);
+        REQUIRE(ctx->r[5] == 0);
+        REQUIRE(ctx->r[6] == 5);
+      });
+}
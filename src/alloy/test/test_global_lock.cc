@@ -0,0 +1,67 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/test/util.h>
+#include <alloy/frontend/ppc/ppc_hir_builder.h>
+
+using namespace alloy;
+using namespace alloy::hir;
+using namespace alloy::runtime;
+using namespace alloy::test;
+using alloy::frontend::ppc::EmitStoreMSR;
+using alloy::frontend::ppc::PPCBuiltins;
+using alloy::frontend::ppc::PPCContext;
+
+namespace {
+
+const uint32_t kThreadCount = 8;
+const uint32_t kIterationCount = 200;
+// Long enough that waiters run out of spins and park.
+const uint32_t kHoldSpinCount = 20000;
+
+// Takes the lock the way mtmsr does around a plain increment of the value
+// at r4, held for r6 spins, r5 times.
+void EmitLockedIncrementLoop(hir::HIRBuilder& b, PPCBuiltins* builtins) {
+  auto loop_label = b.NewLabel();
+  b.MarkLabel(loop_label);
+
+  EmitStoreMSR(b, builtins, LoadGPR(b, 13), 0);
+
+  auto value = b.Load(LoadGPR(b, 4), INT32_TYPE);
+  b.Store(LoadGPR(b, 4), b.Add(value, b.LoadConstant(uint32_t(1))));
+  StoreGPR(b, 7, LoadGPR(b, 6));
+  auto hold_label = b.NewLabel();
+  b.MarkLabel(hold_label);
+  auto spins = b.Sub(LoadGPR(b, 7), b.LoadConstant(uint64_t(1)));
+  StoreGPR(b, 7, spins);
+  b.BranchTrue(b.CompareNE(spins, b.LoadZero(INT64_TYPE)), hold_label);
+
+  EmitStoreMSR(b, builtins, b.LoadConstant(uint64_t(0x8000)), 0);
+
+  auto count = b.Sub(LoadGPR(b, 5), b.LoadConstant(uint64_t(1)));
+  StoreGPR(b, 5, count);
+  b.BranchTrue(b.CompareNE(count, b.LoadZero(INT64_TYPE)), loop_label);
+  b.Return();
+}
+
+}  // namespace
+
+TEST_CASE("GLOBAL_LOCK_CONTENDED", "[instr]") {
+  BuiltinTestFunction(EmitLockedIncrementLoop)
+      .RunThreaded(kThreadCount,
+                   [](PPCContext* ctx) {
+                     ctx->r[4] = 0x100;
+                     ctx->r[5] = kIterationCount;
+                     ctx->r[6] = kHoldSpinCount;
+                   },
+                   [](Memory* memory) {
+                     REQUIRE(memory->LoadI32(0x100) ==
+                             kThreadCount * kIterationCount);
+                   });
+}
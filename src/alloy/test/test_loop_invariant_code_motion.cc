@@ -0,0 +1,141 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/test/util.h>
+
+using namespace alloy;
+using namespace alloy::hir;
+using namespace alloy::runtime;
+using namespace alloy::test;
+using alloy::frontend::ppc::PPCContext;
+
+TEST_CASE("LICM_INVARIANT", "[pass]") {
+  // r3 += r4 * 3 + r6, r5 times. Both context loads and the math on them
+  // don't change in the loop. The loop may be skipped, so it gets a new
+  // preheader.
+  auto generator = [](hir::HIRBuilder& b) {
+    auto loop_label = b.NewLabel();
+    auto end_label = b.NewLabel();
+    StoreGPR(b, 3, b.LoadConstant(uint64_t(0)));
+    b.BranchFalse(b.IsTrue(LoadGPR(b, 5)), end_label);
+    b.MarkLabel(loop_label);
+    auto v = b.Add(b.Mul(LoadGPR(b, 4), b.LoadConstant(uint64_t(3))),
+                   LoadGPR(b, 6));
+    StoreGPR(b, 3, b.Add(LoadGPR(b, 3), v));
+    auto count = b.Sub(LoadGPR(b, 5), b.LoadConstant(uint64_t(1)));
+    StoreGPR(b, 5, count);
+    b.BranchTrue(b.IsTrue(count), loop_label);
+    b.MarkLabel(end_label);
+    b.Return();
+  };
+  // Only the r3 and r5 loads stay.
+  REQUIRE(CompileAndCount(
+              generator,
+              std::make_unique<passes::LoopInvariantCodeMotionPass>(),
+              HasOpcodeInLoop(&OPCODE_LOAD_CONTEXT_info)) == 2);
+  REQUIRE(CompileAndCount(
+              generator,
+              std::make_unique<passes::LoopInvariantCodeMotionPass>(),
+              HasOpcodeInLoop(&OPCODE_MUL_info)) == 0);
+  RunWithPass<passes::LoopInvariantCodeMotionPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 5;
+        ctx->r[5] = 3;
+        ctx->r[6] = 2;
+      },
+      [](PPCContext* ctx) {
+        REQUIRE(ctx->r[3] == 51);
+        REQUIRE(ctx->r[5] == 0);
+      });
+  // Never entered; nothing hoisted may run.
+  RunWithPass<passes::LoopInvariantCodeMotionPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 5;
+        ctx->r[5] = 0;
+        ctx->r[6] = 2;
+      },
+      [](PPCContext* ctx) { REQUIRE(ctx->r[3] == 0); });
+}
+
+TEST_CASE("LICM_CONTEXT_STORE", "[pass]") {
+  // r4 is stored in the loop so its load must stay; r6 isn't.
+  auto generator = [](hir::HIRBuilder& b) {
+    auto loop_label = b.NewLabel();
+    b.MarkLabel(loop_label);
+    StoreGPR(b, 4, b.Add(LoadGPR(b, 4), LoadGPR(b, 6)));
+    auto count = b.Sub(LoadGPR(b, 5), b.LoadConstant(uint64_t(1)));
+    StoreGPR(b, 5, count);
+    b.BranchTrue(b.IsTrue(count), loop_label);
+    b.Return();
+  };
+  REQUIRE(CompileAndCount(
+              generator,
+              std::make_unique<passes::LoopInvariantCodeMotionPass>(),
+              HasOpcodeInLoop(&OPCODE_LOAD_CONTEXT_info)) == 2);
+  RunWithPass<passes::LoopInvariantCodeMotionPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 1;
+        ctx->r[5] = 3;
+        ctx->r[6] = 10;
+      },
+      [](PPCContext* ctx) { REQUIRE(ctx->r[4] == 31); });
+}
+
+TEST_CASE("LICM_GUARDED_DIVIDE", "[pass]") {
+  // r3 += r4 / r6 for r5 iterations, skipping the divide when r6 is 0. Its
+  // operands are invariant, but hoisting it above the check (or above a loop
+  // that never runs) would divide by zero.
+  auto generator = [](hir::HIRBuilder& b) {
+    auto loop_label = b.NewLabel();
+    auto next_label = b.NewLabel();
+    auto end_label = b.NewLabel();
+    StoreGPR(b, 3, b.LoadConstant(uint64_t(0)));
+    b.BranchFalse(b.IsTrue(LoadGPR(b, 5)), end_label);
+    b.MarkLabel(loop_label);
+    b.BranchFalse(b.IsTrue(LoadGPR(b, 6)), next_label);
+    StoreGPR(b, 3, b.Add(LoadGPR(b, 3), b.Div(LoadGPR(b, 4), LoadGPR(b, 6))));
+    b.MarkLabel(next_label);
+    auto count = b.Sub(LoadGPR(b, 5), b.LoadConstant(uint64_t(1)));
+    StoreGPR(b, 5, count);
+    b.BranchTrue(b.IsTrue(count), loop_label);
+    b.MarkLabel(end_label);
+    b.Return();
+  };
+  REQUIRE(CompileAndCount(
+              generator,
+              std::make_unique<passes::LoopInvariantCodeMotionPass>(),
+              HasOpcodeInLoop(&OPCODE_DIV_info)) == 1);
+  RunWithPass<passes::LoopInvariantCodeMotionPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 12;
+        ctx->r[5] = 3;
+        ctx->r[6] = 4;
+      },
+      [](PPCContext* ctx) { REQUIRE(ctx->r[3] == 9); });
+  RunWithPass<passes::LoopInvariantCodeMotionPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 12;
+        ctx->r[5] = 3;
+        ctx->r[6] = 0;
+      },
+      [](PPCContext* ctx) { REQUIRE(ctx->r[3] == 0); });
+  RunWithPass<passes::LoopInvariantCodeMotionPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 12;
+        ctx->r[5] = 0;
+        ctx->r[6] = 0;
+      },
+      [](PPCContext* ctx) { REQUIRE(ctx->r[3] == 0); });
+}
@@ -78,6 +78,49 @@ TEST_CASE("PERMUTE_V128_BY_INT32_CONSTANT", "[instr]") {
   }
 }
 
+TEST_CASE("PERMUTE_V128_BY_INT32", "[instr]") {
+  TestFunction test([](hir::HIRBuilder& b) {
+    StoreVR(b, 3, b.Permute(b.Truncate(LoadGPR(b, 3), INT32_TYPE),
+                            LoadVR(b, 4), LoadVR(b, 5), INT32_TYPE));
+    b.Return();
+  });
+  test.Run([](PPCContext* ctx) {
+             ctx->r[3] = PERMUTE_MASK(0, 3, 1, 2, 0, 1, 1, 0);
+             ctx->v[4] = vec128i(0, 1, 2, 3);
+             ctx->v[5] = vec128i(4, 5, 6, 7);
+           },
+           [](PPCContext* ctx) {
+             auto result = ctx->v[3];
+             REQUIRE(result == vec128i(3, 6, 1, 4));
+           });
+  test.Run([](PPCContext* ctx) {
+             ctx->r[3] = PERMUTE_MASK(1, 0, 1, 1, 1, 2, 1, 3);
+             ctx->v[4] = vec128i(0, 1, 2, 3);
+             ctx->v[5] = vec128i(4, 5, 6, 7);
+           },
+           [](PPCContext* ctx) {
+             auto result = ctx->v[3];
+             REQUIRE(result == vec128i(4, 5, 6, 7));
+           });
+}
+
+TEST_CASE("PERMUTE_V128_BY_INT32_CONSTANT_SRC", "[instr]") {
+  TestFunction test([](hir::HIRBuilder& b) {
+    StoreVR(b, 3, b.Permute(b.Truncate(LoadGPR(b, 3), INT32_TYPE),
+                            b.LoadConstant(vec128i(10, 11, 12, 13)),
+                            LoadVR(b, 5), INT32_TYPE));
+    b.Return();
+  });
+  test.Run([](PPCContext* ctx) {
+             ctx->r[3] = PERMUTE_MASK(1, 3, 0, 0, 1, 1, 0, 2);
+             ctx->v[5] = vec128i(4, 5, 6, 7);
+           },
+           [](PPCContext* ctx) {
+             auto result = ctx->v[3];
+             REQUIRE(result == vec128i(7, 10, 5, 12));
+           });
+}
+
 TEST_CASE("PERMUTE_V128_BY_V128", "[instr]") {
   TestFunction test([](hir::HIRBuilder& b) {
     StoreVR(b, 3,
@@ -0,0 +1,85 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/test/util.h>
+
+using namespace alloy;
+using namespace alloy::hir;
+using namespace alloy::runtime;
+using namespace alloy::test;
+using alloy::frontend::ppc::PPCContext;
+
+TEST_CASE("REGISTER_ALLOCATION_LOOP", "[pass]") {
+  // r3 += r4 * 3, r5 times. The product is last used early in the loop body
+  // but is live around the back edge, so the values made after it can't take
+  // its register.
+  TestFunction test([](hir::HIRBuilder& b) {
+    auto loop_label = b.NewLabel();
+    auto v = b.Mul(LoadGPR(b, 4), b.LoadConstant(uint64_t(3)));
+    StoreGPR(b, 3, b.LoadConstant(uint64_t(0)));
+    b.MarkLabel(loop_label);
+    StoreGPR(b, 3, b.Add(LoadGPR(b, 3), v));
+    auto count = b.Sub(LoadGPR(b, 5), b.LoadConstant(uint64_t(1)));
+    StoreGPR(b, 6, b.Add(LoadGPR(b, 6), count));
+    StoreGPR(b, 5, count);
+    b.BranchTrue(b.IsTrue(count), loop_label);
+    b.Return();
+  });
+  test.Run(
+      [](PPCContext* ctx) {
+        ctx->r[4] = 5;
+        ctx->r[5] = 4;
+        ctx->r[6] = 0;
+      },
+      [](PPCContext* ctx) {
+        REQUIRE(ctx->r[3] == 60);
+        REQUIRE(ctx->r[5] == 0);
+        REQUIRE(ctx->r[6] == 6);
+      });
+}
+
+TEST_CASE("REGISTER_ALLOCATION_JOIN", "[pass]") {
+  // Both values are made before the branch and only one arm uses them, but
+  // both are still live where the arms join.
+  TestFunction test([](hir::HIRBuilder& b) {
+    auto else_label = b.NewLabel();
+    auto join_label = b.NewLabel();
+    auto v = b.Mul(LoadGPR(b, 4), b.LoadConstant(uint64_t(3)));
+    auto w = b.Add(LoadGPR(b, 4), LoadGPR(b, 6));
+    b.BranchFalse(b.IsTrue(LoadGPR(b, 5)), else_label);
+    StoreGPR(b, 3, b.Add(v, b.LoadConstant(uint64_t(1))));
+    b.Branch(join_label);
+    b.MarkLabel(else_label);
+    auto x = b.Sub(LoadGPR(b, 6), LoadGPR(b, 5));
+    StoreGPR(b, 3, b.Mul(x, b.Add(x, b.LoadConstant(uint64_t(2)))));
+    b.MarkLabel(join_label);
+    StoreGPR(b, 7, b.Add(v, w));
+    b.Return();
+  });
+  test.Run(
+      [](PPCContext* ctx) {
+        ctx->r[4] = 5;
+        ctx->r[5] = 1;
+        ctx->r[6] = 2;
+      },
+      [](PPCContext* ctx) {
+        REQUIRE(ctx->r[3] == 16);
+        REQUIRE(ctx->r[7] == 22);
+      });
+  test.Run(
+      [](PPCContext* ctx) {
+        ctx->r[4] = 5;
+        ctx->r[5] = 0;
+        ctx->r[6] = 2;
+      },
+      [](PPCContext* ctx) {
+        REQUIRE(ctx->r[3] == 8);
+        REQUIRE(ctx->r[7] == 22);
+      });
+}
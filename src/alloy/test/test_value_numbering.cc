@@ -0,0 +1,110 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <alloy/test/util.h>
+
+using namespace alloy;
+using namespace alloy::hir;
+using namespace alloy::runtime;
+using namespace alloy::test;
+using alloy::frontend::ppc::PPCContext;
+
+TEST_CASE("VALUE_NUMBERING_BLOCK", "[pass]") {
+  auto generator = [](hir::HIRBuilder& b) {
+    auto v1 = b.And(LoadGPR(b, 4), b.LoadConstant(uint64_t(0xFFFF)));
+    auto v2 = b.And(b.LoadConstant(uint64_t(0xFFFF)), LoadGPR(b, 4));
+    auto v3 = b.SignExtend(b.Truncate(LoadGPR(b, 5), INT16_TYPE), INT64_TYPE);
+    auto v4 = b.SignExtend(b.Truncate(LoadGPR(b, 5), INT16_TYPE), INT64_TYPE);
+    StoreGPR(b, 3, b.Add(v1, v3));
+    StoreGPR(b, 6, b.Add(v4, v2));
+    b.Return();
+  };
+  REQUIRE(CompileAndCount(generator,
+                          std::make_unique<passes::ValueNumberingPass>(),
+                          IsAnyInstr) <
+          CompileAndCount(generator, nullptr, IsAnyInstr));
+  RunWithPass<passes::ValueNumberingPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 0x12345678;
+        ctx->r[5] = 0x8001;
+      },
+      [](PPCContext* ctx) {
+        REQUIRE(ctx->r[3] == 0x5678 - 0x7FFF);
+        REQUIRE(ctx->r[6] == 0x5678 - 0x7FFF);
+      });
+}
+
+TEST_CASE("VALUE_NUMBERING_DOMINATED", "[pass]") {
+  // The computation in the entry block is reused after the branch, but the
+  // two arms of it don't share anything with each other.
+  auto generator = [](hir::HIRBuilder& b) {
+    auto skip_label = b.NewLabel();
+    auto end_label = b.NewLabel();
+    auto v1 = b.Shl(LoadGPR(b, 4), b.LoadConstant(int8_t(3)));
+    StoreGPR(b, 3, v1);
+    b.BranchTrue(b.IsTrue(LoadGPR(b, 5)), skip_label);
+    StoreGPR(b, 6, b.Add(LoadGPR(b, 4), b.LoadConstant(uint64_t(1))));
+    b.Branch(end_label);
+    b.MarkLabel(skip_label);
+    StoreGPR(b, 6, b.Add(LoadGPR(b, 4), b.LoadConstant(uint64_t(1))));
+    StoreGPR(b, 7, b.Shl(LoadGPR(b, 4), b.LoadConstant(int8_t(3))));
+    b.MarkLabel(end_label);
+    b.Return();
+  };
+  REQUIRE(CompileAndCount(generator,
+                          std::make_unique<passes::ValueNumberingPass>(),
+                          IsAnyInstr) <
+          CompileAndCount(generator, nullptr, IsAnyInstr));
+  RunWithPass<passes::ValueNumberingPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 0x10;
+        ctx->r[5] = 1;
+      },
+      [](PPCContext* ctx) {
+        REQUIRE(ctx->r[3] == 0x80);
+        REQUIRE(ctx->r[6] == 0x11);
+        REQUIRE(ctx->r[7] == 0x80);
+      });
+  RunWithPass<passes::ValueNumberingPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 0x10;
+        ctx->r[5] = 0;
+      },
+      [](PPCContext* ctx) {
+        REQUIRE(ctx->r[3] == 0x80);
+        REQUIRE(ctx->r[6] == 0x11);
+        REQUIRE(ctx->r[7] == 0);
+      });
+}
+
+TEST_CASE("VALUE_NUMBERING_LOAD_STORE", "[pass]") {
+  // Loads match only with no store in between.
+  auto generator = [](hir::HIRBuilder& b) {
+    auto v1 = b.Load(LoadGPR(b, 4), INT32_TYPE);
+    auto v2 = b.Load(LoadGPR(b, 4), INT32_TYPE);
+    b.Store(LoadGPR(b, 4), b.Add(v1, b.LoadConstant(uint32_t(1))));
+    auto v3 = b.Load(LoadGPR(b, 4), INT32_TYPE);
+    StoreGPR(b, 3, b.ZeroExtend(b.Add(v2, v3), INT64_TYPE));
+    b.Return();
+  };
+  REQUIRE(CompileAndCount(generator,
+                          std::make_unique<passes::ValueNumberingPass>(),
+                          IsAnyInstr) <
+          CompileAndCount(generator, nullptr, IsAnyInstr));
+  RunWithPass<passes::ValueNumberingPass>(
+      generator,
+      [](PPCContext* ctx) {
+        ctx->r[4] = 0x100;
+        *reinterpret_cast<uint32_t*>(ctx->membase + 0x100) = 5;
+      },
+      [](PPCContext* ctx) { REQUIRE(ctx->r[3] == 11); });
+}
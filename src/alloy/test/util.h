@@ -10,9 +10,14 @@
 #ifndef ALLOY_TEST_UTIL_H_
 #define ALLOY_TEST_UTIL_H_
 
+#include <thread>
+#include <vector>
+
 #include <alloy/alloy.h>
 #include <alloy/backend/ivm/ivm_backend.h>
 #include <alloy/backend/x64/x64_backend.h>
+#include <alloy/compiler/compiler.h>
+#include <alloy/compiler/compiler_passes.h>
 #include <alloy/frontend/ppc/ppc_context.h>
 #include <alloy/frontend/ppc/ppc_frontend.h>
 #include <alloy/hir/hir_builder.h>
@@ -30,6 +35,17 @@ namespace test {
 
 using alloy::frontend::ppc::PPCContext;
 using alloy::runtime::Runtime;
+namespace passes = alloy::compiler::passes;
+
+// Adds passes under test to a TestFunction's pipeline.
+typedef std::function<void(compiler::Compiler* compiler)> PassAdder;
+
+template <typename T>
+PassAdder WithPass() {
+  return [](compiler::Compiler* compiler) {
+    compiler->AddPass(std::make_unique<T>());
+  };
+}
 
 class ThreadState : public alloy::runtime::ThreadState {
  public:
@@ -46,8 +62,11 @@ class ThreadState : public alloy::runtime::ThreadState {
     assert_true((reinterpret_cast<uint64_t>(context_) & 0xF) == 0);
 
     // Stash pointers to common structures that callbacks may need.
-    context_->reserve_address = memory_->reserve_address();
-    context_->reserve_value = memory_->reserve_value();
+    context_->reserve_address = UINT64_MAX;
+    context_->global_lock_owner =
+        static_cast<alloy::frontend::ppc::PPCFrontend*>(runtime->frontend())
+            ->builtins()
+            ->global_lock.owner_ptr();
     context_->membase = memory_->membase();
     context_->runtime = runtime;
     context_->thread_state = this;
@@ -82,7 +101,86 @@ class ThreadState : public alloy::runtime::ThreadState {
 
 class TestFunction {
  public:
-  TestFunction(std::function<void(hir::HIRBuilder& b)> generator) {
+  TestFunction(std::function<void(hir::HIRBuilder& b)> generator,
+               PassAdder add_passes = nullptr) {
+    Initialize([generator](hir::HIRBuilder& b,
+                           frontend::ppc::PPCBuiltins* builtins) {
+                 generator(b);
+               },
+               add_passes);
+  }
+
+  ~TestFunction() {
+    runtimes.clear();
+    memory.reset();
+  }
+
+  void Run(std::function<void(PPCContext*)> pre_call,
+           std::function<void(PPCContext*)> post_call) {
+    for (auto& runtime : runtimes) {
+      memory->Zero(0, memory_size);
+
+      uint64_t stack_size = 64 * 1024;
+      uint64_t stack_address = memory_size - stack_size;
+      uint64_t thread_state_address = stack_address - 0x1000;
+      auto thread_state = std::make_unique<ThreadState>(
+          runtime.get(), 0x100, stack_address, stack_size, thread_state_address);
+      auto ctx = thread_state->context();
+      ctx->lr = 0xBEBEBEBE;
+
+      pre_call(ctx);
+
+      runtime->CallFunction(thread_state.get(), 0x1000, ctx->lr);
+
+      post_call(ctx);
+    }
+  }
+
+  // Calls the function from thread_count host threads at once, each with its
+  // own thread state and stack, and checks memory once all have returned.
+  void RunThreaded(uint32_t thread_count,
+                   std::function<void(PPCContext*)> pre_call,
+                   std::function<void(Memory*)> post_call) {
+    for (auto& runtime : runtimes) {
+      memory->Zero(0, memory_size);
+
+      std::vector<std::thread> threads;
+      for (uint32_t n = 0; n < thread_count; ++n) {
+        threads.emplace_back([&, n]() {
+          uint64_t stack_size = 64 * 1024;
+          uint64_t thread_state_address =
+              memory_size - (stack_size + 0x1000) * (n + 1);
+          uint64_t stack_address = thread_state_address + 0x1000;
+          auto thread_state = std::make_unique<ThreadState>(
+              runtime.get(), 0x100 + n, stack_address, stack_size,
+              thread_state_address);
+          auto ctx = thread_state->context();
+          ctx->lr = 0xBEBEBEBE;
+
+          pre_call(ctx);
+
+          runtime->CallFunction(thread_state.get(), 0x1000, ctx->lr);
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+
+      post_call(memory.get());
+    }
+  }
+
+  size_t memory_size;
+  std::unique_ptr<Memory> memory;
+  std::vector<std::unique_ptr<Runtime>> runtimes;
+
+ protected:
+  TestFunction() = default;
+
+  void Initialize(std::function<void(hir::HIRBuilder& b,
+                                     frontend::ppc::PPCBuiltins* builtins)>
+                      generator,
+                  PassAdder add_passes = nullptr) {
     memory_size = 16 * 1024 * 1024;
     memory.reset(new SimpleMemory(memory_size));
 
@@ -98,62 +196,131 @@ class TestFunction {
     }
 #endif  // ALLOY_TEST_IVM
 #if ALLOY_TEST_X64
-    {
+    // Once with every extension the host has and once with none, so that the
+    // fallback sequences are checked against the same results.
+    for (uint32_t emit_feature_mask : {~0u, 0u}) {
       auto runtime = std::make_unique<Runtime>(memory.get());
       auto frontend =
           std::make_unique<alloy::frontend::ppc::PPCFrontend>(runtime.get());
-      auto backend =
-          std::make_unique<alloy::backend::x64::X64Backend>(runtime.get());
+      auto backend = std::make_unique<alloy::backend::x64::X64Backend>(
+          runtime.get(), emit_feature_mask);
       runtime->Initialize(std::move(frontend), std::move(backend));
       runtimes.emplace_back(std::move(runtime));
     }
 #endif  // ALLOY_TEST_X64
 
     for (auto& runtime : runtimes) {
+      auto builtins =
+          static_cast<alloy::frontend::ppc::PPCFrontend*>(runtime->frontend())
+              ->builtins();
       auto module = std::make_unique<alloy::runtime::TestModule>(
           runtime.get(), "Test",
           [](uint64_t address) { return address == 0x1000; },
-          [generator](hir::HIRBuilder& b) {
-            generator(b);
+          [generator, builtins](hir::HIRBuilder& b) {
+            generator(b, builtins);
             return true;
-          });
+          },
+          add_passes);
       runtime->AddModule(std::move(module));
     }
   }
+};
 
-  ~TestFunction() {
-    runtimes.clear();
-    memory.reset();
+// A TestFunction whose generator can call the frontend builtins (such as the
+// global lock), which live in each runtime.
+class BuiltinTestFunction : public TestFunction {
+ public:
+  BuiltinTestFunction(
+      std::function<void(hir::HIRBuilder& b,
+                         frontend::ppc::PPCBuiltins* builtins)> generator) {
+    Initialize(generator);
   }
+};
 
-  void Run(std::function<void(PPCContext*)> pre_call,
-           std::function<void(PPCContext*)> post_call) {
-    for (auto& runtime : runtimes) {
-      memory->Zero(0, memory_size);
-
-      alloy::runtime::Function* fn;
-      runtime->ResolveFunction(0x1000, &fn);
-
-      uint64_t stack_size = 64 * 1024;
-      uint64_t stack_address = memory_size - stack_size;
-      uint64_t thread_state_address = stack_address - 0x1000;
-      auto thread_state = std::make_unique<ThreadState>(
-          runtime.get(), 0x100, stack_address, stack_size, thread_state_address);
-      auto ctx = thread_state->context();
-      ctx->lr = 0xBEBEBEBE;
-
-      pre_call(ctx);
-
-      fn->Call(thread_state.get(), ctx->lr);
+// Runs generator with and without pass T from the same starting state. Both
+// have to pass post_call and leave the same registers behind.
+template <typename T>
+void RunWithPass(std::function<void(hir::HIRBuilder& b)> generator,
+                 std::function<void(PPCContext*)> pre_call,
+                 std::function<void(PPCContext*)> post_call) {
+  const size_t register_offset = offsetof(PPCContext, r);
+  const size_t register_size =
+      offsetof(PPCContext, thread_id) - register_offset;
+  std::vector<std::vector<uint8_t>> results;
+  TestFunction(generator).Run(pre_call, [&](PPCContext* ctx) {
+    post_call(ctx);
+    auto registers = reinterpret_cast<uint8_t*>(ctx) + register_offset;
+    results.emplace_back(registers, registers + register_size);
+  });
+  size_t n = 0;
+  TestFunction(generator, WithPass<T>()).Run(pre_call, [&](PPCContext* ctx) {
+    post_call(ctx);
+    auto registers = reinterpret_cast<uint8_t*>(ctx) + register_offset;
+    REQUIRE(!memcmp(results[n++].data(), registers, register_size));
+  });
+}
 
-      post_call(ctx);
+// Runs pass between control flow analysis and the usual cleanup over the
+// generated HIR and counts the instructions left that match predicate.
+// Passing a null pass gives the count to compare against, as the value
+// numbering tests do.
+inline uint32_t CompileAndCount(
+    std::function<void(hir::HIRBuilder& b)> generator,
+    std::unique_ptr<compiler::CompilerPass> pass,
+    std::function<bool(const hir::Instr* instr)> predicate) {
+  hir::HIRBuilder builder;
+  generator(builder);
+  compiler::Compiler compiler(nullptr);
+  compiler.AddPass(std::make_unique<passes::ControlFlowAnalysisPass>());
+  if (pass) {
+    compiler.AddPass(std::move(pass));
+  }
+  compiler.AddPass(std::make_unique<passes::SimplificationPass>());
+  compiler.AddPass(std::make_unique<passes::DeadCodeEliminationPass>());
+  compiler.Compile(&builder);
+  uint32_t count = 0;
+  auto block = builder.first_block();
+  while (block) {
+    auto instr = block->instr_head;
+    while (instr) {
+      if (predicate(instr)) {
+        ++count;
+      }
+      instr = instr->next;
     }
+    block = block->next;
   }
+  return count;
+}
 
-  size_t memory_size;
-  std::unique_ptr<Memory> memory;
-  std::vector<std::unique_ptr<Runtime>> runtimes;
-};
+// Predicates for CompileAndCount.
+inline bool IsAnyInstr(const hir::Instr* instr) { return true; }
+inline std::function<bool(const hir::Instr* instr)> HasOpcode(
+    const hir::OpcodeInfo* opcode) {
+  return [opcode](const hir::Instr* instr) { return instr->opcode == opcode; };
+}
+// Only counts instructions in blocks LoopInvariantCodeMotionPass found to be
+// in a loop.
+inline std::function<bool(const hir::Instr* instr)> HasOpcodeInLoop(
+    const hir::OpcodeInfo* opcode) {
+  return [opcode](const hir::Instr* instr) {
+    return instr->block->loop_depth && instr->opcode == opcode;
+  };
+}
+// Only counts conditional branches placed right after the compare they test,
+// looking through context stores of the compare result in between.
+inline bool IsFusedBranch(const hir::Instr* instr) {
+  if (instr->opcode != &hir::OPCODE_BRANCH_TRUE_info &&
+      instr->opcode != &hir::OPCODE_BRANCH_FALSE_info) {
+    return false;
+  }
+  auto prev = instr->prev;
+  while (prev && prev->opcode == &hir::OPCODE_STORE_CONTEXT_info &&
+         prev->src2.value == instr->src1.value) {
+    prev = prev->prev;
+  }
+  return prev && prev == instr->src1.value->def;
+}
 
 inline hir::Value* LoadGPR(hir::HIRBuilder& b, int reg) {
   return b.LoadContext(offsetof(PPCContext, r) + reg * 8, hir::INT64_TYPE);
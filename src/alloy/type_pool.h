@@ -15,7 +15,7 @@
 
 namespace alloy {
 
-template <class T, typename A>
+template <class T, typename... A>
 class TypePool {
  public:
   ~TypePool() { Reset(); }
@@ -29,7 +29,7 @@ class TypePool {
     list_.clear();
   }
 
-  T* Allocate(A arg0) {
+  T* Allocate(A... args) {
     T* result = 0;
     {
       std::lock_guard<std::mutex> guard(lock_);
@@ -39,7 +39,7 @@ class TypePool {
       }
     }
     if (!result) {
-      result = new T(arg0);
+      result = new T(args...);
     }
     return result;
   }
@@ -44,6 +44,14 @@ void Sleep(std::chrono::duration<Rep, Period> duration) {
   Sleep(std::chrono::duration_cast<std::chrono::microseconds>(duration));
 }
 
+// Blocks the current thread while *address == expected_value, until another
+// thread calls WakeAddressSingle on the address. May return spuriously.
+// On OS X, which has no public address wait, this only yields, so callers
+// spin on it rather than sleep.
+void WaitOnAddress(volatile uint32_t* address, uint32_t expected_value);
+// Wakes one thread blocked in WaitOnAddress on the address, if any.
+void WakeAddressSingle(volatile uint32_t* address);
+
 }  // namespace threading
 }  // namespace poly
 
@@ -40,5 +40,17 @@ void Sleep(std::chrono::microseconds duration) {
   // TODO(benvanik): spin while rmtp >0?
 }
 
+void WaitOnAddress(volatile uint32_t* address, uint32_t expected_value) {
+  // Spin fallback: there's no public address wait here, so this never
+  // blocks. It gives up the timeslice and returns (spuriously, as far as the
+  // caller can tell), and a waiting caller busy-loops through here until the
+  // value changes. WakeAddressSingle has nothing to wake.
+  if (*address == expected_value) {
+    Yield();
+  }
+}
+
+void WakeAddressSingle(volatile uint32_t* address) {}
+
 }  // namespace threading
 }  // namespace poly
@@ -9,8 +9,11 @@
 
 #include <poly/threading.h>
 
+#include <linux/futex.h>
 #include <pthread.h>
+#include <sys/syscall.h>
 #include <time.h>
+#include <unistd.h>
 
 namespace poly {
 namespace threading {
@@ -38,5 +41,14 @@ void Sleep(std::chrono::microseconds duration) {
   // TODO(benvanik): spin while rmtp >0?
 }
 
+void WaitOnAddress(volatile uint32_t* address, uint32_t expected_value) {
+  syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected_value, nullptr,
+          nullptr, 0);
+}
+
+void WakeAddressSingle(volatile uint32_t* address) {
+  syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
 }  // namespace threading
 }  // namespace poly
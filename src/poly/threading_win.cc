@@ -11,6 +11,8 @@
 
 #include <poly/platform.h>
 
+#pragma comment(lib, "synchronization.lib")
+
 namespace poly {
 namespace threading {
 
@@ -71,5 +73,13 @@ void Sleep(std::chrono::microseconds duration) {
   }
 }
 
+void WaitOnAddress(volatile uint32_t* address, uint32_t expected_value) {
+  ::WaitOnAddress(address, &expected_value, sizeof(expected_value), INFINITE);
+}
+
+void WakeAddressSingle(volatile uint32_t* address) {
+  ::WakeByAddressSingle(const_cast<uint32_t*>(address));
+}
+
 }  // namespace threading
 }  // namespace poly
@@ -19,6 +19,10 @@ DECLARE_bool(trace_instructions);
 DECLARE_bool(trace_registers);
 DECLARE_string(load_module_map);
 
+DECLARE_bool(precompile);
+DECLARE_int32(precompile_threads);
+DECLARE_string(precompile_profile);
+
 DECLARE_string(dump_path);
 DECLARE_bool(dump_module_map);
 
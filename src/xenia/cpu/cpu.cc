@@ -22,6 +22,18 @@ DEFINE_string(
     "Loads a .map for symbol names and to diff with the generated symbol "
     "database.");
 
+// Translation:
+DEFINE_bool(precompile, false,
+            "Translate all functions discovered in loaded XEX modules on "
+            "background threads.");
+DEFINE_int32(precompile_threads, 0,
+             "Number of precompile worker threads (0 = half of the host "
+             "cores).");
+DEFINE_string(precompile_profile, "",
+              "File of guest function addresses, hottest first, used to order "
+              "precompilation. Functions guest threads had to translate "
+              "themselves are moved to the front of it on exit.");
+
 // Dumping:
 DEFINE_string(dump_path, "build/",
               "Directory that dump files are placed into.");
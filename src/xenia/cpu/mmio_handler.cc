@@ -9,7 +9,10 @@
 
 #include <xenia/cpu/mmio_handler.h>
 
+#include <algorithm>
+
 #include <poly/poly.h>
+#include <xenia/logging.h>
 
 namespace BE {
 #include <beaengine/BeaEngine.h>
@@ -20,10 +23,77 @@ namespace cpu {
 
 MMIOHandler* MMIOHandler::global_handler_ = nullptr;
 
+namespace {
+
+// A movbe register <-> memory access.
+struct MovbeAccess {
+  bool is_store;
+  uint32_t size;
+  uint32_t reg_index;
+  size_t length;
+};
+
+// Generated code fuses guest loads/stores with their byte swap into movbe.
+// Unlike mov, the value in the register is already in guest order, so it
+// must not be swapped again. Decoded here so that it doesn't depend on the
+// disassembler knowing the instruction.
+bool DecodeMovbe(const uint8_t* p, MovbeAccess* out) {
+  const uint8_t* start = p;
+  bool has_operand_size_prefix = false;
+  while (true) {
+    if (*p == 0x66) {
+      has_operand_size_prefix = true;
+    } else if (*p != 0x67 && *p != 0x2E && *p != 0x36 && *p != 0x3E &&
+               *p != 0x26 && *p != 0x64 && *p != 0x65) {
+      // Anything else (including F2, which makes it crc32) is not movbe.
+      break;
+    }
+    ++p;
+  }
+  uint8_t rex = 0;
+  if ((*p & 0xF0) == 0x40) {
+    rex = *p++;
+  }
+  // 0F 38 F0 is the load, 0F 38 F1 the store.
+  if (p[0] != 0x0F || p[1] != 0x38 || (p[2] & 0xFE) != 0xF0) {
+    return false;
+  }
+  out->is_store = p[2] == 0xF1;
+  p += 3;
+  uint8_t modrm = *p++;
+  uint8_t mod = modrm >> 6;
+  uint8_t rm = modrm & 0x7;
+  if (mod == 3) {
+    // Not a memory operand.
+    return false;
+  }
+  if (rm == 4) {
+    uint8_t sib = *p++;
+    if (mod == 0 && (sib & 0x7) == 5) {
+      p += 4;
+    }
+  } else if (mod == 0 && rm == 5) {
+    // rip relative.
+    p += 4;
+  }
+  if (mod == 1) {
+    p += 1;
+  } else if (mod == 2) {
+    p += 4;
+  }
+  out->size = (rex & 0x8) ? 64 : has_operand_size_prefix ? 16 : 32;
+  out->reg_index = ((rex & 0x4) << 1) | ((modrm >> 3) & 0x7);
+  out->length = p - start;
+  return true;
+}
+
+}  // namespace
+
 // Implemented in the platform cc file.
 std::unique_ptr<MMIOHandler> CreateMMIOHandler(uint8_t* mapping_base);
 
-std::unique_ptr<MMIOHandler> MMIOHandler::Install(uint8_t* mapping_base) {
+std::unique_ptr<MMIOHandler> MMIOHandler::Install(uint8_t* mapping_base,
+                                                  Memory* memory) {
   // There can be only one handler at a time.
   assert_null(global_handler_);
   if (global_handler_) {
@@ -32,6 +102,7 @@ std::unique_ptr<MMIOHandler> MMIOHandler::Install(uint8_t* mapping_base) {
 
   // Create the platform-specific handler.
   auto handler = CreateMMIOHandler(mapping_base);
+  handler->memory_ = memory;
 
   // Platform-specific initialization for the handler.
   if (!handler->Initialize()) {
@@ -42,6 +113,11 @@ std::unique_ptr<MMIOHandler> MMIOHandler::Install(uint8_t* mapping_base) {
   return handler;
 }
 
+MMIOHandler::MMIOHandler(uint8_t* mapping_base)
+    : mapping_base_(mapping_base),
+      memory_(nullptr),
+      watch_pages_(kPhysicalSize >> kWatchPageShift, WATCH_NONE) {}
+
 MMIOHandler::~MMIOHandler() {
   assert_true(global_handler_ == this);
   global_handler_ = nullptr;
@@ -78,8 +154,131 @@ bool MMIOHandler::CheckStore(uint64_t address, uint64_t value) {
   return false;
 }
 
+// Guest views that alias physical memory, which is where everything that
+// gets watched lives.
+static const uint32_t kPhysicalViews[] = {
+    0x00000000, 0xA0000000, 0xC0000000, 0xE0000000,
+};
+
+bool MMIOHandler::ProtectPhysicalPages(uint32_t first_page, uint32_t last_page,
+                                       bool read_only) {
+  size_t offset = size_t(first_page) << kWatchPageShift;
+  size_t length = size_t(last_page - first_page + 1) << kWatchPageShift;
+  bool result = true;
+  for (size_t n = 0; n < poly::countof(kPhysicalViews); n++) {
+    // Views the pages aren't committed in are left alone.
+    result = ProtectRange(mapping_base_ + kPhysicalViews[n] + offset, length,
+                          read_only) && result;
+  }
+  return result;
+}
+
+void MMIOHandler::WatchWrites(uint64_t address, size_t length) {
+  if (!length) {
+    return;
+  }
+  uint64_t lo_address = address % kPhysicalSize;
+  uint64_t hi_address = std::min(lo_address + length, kPhysicalSize) - 1;
+  uint32_t first_page = static_cast<uint32_t>(lo_address >> kWatchPageShift);
+  uint32_t last_page = static_cast<uint32_t>(hi_address >> kWatchPageShift);
+  std::lock_guard<std::mutex> guard(watch_lock_);
+  WatchState state = WATCH_PROTECTED;
+  if (!ProtectPhysicalPages(first_page, last_page, true)) {
+    // Writes to whatever wasn't protected would go unseen, so give up on
+    // watching these and have them always read as written.
+    XELOGW("Unable to write watch %.8llX-%.8llX; treating it as dirty",
+           lo_address, hi_address);
+    ProtectPhysicalPages(first_page, last_page, false);
+    state = WATCH_WRITTEN;
+  }
+  for (uint32_t page = first_page; page <= last_page; ++page) {
+    watch_pages_[page] = state;
+  }
+}
+
+bool MMIOHandler::QueryWrites(uint64_t address, size_t length) {
+  if (!length) {
+    return false;
+  }
+  uint64_t lo_address = address % kPhysicalSize;
+  uint64_t hi_address = std::min(lo_address + length, kPhysicalSize) - 1;
+  uint32_t first_page = static_cast<uint32_t>(lo_address >> kWatchPageShift);
+  uint32_t last_page = static_cast<uint32_t>(hi_address >> kWatchPageShift);
+  std::lock_guard<std::mutex> guard(watch_lock_);
+  for (uint32_t page = first_page; page <= last_page; ++page) {
+    if (watch_pages_[page] == WATCH_WRITTEN) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void MMIOHandler::TriggerWrites(uint64_t address, size_t length) {
+  if (!length) {
+    return;
+  }
+  uint64_t lo_address = address % kPhysicalSize;
+  uint64_t hi_address = std::min(lo_address + length, kPhysicalSize) - 1;
+  uint32_t first_page = static_cast<uint32_t>(lo_address >> kWatchPageShift);
+  uint32_t last_page = static_cast<uint32_t>(hi_address >> kWatchPageShift);
+  std::lock_guard<std::mutex> guard(watch_lock_);
+  // Only unprotect pages we protected, in as few runs as possible.
+  uint32_t run_start = 0;
+  bool in_run = false;
+  for (uint32_t page = first_page; page <= last_page; ++page) {
+    if (watch_pages_[page] == WATCH_PROTECTED) {
+      watch_pages_[page] = WATCH_WRITTEN;
+      if (!in_run) {
+        run_start = page;
+        in_run = true;
+      }
+    } else if (in_run) {
+      ProtectPhysicalPages(run_start, page - 1, false);
+      in_run = false;
+    }
+  }
+  if (in_run) {
+    ProtectPhysicalPages(run_start, last_page, false);
+  }
+}
+
+bool MMIOHandler::HandleWriteWatchFault(uint64_t fault_address) {
+  uint64_t base_address = reinterpret_cast<uint64_t>(mapping_base_);
+  if (fault_address < base_address ||
+      fault_address - base_address > 0xFFFFFFFF) {
+    return false;
+  }
+  uint32_t guest_address = static_cast<uint32_t>(fault_address - base_address);
+  if (guest_address >= 0x20000000 && guest_address < 0xA0000000) {
+    // Not in a physical view.
+    return false;
+  }
+  uint32_t page = static_cast<uint32_t>((guest_address % kPhysicalSize) >>
+                                        kWatchPageShift);
+  std::lock_guard<std::mutex> guard(watch_lock_);
+  switch (watch_pages_[page]) {
+    case WATCH_PROTECTED:
+      watch_pages_[page] = WATCH_WRITTEN;
+      return ProtectPhysicalPages(page, page, false);
+    case WATCH_WRITTEN:
+      // Another thread may have faulted on the page first and made it
+      // writable again already, in which case the write just has to be run
+      // again. If it is still not writable (such as in a view it isn't
+      // committed in) the fault isn't ours.
+      return IsPageWritable(reinterpret_cast<uint8_t*>(fault_address));
+    default:
+      return false;
+  }
+}
+
 bool MMIOHandler::HandleAccessFault(void* thread_state,
-                                    uint64_t fault_address) {
+                                    uint64_t fault_address, bool is_write) {
+  // Write watch faults are resolved by unprotecting the page, after which the
+  // faulting instruction is simply run again.
+  if (is_write && HandleWriteWatchFault(fault_address)) {
+    return true;
+  }
+
   // Access violations are pretty rare, so we can do a linear search here.
   const MMIORange* range = nullptr;
   for (const auto& test_range : mapped_ranges_) {
@@ -95,9 +294,29 @@ bool MMIOHandler::HandleAccessFault(void* thread_state,
     return false;
   }
 
+  auto rip = GetThreadStateRip(thread_state);
+  MovbeAccess movbe;
+  if (DecodeMovbe(reinterpret_cast<const uint8_t*>(rip), &movbe)) {
+    uint64_t* reg_ptr = GetThreadStateRegPtr(thread_state, movbe.reg_index);
+    uint64_t mask = movbe.size == 64 ? ~0ull : (1ull << movbe.size) - 1;
+    if (movbe.is_store) {
+      range->write(range->context, fault_address & 0xFFFFFFFF,
+                   *reg_ptr & mask);
+    } else {
+      uint64_t value =
+          range->read(range->context, fault_address & 0xFFFFFFFF) & mask;
+      if (movbe.size == 16) {
+        // 16-bit loads only write the low word; 32-bit ones zero-extend.
+        value |= *reg_ptr & ~mask;
+      }
+      *reg_ptr = value;
+    }
+    SetThreadStateRip(thread_state, rip + movbe.length);
+    return true;
+  }
+
   // TODO(benvanik): replace with simple check of mov (that's all
   //     we care about).
-  auto rip = GetThreadStateRip(thread_state);
   BE::DISASM disasm = {0};
   disasm.Archi = 64;
   disasm.Options = BE::MasmSyntax + BE::PrefixedNumeral;
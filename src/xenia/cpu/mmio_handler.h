@@ -11,8 +11,13 @@
 #define XENIA_CPU_MMIO_HANDLER_H_
 
 #include <memory>
+#include <mutex>
 #include <vector>
 
+namespace xe {
+class Memory;
+}  // namespace xe
+
 namespace xe {
 namespace cpu {
 
@@ -24,7 +29,9 @@ class MMIOHandler {
  public:
   virtual ~MMIOHandler();
 
-  static std::unique_ptr<MMIOHandler> Install(uint8_t* mapping_base);
+  // memory keeps the page table the handler asks for committed pages.
+  static std::unique_ptr<MMIOHandler> Install(uint8_t* mapping_base,
+                                              Memory* memory);
   static MMIOHandler* global_handler() { return global_handler_; }
 
   bool RegisterRange(uint64_t address, uint64_t mask, uint64_t size,
@@ -34,20 +41,45 @@ class MMIOHandler {
   bool CheckLoad(uint64_t address, uint64_t* out_value);
   bool CheckStore(uint64_t address, uint64_t value);
 
+  // Write watches over physical memory (addresses are taken mod 512MB, as all
+  // of its views alias). Watched pages are write protected, and the first
+  // write to one marks it written and makes it writable again, so the cost is
+  // a single fault per page instead of a check on every guest store. Pages
+  // that can't be protected are reported as written from then on, so callers
+  // resync them every time instead of missing writes.
+  void WatchWrites(uint64_t address, size_t length);
+  // Returns true if any page in the range was written since it was watched.
+  bool QueryWrites(uint64_t address, size_t length);
+  // Marks watched pages written ahead of writes that won't fault, such as the
+  // OS reading a file into guest memory.
+  void TriggerWrites(uint64_t address, size_t length);
+
  public:
-  bool HandleAccessFault(void* thread_state, uint64_t fault_address);
+  // is_write is whether the faulting access was a write (as opposed to a read
+  // or instruction fetch).
+  bool HandleAccessFault(void* thread_state, uint64_t fault_address,
+                         bool is_write);
 
  protected:
-  MMIOHandler(uint8_t* mapping_base) : mapping_base_(mapping_base) {}
+  MMIOHandler(uint8_t* mapping_base);
 
   virtual bool Initialize() = 0;
 
+  // Only the committed pages in the range are changed; others stay
+  // inaccessible. Returns false if any committed page may not have been
+  // changed.
+  virtual bool ProtectRange(uint8_t* host_address, size_t length,
+                            bool read_only) = 0;
+  // Whether the page is committed and writable right now.
+  virtual bool IsPageWritable(uint8_t* host_address) = 0;
+
   virtual uint64_t GetThreadStateRip(void* thread_state_ptr) = 0;
   virtual void SetThreadStateRip(void* thread_state_ptr, uint64_t rip) = 0;
   virtual uint64_t* GetThreadStateRegPtr(void* thread_state_ptr,
                                          int32_t be_reg_index) = 0;
 
   uint8_t* mapping_base_;
+  Memory* memory_;
 
   struct MMIORange {
     uint64_t address;
@@ -59,6 +91,19 @@ class MMIOHandler {
   };
   std::vector<MMIORange> mapped_ranges_;
 
+  enum WatchState : uint8_t {
+    WATCH_NONE = 0,
+    WATCH_PROTECTED,
+    WATCH_WRITTEN,
+  };
+  static const uint32_t kWatchPageShift = 12;
+  static const uint64_t kPhysicalSize = 512 * 1024 * 1024;
+  bool HandleWriteWatchFault(uint64_t fault_address);
+  bool ProtectPhysicalPages(uint32_t first_page, uint32_t last_page,
+                            bool read_only);
+  std::mutex watch_lock_;
+  std::vector<uint8_t> watch_pages_;
+
   static MMIOHandler* global_handler_;
 };
 
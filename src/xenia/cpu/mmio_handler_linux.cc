@@ -0,0 +1,214 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/mmio_handler.h>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+#include <cstring>
+
+#include <poly/poly.h>
+#include <xenia/logging.h>
+#include <xenia/memory.h>
+#include <xenia/xbox.h>
+
+namespace xe {
+namespace cpu {
+
+void SigsegvHandler(int signal_number, siginfo_t* signal_info,
+                    void* signal_context);
+
+class LinuxMMIOHandler : public MMIOHandler {
+ public:
+  LinuxMMIOHandler(uint8_t* mapping_base);
+  ~LinuxMMIOHandler() override;
+
+  // Passes a fault we don't want on to whoever had SIGSEGV before us.
+  void ForwardSignal(int signal_number, siginfo_t* signal_info,
+                     void* signal_context);
+
+ protected:
+  bool Initialize() override;
+
+  bool ProtectRange(uint8_t* host_address, size_t length,
+                    bool read_only) override;
+  bool IsPageWritable(uint8_t* host_address) override;
+
+  uint64_t GetThreadStateRip(void* thread_state_ptr) override;
+  void SetThreadStateRip(void* thread_state_ptr, uint64_t rip) override;
+  uint64_t* GetThreadStateRegPtr(void* thread_state_ptr,
+                                 int32_t be_reg_index) override;
+
+ private:
+  struct sigaction previous_action_;
+  bool installed_;
+};
+
+std::unique_ptr<MMIOHandler> CreateMMIOHandler(uint8_t* mapping_base) {
+  return std::make_unique<LinuxMMIOHandler>(mapping_base);
+}
+
+LinuxMMIOHandler::LinuxMMIOHandler(uint8_t* mapping_base)
+    : MMIOHandler(mapping_base), installed_(false) {
+  std::memset(&previous_action_, 0, sizeof(previous_action_));
+}
+
+bool LinuxMMIOHandler::Initialize() {
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_sigaction = SigsegvHandler;
+  action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGSEGV, &action, &previous_action_)) {
+    XELOGE("Unable to install the SIGSEGV handler");
+    return false;
+  }
+  installed_ = true;
+  return true;
+}
+
+LinuxMMIOHandler::~LinuxMMIOHandler() {
+  if (installed_) {
+    sigaction(SIGSEGV, &previous_action_, nullptr);
+  }
+}
+
+// Handles potential accesses to mmio and watched pages. This runs on the
+// faulting thread, so it has to stay clear of anything that allocates.
+void SigsegvHandler(int signal_number, siginfo_t* signal_info,
+                    void* signal_context) {
+  auto context = reinterpret_cast<ucontext_t*>(signal_context);
+  auto fault_address = reinterpret_cast<uint64_t>(signal_info->si_addr);
+  // Page fault error code; bit 1 is set for writes.
+  bool is_write = (context->uc_mcontext.gregs[REG_ERR] & 0x2) != 0;
+  auto mmio_handler =
+      static_cast<LinuxMMIOHandler*>(MMIOHandler::global_handler());
+  if (mmio_handler &&
+      mmio_handler->HandleAccessFault(context, fault_address, is_write)) {
+    // Handled successfully - RIP has been updated and we can continue.
+    return;
+  }
+  if (mmio_handler) {
+    mmio_handler->ForwardSignal(signal_number, signal_info, signal_context);
+  } else {
+    signal(SIGSEGV, SIG_DFL);
+  }
+}
+
+void LinuxMMIOHandler::ForwardSignal(int signal_number, siginfo_t* signal_info,
+                                     void* signal_context) {
+  if (previous_action_.sa_flags & SA_SIGINFO) {
+    previous_action_.sa_sigaction(signal_number, signal_info, signal_context);
+  } else if (previous_action_.sa_handler != SIG_DFL &&
+             previous_action_.sa_handler != SIG_IGN) {
+    previous_action_.sa_handler(signal_number);
+  } else {
+    // Put the default action back, so that returning runs the faulting
+    // instruction again and kills us with a useful core.
+    XELOGE("MMIO unhandled bad access for %llx, bubbling",
+           reinterpret_cast<uint64_t>(signal_info->si_addr));
+    signal(SIGSEGV, SIG_DFL);
+  }
+}
+
+namespace {
+
+// Whether the host lets the page be touched at all. Pages that aren't
+// committed or are X_PAGE_NOACCESS (such as mapped MMIO ranges) are PROT_NONE
+// and must stay that way.
+bool IsAccessible(uint32_t protect) {
+  return (protect & (X_PAGE_READONLY | X_PAGE_READWRITE | X_PAGE_WRITECOPY |
+                     X_PAGE_EXECUTE | X_PAGE_EXECUTE_READ |
+                     X_PAGE_EXECUTE_READWRITE |
+                     X_PAGE_EXECUTE_WRITECOPY)) != 0;
+}
+
+}  // namespace
+
+bool LinuxMMIOHandler::ProtectRange(uint8_t* host_address, size_t length,
+                                    bool read_only) {
+  // Linux can't be asked for the protection of a range short of parsing
+  // /proc/self/maps, so the page table memory keeps is used instead. Only the
+  // accessible runs within the range are changed.
+  uint64_t address = host_address - mapping_base_;
+  uint64_t end_address = address + length;
+  const uint64_t page_size = 1ull << kWatchPageShift;
+  int host_protect = read_only ? PROT_READ : (PROT_READ | PROT_WRITE);
+  bool result = true;
+  uint64_t run_address = address;
+  bool in_run = false;
+  for (; address < end_address; address += page_size) {
+    bool is_accessible = IsAccessible(memory_->QueryProtect(address));
+    if (is_accessible && !in_run) {
+      run_address = address;
+      in_run = true;
+    } else if (!is_accessible && in_run) {
+      result = !mprotect(mapping_base_ + run_address, address - run_address,
+                         host_protect) &&
+               result;
+      in_run = false;
+    }
+  }
+  if (in_run) {
+    result = !mprotect(mapping_base_ + run_address, end_address - run_address,
+                       host_protect) &&
+             result;
+  }
+  return result;
+}
+
+bool LinuxMMIOHandler::IsPageWritable(uint8_t* host_address) {
+  // Called with the watch lock held, after any write watch on the page was
+  // already lifted, so it is writable if the host lets it be accessed.
+  // This runs in the SIGSEGV handler; the page table lock is never held
+  // around guest memory accesses, so it can't be held by the faulting thread.
+  return IsAccessible(memory_->QueryProtect(host_address - mapping_base_));
+}
+
+uint64_t LinuxMMIOHandler::GetThreadStateRip(void* thread_state_ptr) {
+  auto context = reinterpret_cast<ucontext_t*>(thread_state_ptr);
+  return context->uc_mcontext.gregs[REG_RIP];
+}
+
+void LinuxMMIOHandler::SetThreadStateRip(void* thread_state_ptr,
+                                         uint64_t rip) {
+  auto context = reinterpret_cast<ucontext_t*>(thread_state_ptr);
+  context->uc_mcontext.gregs[REG_RIP] = rip;
+}
+
+uint64_t* LinuxMMIOHandler::GetThreadStateRegPtr(void* thread_state_ptr,
+                                                 int32_t be_reg_index) {
+  // Map from BeaEngine register order to mcontext_t gregs order.
+  static const uint32_t mapping[] = {
+      REG_RAX,  // REG0
+      REG_RCX,  // REG1
+      REG_RDX,  // REG2
+      REG_RBX,  // REG3
+      REG_RSP,  // REG4
+      REG_RBP,  // REG5
+      REG_RSI,  // REG6
+      REG_RDI,  // REG7
+      REG_R8,   // REG8
+      REG_R9,   // REG9
+      REG_R10,  // REG10
+      REG_R11,  // REG11
+      REG_R12,  // REG12
+      REG_R13,  // REG13
+      REG_R14,  // REG14
+      REG_R15,  // REG15
+  };
+  auto context = reinterpret_cast<ucontext_t*>(thread_state_ptr);
+  return reinterpret_cast<uint64_t*>(
+      &context->uc_mcontext.gregs[mapping[be_reg_index]]);
+}
+
+}  // namespace cpu
+}  // namespace xe
@@ -10,8 +10,11 @@
 #include <xenia/cpu/mmio_handler.h>
 
 #include <mach/mach.h>
+#include <mach/mach_vm.h>
 #include <signal.h>
+#include <sys/mman.h>
 
+#include <algorithm>
 #include <thread>
 
 #include <poly/poly.h>
@@ -40,6 +43,10 @@ class MachMMIOHandler : public MMIOHandler {
  protected:
   bool Initialize() override;
 
+  bool ProtectRange(uint8_t* host_address, size_t length,
+                    bool read_only) override;
+  bool IsPageWritable(uint8_t* host_address) override;
+
   uint64_t GetThreadStateRip(void* thread_state_ptr) override;
   void SetThreadStateRip(void* thread_state_ptr, uint64_t rip) override;
   uint64_t* GetThreadStateRegPtr(void* thread_state_ptr,
@@ -161,9 +168,12 @@ kern_return_t CatchExceptionRaise(mach_port_t thread) {
   }
 
   auto fault_address = exc_state.__faultvaddr;
+  // Page fault error code; bit 1 is set for writes.
+  bool is_write = (exc_state.__err & 0x2) != 0;
   auto mmio_handler =
       static_cast<MachMMIOHandler*>(MMIOHandler::global_handler());
-  bool handled = mmio_handler->HandleAccessFault(&thread_state, fault_address);
+  bool handled =
+      mmio_handler->HandleAccessFault(&thread_state, fault_address, is_write);
   if (!handled) {
     // Unhandled - raise to the system.
     XELOGE("MMIO unhandled bad access for %llx, bubbling", fault_address);
@@ -189,6 +199,56 @@ kern_return_t CatchExceptionRaise(mach_port_t thread) {
   return KERN_SUCCESS;
 }
 
+bool MachMMIOHandler::ProtectRange(uint8_t* host_address, size_t length,
+                                   bool read_only) {
+  // Pages that aren't committed are PROT_NONE and must stay that way, so only
+  // the accessible regions within the range are changed.
+  mach_vm_address_t address = reinterpret_cast<mach_vm_address_t>(host_address);
+  mach_vm_address_t end_address = address + length;
+  while (address < end_address) {
+    mach_vm_address_t region_address = address;
+    mach_vm_size_t region_size = 0;
+    vm_region_basic_info_data_64_t info;
+    mach_msg_type_number_t info_count = VM_REGION_BASIC_INFO_COUNT_64;
+    mach_port_t object_name;
+    if (mach_vm_region(mach_task_self(), &region_address, &region_size,
+                       VM_REGION_BASIC_INFO_64,
+                       reinterpret_cast<vm_region_info_t>(&info), &info_count,
+                       &object_name) != KERN_SUCCESS ||
+        region_address >= end_address) {
+      break;
+    }
+    mach_vm_address_t run_address = std::max(address, region_address);
+    mach_vm_address_t run_end_address =
+        std::min(end_address, region_address + region_size);
+    if (info.protection != VM_PROT_NONE &&
+        mprotect(reinterpret_cast<void*>(run_address),
+                 run_end_address - run_address,
+                 read_only ? PROT_READ : (PROT_READ | PROT_WRITE))) {
+      return false;
+    }
+    address = run_end_address;
+  }
+  return true;
+}
+
+bool MachMMIOHandler::IsPageWritable(uint8_t* host_address) {
+  mach_vm_address_t address = reinterpret_cast<mach_vm_address_t>(host_address);
+  mach_vm_address_t region_address = address;
+  mach_vm_size_t region_size = 0;
+  vm_region_basic_info_data_64_t info;
+  mach_msg_type_number_t info_count = VM_REGION_BASIC_INFO_COUNT_64;
+  mach_port_t object_name;
+  if (mach_vm_region(mach_task_self(), &region_address, &region_size,
+                     VM_REGION_BASIC_INFO_64,
+                     reinterpret_cast<vm_region_info_t>(&info), &info_count,
+                     &object_name) != KERN_SUCCESS) {
+    return false;
+  }
+  // The region found may start after the address if it isn't mapped.
+  return region_address <= address && (info.protection & VM_PROT_WRITE) != 0;
+}
+
 uint64_t MachMMIOHandler::GetThreadStateRip(void* thread_state_ptr) {
   auto thread_state = reinterpret_cast<x86_thread_state64_t*>(thread_state_ptr);
   return thread_state->__rip;
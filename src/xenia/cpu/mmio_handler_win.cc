@@ -11,6 +11,8 @@
 
 #include <Windows.h>
 
+#include <algorithm>
+
 namespace xe {
 namespace cpu {
 
@@ -24,6 +26,10 @@ class WinMMIOHandler : public MMIOHandler {
  protected:
   bool Initialize() override;
 
+  bool ProtectRange(uint8_t* host_address, size_t length,
+                    bool read_only) override;
+  bool IsPageWritable(uint8_t* host_address) override;
+
   uint64_t GetThreadStateRip(void* thread_state_ptr) override;
   void SetThreadStateRip(void* thread_state_ptr, uint64_t rip) override;
   uint64_t* GetThreadStateRegPtr(void* thread_state_ptr,
@@ -59,9 +65,11 @@ LONG CALLBACK MMIOExceptionHandler(PEXCEPTION_POINTERS ex_info) {
   // http://msdn.microsoft.com/en-us/library/aa363082(v=vs.85).aspx
   auto code = ex_info->ExceptionRecord->ExceptionCode;
   if (code == STATUS_ACCESS_VIOLATION) {
+    // 0 is a read, 1 a write and 8 an instruction fetch.
+    bool is_write = ex_info->ExceptionRecord->ExceptionInformation[0] == 1;
     auto fault_address = ex_info->ExceptionRecord->ExceptionInformation[1];
-    if (MMIOHandler::global_handler()->HandleAccessFault(ex_info->ContextRecord,
-                                                         fault_address)) {
+    if (MMIOHandler::global_handler()->HandleAccessFault(
+            ex_info->ContextRecord, fault_address, is_write)) {
       // Handled successfully - RIP has been updated and we can continue.
       return EXCEPTION_CONTINUE_EXECUTION;
     } else {
@@ -73,6 +81,41 @@ LONG CALLBACK MMIOExceptionHandler(PEXCEPTION_POINTERS ex_info) {
   return EXCEPTION_CONTINUE_SEARCH;
 }
 
+bool WinMMIOHandler::ProtectRange(uint8_t* host_address, size_t length,
+                                  bool read_only) {
+  // VirtualProtect fails on the whole range if any of it isn't committed, so
+  // committed runs are done one at a time.
+  uint8_t* end_address = host_address + length;
+  while (host_address < end_address) {
+    MEMORY_BASIC_INFORMATION info;
+    if (!VirtualQuery(host_address, &info, sizeof(info))) {
+      return false;
+    }
+    uint8_t* region_end_address =
+        static_cast<uint8_t*>(info.BaseAddress) + info.RegionSize;
+    uint8_t* run_end_address = std::min(end_address, region_end_address);
+    if (info.State == MEM_COMMIT) {
+      DWORD old_protect;
+      if (!VirtualProtect(host_address, run_end_address - host_address,
+                          read_only ? PAGE_READONLY : PAGE_READWRITE,
+                          &old_protect)) {
+        return false;
+      }
+    }
+    host_address = run_end_address;
+  }
+  return true;
+}
+
+bool WinMMIOHandler::IsPageWritable(uint8_t* host_address) {
+  MEMORY_BASIC_INFORMATION info;
+  if (!VirtualQuery(host_address, &info, sizeof(info))) {
+    return false;
+  }
+  return info.State == MEM_COMMIT &&
+         (info.Protect & (PAGE_READWRITE | PAGE_EXECUTE_READWRITE)) != 0;
+}
+
 uint64_t WinMMIOHandler::GetThreadStateRip(void* thread_state_ptr) {
   auto context = reinterpret_cast<LPCONTEXT>(thread_state_ptr);
   return context->Rip;
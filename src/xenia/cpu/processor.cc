@@ -108,14 +108,6 @@ int Processor::Setup() {
 int Processor::Execute(XenonThreadState* thread_state, uint64_t address) {
   SCOPE_profile_cpu_f("cpu");
 
-  // Attempt to get the function.
-  Function* fn;
-  if (runtime_->ResolveFunction(address, &fn)) {
-    // Symbol not found in any module.
-    XELOGCPU("Execute(%.8X): failed to find function", address);
-    return 1;
-  }
-
   PPCContext* context = thread_state->context();
 
   // This could be set to anything to give us a unique identifier to track
@@ -126,7 +118,11 @@ int Processor::Execute(XenonThreadState* thread_state, uint64_t address) {
   context->lr = lr;
 
   // Execute the function.
-  fn->Call(thread_state, lr);
+  if (runtime_->CallFunction(thread_state, address, lr)) {
+    // Symbol not found in any module.
+    XELOGCPU("Execute(%.8X): failed to find function", address);
+    return 1;
+  }
   return 0;
 }
 
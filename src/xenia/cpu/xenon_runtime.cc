@@ -9,8 +9,15 @@
 
 #include <xenia/cpu/xenon_runtime.h>
 
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+
 #include <alloy/frontend/ppc/ppc_frontend.h>
+#include <xenia/cpu/cpu-private.h>
 #include <xenia/cpu/xenon_thread_state.h>
+#include <xenia/cpu/xex_module.h>
 
 using namespace xe;
 using namespace xe::cpu;
@@ -20,7 +27,12 @@ XenonRuntime::XenonRuntime(Memory* memory, ExportResolver* export_resolver,
     : Runtime(memory, debug_info_flags, trace_flags),
       export_resolver_(export_resolver) {}
 
-XenonRuntime::~XenonRuntime() = default;
+XenonRuntime::~XenonRuntime() {
+  EndPrecompile();
+  if (FLAGS_precompile_profile.size()) {
+    WritePrecompileProfile();
+  }
+}
 
 int XenonRuntime::Initialize(std::unique_ptr<alloy::backend::Backend> backend) {
   auto frontend = std::make_unique<alloy::frontend::ppc::PPCFrontend>(this);
@@ -33,3 +45,65 @@ int XenonRuntime::Initialize(std::unique_ptr<alloy::backend::Backend> backend) {
 
   return result;
 }
+
+namespace {
+std::vector<uint64_t> ReadPrecompileProfile(const std::string& path) {
+  std::vector<uint64_t> addresses;
+  std::ifstream file(path);
+  uint64_t address;
+  while (file >> std::hex >> address) {
+    addresses.push_back(address);
+  }
+  return addresses;
+}
+}  // namespace
+
+int XenonRuntime::PrecompileModule(XexModule* module) {
+  if (!FLAGS_precompile) {
+    return 0;
+  }
+
+  std::vector<uint64_t> addresses = module->function_addresses();
+  if (FLAGS_precompile_profile.size()) {
+    // Profiled functions go first, in profile order. Everything else follows
+    // in address order.
+    auto profile = ReadPrecompileProfile(FLAGS_precompile_profile);
+    std::unordered_map<uint64_t, size_t> rank;
+    for (size_t n = 0; n < profile.size(); ++n) {
+      rank.emplace(profile[n], n);
+    }
+    std::stable_sort(addresses.begin(), addresses.end(),
+                     [&rank](uint64_t a, uint64_t b) {
+                       auto it_a = rank.find(a);
+                       auto it_b = rank.find(b);
+                       size_t rank_a =
+                           it_a != rank.end() ? it_a->second : SIZE_MAX;
+                       size_t rank_b =
+                           it_b != rank.end() ? it_b->second : SIZE_MAX;
+                       return rank_a < rank_b;
+                     });
+  }
+
+  uint32_t thread_count = FLAGS_precompile_threads;
+  if (!thread_count) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency() / 2);
+  }
+  return BeginPrecompile(std::move(addresses), thread_count);
+}
+
+void XenonRuntime::WritePrecompileProfile() {
+  // Functions guest threads had to translate themselves are the ones that
+  // hitched, so move them to the front for next time.
+  auto addresses = demanded_addresses();
+  std::unordered_set<uint64_t> seen(addresses.begin(), addresses.end());
+  for (uint64_t address : ReadPrecompileProfile(FLAGS_precompile_profile)) {
+    if (seen.insert(address).second) {
+      addresses.push_back(address);
+    }
+  }
+
+  std::ofstream file(FLAGS_precompile_profile, std::ios::trunc);
+  for (uint64_t address : addresses) {
+    file << std::hex << std::uppercase << address << "\n";
+  }
+}
@@ -20,6 +20,7 @@ namespace xe {
 namespace cpu {
 
 class XenonThreadState;
+class XexModule;
 
 class XenonRuntime : public alloy::runtime::Runtime {
  public:
@@ -31,6 +32,12 @@ class XenonRuntime : public alloy::runtime::Runtime {
 
   virtual int Initialize(std::unique_ptr<alloy::backend::Backend> backend = 0);
 
+  // Starts background translation of the module if --precompile is set.
+  int PrecompileModule(XexModule* module);
+
+ private:
+  void WritePrecompileProfile();
+
  private:
   ExportResolver* export_resolver_;
 };
@@ -9,6 +9,7 @@
 
 #include <xenia/cpu/xenon_thread_state.h>
 
+#include <alloy/frontend/ppc/ppc_frontend.h>
 #include <xdb/protocol.h>
 #include <xenia/cpu/xenon_runtime.h>
 
@@ -32,8 +33,11 @@ XenonThreadState::XenonThreadState(XenonRuntime* runtime, uint32_t thread_id,
   assert_true(((uint64_t)context_ & 0xF) == 0);
 
   // Stash pointers to common structures that callbacks may need.
-  context_->reserve_address = memory_->reserve_address();
-  context_->reserve_value = memory_->reserve_value();
+  context_->reserve_address = UINT64_MAX;
+  context_->global_lock_owner =
+      static_cast<PPCFrontend*>(runtime->frontend())
+          ->builtins()
+          ->global_lock.owner_ptr();
   context_->membase = memory_->membase();
   context_->runtime = runtime;
   context_->thread_state = this;
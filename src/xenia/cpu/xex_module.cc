@@ -12,6 +12,7 @@
 #include <algorithm>
 
 #include <poly/math.h>
+#include <xenia/core/hash.h>
 #include <xenia/cpu/cpu-private.h>
 #include <xenia/cpu/xenon_runtime.h>
 #include <xenia/export_resolver.h>
@@ -31,7 +32,7 @@ void UndefinedImport(PPCContext* ppc_state, void* arg0, void* arg1) {
 XexModule::XexModule(
     XenonRuntime* runtime) :
     runtime_(runtime),
-    xex_(0),
+    xex_(0), content_hash_(0),
     base_address_(0), low_address_(0), high_address_(0),
     Module(runtime) {
 }
@@ -46,6 +47,12 @@ int XexModule::Load(const std::string& name, const std::string& path, xe_xex2_re
   xex_ = xe_xex2_retain(xex);
   const xe_xex2_header_t* header = xe_xex2_get_header(xex);
 
+  // The header digest covers the page hash table, so it changes along with
+  // any of the image contents.
+  const xe_xex2_loader_info_t* ldr = &header->loader_info;
+  content_hash_ = xe::hash64(ldr->header_digest, sizeof(ldr->header_digest),
+                             ldr->image_size);
+
   // Scan and find the low/high addresses.
   // All code sections are continuous, so this should be easy.
   low_address_ = UINT_MAX;
@@ -79,6 +86,14 @@ int XexModule::Load(const std::string& name, const std::string& path, xe_xex2_re
     return result;
   }
 
+  // Collect function entry points so they can be precompiled.
+  if (FLAGS_precompile) {
+    result = FindFunctions();
+    if (result) {
+      return result;
+    }
+  }
+
   // Setup debug info.
   name_ = std::string(name);
   path_ = std::string(path);
@@ -210,6 +225,45 @@ bool XexModule::ContainsAddress(uint64_t address) {
   return address >= low_address_ && address < high_address_;
 }
 
+int XexModule::FindFunctions() {
+  // There's no function table in the XEX, so the best we can do cheaply is
+  // the entry point plus every target of a bl in the code sections. This
+  // misses functions only ever called indirectly, but those will still be
+  // translated on demand.
+  const xe_xex2_header_t* header = xe_xex2_get_header(xex_);
+  std::vector<uint64_t> addresses;
+  addresses.push_back(header->exe_entry_point);
+  const uint8_t* p = memory_->membase();
+  for (size_t n = 0, i = 0; n < header->section_count; n++) {
+    const xe_xex2_section_t* section = &header->sections[n];
+    const size_t start_address = header->exe_address + (i * section->page_size);
+    const size_t end_address =
+        start_address + (section->info.page_count * section->page_size);
+    if (section->info.type == XEX_SECTION_CODE) {
+      for (size_t address = start_address; address < end_address;
+           address += 4) {
+        uint32_t code = poly::load_and_swap<uint32_t>(p + address);
+        // bl: opcode 18, AA=0, LK=1.
+        if ((code & 0xFC000003) != 0x48000001) {
+          continue;
+        }
+        int32_t offset = static_cast<int32_t>(code << 6) >> 6;
+        uint64_t target = static_cast<uint32_t>(address + (offset & ~0x3));
+        if (target >= low_address_ && target < high_address_) {
+          addresses.push_back(target);
+        }
+      }
+    }
+    i += section->info.page_count;
+  }
+
+  std::sort(addresses.begin(), addresses.end());
+  addresses.erase(std::unique(addresses.begin(), addresses.end()),
+                  addresses.end());
+  function_addresses_ = std::move(addresses);
+  return 0;
+}
+
 int XexModule::FindSaveRest() {
   // Special stack save/restore functions.
   // http://research.microsoft.com/en-us/um/redmond/projects/invisible/src/crt/md/ppc/xxx.s.htm
@@ -480,12 +534,14 @@ int XexModule::FindSaveRest() {
     // 64-127 save
     // 14-31 rest
     // 64-127 rest
+    // Each entry point falls through to the blr that ends its group.
     uint64_t address = vmx_start;
     for (int n = 14; n <= 31; n++) {
       snprintf(name, poly::countof(name), "__savevmx_%d", n);
       FunctionInfo* symbol_info;
       DeclareFunction(address, &symbol_info);
       symbol_info->set_name(name);
+      symbol_info->set_end_address(vmx_start + 36 * 4);
       // TODO(benvanik): set type  fn->type = FunctionSymbol::User;
       // TODO(benvanik): set flags fn->flags |= FunctionSymbol::kFlagSaveVmx;
       symbol_info->set_behavior(FunctionInfo::BEHAVIOR_PROLOG);
@@ -498,18 +554,22 @@ int XexModule::FindSaveRest() {
       FunctionInfo* symbol_info;
       DeclareFunction(address, &symbol_info);
       symbol_info->set_name(name);
+      symbol_info->set_end_address(vmx_start + 165 * 4);
       // TODO(benvanik): set type  fn->type = FunctionSymbol::User;
       // TODO(benvanik): set flags fn->flags |= FunctionSymbol::kFlagSaveVmx;
       symbol_info->set_behavior(FunctionInfo::BEHAVIOR_PROLOG);
       symbol_info->set_status(SymbolInfo::STATUS_DECLARED);
       address += 2 * 4;
     }
-    address = vmx_start + (18 * 2 * 4) + (1 * 4) + (64 * 2 * 4) + (1 * 4);
+    uint64_t rest_start =
+        vmx_start + (18 * 2 * 4) + (1 * 4) + (64 * 2 * 4) + (1 * 4);
+    address = rest_start;
     for (int n = 14; n <= 31; n++) {
       snprintf(name, poly::countof(name), "__restvmx_%d", n);
       FunctionInfo* symbol_info;
       DeclareFunction(address, &symbol_info);
       symbol_info->set_name(name);
+      symbol_info->set_end_address(rest_start + 36 * 4);
       // TODO(benvanik): set type  fn->type = FunctionSymbol::User;
       // TODO(benvanik): set flags fn->flags |= FunctionSymbol::kFlagRestVmx;
       symbol_info->set_behavior(FunctionInfo::BEHAVIOR_EPILOG);
@@ -522,6 +582,7 @@ int XexModule::FindSaveRest() {
       FunctionInfo* symbol_info;
       DeclareFunction(address, &symbol_info);
       symbol_info->set_name(name);
+      symbol_info->set_end_address(rest_start + 165 * 4);
       // TODO(benvanik): set type  fn->type = FunctionSymbol::User;
       // TODO(benvanik): set flags fn->flags |= FunctionSymbol::kFlagRestVmx;
       symbol_info->set_behavior(FunctionInfo::BEHAVIOR_EPILOG);
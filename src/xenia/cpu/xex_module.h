@@ -11,6 +11,7 @@
 #define XENIA_CPU_XEX_MODULE_H_
 
 #include <string>
+#include <vector>
 
 #include <alloy/runtime/module.h>
 #include <xenia/core.h>
@@ -33,6 +34,12 @@ public:
   int Load(const std::string& name, const std::string& path, xe_xex2_ref xex);
 
   const std::string& name() const override { return name_; }
+  uint64_t content_hash() const override { return content_hash_; }
+
+  // Function entry points found by scanning the code sections.
+  const std::vector<uint64_t>& function_addresses() const {
+    return function_addresses_;
+  }
 
   bool ContainsAddress(uint64_t address) override;
 
@@ -40,16 +47,20 @@ private:
   int SetupImports(xe_xex2_ref xex);
   int SetupLibraryImports(const xe_xex2_import_library_t* library);
   int FindSaveRest();
+  int FindFunctions();
 
 private:
   XenonRuntime* runtime_;
   std::string   name_;
   std::string   path_;
   xe_xex2_ref   xex_;
+  uint64_t      content_hash_;
 
   uint64_t      base_address_;
   uint64_t      low_address_;
   uint64_t      high_address_;
+
+  std::vector<uint64_t> function_addresses_;
 };
 
 
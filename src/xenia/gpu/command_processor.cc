@@ -11,6 +11,7 @@
 
 #include <algorithm>
 
+#include <xenia/cpu/processor.h>
 #include <xenia/gpu/gpu-private.h>
 #include <xenia/gpu/graphics_driver.h>
 #include <xenia/gpu/graphics_system.h>
@@ -310,6 +311,7 @@ uint32_t CommandProcessor::ExecutePacket(PacketArgs& args) {
                   packet_ptr, packet);
         LOG_DATA(count);
         ADVANCE_PTR(count);
+        graphics_system_->processor()->runtime()->MarkFirstFrame();
         graphics_system_->Swap();
         break;
 
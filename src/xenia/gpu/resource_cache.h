@@ -88,6 +88,8 @@ protected:
       }
     }
     auto resource = (this->*factory)(memory_range, info);
+    // New resources start dirty, so watch for writes after their first sync.
+    memory_->WatchWrites(lo_address, memory_range.length);
     paged_resources_.insert({ key, resource });
     resources_.push_back(resource);
     return resource;
@@ -118,6 +120,8 @@ private:
   std::unordered_map<uint64_t, HashedResource*> hashed_resources_;
   std::unordered_map<uint64_t, StaticResource*> static_resources_;
   std::multimap<uint64_t, PagedResource*> paged_resources_;
+  // Scratch list for SyncRange.
+  std::vector<PagedResource*> written_resources_;
 };
 
 
@@ -230,6 +230,7 @@ X_STATUS XThread::Exit(int exit_code) {
   // TODO(benvanik); dispatch events? waiters? etc?
   event_->Set(0, false);
   RundownAPCs();
+  memory()->ReleaseHeapCaches();
 
   // NOTE: unless PlatformExit fails, expect it to never return!
   X_STATUS return_code = PlatformExit(exit_code);
@@ -100,9 +100,14 @@ X_STATUS XUserModule::LoadFromMemory(const void* addr, const size_t length) {
   if (xex_module->Load(name_, path_, xex_)) {
     return X_STATUS_UNSUCCESSFUL;
   }
+  XexModule* xex_module_ptr = xex_module.get();
   if (runtime->AddModule(std::move(xex_module))) {
     return X_STATUS_UNSUCCESSFUL;
   }
+  if (runtime->PrecompileModule(xex_module_ptr)) {
+    // Everything still gets translated on demand.
+    XELOGW("Unable to precompile module %s", name_.c_str());
+  }
 
   OnLoad();
 
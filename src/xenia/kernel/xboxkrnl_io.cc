@@ -263,7 +263,9 @@ SHIM_CALL NtReadFile_shim(PPCContext* ppc_state, KernelState* state) {
         byte_offset = -1;
       }
 
-      // Read now.
+      // Read now. The OS fails the read rather than faulting if it hits a
+      // write watched page, so they have to be released first.
+      state->memory()->TriggerWriteWatches(buffer, buffer_length);
       size_t bytes_read = 0;
       result = file->Read(SHIM_MEM_ADDR(buffer), buffer_length, byte_offset,
                           &bytes_read);
@@ -10,11 +10,15 @@
 #include <xenia/memory.h>
 
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
 #include <mutex>
 
 #include <gflags/gflags.h>
 #include <poly/math.h>
 #include <xenia/cpu/mmio_handler.h>
+#include <xenia/slab_heap.h>
 
 using namespace xe;
 
@@ -22,7 +26,9 @@ using namespace xe;
 #include <xenia/xbox.h>
 
 #if !XE_PLATFORM_WIN32
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <unistd.h>
 #endif  // WIN32
 
 #define MSPACES 1
@@ -32,6 +38,8 @@ using namespace xe;
 #define HAVE_MREMAP 0
 #define malloc_getpagesize 4096
 #define DEFAULT_GRANULARITY 64 * 1024
+// The heaps are single fixed segments dlmalloc can't give back, so
+// MemoryHeap::Free releases the pages of large frees itself.
 #define DEFAULT_TRIM_THRESHOLD MAX_SIZE_T
 #define MALLOC_ALIGNMENT 32
 #define MALLOC_INSPECT_ALL 1
@@ -46,6 +54,13 @@ DEFINE_uint64(
     "Allocate the given number of guard pages around all heap chunks.");
 DEFINE_bool(scribble_heap, false,
             "Scribble 0xCD into all allocated heap memory.");
+DEFINE_bool(heap_use_mspace, true,
+            "Use a single locked dlmalloc mspace for the guest heaps. Pass "
+            "false to try the experimental size class heap with per-thread "
+            "caches.");
+DEFINE_bool(memory_large_pages, false,
+            "Back guest memory with large pages where the host allows it, to "
+            "cut down on TLB misses.");
 
 /**
  * Memory map:
@@ -95,6 +110,7 @@ class xe::MemoryHeap {
                  uint32_t alignment);
   uint64_t Free(uint64_t address, size_t size);
   size_t QuerySize(uint64_t base_address);
+  void ReleaseThreadCache();
 
   void Dump();
 
@@ -102,6 +118,11 @@ class xe::MemoryHeap {
   static uint32_t next_heap_id_;
   static void DumpHandler(void* start, void* end, size_t used_bytes,
                           void* context);
+  static bool CommitPages(void* context, uint8_t* p, size_t length,
+                          bool commit);
+  // Both require lock_.
+  void MarkDirty(uint8_t* start, uint8_t* end);
+  void ReleaseFreedPages(uint8_t* p, size_t size);
 
  private:
   Memory* memory_;
@@ -110,12 +131,53 @@ class xe::MemoryHeap {
   std::mutex lock_;
   size_t size_;
   uint8_t* ptr_;
+  // Exactly one of these is used, based on --heap_use_mspace.
   mspace space_;
+  SlabHeap* slab_heap_;
+  // Pages of the mspace that may hold something other than zero: anything
+  // handed out or written by dlmalloc since it was committed or released.
+  std::vector<bool> dirty_pages_;
 };
 uint32_t MemoryHeap::next_heap_id_ = 1;
 
+namespace {
+
+const size_t kGuestPageSize = 4096;
+const uint32_t kGuestPageCount = 0x100000000ull / kGuestPageSize;
+
+// Widens a guest range out to whole pages, as the host would.
+void AlignToPages(uint64_t* address, size_t* length) {
+  uint64_t end = poly::align(*address + *length, uint64_t(kGuestPageSize));
+  *address &= ~uint64_t(kGuestPageSize - 1);
+  *length = static_cast<size_t>(end - *address);
+}
+
+#if !XE_PLATFORM_WIN32
+int ToHostProtect(uint32_t protect) {
+  // PAGE_GUARD is treated as plain access and NOCACHE/WRITECOMBINE are
+  // dropped, as the host has no equivalent for them.
+  if (protect & (X_PAGE_READWRITE | X_PAGE_WRITECOPY |
+                 X_PAGE_EXECUTE_READWRITE | X_PAGE_EXECUTE_WRITECOPY)) {
+    return PROT_READ | PROT_WRITE;
+  } else if (protect &
+             (X_PAGE_READONLY | X_PAGE_EXECUTE | X_PAGE_EXECUTE_READ)) {
+    return PROT_READ;
+  } else {
+    return PROT_NONE;
+  }
+}
+#endif  // !XE_PLATFORM_WIN32
+
+}  // namespace
+
 Memory::Memory()
-    : alloy::Memory(), mapping_(0), mapping_base_(0), page_table_(0) {
+    : alloy::Memory(),
+#if XE_PLATFORM_WIN32
+      mapping_(0),
+#else
+      mapping_(-1),
+#endif  // XE_PLATFORM_WIN32
+      mapping_base_(0) {
   virtual_heap_ = new MemoryHeap(this, false);
   physical_heap_ = new MemoryHeap(this, true);
 }
@@ -127,19 +189,28 @@ Memory::~Memory() {
 
   if (mapping_base_) {
     // GPU writeback.
-    VirtualFree(Translate(0xC0000000), 0x00100000, MEM_DECOMMIT);
+    DecommitRange(0xC0000000, 0x00100000);
   }
 
   delete physical_heap_;
   delete virtual_heap_;
 
   // Unmap all views and close mapping.
+#if XE_PLATFORM_WIN32
   if (mapping_) {
     UnmapViews();
     CloseHandle(mapping_);
     mapping_base_ = 0;
     mapping_ = 0;
   }
+#else
+  if (mapping_ != -1) {
+    UnmapViews();
+    close(mapping_);
+    mapping_base_ = 0;
+    mapping_ = -1;
+  }
+#endif  // XE_PLATFORM_WIN32
 }
 
 int Memory::Initialize() {
@@ -155,17 +226,34 @@ int Memory::Initialize() {
       CreateFileMapping(INVALID_HANDLE_VALUE, NULL,
                         PAGE_READWRITE | SEC_RESERVE, 1, 0,  // entire 4gb space
                         NULL);
-#else
-  char mapping_path[] = "/xenia/mapping/XXXXXX";
-  mktemp(mapping_path);
-  mapping_ = shm_open(mapping_path, O_CREAT, 0);
-  ftruncate(mapping_, 0x100000000);
-#endif  // XE_PLATFORM_WIN32
   if (!mapping_) {
     XELOGE("Unable to reserve the 4gb guest address space.");
     assert_not_null(mapping_);
     return 1;
   }
+#else
+  // An anonymous file that's sparse until pages are touched, so sizing it to
+  // the whole space costs nothing.
+#if defined(__linux__)
+  mapping_ = memfd_create("xenia-memory", MFD_CLOEXEC);
+#else
+  // Names are limited to 31 characters on OS X.
+  char name[32];
+  std::snprintf(name, sizeof(name), "/xenia-%d-%p", getpid(), this);
+  mapping_ = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (mapping_ != -1) {
+    shm_unlink(name);
+  }
+#endif  // __linux__
+  if (mapping_ == -1 || ftruncate(mapping_, 0x100000000ull)) {
+    XELOGE("Unable to reserve the 4gb guest address space.");
+    assert_always();
+    return 1;
+  }
+#endif  // XE_PLATFORM_WIN32
+
+  // Everything starts out free.
+  page_table_.resize(kGuestPageCount, PageEntry());
 
   // Attempt to create our views. This may fail at the first address
   // we pick, so try a few times.
@@ -184,6 +272,10 @@ int Memory::Initialize() {
   }
   membase_ = mapping_base_;
 
+  if (FLAGS_memory_large_pages && !EnableLargePages()) {
+    XELOGW("Large pages are unavailable; guest memory will use 4KB pages.");
+  }
+
   // Prepare heaps.
   virtual_heap_->Initialize(XENON_MEMORY_VIRTUAL_HEAP_LOW,
                             XENON_MEMORY_VIRTUAL_HEAP_HIGH);
@@ -192,22 +284,16 @@ int Memory::Initialize() {
 
   // GPU writeback.
   // 0xC... is physical, 0x7F... is virtual. We may need to overlay these.
-  VirtualAlloc(Translate(0xC0000000), 0x00100000, MEM_COMMIT, PAGE_READWRITE);
+  CommitRange(0xC0000000, 0x00100000, X_PAGE_READWRITE);
 
   // Add handlers for MMIO.
-  mmio_handler_ = cpu::MMIOHandler::Install(mapping_base_);
+  mmio_handler_ = cpu::MMIOHandler::Install(mapping_base_, this);
   if (!mmio_handler_) {
     XELOGE("Unable to install MMIO handlers");
     assert_always();
     return 1;
   }
 
-  // Allocate dirty page table.
-  // This must live within our low heap. Ideally we'd hardcode the address but
-  // this is more flexible.
-  page_table_ = physical_heap_->Alloc(0, (512 * 1024 * 1024) / (16 * 1024),
-                                      X_MEM_COMMIT, 16 * 1024);
-
   return 0;
 }
 
@@ -224,6 +310,20 @@ const static struct {
       0xC0000000, 0xDFFFFFFF, 0x00000000,  //          - physical 16mb pages
       0xE0000000, 0xFFFFFFFF, 0x00000000,  //          - physical 4k pages
 };
+#if defined(__linux__)
+// Offset in the backing file of a guest address.
+uint64_t ToFileOffset(uint64_t address) {
+  for (size_t n = 0; n < poly::countof(map_info); n++) {
+    if (address >= map_info[n].virtual_address_start &&
+        address <= map_info[n].virtual_address_end) {
+      return map_info[n].target_address + address -
+             map_info[n].virtual_address_start;
+    }
+  }
+  return 0;
+}
+#endif  // __linux__
+
 int Memory::MapViews(uint8_t* mapping_base) {
   assert_true(poly::countof(map_info) == poly::countof(views_.all_views));
   for (size_t n = 0; n < poly::countof(map_info); n++) {
@@ -234,11 +334,19 @@ int Memory::MapViews(uint8_t* mapping_base) {
         map_info[n].virtual_address_end - map_info[n].virtual_address_start + 1,
         mapping_base + map_info[n].virtual_address_start));
 #else
-    views_.all_views[n] = reinterpret_cast<uint8_t*>(mmap(
-        map_info[n].virtual_address_start + mapping_base,
-        map_info[n].virtual_address_end - map_info[n].virtual_address_start + 1,
-        PROT_NONE, MAP_SHARED | MAP_FIXED, mapping_,
-        map_info[n].target_address));
+    // Not MAP_FIXED, as that would silently replace anything already there.
+    uint8_t* target_address =
+        map_info[n].virtual_address_start + mapping_base;
+    size_t length =
+        map_info[n].virtual_address_end - map_info[n].virtual_address_start + 1;
+    void* result = mmap(target_address, length, PROT_NONE, MAP_SHARED,
+                        mapping_, map_info[n].target_address);
+    if (result != MAP_FAILED && result != target_address) {
+      munmap(result, length);
+      result = MAP_FAILED;
+    }
+    views_.all_views[n] =
+        result != MAP_FAILED ? reinterpret_cast<uint8_t*>(result) : nullptr;
 #endif  // XE_PLATFORM_WIN32
     if (!views_.all_views[n]) {
       // Failed, so bail and try again.
@@ -259,15 +367,206 @@ void Memory::UnmapViews() {
                       map_info[n].virtual_address_start + 1;
       munmap(views_.all_views[n], length);
 #endif  // XE_PLATFORM_WIN32
+      views_.all_views[n] = nullptr;
     }
   }
 }
 
+bool Memory::EnableLargePages() {
+#if XE_PLATFORM_WIN32
+  // SEC_LARGE_PAGES sections must be committed in full when created (and
+  // need SeLockMemoryPrivilege), which doesn't work with reserving the whole
+  // space and committing as we go.
+  return false;
+#elif defined(MADV_HUGEPAGE)
+  // Transparent huge pages rather than hugetlbfs, as we commit, protect and
+  // decommit with 4KB granularity. The kernel uses 2MB pages wherever a range
+  // allows it and 4KB pages elsewhere. Views and their file offsets are all
+  // 2MB aligned, which shared memory huge pages require.
+  for (size_t n = 0; n < poly::countof(map_info); n++) {
+    size_t length =
+        map_info[n].virtual_address_end - map_info[n].virtual_address_start + 1;
+    if (madvise(views_.all_views[n], length, MADV_HUGEPAGE)) {
+      return false;
+    }
+  }
+  // The advice is accepted even if shared memory huge pages are disabled.
+  FILE* file = fopen("/sys/kernel/mm/transparent_hugepage/shmem_enabled", "r");
+  if (!file) {
+    return false;
+  }
+  char buffer[128];
+  size_t length = fread(buffer, 1, sizeof(buffer) - 1, file);
+  fclose(file);
+  buffer[length] = 0;
+  return !std::strstr(buffer, "[never]") && !std::strstr(buffer, "[deny]");
+#else
+  return false;
+#endif  // XE_PLATFORM_WIN32
+}
+
+bool Memory::CommitRange(uint64_t address, size_t length, uint32_t protect) {
+  AlignToPages(&address, &length);
+  uint8_t* p = Translate(address);
+#if XE_PLATFORM_WIN32
+  if (!VirtualAlloc(p, length, MEM_COMMIT, protect)) {
+    return false;
+  }
+#else
+  // Pages are always backed by the file; committing is just allowing access.
+  if (mprotect(p, length, ToHostProtect(protect))) {
+    return false;
+  }
+#endif  // XE_PLATFORM_WIN32
+  uint32_t first_page = static_cast<uint32_t>(address / kGuestPageSize);
+  uint32_t end_page =
+      static_cast<uint32_t>((address + length) / kGuestPageSize);
+  std::lock_guard<std::mutex> guard(page_table_lock_);
+  for (uint32_t page = first_page; page < end_page; page++) {
+    auto& entry = page_table_[page];
+    if (!entry.committed) {
+      entry.base_page = first_page;
+      entry.committed = 1;
+      entry.allocation_protect = static_cast<uint16_t>(protect);
+    }
+    entry.protect = static_cast<uint16_t>(protect);
+  }
+  return true;
+}
+
+bool Memory::DecommitRange(uint64_t address, size_t length) {
+  AlignToPages(&address, &length);
+  uint8_t* p = Translate(address);
+#if XE_PLATFORM_WIN32
+  // Pages of a mapped view can't be decommitted, so this fails and they keep
+  // their contents until the views go away.
+  bool result = VirtualFree(p, length, MEM_DECOMMIT) == TRUE;
+#else
+  bool result = !mprotect(p, length, PROT_NONE);
+#endif  // XE_PLATFORM_WIN32
+  // The guest freed it either way, but unreleased pages have to be cleared
+  // by whoever zero allocates them next.
+  PageEntry free_entry = PageEntry();
+  free_entry.dirty = 1;
+  uint32_t first_page = static_cast<uint32_t>(address / kGuestPageSize);
+  uint32_t end_page =
+      static_cast<uint32_t>((address + length) / kGuestPageSize);
+  std::lock_guard<std::mutex> guard(page_table_lock_);
+  std::fill(page_table_.begin() + first_page, page_table_.begin() + end_page,
+            free_entry);
+  return result && ReleasePages(address, length);
+}
+
+bool Memory::ReleasePages(uint64_t address, size_t length) {
+  uint32_t first_page = static_cast<uint32_t>(address / kGuestPageSize);
+  uint32_t end_page =
+      static_cast<uint32_t>((address + length) / kGuestPageSize);
+#if XE_PLATFORM_WIN32
+  // VirtualFree already released them.
+  for (uint32_t page = first_page; page < end_page; page++) {
+    page_table_[page].dirty = 0;
+  }
+  return true;
+#elif defined(__linux__)
+  // Punching a hole in the file frees the backing pages, but also zeros them
+  // in every view aliasing them. Pages still committed in another view are
+  // kept until the last view lets go of them.
+  uint64_t offset = ToFileOffset(address);
+  // Calls visit(entry) for the page at the file offset in each view.
+  auto visit_aliases = [this](uint64_t page_offset,
+                              std::function<void(PageEntry&)> visit) {
+    for (size_t n = 0; n < poly::countof(map_info); n++) {
+      uint64_t view_length = map_info[n].virtual_address_end -
+                             map_info[n].virtual_address_start + 1;
+      if (page_offset >= map_info[n].target_address &&
+          page_offset - map_info[n].target_address < view_length) {
+        visit(page_table_[(map_info[n].virtual_address_start + page_offset -
+                           map_info[n].target_address) /
+                          kGuestPageSize]);
+      }
+    }
+  };
+  uint32_t run_start = first_page;
+  for (uint32_t page = first_page; page <= end_page; page++) {
+    bool is_aliased = false;
+    if (page < end_page) {
+      visit_aliases(offset + uint64_t(page - first_page) * kGuestPageSize,
+                    [&is_aliased](PageEntry& entry) {
+                      is_aliased = is_aliased || entry.committed;
+                    });
+      if (!is_aliased) {
+        continue;
+      }
+    }
+    if (run_start < page) {
+      uint64_t run_offset =
+          offset + uint64_t(run_start - first_page) * kGuestPageSize;
+      uint64_t run_length = uint64_t(page - run_start) * kGuestPageSize;
+      if (fallocate(mapping_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                    run_offset, run_length)) {
+        return false;
+      }
+      // They now read back zero in every view.
+      for (uint64_t page_offset = run_offset;
+           page_offset < run_offset + run_length;
+           page_offset += kGuestPageSize) {
+        visit_aliases(page_offset,
+                      [](PageEntry& entry) { entry.dirty = 0; });
+      }
+    }
+    run_start = page + 1;
+  }
+  return true;
+#else
+  // No way to free part of a shared memory object.
+  return false;
+#endif  // XE_PLATFORM_WIN32
+}
+
+bool Memory::ResetRange(uint64_t address, size_t length) {
+  // Only whole pages can be given back.
+  uint64_t end = (address + length) & ~uint64_t(kGuestPageSize - 1);
+  address = poly::align(address, uint64_t(kGuestPageSize));
+  if (end <= address) {
+    return false;
+  }
+#if defined(__linux__)
+  // The mapping stays as it is and reads back zero.
+  return !fallocate(mapping_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                    ToFileOffset(address), end - address);
+#else
+  // Neither MEM_RESET nor madvise on a shared mapping promise zeros.
+  return false;
+#endif  // __linux__
+}
+
+bool Memory::ProtectRange(uint64_t address, size_t length, uint32_t protect) {
+  AlignToPages(&address, &length);
+  uint8_t* p = Translate(address);
+#if XE_PLATFORM_WIN32
+  DWORD old_protect;
+  if (!VirtualProtect(p, length, protect, &old_protect)) {
+    return false;
+  }
+#else
+  if (mprotect(p, length, ToHostProtect(protect))) {
+    return false;
+  }
+#endif  // XE_PLATFORM_WIN32
+  uint32_t first_page = static_cast<uint32_t>(address / kGuestPageSize);
+  uint32_t end_page =
+      static_cast<uint32_t>((address + length) / kGuestPageSize);
+  std::lock_guard<std::mutex> guard(page_table_lock_);
+  for (uint32_t page = first_page; page < end_page; page++) {
+    page_table_[page].protect = static_cast<uint16_t>(protect);
+  }
+  return true;
+}
+
 bool Memory::AddMappedRange(uint64_t address, uint64_t mask, uint64_t size,
                             void* context, cpu::MMIOReadCallback read_callback,
                             cpu::MMIOWriteCallback write_callback) {
-  DWORD protect = PAGE_NOACCESS;
-  if (!VirtualAlloc(Translate(address), size, MEM_COMMIT, protect)) {
+  if (!CommitRange(address, size, X_PAGE_NOACCESS)) {
     XELOGE("Unable to map range; commit/protect failed");
     return false;
   }
@@ -275,6 +574,18 @@ bool Memory::AddMappedRange(uint64_t address, uint64_t mask, uint64_t size,
                                       read_callback, write_callback);
 }
 
+void Memory::WatchWrites(uint64_t address, size_t length) {
+  mmio_handler_->WatchWrites(address, length);
+}
+
+bool Memory::QueryWrites(uint64_t address, size_t length) {
+  return mmio_handler_->QueryWrites(address, length);
+}
+
+void Memory::TriggerWriteWatches(uint64_t address, size_t length) {
+  mmio_handler_->TriggerWrites(address, length);
+}
+
 uint8_t Memory::LoadI8(uint64_t address) {
   uint64_t value;
   if (!mmio_handler_->CheckLoad(address, &value)) {
@@ -343,11 +654,7 @@ uint64_t Memory::HeapAlloc(uint64_t base_address, size_t size, uint32_t flags,
     } else {
       result = virtual_heap_->Alloc(base_address, size, flags, alignment);
     }
-    if (result) {
-      if (flags & MEMORY_FLAG_ZERO) {
-        memset(Translate(result), 0, size);
-      }
-    }
+    // The heap has already cleared the memory.
     return result;
   } else {
     if (base_address >= XENON_MEMORY_VIRTUAL_HEAP_LOW &&
@@ -363,18 +670,35 @@ uint64_t Memory::HeapAlloc(uint64_t base_address, size_t size, uint32_t flags,
       return 0;
     }
 
-    uint8_t* p = Translate(base_address);
     // TODO(benvanik): check if address range is in use with a query.
 
-    void* pv = VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE);
-    if (!pv) {
+    // Pages that were released come back zero filled, so only clear if some
+    // of the range is in use or was freed without being released.
+    bool needs_zero = false;
+    {
+      uint64_t address = base_address;
+      size_t length = size;
+      AlignToPages(&address, &length);
+      uint32_t first_page = static_cast<uint32_t>(address / kGuestPageSize);
+      uint32_t end_page =
+          static_cast<uint32_t>((address + length) / kGuestPageSize);
+      std::lock_guard<std::mutex> guard(page_table_lock_);
+      for (uint32_t page = first_page; page < end_page; page++) {
+        if (page_table_[page].committed || page_table_[page].dirty) {
+          needs_zero = true;
+          break;
+        }
+      }
+    }
+
+    if (!CommitRange(base_address, size, X_PAGE_READWRITE)) {
       // Failed.
       assert_always();
       return 0;
     }
 
-    if (flags & MEMORY_FLAG_ZERO) {
-      memset(pv, 0, size);
+    if ((flags & MEMORY_FLAG_ZERO) && needs_zero) {
+      memset(Translate(base_address), 0, size);
     }
 
     return base_address;
@@ -390,25 +714,49 @@ int Memory::HeapFree(uint64_t address, size_t size) {
     return physical_heap_->Free(address, size) ? 0 : 1;
   } else {
     // A placed address. Decommit.
-    uint8_t* p = Translate(address);
-    return VirtualFree(p, size, MEM_DECOMMIT) ? 0 : 1;
+    return DecommitRange(address, size) ? 0 : 1;
   }
 }
 
+void Memory::ReleaseHeapCaches() {
+  virtual_heap_->ReleaseThreadCache();
+  physical_heap_->ReleaseThreadCache();
+}
+
 bool Memory::QueryInformation(uint64_t base_address, AllocationInfo* mem_info) {
-  uint8_t* p = Translate(base_address);
-  MEMORY_BASIC_INFORMATION mbi;
-  if (!VirtualQuery(p, &mbi, sizeof(mbi))) {
+  uint32_t first_page = static_cast<uint32_t>(base_address / kGuestPageSize);
+  if (first_page >= page_table_.size()) {
     return false;
   }
-  mem_info->base_address = base_address;
-  mem_info->allocation_base = static_cast<uint64_t>(
-      reinterpret_cast<uint8_t*>(mbi.AllocationBase) - membase_);
-  mem_info->allocation_protect = mbi.AllocationProtect;
-  mem_info->region_size = mbi.RegionSize;
-  mem_info->state = mbi.State;
-  mem_info->protect = mbi.Protect;
-  mem_info->type = mbi.Type;
+  std::lock_guard<std::mutex> guard(page_table_lock_);
+  // Like VirtualQuery the region extends over all following pages that
+  // match the first.
+  const auto& first_entry = page_table_[first_page];
+  uint32_t end_page = first_page + 1;
+  for (; end_page < page_table_.size(); end_page++) {
+    const auto& entry = page_table_[end_page];
+    if (entry.committed != first_entry.committed ||
+        (entry.committed && (entry.base_page != first_entry.base_page ||
+                             entry.protect != first_entry.protect))) {
+      break;
+    }
+  }
+  mem_info->base_address = uint64_t(first_page) * kGuestPageSize;
+  mem_info->region_size = size_t(end_page - first_page) * kGuestPageSize;
+  if (first_entry.committed) {
+    mem_info->allocation_base =
+        uint64_t(first_entry.base_page) * kGuestPageSize;
+    mem_info->allocation_protect = first_entry.allocation_protect;
+    mem_info->state = X_MEM_COMMIT;
+    mem_info->protect = first_entry.protect;
+    mem_info->type = X_MEM_PRIVATE;
+  } else {
+    mem_info->allocation_base = 0;
+    mem_info->allocation_protect = 0;
+    mem_info->state = X_MEM_FREE;
+    mem_info->protect = X_PAGE_NOACCESS;
+    mem_info->type = 0;
+  }
   return true;
 }
 
@@ -421,10 +769,10 @@ size_t Memory::QuerySize(uint64_t base_address) {
     return physical_heap_->QuerySize(base_address);
   } else {
     // A placed address.
-    uint8_t* p = Translate(base_address);
-    MEMORY_BASIC_INFORMATION mem_info;
-    if (VirtualQuery(p, &mem_info, sizeof(mem_info))) {
-      return mem_info.RegionSize;
+    AllocationInfo alloc_info;
+    if (QueryInformation(base_address, &alloc_info) &&
+        alloc_info.state == X_MEM_COMMIT) {
+      return alloc_info.region_size;
     } else {
       // Error.
       return 0;
@@ -433,37 +781,42 @@ size_t Memory::QuerySize(uint64_t base_address) {
 }
 
 int Memory::Protect(uint64_t address, size_t size, uint32_t access) {
-  uint8_t* p = Translate(address);
-
   size_t heap_guard_size = FLAGS_heap_guard_pages * 4096;
-  p += heap_guard_size;
+  address += heap_guard_size;
 
-  DWORD new_protect = access;
+  uint32_t new_protect = access;
   new_protect =
       new_protect &
       (X_PAGE_NOACCESS | X_PAGE_READONLY | X_PAGE_READWRITE | X_PAGE_WRITECOPY |
        X_PAGE_GUARD | X_PAGE_NOCACHE | X_PAGE_WRITECOMBINE);
 
-  DWORD old_protect;
-  return VirtualProtect(p, size, new_protect, &old_protect) == TRUE ? 0 : 1;
+  return ProtectRange(address, size, new_protect) ? 0 : 1;
 }
 
 uint32_t Memory::QueryProtect(uint64_t address) {
-  uint8_t* p = Translate(address);
-  MEMORY_BASIC_INFORMATION info;
-  size_t info_size = VirtualQuery((void*)p, &info, sizeof(info));
-  if (!info_size) {
+  uint32_t page = static_cast<uint32_t>(address / kGuestPageSize);
+  if (page >= page_table_.size()) {
     return 0;
   }
-  return info.Protect;
+  std::lock_guard<std::mutex> guard(page_table_lock_);
+  const auto& entry = page_table_[page];
+  return entry.committed ? entry.protect : 0;
 }
 
 MemoryHeap::MemoryHeap(Memory* memory, bool is_physical)
-    : memory_(memory), is_physical_(is_physical) {
+    : memory_(memory),
+      is_physical_(is_physical),
+      size_(0),
+      ptr_(NULL),
+      space_(NULL),
+      slab_heap_(NULL) {
   heap_id_ = next_heap_id_++;
 }
 
 MemoryHeap::~MemoryHeap() {
+  delete slab_heap_;
+  slab_heap_ = NULL;
+
   if (space_) {
     std::lock_guard<std::mutex> guard(lock_);
     destroy_mspace(space_);
@@ -471,70 +824,110 @@ MemoryHeap::~MemoryHeap() {
   }
 
   if (ptr_) {
-    VirtualFree(ptr_, 0, MEM_RELEASE);
+    memory_->DecommitRange(ptr_ - memory_->mapping_base_, size_);
   }
 }
 
 int MemoryHeap::Initialize(uint64_t low, uint64_t high) {
-  // Commit the memory where our heap will live and allocate it.
-  // TODO(benvanik): replace dlmalloc with an implementation that can commit
-  //     as it goes.
   size_ = high - low;
   ptr_ = memory_->views_.v00000000 + low;
-  void* heap_result = VirtualAlloc(ptr_, size_, MEM_COMMIT, PAGE_READWRITE);
-  if (!heap_result) {
+  if (!FLAGS_heap_use_mspace) {
+    // Commits pages (in all physical views, if needed) as it goes.
+    slab_heap_ = new SlabHeap(ptr_, size_, CommitPages, this);
+    return 0;
+  }
+
+  // Commit the memory where our heap will live and allocate it.
+  if (!memory_->CommitRange(low, size_, X_PAGE_READWRITE)) {
     return 1;
   }
   space_ = create_mspace_with_base(ptr_, size_, 0);
+  // dlmalloc keeps its state at the start and a footer at the end.
+  dirty_pages_.assign(size_ / kGuestPageSize, false);
+  MarkDirty(ptr_, ptr_ + 16 * 1024);
+  MarkDirty(ptr_ + size_ - kGuestPageSize, ptr_ + size_);
 
   return 0;
 }
 
 uint64_t MemoryHeap::Alloc(uint64_t base_address, size_t size, uint32_t flags,
                            uint32_t alignment) {
-  lock_.lock();
   size_t alloc_size = size;
   size_t heap_guard_size = FLAGS_heap_guard_pages * 4096;
   if (heap_guard_size) {
     alignment = std::max(alignment, static_cast<uint32_t>(heap_guard_size));
     alloc_size = static_cast<uint32_t>(poly::round_up(size, heap_guard_size));
   }
-  uint8_t* p = (uint8_t*)mspace_memalign(space_, alignment,
-                                         alloc_size + heap_guard_size * 2);
+  // Allocations are zeroed unless asked not to (and we want to see that).
+  bool scribble = (flags & X_MEM_NOZERO) && !(flags & MEMORY_FLAG_ZERO) &&
+                  FLAGS_scribble_heap;
+  uint8_t* p;
+  // Part of the allocation that may need clearing.
+  uint8_t* dirty_start = NULL;
+  uint8_t* dirty_end = NULL;
+  if (slab_heap_) {
+    p = slab_heap_->Alloc(alloc_size + heap_guard_size * 2, alignment,
+                          !scribble);
+  } else {
+    lock_.lock();
+    p = (uint8_t*)mspace_memalign(space_, alignment,
+                                  alloc_size + heap_guard_size * 2);
+    if (p) {
+      uint8_t* user_start = p + heap_guard_size;
+      uint8_t* user_end = user_start + alloc_size;
+      size_t first_page = (user_start - ptr_) / kGuestPageSize;
+      size_t end_page = (user_end - ptr_ + kGuestPageSize - 1) / kGuestPageSize;
+      for (size_t page = first_page; page < end_page; ++page) {
+        if (dirty_pages_[page]) {
+          uint8_t* page_start = ptr_ + page * kGuestPageSize;
+          if (!dirty_start) {
+            dirty_start = std::max(user_start, page_start);
+          }
+          dirty_end = std::min(user_end, page_start + kGuestPageSize);
+        }
+      }
+      // memalign splits what it doesn't use off both ends, and moves the top
+      // chunk past us, writing chunk headers just outside the allocation.
+      size_t slack = alignment + 128;
+      MarkDirty(p - std::min(slack, size_t(p - ptr_)),
+                p + alloc_size + heap_guard_size * 2 + slack);
+    }
+  }
   assert_true(reinterpret_cast<uint64_t>(p) <= 0xFFFFFFFFFull);
-  if (FLAGS_heap_guard_pages) {
-    size_t real_size = mspace_usable_size(p);
-    DWORD old_protect;
-    VirtualProtect(p, heap_guard_size, PAGE_NOACCESS, &old_protect);
+  if (p && FLAGS_heap_guard_pages) {
+    uint64_t guard_address = p - memory_->mapping_base_;
+    memory_->ProtectRange(guard_address, heap_guard_size, X_PAGE_NOACCESS);
     p += heap_guard_size;
-    VirtualProtect(p + alloc_size, heap_guard_size, PAGE_NOACCESS,
-                   &old_protect);
+    memory_->ProtectRange(guard_address + heap_guard_size + alloc_size,
+                          heap_guard_size, X_PAGE_NOACCESS);
   }
   if (FLAGS_log_heap) {
     Dump();
   }
-  lock_.unlock();
+  if (!slab_heap_) {
+    lock_.unlock();
+  }
   if (!p) {
     return 0;
   }
 
-  if (is_physical_) {
+  if (is_physical_ && !slab_heap_) {
     // If physical, we need to commit the memory in the physical address ranges
     // so that it can be accessed.
-    VirtualAlloc(memory_->views_.vA0000000 + (p - memory_->views_.v00000000),
-                 size, MEM_COMMIT, PAGE_READWRITE);
-    VirtualAlloc(memory_->views_.vC0000000 + (p - memory_->views_.v00000000),
-                 size, MEM_COMMIT, PAGE_READWRITE);
-    VirtualAlloc(memory_->views_.vE0000000 + (p - memory_->views_.v00000000),
-                 size, MEM_COMMIT, PAGE_READWRITE);
+    uint64_t offset = p - memory_->views_.v00000000;
+    memory_->CommitRange(0xA0000000 + offset, size, X_PAGE_READWRITE);
+    memory_->CommitRange(0xC0000000 + offset, size, X_PAGE_READWRITE);
+    memory_->CommitRange(0xE0000000 + offset, size, X_PAGE_READWRITE);
   }
 
-  if ((flags & X_MEM_NOZERO) && FLAGS_scribble_heap) {
+  if (scribble) {
     // Trash the memory so that we can see bad read-before-write bugs easier.
     memset(p, 0xCD, alloc_size);
-  } else {
-    // Implicit clear.
-    memset(p, 0, alloc_size);
+  } else if (dirty_start) {
+    // Implicit clear of whatever part of the chunk has been used before.
+    // Leaving the rest alone means new heap memory isn't faulted in until
+    // the guest touches it. The slab heap has cleared already.
+    memset(dirty_start, 0, dirty_end - dirty_start);
   }
 
   uint64_t address =
@@ -549,39 +942,45 @@ uint64_t MemoryHeap::Free(uint64_t address, size_t size) {
   // Heap allocated address.
   size_t heap_guard_size = FLAGS_heap_guard_pages * 4096;
   p -= heap_guard_size;
-  size_t real_size = mspace_usable_size(p);
-  real_size -= heap_guard_size * 2;
-  if (!real_size) {
+  size_t real_size =
+      slab_heap_ ? slab_heap_->QuerySize(p) : mspace_usable_size(p);
+  if (real_size <= heap_guard_size * 2) {
     return 0;
   }
+  real_size -= heap_guard_size * 2;
 
   if (FLAGS_scribble_heap) {
     // Trash the memory so that we can see bad read-before-write bugs easier.
     memset(p + heap_guard_size, 0xDC, size);
   }
 
-  lock_.lock();
   if (FLAGS_heap_guard_pages) {
-    DWORD old_protect;
-    VirtualProtect(p, heap_guard_size, PAGE_READWRITE, &old_protect);
-    VirtualProtect(p + heap_guard_size + real_size, heap_guard_size,
-                   PAGE_READWRITE, &old_protect);
+    uint64_t guard_address = p - memory_->mapping_base_;
+    memory_->ProtectRange(guard_address, heap_guard_size, X_PAGE_READWRITE);
+    memory_->ProtectRange(guard_address + heap_guard_size + real_size,
+                          heap_guard_size, X_PAGE_READWRITE);
   }
+
+  if (slab_heap_) {
+    // Pages are decommitted (in all views) by the heap once unused.
+    slab_heap_->Free(p);
+    if (FLAGS_log_heap) {
+      Dump();
+    }
+    return (uint64_t)real_size;
+  }
+
+  lock_.lock();
+  size_t chunk_size = mspace_usable_size(p);
   mspace_free(space_, p);
+  ReleaseFreedPages(p, chunk_size);
   if (FLAGS_log_heap) {
     Dump();
   }
   lock_.unlock();
 
-  if (is_physical_) {
-    // If physical, decommit from physical ranges too.
-    VirtualFree(memory_->views_.vA0000000 + (p - memory_->views_.v00000000),
-                size, MEM_DECOMMIT);
-    VirtualFree(memory_->views_.vC0000000 + (p - memory_->views_.v00000000),
-                size, MEM_DECOMMIT);
-    VirtualFree(memory_->views_.vE0000000 + (p - memory_->views_.v00000000),
-                size, MEM_DECOMMIT);
-  }
+  // The physical views are left committed: their pages may be shared with
+  // neighboring chunks, and releasing them would take the data with them.
 
   return (uint64_t)real_size;
 }
@@ -592,20 +991,92 @@ size_t MemoryHeap::QuerySize(uint64_t base_address) {
   // Heap allocated address.
   size_t heap_guard_size = FLAGS_heap_guard_pages * 4096;
   p -= heap_guard_size;
-  size_t real_size = mspace_usable_size(p);
-  real_size -= heap_guard_size * 2;
-  if (!real_size) {
+  size_t real_size =
+      slab_heap_ ? slab_heap_->QuerySize(p) : mspace_usable_size(p);
+  if (real_size <= heap_guard_size * 2) {
     return 0;
   }
+  real_size -= heap_guard_size * 2;
 
   return real_size;
 }
 
+void MemoryHeap::ReleaseThreadCache() {
+  if (slab_heap_) {
+    slab_heap_->ReleaseThreadCache();
+  }
+}
+
+bool MemoryHeap::CommitPages(void* context, uint8_t* p, size_t length,
+                             bool commit) {
+  auto heap = reinterpret_cast<MemoryHeap*>(context);
+  auto memory = heap->memory_;
+  uint64_t address = p - memory->mapping_base_;
+  uint64_t addresses[] = {
+      address, 0xA0000000 + address, 0xC0000000 + address,
+      0xE0000000 + address,
+  };
+  // Physical memory has to be accessible through all of its views.
+  size_t count = heap->is_physical_ ? poly::countof(addresses) : 1;
+  bool result = true;
+  for (size_t n = 0; n < count; n++) {
+    if (commit) {
+      if (!memory->CommitRange(addresses[n], length, X_PAGE_READWRITE)) {
+        return false;
+      }
+    } else {
+      // Keep going so that every view is marked free.
+      result = memory->DecommitRange(addresses[n], length) && result;
+    }
+  }
+  return result;
+}
+
+void MemoryHeap::MarkDirty(uint8_t* start, uint8_t* end) {
+  size_t first_page = (start - ptr_) / kGuestPageSize;
+  size_t end_page = std::min(
+      (end - ptr_ + kGuestPageSize - 1) / kGuestPageSize, dirty_pages_.size());
+  for (size_t page = first_page; page < end_page; ++page) {
+    dirty_pages_[page] = true;
+  }
+}
+
+void MemoryHeap::ReleaseFreedPages(uint8_t* p, size_t size) {
+  // Small frees aren't worth the syscall; their pages are likely to be
+  // handed out again soon anyway.
+  const size_t kReleaseThreshold = 64 * 1024;
+  if (size < kReleaseThreshold) {
+    return;
+  }
+  // dlmalloc keeps its bookkeeping for a free chunk at either end of it, and
+  // writes nothing in between until it's handed out again. The pages of
+  // that middle part are freed now, before anyone else can allocate them,
+  // and read back zero from then on.
+  const size_t kChunkBookkeeping = 128;
+  uint8_t* start = reinterpret_cast<uint8_t*>(poly::align(
+      reinterpret_cast<uintptr_t>(p + kChunkBookkeeping), kGuestPageSize));
+  uint8_t* end = reinterpret_cast<uint8_t*>(
+      reinterpret_cast<uintptr_t>(p + size - kChunkBookkeeping) &
+      ~uintptr_t(kGuestPageSize - 1));
+  if (end <= start ||
+      !memory_->ResetRange(start - memory_->mapping_base_, end - start)) {
+    return;
+  }
+  for (size_t page = (start - ptr_) / kGuestPageSize;
+       page < size_t(end - ptr_) / kGuestPageSize; ++page) {
+    dirty_pages_[page] = false;
+  }
+}
+
 void MemoryHeap::Dump() {
   XELOGI("MemoryHeap::Dump - %s", is_physical_ ? "physical" : "virtual");
   if (FLAGS_heap_guard_pages) {
     XELOGI("  (heap guard pages enabled, stats will be wrong)");
   }
+  if (slab_heap_) {
+    slab_heap_->Dump();
+    return;
+  }
   struct mallinfo info = mspace_mallinfo(space_);
   XELOGI("    arena: %lld", info.arena);
   XELOGI("  ordblks: %lld", info.ordblks);
@@ -11,6 +11,8 @@
 #define XENIA_MEMORY_H_
 
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include <alloy/memory.h>
 
@@ -49,13 +51,16 @@ class Memory : public alloy::Memory {
 
   int Initialize() override;
 
-  // TODO(benvanik): remove with GPU refactor.
-  uint64_t page_table() const override { return page_table_; }
-
   bool AddMappedRange(uint64_t address, uint64_t mask, uint64_t size,
                       void* context, cpu::MMIOReadCallback read_callback,
                       cpu::MMIOWriteCallback write_callback);
 
+  // Finds guest writes to physical memory that is cached elsewhere (GPU
+  // resources) by write protecting it. See MMIOHandler::WatchWrites.
+  void WatchWrites(uint64_t address, size_t length);
+  bool QueryWrites(uint64_t address, size_t length);
+  void TriggerWriteWatches(uint64_t address, size_t length);
+
   uint8_t LoadI8(uint64_t address) override;
   uint16_t LoadI16(uint64_t address) override;
   uint32_t LoadI32(uint64_t address) override;
@@ -68,6 +73,9 @@ class Memory : public alloy::Memory {
   uint64_t HeapAlloc(uint64_t base_address, size_t size, uint32_t flags,
                      uint32_t alignment = 0x20);
   int HeapFree(uint64_t address, size_t size);
+  // Returns memory cached by the heaps for the calling thread. Call before
+  // the thread exits.
+  void ReleaseHeapCaches();
 
   bool QueryInformation(uint64_t base_address, AllocationInfo* mem_info);
   size_t QuerySize(uint64_t base_address);
@@ -78,9 +86,34 @@ class Memory : public alloy::Memory {
  private:
   int MapViews(uint8_t* mapping_base);
   void UnmapViews();
+  // Asks the host to back the views with large pages. Returns false if it
+  // can't, in which case normal pages are used.
+  bool EnableLargePages();
+
+  // Commits, decommits or reprotects the host pages backing a guest range in
+  // the view it's addressed through, keeping the page table in sync.
+  // Protection is given as X_PAGE_* flags. Decommitted pages are marked free
+  // either way, but DecommitRange returns false if the host couldn't release
+  // them (so they don't read back zero when next committed). Pages still
+  // committed in another view aliasing them are kept for it and stay dirty
+  // until the last view decommits them.
+  bool CommitRange(uint64_t address, size_t length, uint32_t protect);
+  bool DecommitRange(uint64_t address, size_t length);
+  bool ProtectRange(uint64_t address, size_t length, uint32_t protect);
+  // Frees the host pages behind a range just marked free, with the page table
+  // lock held, and clears their dirty bits in every view.
+  bool ReleasePages(uint64_t address, size_t length);
+  // Frees the host pages behind the whole pages of a committed range, which
+  // stay committed and read back zero. Returns false if the host can't, in
+  // which case they keep their contents.
+  bool ResetRange(uint64_t address, size_t length);
 
  private:
+#if XE_PLATFORM_WIN32
   HANDLE mapping_;
+#else
+  int mapping_;
+#endif  // XE_PLATFORM_WIN32
   uint8_t* mapping_base_;
   union {
     struct {
@@ -97,11 +130,24 @@ class Memory : public alloy::Memory {
 
   std::unique_ptr<cpu::MMIOHandler> mmio_handler_;
 
+  // Our own record of every 4KB guest page, so that queries are answered
+  // without asking the host (and the same way on all of them).
+  struct PageEntry {
+    // First page of the allocation the page belongs to.
+    uint32_t base_page : 20;
+    uint32_t committed : 1;
+    // Freed without the host releasing it, so it still holds old contents.
+    uint32_t dirty : 1;
+    uint32_t : 10;
+    uint16_t protect;             // X_PAGE_*
+    uint16_t allocation_protect;  // X_PAGE_* the allocation was made with.
+  };
+  std::mutex page_table_lock_;
+  std::vector<PageEntry> page_table_;
+
   MemoryHeap* virtual_heap_;
   MemoryHeap* physical_heap_;
 
-  uint64_t page_table_;
-
   friend class MemoryHeap;
 };
 
@@ -0,0 +1,514 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/slab_heap.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include <poly/poly.h>
+#include <xenia/logging.h>
+
+namespace xe {
+
+namespace {
+
+// Multiples of 32 (the guest default alignment), getting coarser with size
+// so waste stays under ~20%.
+const uint32_t kSizeClassSizes[] = {
+    32,   64,   96,   128,  160,  192,  224,  256,  320,  384,
+    448,  512,  640,  768,  896,  1024, 1280, 1536, 1792, 2048,
+    2560, 3072, 3584, 4096, 5120, 6144, 7168, 8192,
+};
+const uint32_t kSizeClassCount = poly::countof(kSizeClassSizes);
+
+// Each thread caches up to this many bytes per size class (or 4 objects,
+// whichever is more) before flushing half back to the spans.
+const uint32_t kThreadCacheBytes = 32 * 1024;
+const uint32_t kMinThreadCacheCount = 4;
+
+// Page runs at least this big (1MB) are decommitted when freed, which also
+// gets them zero filled by the OS for the next user. Smaller ones stay
+// committed (and dirty) as they'll likely be reused soon; decommitting every
+// freed span made churning 64KB buffers spend half their time in the kernel.
+const uint32_t kDecommitPageCount = 256;
+
+std::atomic<uint32_t> next_serial_(1);
+
+// Fast path lookup of the calling thread's cache. Heaps are told apart by
+// serial so that a stale slot from a destroyed heap is never used. This must
+// stay POD (see cxx_compat.h), so the caches are owned by the heap.
+struct TlsCacheSlot {
+  uint32_t serial;
+  void* cache;
+};
+const uint32_t kTlsCacheSlotCount = 4;
+thread_local TlsCacheSlot tls_cache_slots_[kTlsCacheSlotCount];
+
+}  // namespace
+
+SlabHeap::SlabHeap(uint8_t* base, size_t size, CommitCallback commit_callback,
+                   void* callback_context)
+    : base_(base),
+      size_(size),
+      commit_callback_(commit_callback),
+      callback_context_(callback_context),
+      serial_(next_serial_++),
+      size_classes_(kSizeClassCount),
+      span_map_((size + kSpanSize - 1) / kSpanSize),
+      dirty_pages_(size / kPageSize, 0) {
+  for (auto& slot : span_map_) {
+    slot.store(nullptr, std::memory_order_relaxed);
+  }
+  for (uint32_t n = 0; n < kSizeClassCount; n++) {
+    auto& size_class = size_classes_[n];
+    size_class.object_size = kSizeClassSizes[n];
+    size_class.cache_limit =
+        std::max(kMinThreadCacheCount, kThreadCacheBytes / kSizeClassSizes[n]);
+    size_class.span_count = 0;
+  }
+  uint32_t page_count = static_cast<uint32_t>(size / kPageSize);
+  if (page_count) {
+    InsertFreeRun(0, page_count);
+  }
+}
+
+SlabHeap::~SlabHeap() {
+  // Guest memory goes away with us, so there's nothing to give back.
+  for (auto cache : thread_caches_) {
+    delete[] cache->objects;
+    delete cache;
+  }
+  for (auto& slot : span_map_) {
+    delete slot.load(std::memory_order_relaxed);
+  }
+}
+
+int SlabHeap::SizeClassForRequest(size_t size, size_t alignment) {
+  if (size > kMaxSmallSize || alignment > kMaxSmallSize) {
+    return -1;
+  }
+  // Objects are aligned to their size class within the 64KB aligned span,
+  // so any class that is a multiple of the alignment will do.
+  auto it = std::lower_bound(kSizeClassSizes, kSizeClassSizes + kSizeClassCount,
+                             static_cast<uint32_t>(std::max(size, size_t(1))));
+  for (; it != kSizeClassSizes + kSizeClassCount; ++it) {
+    if (*it % alignment == 0) {
+      return static_cast<int>(it - kSizeClassSizes);
+    }
+  }
+  return -1;
+}
+
+uint8_t* SlabHeap::Alloc(size_t size, size_t alignment, bool zero) {
+  alignment = std::max(alignment, size_t(1));
+  assert_zero(alignment & (alignment - 1));
+  int size_class = SizeClassForRequest(size, alignment);
+  if (size_class != -1) {
+    // Objects get recycled through the caches, so always clear them. They're
+    // small enough that it doesn't matter.
+    uint8_t* p = AllocSmall(size_class);
+    if (p && zero) {
+      std::memset(p, 0, size);
+    }
+    return p;
+  } else {
+    return AllocLarge(size, alignment, zero);
+  }
+}
+
+size_t SlabHeap::Free(uint8_t* p) {
+  if (p < base_ || p >= base_ + size_) {
+    return 0;
+  }
+  // A span can't go away while one of its objects is live, so the caller's
+  // own allocation keeps this one valid.
+  Span* span = span_map_[(p - base_) / kSpanSize].load(std::memory_order_acquire);
+  if (span) {
+    size_t object_size = span->object_size;
+    FreeSmall(span, p);
+    return object_size;
+  } else {
+    return FreeLarge(p);
+  }
+}
+
+size_t SlabHeap::QuerySize(uint8_t* p) {
+  if (p < base_ || p >= base_ + size_) {
+    return 0;
+  }
+  Span* span = span_map_[(p - base_) / kSpanSize].load(std::memory_order_acquire);
+  if (span) {
+    return span->object_size;
+  }
+  std::lock_guard<std::mutex> guard(page_lock_);
+  auto it = large_objects_.find(static_cast<uint32_t>((p - base_) / kPageSize));
+  return it != large_objects_.end() ? it->second * kPageSize : 0;
+}
+
+SlabHeap::ThreadCache* SlabHeap::GetThreadCache() {
+  auto& slot = tls_cache_slots_[serial_ % kTlsCacheSlotCount];
+  if (slot.serial == serial_) {
+    return reinterpret_cast<ThreadCache*>(slot.cache);
+  }
+
+  // Either a new thread or another heap sharing the slot.
+  auto thread_id = std::this_thread::get_id();
+  ThreadCache* cache = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(cache_lock_);
+    for (auto test_cache : thread_caches_) {
+      if (test_cache->owner == thread_id) {
+        cache = test_cache;
+        break;
+      }
+    }
+    if (!cache) {
+      cache = new ThreadCache();
+      cache->owner = thread_id;
+      cache->objects = new std::vector<uint8_t*>[kSizeClassCount];
+      thread_caches_.push_back(cache);
+    }
+  }
+  slot.serial = serial_;
+  slot.cache = cache;
+  return cache;
+}
+
+void SlabHeap::ReleaseThreadCache() {
+  auto thread_id = std::this_thread::get_id();
+  ThreadCache* cache = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(cache_lock_);
+    auto it = std::find_if(
+        thread_caches_.begin(), thread_caches_.end(),
+        [thread_id](ThreadCache* test) { return test->owner == thread_id; });
+    if (it == thread_caches_.end()) {
+      return;
+    }
+    cache = *it;
+    thread_caches_.erase(it);
+  }
+  auto& slot = tls_cache_slots_[serial_ % kTlsCacheSlotCount];
+  if (slot.serial == serial_) {
+    slot.serial = 0;
+    slot.cache = nullptr;
+  }
+  for (uint32_t n = 0; n < kSizeClassCount; n++) {
+    FlushThreadCache(cache, n, 0);
+  }
+  delete[] cache->objects;
+  delete cache;
+}
+
+void SlabHeap::FlushThreadCache(ThreadCache* cache, uint32_t size_class,
+                                size_t keep_count) {
+  auto& objects = cache->objects[size_class];
+  if (objects.size() <= keep_count) {
+    return;
+  }
+  auto& sc = size_classes_[size_class];
+  // Oldest first, so the most recently freed (and cache warm) objects stay.
+  size_t flush_count = objects.size() - keep_count;
+  // Spans that empty out are given back once the lock is dropped.
+  std::vector<Span*> empty_spans;
+  {
+    std::lock_guard<std::mutex> guard(sc.lock);
+    for (size_t n = 0; n < flush_count; n++) {
+      uint8_t* p = objects[n];
+      Span* span =
+          span_map_[(p - base_) / kSpanSize].load(std::memory_order_relaxed);
+      span = ReleaseObject(sc, span, p);
+      if (span) {
+        empty_spans.push_back(span);
+      }
+    }
+  }
+  for (auto span : empty_spans) {
+    FreeSpan(span);
+  }
+  objects.erase(objects.begin(), objects.begin() + flush_count);
+}
+
+uint8_t* SlabHeap::AllocSmall(uint32_t size_class) {
+  auto cache = GetThreadCache();
+  auto& objects = cache->objects[size_class];
+  if (objects.empty()) {
+    RefillThreadCache(cache, size_class);
+    if (objects.empty()) {
+      return nullptr;
+    }
+  }
+  uint8_t* p = objects.back();
+  objects.pop_back();
+  return p;
+}
+
+void SlabHeap::FreeSmall(Span* span, uint8_t* p) {
+  assert_zero((p - base_ - span->offset) % span->object_size);
+  auto cache = GetThreadCache();
+  auto& objects = cache->objects[span->size_class];
+  objects.push_back(p);
+  if (objects.size() > size_classes_[span->size_class].cache_limit) {
+    FlushThreadCache(cache, span->size_class,
+                     size_classes_[span->size_class].cache_limit / 2);
+  }
+}
+
+void SlabHeap::RefillThreadCache(ThreadCache* cache, uint32_t size_class) {
+  auto& sc = size_classes_[size_class];
+  auto& objects = cache->objects[size_class];
+  size_t want_count = std::max(size_t(1), size_t(sc.cache_limit / 2));
+  std::unique_lock<std::mutex> guard(sc.lock);
+  while (objects.size() < want_count) {
+    if (sc.partial.empty()) {
+      // Other threads can keep using the class while the span is committed.
+      guard.unlock();
+      Span* span = AllocSpan(size_class);
+      guard.lock();
+      if (!span) {
+        break;
+      }
+      span->partial_index = static_cast<int32_t>(sc.partial.size());
+      sc.partial.push_back(span);
+      ++sc.span_count;
+    }
+    Span* span = sc.partial.back();
+    while (objects.size() < want_count && !span->free_objects.empty()) {
+      uint32_t index = span->free_objects.back();
+      span->free_objects.pop_back();
+      objects.push_back(base_ + span->offset + index * span->object_size);
+    }
+    if (span->free_objects.empty()) {
+      sc.partial.pop_back();
+      span->partial_index = -1;
+    }
+  }
+}
+
+SlabHeap::Span* SlabHeap::ReleaseObject(SizeClass& sc, Span* span,
+                                        uint8_t* p) {
+  uint32_t index =
+      static_cast<uint32_t>((p - base_ - span->offset) / span->object_size);
+  span->free_objects.push_back(static_cast<uint16_t>(index));
+  if (span->partial_index == -1) {
+    span->partial_index = static_cast<int32_t>(sc.partial.size());
+    sc.partial.push_back(span);
+  }
+  if (span->free_objects.size() == span->capacity && sc.partial.size() > 1) {
+    // Entirely free and there's another span to allocate from, so give the
+    // pages back.
+    auto last = sc.partial.back();
+    sc.partial[span->partial_index] = last;
+    last->partial_index = span->partial_index;
+    sc.partial.pop_back();
+    --sc.span_count;
+    span_map_[span->offset / kSpanSize].store(nullptr,
+                                              std::memory_order_relaxed);
+    return span;
+  }
+  return nullptr;
+}
+
+SlabHeap::Span* SlabHeap::AllocSpan(uint32_t size_class) {
+  uint32_t page_count = kSpanSize / kPageSize;
+  uint32_t page = AllocPages(page_count, page_count);
+  if (page == UINT32_MAX) {
+    return nullptr;
+  }
+  auto span = new Span();
+  span->offset = page * kPageSize;
+  span->size_class = size_class;
+  span->object_size = size_classes_[size_class].object_size;
+  span->capacity = kSpanSize / span->object_size;
+  span->partial_index = -1;
+  span->free_objects.reserve(span->capacity);
+  // Reversed so objects are handed out in address order.
+  for (uint32_t n = span->capacity; n > 0; n--) {
+    span->free_objects.push_back(static_cast<uint16_t>(n - 1));
+  }
+  // Published before any of its objects can reach a lock-free Free.
+  span_map_[span->offset / kSpanSize].store(span, std::memory_order_release);
+  return span;
+}
+
+void SlabHeap::FreeSpan(Span* span) {
+  FreePages(span->offset / kPageSize, kSpanSize / kPageSize);
+  delete span;
+}
+
+uint8_t* SlabHeap::AllocLarge(size_t size, size_t alignment, bool zero) {
+  uint32_t page_count =
+      static_cast<uint32_t>(poly::round_up(size, kPageSize) / kPageSize);
+  uint32_t page_alignment =
+      static_cast<uint32_t>(alignment > kPageSize ? alignment / kPageSize : 1);
+  DirtyRuns dirty_runs;
+  uint32_t page = AllocPages(page_count, page_alignment, &dirty_runs);
+  if (page == UINT32_MAX) {
+    return nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> guard(page_lock_);
+    large_objects_.insert({page, page_count});
+  }
+  uint8_t* p = base_ + page * kPageSize;
+  if (zero) {
+    // Clean pages are already zero, and touching them would only fault them
+    // in. The tail of the last page past size is never seen by the guest.
+    for (auto& run : dirty_runs) {
+      size_t start = (run.first - page) * kPageSize;
+      size_t end = std::min(size_t(run.second - page) * kPageSize, size);
+      if (start < end) {
+        std::memset(p + start, 0, end - start);
+      }
+    }
+  }
+  return p;
+}
+
+size_t SlabHeap::FreeLarge(uint8_t* p) {
+  uint32_t page = static_cast<uint32_t>((p - base_) / kPageSize);
+  uint32_t page_count;
+  {
+    std::lock_guard<std::mutex> guard(page_lock_);
+    auto it = large_objects_.find(page);
+    if (it == large_objects_.end()) {
+      return 0;
+    }
+    page_count = it->second;
+    large_objects_.erase(it);
+  }
+  FreePages(page, page_count);
+  return page_count * kPageSize;
+}
+
+uint32_t SlabHeap::AllocPages(uint32_t page_count, uint32_t page_alignment,
+                              DirtyRuns* out_dirty_runs) {
+  std::unique_lock<std::mutex> guard(page_lock_);
+  uint32_t page = UINT32_MAX;
+  // Best fit. Only aligned requests may have to pass over runs that are big
+  // enough but start in the wrong place.
+  for (auto it = free_runs_by_size_.lower_bound({page_count, 0});
+       it != free_runs_by_size_.end(); ++it) {
+    uint32_t run_start = it->second;
+    uint32_t run_end = it->second + it->first;
+    uint32_t start = poly::align(run_start, page_alignment);
+    if (start >= run_end || run_end - start < page_count) {
+      continue;
+    }
+    for (uint32_t n = start; n < start + page_count; n++) {
+      if (!dirty_pages_[n]) {
+        dirty_pages_[n] = 1;
+      } else if (out_dirty_runs) {
+        if (!out_dirty_runs->empty() && out_dirty_runs->back().second == n) {
+          out_dirty_runs->back().second = n + 1;
+        } else {
+          out_dirty_runs->push_back({n, n + 1});
+        }
+      }
+    }
+    EraseFreeRun(run_start, run_end - run_start);
+    if (start > run_start) {
+      InsertFreeRun(run_start, start - run_start);
+    }
+    if (start + page_count < run_end) {
+      InsertFreeRun(start + page_count, run_end - start - page_count);
+    }
+    page = start;
+    break;
+  }
+  if (page == UINT32_MAX) {
+    return UINT32_MAX;
+  }
+  guard.unlock();
+
+  // The pages are ours now, so nobody else can touch them while committing.
+  if (!commit_callback_(callback_context_, base_ + page * kPageSize,
+                        page_count * kPageSize, true)) {
+    guard.lock();
+    MergeFreeRun(page, page_count);
+    return UINT32_MAX;
+  }
+  return page;
+}
+
+void SlabHeap::FreePages(uint32_t page, uint32_t page_count) {
+  // Only trust the pages to come back zeroed if the decommit worked. This
+  // happens before the run is back in the free map, so nobody can be
+  // committing it at the same time.
+  bool decommitted =
+      page_count >= kDecommitPageCount &&
+      commit_callback_(callback_context_, base_ + page * kPageSize,
+                       page_count * kPageSize, false);
+  std::lock_guard<std::mutex> guard(page_lock_);
+  if (decommitted) {
+    std::fill_n(dirty_pages_.begin() + page, page_count, 0);
+  }
+  MergeFreeRun(page, page_count);
+}
+
+void SlabHeap::MergeFreeRun(uint32_t page, uint32_t page_count) {
+  uint32_t start = page;
+  uint32_t end = page + page_count;
+  auto next = free_runs_.lower_bound(start);
+  if (next != free_runs_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == start) {
+      start = prev->first;
+      EraseFreeRun(prev->first, prev->second);
+    }
+  }
+  if (next != free_runs_.end() && next->first == end) {
+    end += next->second;
+    EraseFreeRun(next->first, next->second);
+  }
+  InsertFreeRun(start, end - start);
+}
+
+void SlabHeap::InsertFreeRun(uint32_t page, uint32_t page_count) {
+  free_runs_.insert({page, page_count});
+  free_runs_by_size_.insert({page_count, page});
+}
+
+void SlabHeap::EraseFreeRun(uint32_t page, uint32_t page_count) {
+  free_runs_.erase(page);
+  free_runs_by_size_.erase({page_count, page});
+}
+
+void SlabHeap::Dump() {
+  for (uint32_t n = 0; n < kSizeClassCount; n++) {
+    auto& sc = size_classes_[n];
+    std::lock_guard<std::mutex> guard(sc.lock);
+    if (!sc.span_count) {
+      continue;
+    }
+    size_t free_count = 0;
+    for (auto span : sc.partial) {
+      free_count += span->free_objects.size();
+    }
+    XELOGI("  class %5db: %4d spans, %6lld free objects", sc.object_size,
+           sc.span_count, static_cast<uint64_t>(free_count));
+  }
+  std::lock_guard<std::mutex> guard(page_lock_);
+  size_t large_pages = 0;
+  for (auto& it : large_objects_) {
+    large_pages += it.second;
+  }
+  size_t free_pages = 0;
+  for (auto& it : free_runs_) {
+    free_pages += it.second;
+  }
+  XELOGI("  large: %lld objects, %lldb", static_cast<uint64_t>(
+      large_objects_.size()), static_cast<uint64_t>(large_pages * kPageSize));
+  XELOGI("   free: %lld runs, %lldb", static_cast<uint64_t>(free_runs_.size()),
+         static_cast<uint64_t>(free_pages * kPageSize));
+}
+
+}  // namespace xe
@@ -0,0 +1,146 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_SLAB_HEAP_H_
+#define XENIA_SLAB_HEAP_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace xe {
+
+// Allocator for a guest heap range that commits memory as it goes.
+//
+// Small requests are rounded to a size class and carved out of 64KB spans,
+// with freed objects parked in a per-thread cache so that most alloc/free
+// pairs never take a lock. Each size class has its own lock for refilling
+// and flushing those caches. Larger requests are page granular runs taken
+// best-fit from the free page map. Pages are committed and decommitted with
+// no locks held. All bookkeeping lives on the host, so guest overruns can't
+// corrupt the heap itself.
+class SlabHeap {
+ public:
+  // Called to commit (or decommit) pages before they are handed out (or
+  // after they are released). Returns false on failure.
+  typedef bool (*CommitCallback)(void* context, uint8_t* p, size_t length,
+                                 bool commit);
+
+  static const size_t kPageSize = 4 * 1024;
+  static const size_t kSpanSize = 64 * 1024;
+  static const size_t kMaxSmallSize = 8 * 1024;
+
+  SlabHeap(uint8_t* base, size_t size, CommitCallback commit_callback,
+           void* callback_context);
+  ~SlabHeap();
+
+  // Alignment must be a power of two. Returns NULL when out of memory.
+  // If zero is set the memory is cleared, though page runs that haven't
+  // been touched since they were (re)committed are left to the OS zero fill.
+  uint8_t* Alloc(size_t size, size_t alignment, bool zero);
+  // Returns the usable size of the allocation, or 0 if p isn't one.
+  size_t Free(uint8_t* p);
+  size_t QuerySize(uint8_t* p);
+
+  // Returns anything cached by the calling thread to the heap. Threads
+  // should call this before exiting.
+  void ReleaseThreadCache();
+
+  void Dump();
+
+ private:
+  struct Span {
+    uint32_t offset;
+    uint32_t size_class;
+    uint32_t object_size;
+    uint32_t capacity;
+    // Position in the size class partial list, or -1 if full.
+    int32_t partial_index;
+    std::vector<uint16_t> free_objects;
+  };
+  struct SizeClass {
+    std::mutex lock;
+    uint32_t object_size;
+    uint32_t cache_limit;
+    // Spans with at least one free object.
+    std::vector<Span*> partial;
+    uint32_t span_count;
+  };
+  struct ThreadCache {
+    std::thread::id owner;
+    std::vector<uint8_t*>* objects;
+  };
+
+  static int SizeClassForRequest(size_t size, size_t alignment);
+
+  ThreadCache* GetThreadCache();
+  void FlushThreadCache(ThreadCache* cache, uint32_t size_class,
+                        size_t keep_count);
+
+  uint8_t* AllocSmall(uint32_t size_class);
+  void FreeSmall(Span* span, uint8_t* p);
+  // Takes the size class lock, dropping it while committing new spans.
+  void RefillThreadCache(ThreadCache* cache, uint32_t size_class);
+  // Must hold the size class lock. Returns the span if it is now empty and
+  // has been unlinked, for the caller to free once the lock is dropped.
+  Span* ReleaseObject(SizeClass& size_class, Span* span, uint8_t* p);
+  Span* AllocSpan(uint32_t size_class);
+  void FreeSpan(Span* span);
+
+  uint8_t* AllocLarge(size_t size, size_t alignment, bool zero);
+  size_t FreeLarge(uint8_t* p);
+
+  // [start, end) page ranges that may hold stale data.
+  typedef std::vector<std::pair<uint32_t, uint32_t>> DirtyRuns;
+
+  // These take the page lock, but commit and decommit outside of it.
+  // Allocated pages are marked dirty, and any that already were are added to
+  // out_dirty_runs.
+  uint32_t AllocPages(uint32_t page_count, uint32_t page_alignment,
+                      DirtyRuns* out_dirty_runs = nullptr);
+  void FreePages(uint32_t page, uint32_t page_count);
+  // These must hold the page lock.
+  void MergeFreeRun(uint32_t page, uint32_t page_count);
+  void InsertFreeRun(uint32_t page, uint32_t page_count);
+  void EraseFreeRun(uint32_t page, uint32_t page_count);
+
+  uint8_t* base_;
+  size_t size_;
+  CommitCallback commit_callback_;
+  void* callback_context_;
+  uint32_t serial_;
+
+  std::vector<SizeClass> size_classes_;
+  // One entry per span sized chunk of the heap, set when it holds a slab.
+  // Read without locks by Free and QuerySize.
+  std::vector<std::atomic<Span*>> span_map_;
+
+  std::mutex page_lock_;
+  // First page -> page count.
+  std::map<uint32_t, uint32_t> free_runs_;
+  // The same runs as page count -> first page, for best fit.
+  std::set<std::pair<uint32_t, uint32_t>> free_runs_by_size_;
+  std::unordered_map<uint32_t, uint32_t> large_objects_;
+  // Nonzero for each page that may have been written since it was last
+  // decommitted. Clean pages read as zero.
+  std::vector<uint8_t> dirty_pages_;
+
+  std::mutex cache_lock_;
+  std::vector<ThreadCache*> thread_caches_;
+};
+
+}  // namespace xe
+
+#endif  // XENIA_SLAB_HEAP_H_
@@ -0,0 +1,106 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <poly/main.h>
+#include <poly/poly.h>
+#include <xenia/memory.h>
+
+DEFINE_int32(bench_threads, 4, "Number of threads allocating at once.");
+DEFINE_int32(bench_iterations, 200000, "Alloc/free operations per thread.");
+DEFINE_int32(bench_live_count, 512,
+             "Allocations each thread keeps live at a time.");
+DEFINE_bool(bench_physical, false, "Allocate from the physical heap.");
+
+DECLARE_bool(heap_use_mspace);
+
+namespace xe {
+namespace heap_bench {
+
+// Roughly what titles ask for: mostly small objects, some buffers and the
+// occasional large block.
+size_t RandomSize(std::mt19937& rng) {
+  uint32_t bucket = rng() % 100;
+  if (bucket < 80) {
+    return 16 + rng() % 240;
+  } else if (bucket < 95) {
+    return 256 + rng() % (4096 - 256);
+  } else {
+    return 4096 + rng() % (64 * 1024 - 4096);
+  }
+}
+
+void ThreadEntry(Memory* memory, uint32_t seed) {
+  uint32_t flags = FLAGS_bench_physical ? MEMORY_FLAG_PHYSICAL : 0;
+  std::mt19937 rng(seed);
+  std::vector<uint64_t> live(FLAGS_bench_live_count, 0);
+  for (int n = 0; n < FLAGS_bench_iterations; n++) {
+    auto& slot = live[rng() % live.size()];
+    if (slot) {
+      memory->HeapFree(slot, 0);
+      slot = 0;
+    } else {
+      slot = memory->HeapAlloc(0, RandomSize(rng), flags);
+    }
+  }
+  for (auto address : live) {
+    if (address) {
+      memory->HeapFree(address, 0);
+    }
+  }
+  memory->ReleaseHeapCaches();
+}
+
+double Run(bool use_mspace) {
+  FLAGS_heap_use_mspace = use_mspace;
+  auto memory = std::make_unique<Memory>();
+  if (memory->Initialize()) {
+    PFATAL("Unable to initialize memory");
+    return 0;
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<std::thread> threads;
+  for (int n = 0; n < FLAGS_bench_threads; n++) {
+    threads.emplace_back(ThreadEntry, memory.get(), n + 1);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  double seconds = std::chrono::duration<double>(end - start).count();
+  double ops = double(FLAGS_bench_threads) * FLAGS_bench_iterations;
+  std::printf("%-8s %8.3fs %12.0f ops/s\n", use_mspace ? "mspace" : "slab",
+              seconds, ops / seconds);
+  return seconds;
+}
+
+int main(std::vector<std::wstring>& args) {
+  std::printf("%d threads x %d ops, %d live, %s heap\n", FLAGS_bench_threads,
+              FLAGS_bench_iterations, FLAGS_bench_live_count,
+              FLAGS_bench_physical ? "physical" : "virtual");
+  double mspace_seconds = Run(true);
+  double slab_seconds = Run(false);
+  std::printf("speedup: %.2fx\n", mspace_seconds / slab_seconds);
+  return 0;
+}
+
+}  // namespace heap_bench
+}  // namespace xe
+
+DEFINE_ENTRY_POINT(L"xenia-heap-bench", L"xenia-heap-bench",
+                   xe::heap_bench::main);
@@ -0,0 +1,170 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2014 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <poly/main.h>
+#include <poly/poly.h>
+#include <xenia/memory.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // __linux__
+
+DEFINE_int32(bench_range_mb, 256,
+             "Size of the guest range loaded from, in MB (physical heap).");
+DEFINE_int32(bench_loads, 50000000, "Random loads per run.");
+
+DECLARE_bool(memory_large_pages);
+
+namespace xe {
+namespace tlb_bench {
+
+#if defined(__linux__)
+// Counts data TLB load misses of the calling thread.
+class TlbMissCounter {
+ public:
+  TlbMissCounter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+  ~TlbMissCounter() {
+    if (fd_ != -1) {
+      close(fd_);
+    }
+  }
+
+  bool is_valid() const { return fd_ != -1; }
+
+  void Start() {
+    if (fd_ != -1) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+  uint64_t Stop() {
+    uint64_t count = 0;
+    if (fd_ != -1) {
+      ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+    return count;
+  }
+
+ private:
+  int fd_;
+};
+#else
+// The TLB counters aren't reachable from user mode here, so only time.
+class TlbMissCounter {
+ public:
+  bool is_valid() const { return false; }
+  void Start() {}
+  uint64_t Stop() { return 0; }
+};
+#endif  // __linux__
+
+volatile uint32_t sink_;
+
+struct Result {
+  double seconds;
+  uint64_t tlb_misses;
+};
+
+Result Run(bool large_pages) {
+  FLAGS_memory_large_pages = large_pages;
+  auto memory = std::make_unique<Memory>();
+  if (memory->Initialize()) {
+    PFATAL("Unable to initialize memory");
+    return Result();
+  }
+
+  size_t range = size_t(FLAGS_bench_range_mb) * 1024 * 1024;
+  uint64_t address =
+      memory->HeapAlloc(0, range, MEMORY_FLAG_PHYSICAL, 2 * 1024 * 1024);
+  if (!address) {
+    PFATAL("Unable to allocate %dMB", FLAGS_bench_range_mb);
+    return Result();
+  }
+  // Fault everything in up front so only the loads are measured.
+  std::memset(memory->Translate(address), 1, range);
+
+  // Dependent loads from random offsets, addressed the way generated code
+  // does (membase + guest address).
+  uint8_t* membase = memory->membase();
+  uint32_t x = 2463534242u;
+  TlbMissCounter counter;
+  auto start = std::chrono::high_resolution_clock::now();
+  counter.Start();
+  for (int n = 0; n < FLAGS_bench_loads; n++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    uint32_t offset = static_cast<uint32_t>((uint64_t(x) * range) >> 32) & ~3;
+    x += *reinterpret_cast<uint32_t*>(membase + address + offset);
+  }
+  Result result;
+  result.tlb_misses = counter.Stop();
+  auto end = std::chrono::high_resolution_clock::now();
+  result.seconds = std::chrono::duration<double>(end - start).count();
+  sink_ = x;
+
+  memory->HeapFree(address, 0);
+
+  std::printf("%-6s %8.3fs %8.2f ns/load", large_pages ? "large" : "small",
+              result.seconds, result.seconds * 1e9 / FLAGS_bench_loads);
+  if (counter.is_valid()) {
+    std::printf(" %14lld dTLB misses (%.3f/load)",
+                static_cast<uint64_t>(result.tlb_misses),
+                double(result.tlb_misses) / FLAGS_bench_loads);
+  }
+  std::printf("\n");
+  return result;
+}
+
+int main(std::vector<std::wstring>& args) {
+  std::printf("%d random loads over %dMB\n", FLAGS_bench_loads,
+              FLAGS_bench_range_mb);
+  if (!TlbMissCounter().is_valid()) {
+    std::printf("(dTLB miss counter unavailable, timing only)\n");
+  }
+  Result small = Run(false);
+  Result large = Run(true);
+  std::printf("speedup: %.2fx\n", small.seconds / large.seconds);
+  if (large.tlb_misses) {
+    std::printf("dTLB misses: %.2fx fewer\n",
+                double(small.tlb_misses) / large.tlb_misses);
+  }
+  return 0;
+}
+
+}  // namespace tlb_bench
+}  // namespace xe
+
+DEFINE_ENTRY_POINT(L"xenia-tlb-bench", L"xenia-tlb-bench",
+                   xe::tlb_bench::main);